@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Host-side helper for the binary bucket log (/data/YYYYMMDD.bkt).
+
+  convert <data_dir>        write a .bkt next to every YYYYMMDD.csv that lacks one
+  dump <file.bkt>           print a .bkt file as the equivalent CSV
+  bench [--days N]          synthesize N days (default 365), then time the boot
+                            loaders' work (last 24h + per-day summaries) from CSV
+                            versus the binary log
+
+The layout must match BktHeader/BktRecord/BktFooter in weather_station.ino.
+"""
+
+import argparse
+import math
+import os
+import random
+import struct
+import sys
+import tempfile
+import time
+
+HEADER = struct.Struct("<4sHHII")      # magic, version, recordSize, bucketSeconds, dayStartEpoch
+RECORD = struct.Struct("<I8fI")        # epoch, 8 floats, samples
+FOOTER = struct.Struct("<4sIIII")      # magic, count, minEpoch, maxEpoch, flags
+VERSION = 1
+FLAG_SORTED = 0x1
+CSV_HEADER = "datetime,epoch,wind_avg_ms,wind_max_ms,temp_c,hum_rh,press_hpa,pm1,pm25,pm10,samples"
+NAN = float("nan")
+
+
+def parse_float(s):
+    s = s.strip()
+    if not s or s in ("nan", "NaN", "NAN", "null", "NULL", "-", "--"):
+        return NAN
+    if not (s[0] in "-." or s[0].isdigit()):
+        return NAN
+    try:
+        return float(s)
+    except ValueError:
+        return NAN
+
+
+def parse_csv_rows(path):
+    """Same column tolerance as the firmware: 8 (legacy) to 11 columns."""
+    rows = []
+    with open(path, "r", newline="") as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("datetime"):
+                continue
+            p = line.split(",")
+            if len(p) < 8:
+                continue
+            try:
+                epoch = int(p[1])
+            except ValueError:
+                continue
+            vals = [parse_float(p[i]) for i in range(2, 7)]
+            pm = [parse_float(p[i]) if len(p) > i else NAN for i in (7, 8, 9)]
+            try:
+                samples = max(0, int(p[10] if len(p) > 10 else p[7]))
+            except ValueError:
+                samples = 0
+            rows.append((epoch, *vals, *pm, samples))
+    return rows
+
+
+def write_bkt(path, rows, bucket_seconds=60, day_start=0):
+    flags = FLAG_SORTED
+    for a, b in zip(rows, rows[1:]):
+        if b[0] <= a[0]:
+            flags = 0
+            break
+    epochs = [r[0] for r in rows]
+    with open(path, "wb") as f:
+        f.write(HEADER.pack(b"WSBK", VERSION, RECORD.size, bucket_seconds, day_start))
+        for r in rows:
+            f.write(RECORD.pack(*r))
+        f.write(FOOTER.pack(b"WSBF", len(rows), min(epochs, default=0xFFFFFFFF),
+                            max(epochs, default=0), flags))
+
+
+def read_bkt(path, from_epoch=0):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, rsize, _, _ = HEADER.unpack_from(data, 0)
+    if magic != b"WSBK" or version != VERSION or rsize != RECORD.size:
+        raise ValueError("%s: not a bucket log" % path)
+    fmagic, count, min_e, max_e, flags = FOOTER.unpack_from(data, len(data) - FOOTER.size)
+    if fmagic != b"WSBF":
+        count = (len(data) - HEADER.size) // RECORD.size
+        flags = 0
+    if from_epoch and count and max_e < from_epoch:
+        return []
+    first = 0
+    if flags & FLAG_SORTED and from_epoch:
+        lo, hi = 0, count
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if struct.unpack_from("<I", data, HEADER.size + mid * RECORD.size)[0] < from_epoch:
+                lo = mid + 1
+            else:
+                hi = mid
+        first = lo
+    out = list(RECORD.iter_unpack(data[HEADER.size + first * RECORD.size:HEADER.size + count * RECORD.size]))
+    return [r for r in out if r[0] >= from_epoch]
+
+
+def day_start_from_name(name):
+    t = time.strptime(name[:8], "%Y%m%d")
+    return int(time.mktime(t))
+
+
+def cmd_convert(args):
+    n = 0
+    for name in sorted(os.listdir(args.data_dir)):
+        if not (name.endswith(".csv") and name[:8].isdigit()):
+            continue
+        bkt = os.path.join(args.data_dir, name[:-4] + ".bkt")
+        if os.path.exists(bkt) and not args.force:
+            continue
+        rows = parse_csv_rows(os.path.join(args.data_dir, name))
+        write_bkt(bkt, rows, args.bucket_seconds, day_start_from_name(name))
+        n += 1
+    print("converted %d file(s)" % n)
+
+
+def fmt(v, prec):
+    return "nan" if math.isnan(v) else "%.*f" % (prec, v)
+
+
+def cmd_dump(args):
+    print(CSV_HEADER)
+    for r in read_bkt(args.file):
+        pm = ["" if math.isnan(v) else "%.1f" % v for v in r[6:9]]
+        print(",".join([time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(r[0])), str(r[0]),
+                        fmt(r[1], 3), fmt(r[2], 3), fmt(r[3], 2), fmt(r[4], 2), fmt(r[5], 2),
+                        *pm, str(r[9])]))
+
+
+def synthesize(data_dir, days, bucket_seconds=60):
+    random.seed(1)
+    now = int(time.time()) // 86400 * 86400
+    for d in range(days, -1, -1):
+        start = now - d * 86400
+        rows = []
+        for t in range(start, start + 86400, bucket_seconds):
+            w = abs(3 + 2 * math.sin(t / 3600.0) + random.random())
+            rows.append((t, w, w * 1.5, 15 + 5 * math.sin(t / 7200.0), 60.0, 1013.2, 3.0, 5.0, 8.0, 60))
+        name = time.strftime("%Y%m%d", time.localtime(start))
+        with open(os.path.join(data_dir, name + ".csv"), "w") as f:
+            f.write(CSV_HEADER + "\n")
+            for r in rows:
+                f.write("%s,%d,%.3f,%.3f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%d\n" % (
+                    time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(r[0])), *r))
+        write_bkt(os.path.join(data_dir, name + ".bkt"), rows, bucket_seconds, start)
+
+
+def cmd_bench(args):
+    with tempfile.TemporaryDirectory() as tmp:
+        print("synthesizing %d days..." % args.days)
+        synthesize(tmp, args.days)
+        names = sorted(n[:-4] for n in os.listdir(tmp) if n.endswith(".csv"))
+        cutoff = int(time.time()) - 86400
+
+        def boot(ext, loader):
+            t0 = time.perf_counter()
+            nbytes = rows = 0
+            for i, n in enumerate(names):
+                path = os.path.join(tmp, n + ext)
+                nbytes += os.path.getsize(path)
+                # summaries read every day; the 24h loader only the last two
+                rows += len(loader(path, 0))
+                if i >= len(names) - 2:
+                    rows += len(loader(path, cutoff))
+            return time.perf_counter() - t0, nbytes, rows
+
+        def csv_loader(path, from_epoch):
+            return [r for r in parse_csv_rows(path) if r[0] >= from_epoch]
+
+        for label, ext, loader in (("csv", ".csv", csv_loader), ("bkt", ".bkt", read_bkt)):
+            secs, nbytes, rows = boot(ext, loader)
+            print("%-4s %8.1f MB  %9d rows  %7.2f s  %10.0f rows/s" % (
+                label, nbytes / 1e6, rows, secs, rows / secs if secs else 0))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    c = sub.add_parser("convert")
+    c.add_argument("data_dir")
+    c.add_argument("--bucket-seconds", type=int, default=60)
+    c.add_argument("--force", action="store_true", help="overwrite existing .bkt files")
+    c.set_defaults(fn=cmd_convert)
+    d = sub.add_parser("dump")
+    d.add_argument("file")
+    d.set_defaults(fn=cmd_dump)
+    b = sub.add_parser("bench")
+    b.add_argument("--days", type=int, default=365)
+    b.set_defaults(fn=cmd_bench)
+    args = ap.parse_args()
+    args.fn(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
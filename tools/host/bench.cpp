@@ -0,0 +1,237 @@
+// Boot, bucket and endpoint costs of the sketch on a card with N days of history.
+//
+//   ./bench --sd bench-sd --days 30
+//
+// Each phase runs in its own process so it starts from a fresh boot:
+//   generate   N synthetic days (and today up to the start time) written with
+//              the sketch's own writeBucketsToDay(), so files match a real card
+//   cold boot  no days.idx yet: setup() and the history load until every
+//              BootLoad stage is done
+//   warm boot  the same with the index the cold boot wrote
+//   finalize   host time of each drainClosedBuckets() that committed a bucket
+//              (RAM ring, rollups, day aggregates, SD buffer and flushes)
+//   endpoints  median render time (host time spent in loop() until the response
+//              was complete), size and heap allocations per request
+//
+// Times are host times, so compare runs on the same machine rather than
+// reading them as board milliseconds. SD opens count files and directories.
+//
+// Options: --sd DIR (default bench-sd), --days N (30), --hours H of finalize (3),
+//          --reps R per endpoint (5), --keep (reuse the card from a previous run)
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const time_t kStart = 1765764000;  // 2025-12-15 02:00 UTC, noon at the default timezone
+int gGenDays = 30;
+int gHours = 3;
+int gReps = 5;
+
+double msSince(Clock::time_point t0) { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); }
+
+template <typename T>
+T percentile(std::vector<T> v, double p) {
+  if (v.empty()) return T();
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p * (double)(v.size() - 1) + 0.5)];
+}
+
+// Runs fn in a child process; false if it failed
+template <typename Fn>
+bool phase(Fn fn) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    fn();
+    fflush(stdout);
+    _Exit(0);  // the acquisition thread is still parked: skip static destructors
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void startClock() {
+  setenv("HOST_QUIET", "1", 1);
+  setenv("TZ", NetworkConfig::TIMEZONE, 1);
+  tzset();
+  host::setWall(kStart);
+}
+
+BucketSample syntheticBucket(time_t t) {
+  host::Weather w = host::weatherAt((double)t);
+  BucketSample b;
+  b.startEpoch = t;
+  b.avgWind = w.windMs;
+  b.maxWind = w.windMs * 1.45f;
+  b.samples = LogConfig::BUCKET_SECONDS;
+  b.avgTempC = w.tempC;
+  b.avgHumRH = w.humRH;
+  b.avgPressHpa = w.pressurePa / 100.0f + 12.0f;  // sea-level
+  b.avgPM1 = w.pm1;
+  b.avgPM25 = w.pm25;
+  b.avgPM10 = w.pm10;
+  b.windStd = NAN;
+  return b;
+}
+
+void generate() {
+  startClock();
+  initSD();
+  static BucketSample day[86400 / LogConfig::BUCKET_SECONDS];
+  const time_t today = localMidnight(kStart);
+  for (int d = gGenDays; d >= 0; d--) {
+    time_t mid = subtractDaysLocalMidnight(today, d);
+    time_t end = d ? mid + 86400 : floorToBucketBoundaryLocal(kStart);
+    int n = 0;
+    for (time_t t = mid; t < end; t += LogConfig::BUCKET_SECONDS) day[n++] = syntheticBucket(t);
+    if (!writeBucketsToDay(mid, BucketRun::of(day, n), false)) {
+      fprintf(stderr, "bench: cannot write %s\n", ymdString(mid).c_str());
+      _Exit(1);
+    }
+  }
+  printf("generated %d days + today in %s\n", gGenDays, host::sdRoot().c_str());
+}
+
+// setup() and loop() until the history is loaded; prints one row
+void bootRow(const char* label) {
+  startClock();
+  auto t0 = Clock::now();
+  host::boot();
+  const double setupMs = msSince(t0);
+  const uint64_t opens0 = host::sdOpens();
+  double stageMs[BOOT_LOAD_COUNT] = {};
+  auto tHist = Clock::now();
+  int stage = gBoot.stage;
+  auto tStage = tHist;
+  for (int i = 0; i < 60000 && !bootLoadDone(); i++) {
+    host::advance(20);
+    host::loopOnce();
+    if (gBoot.stage != stage) {
+      stageMs[stage] = msSince(tStage);
+      stage = gBoot.stage;
+      tStage = Clock::now();
+    }
+  }
+  const double histMs = msSince(tHist);
+  printf("%-10s %9.1f %9.1f %8u %9llu %7.1f %7.1f %7.1f %7.1f\n", label, setupMs, histMs,
+         (unsigned)(gBoot.historyMs - gBoot.httpReadyMs), (unsigned long long)(host::sdOpens() - opens0),
+         stageMs[BOOT_LOAD_DAYS], stageMs[BOOT_LOAD_BUCKETS], stageMs[BOOT_LOAD_ROLLUPS], stageMs[BOOT_LOAD_FILES]);
+  if (!bootLoadDone()) printf("%-10s history load did not finish\n", label);
+}
+
+void bootAndLoad() {
+  startClock();
+  host::boot();
+  for (int i = 0; i < 60000 && !bootLoadDone(); i++) host::run(20);
+}
+
+void finalizeRow() {
+  bootAndLoad();
+  std::vector<double> us;
+  const uint64_t opens0 = host::sdOpens();
+  const uint64_t steps = (uint64_t)gHours * 3600 * 1000 / 20;
+  for (uint64_t i = 0; i < steps; i++) {
+    host::advance(20);
+    const time_t newest = gBucketRing.newestEpoch();
+    auto t0 = Clock::now();
+    drainClosedBuckets();
+    const double dt = msSince(t0) * 1000.0;
+    if (gBucketRing.newestEpoch() != newest) us.push_back(dt);
+    host::loopOnce();
+  }
+  printf("%zu buckets: median %.1f us, p90 %.1f us, max %.1f us, %.1f SD opens per bucket\n", us.size(),
+         percentile(us, 0.5), percentile(us, 0.9), percentile(us, 1.0),
+         us.empty() ? 0.0 : (double)(host::sdOpens() - opens0) / (double)us.size());
+}
+
+void endpointRows() {
+  bootAndLoad();
+  host::run(10 * 60000);
+  const String yesterday = ymdString(subtractDaysLocalMidnight(localMidnight(host::wallNow()), 1));
+  const std::string targets[] = {
+      "/api/now",
+      "/api/buckets",
+      "/api/buckets_compact",
+      "/api/buckets.bin",
+      "/api/series?from=" + std::to_string(host::wallNow() - 30 * 86400),
+      "/api/days",
+      "/api/histogram",
+      "/api/range",
+      "/api/config",
+      "/api/files?dir=data",
+      "/api/metrics",
+      std::string("/download?filename=") + yesterday.c_str() + ".csv",
+      "/download_zip?days=7",
+  };
+  for (const std::string& t : targets) {
+    std::vector<double> ms;
+    int status = 0;
+    size_t bytes = 0;
+    bool complete = false;
+    uint64_t allocs = 0;
+    for (int r = 0; r < gReps; r++) {
+      const uint64_t allocs0 = host::allocations();
+      host::Response resp = host::request(t);
+      allocs += host::allocations() - allocs0;
+      ms.push_back(resp.renderMs);
+      status = resp.status;
+      bytes = resp.body.size();
+      complete = resp.complete;
+      host::run(1000);  // a second between requests, like a polling UI
+    }
+    printf("%-34s %4d %9zu %9.2f %9.0f%s\n", t.substr(0, 34).c_str(), status, bytes,
+           percentile(ms, 0.5), (double)allocs / gReps, complete ? "" : "  (incomplete)");
+  }
+}
+
+[[noreturn]] void usage() {
+  fprintf(stderr, "usage: bench [--sd DIR] [--days N] [--hours H] [--reps R] [--keep]\n");
+  exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool keep = false;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--keep") { keep = true; continue; }
+    if (i + 1 >= argc) usage();
+    if (a == "--sd") host::setSdRoot(argv[++i]);
+    else if (a == "--days") gGenDays = atoi(argv[++i]);
+    else if (a == "--hours") gHours = atoi(argv[++i]);
+    else if (a == "--reps") gReps = atoi(argv[++i]);
+    else usage();
+  }
+  if (host::sdRoot() == "sd") host::setSdRoot("bench-sd");
+
+  if (!keep) {
+    std::string rm = "rm -rf '" + host::sdRoot() + "'";
+    if (system(rm.c_str()) != 0) return 1;
+    if (!phase(generate)) return 1;
+  }
+
+  printf("\n%-10s %9s %9s %8s %9s %7s %7s %7s %7s\n", "boot", "setup_ms", "hist_ms", "sim_ms", "sd_opens",
+         "days", "buckets", "rollups", "files");
+  std::string idx = host::sdRoot() + "/data/days.idx";
+  if (!keep) remove(idx.c_str());
+  phase([] { bootRow(access((host::sdRoot() + "/data/days.idx").c_str(), F_OK) ? "cold" : "warm"); });
+  phase([] { bootRow("warm"); });
+
+  printf("\nfinalize (%d h)\n", gHours);
+  phase(finalizeRow);
+
+  printf("\n%-34s %4s %9s %9s %9s\n", "endpoint", "code", "bytes", "render_ms", "allocs");
+  phase(endpointRows);
+  return 0;
+}
@@ -0,0 +1,290 @@
+// CsvReader / csvFloat / csvInt against the String-based parser they replaced
+// (readStringUntil + trim + splitCSVLine + parseFloatOrNan), then a timing of
+// both on day files.
+//
+//   ./csvfuzz                 fixed cases + 300 random files, then the bench
+//   ./csvfuzz --files 5000    more random files
+//   ./csvfuzz --seed 7        another random sequence
+//   ./csvfuzz --days 100      parses of the day file in the bench (default 30)
+//
+// Random files mix CRLF and LF, blank and whitespace-only lines, 1 to 24
+// columns, nan/null/-/-- markers, padded and malformed numbers, lines longer
+// than the read buffer and a missing final newline. Every row is compared
+// field by field: the reader must produce the same rows as the reference,
+// minus the lines longer than CSV_READ_BUF_SIZE (which it skips by design).
+// Exits non-zero on the first mismatch and prints the file and row.
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Row {
+  int numCols = 0;
+  std::vector<std::string> fields;  // what the old parser handed to toInt()/parseFloatOrNan()
+};
+
+// ------------------- reference: the pre-CsvReader parser -------------------
+
+float refParseFloatOrNan(const String& s) {
+  if (!s.length()) return NAN;
+  String trimmed = s;
+  trimmed.trim();
+  if (!trimmed.length()) return NAN;
+  if (trimmed == "nan" || trimmed == "NaN" || trimmed == "NAN") return NAN;
+  if (trimmed == "null" || trimmed == "NULL") return NAN;
+  if (trimmed == "-" || trimmed == "--") return NAN;
+  char first = trimmed.charAt(0);
+  if (first != '-' && first != '.' && !isdigit(first)) return NAN;
+  return trimmed.toFloat();
+}
+
+void refSplitCSVLine(const String& line, String parts[], int expectedParts) {
+  int start = 0;
+  int idx = 0;
+  while (idx < expectedParts - 1) {
+    int comma = line.indexOf(',', start);
+    if (comma < 0) break;
+    parts[idx++] = line.substring(start, comma);
+    start = comma + 1;
+  }
+  parts[idx++] = line.substring(start);
+}
+
+std::vector<Row> refParse(const char* path, int maxParts) {
+  std::vector<Row> rows;
+  File f = hal::storage().open(path, FILE_READ);
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    const bool tooLong = line.length() >= CSV_READ_BUF_SIZE;
+    line.trim();
+    if (!line.length() || tooLong) continue;
+    int commas = 0;
+    for (unsigned i = 0; i < line.length(); i++) commas += line[i] == ',';
+    Row r;
+    r.numCols = commas + 1;
+    const int n = r.numCols < maxParts ? r.numCols : maxParts;
+    std::vector<String> parts(n);
+    refSplitCSVLine(line, parts.data(), n);
+    for (const String& p : parts) r.fields.push_back(p.s);
+    rows.push_back(r);
+  }
+  return rows;
+}
+
+// ------------------- cases -------------------
+
+std::mt19937 gRng;
+
+int pick(int n) { return (int)(gRng() % (uint32_t)n); }
+
+std::string randomField() {
+  static const char* const kOdd[] = {"nan", "NaN", "NAN", "null", "NULL", "-", "--", " 1.5 ", "\t2.25", "abc",
+                                     "1e3", "-.5", ".", " ", "+4", "-x", "0x10", "12abc", "  -3.75\t", "inf"};
+  char b[32];
+  switch (pick(10)) {
+    case 0: return "";
+    case 1: return kOdd[pick(sizeof(kOdd) / sizeof(kOdd[0]))];
+    case 2: snprintf(b, sizeof(b), "%d", pick(200000) - 100000); return b;
+    default: snprintf(b, sizeof(b), "%.*f", pick(4), (pick(200000) - 50000) / 1000.0); return b;
+  }
+}
+
+std::string randomFile() {
+  std::string out;
+  if (pick(2)) out += std::string(CSV_HEADER) + (pick(2) ? "\r\n" : "\n");
+  const int lines = 1 + pick(400);
+  uint32_t epoch = 1764547200u + (uint32_t)pick(86400);
+  for (int i = 0; i < lines; i++) {
+    std::string line;
+    const int kind = pick(100);
+    if (kind < 3) {
+      line = "";
+    } else if (kind < 5) {
+      line = pick(2) ? "   " : "\t \r";
+    } else if (kind < 7) {
+      line = std::string(CSV_READ_BUF_SIZE - 8 + pick(3000), pick(2) ? ' ' : 'x') + ",1,2,3";
+    } else {
+      const int cols = 1 + pick(24);
+      line = "2025-12-01 10:00:00";
+      for (int c = 1; c < cols; c++) {
+        line += ',';
+        if (c == 1 && pick(10)) line += std::to_string(epoch);
+        else line += randomField();
+      }
+      epoch += 60;
+      if (pick(20) == 0) line = " " + line;
+    }
+    const bool last = i == lines - 1;
+    out += line;
+    if (!last || pick(3)) out += pick(3) ? "\n" : "\r\n";
+  }
+  return out;
+}
+
+const char* const kFixedCases[] = {
+    "",
+    "\n\n\r\n",
+    "datetime,epoch\n",
+    "x,1764547200,1.5,2.5,20.1,55,1013.2\n",                                   // 7 columns (legacy)
+    "x,1764547200,1.5,2.5,20.1,55,1013.2,60\n",                                // 8 columns (legacy, samples)
+    "x,1764547200,1.5,2.5,20.1,55,1013.2,3,5,8,60\r\n",                        // current layout, CRLF
+    "x,1764547200,1.5,2.5,20.1,55,1013.2,,,,60",                               // blank PM, no final newline
+    "x,1764547200,nan,null,-,--,NaN,NULL,abc,.,60\n",                          // markers
+    "x,1764547200,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22\n",  // more than MAX_FIELDS
+    "  x,1764547200, 1.5 ,\t2.5,20.1 ,55,1013.2,3,5,8,60  \r\n",
+};
+
+bool sameFloat(float a, float b) { return (isnan(a) && isnan(b)) || a == b; }
+
+// Writes `text` to the card and compares the two parsers; false on a mismatch
+bool compareCase(const std::string& text, const char* label) {
+  {
+    File f = hal::storage().open("/fuzz.csv", FILE_WRITE);
+    f.write((const uint8_t*)text.data(), text.size());
+  }
+  const std::vector<Row> want = refParse("/fuzz.csv", CsvReader::MAX_FIELDS + 4);
+  File f = hal::storage().open("/fuzz.csv", FILE_READ);
+  CsvReader r(f);
+  size_t i = 0;
+  for (; r.nextRow(); i++) {
+    if (i >= want.size()) {
+      printf("%s: extra row %zu (%d columns, \"%.60s\")\n", label, i, r.numCols, r.field(0));
+      return false;
+    }
+    const Row& w = want[i];
+    if (r.numCols != w.numCols) {
+      printf("%s: row %zu has %d columns, expected %d\n", label, i, r.numCols, w.numCols);
+      return false;
+    }
+    for (int c = 0; c < w.numCols && c < CsvReader::MAX_FIELDS; c++) {
+      // Past MAX_FIELDS the old parser's last part held the rest of the line
+      const std::string& ref = w.fields[c];
+      const float a = csvFloat(r.field(c)), b = refParseFloatOrNan(String(ref));
+      const long ia = csvInt(r.field(c)), ib = String(ref).toInt();
+      if (!sameFloat(a, b) || ia != ib) {
+        printf("%s: row %zu field %d: \"%s\" -> %g / %ld, expected \"%s\" -> %g / %ld\n", label, i, c, r.field(c), a,
+               ia, ref.c_str(), b, ib);
+        return false;
+      }
+    }
+  }
+  if (i != want.size()) {
+    printf("%s: %zu rows, expected %zu\n", label, i, want.size());
+    return false;
+  }
+  return true;
+}
+
+// ------------------- bench -------------------
+
+template <typename Fn>
+void timeParser(const char* name, int days, Fn&& parse) {
+  const uint64_t allocs0 = host::allocations();
+  auto t0 = std::chrono::steady_clock::now();
+  size_t rows = 0;
+  for (int d = 0; d < days; d++) rows += parse();
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  printf("%-28s %8zu rows %9.1f ms %8.0f ns/row %8.1f allocs/row\n", name, rows, ms, ms * 1e6 / (double)rows,
+         (double)(host::allocations() - allocs0) / (double)rows);
+}
+
+void bench(int days) {
+  // A real day file: the sketch's own row format
+  std::string text = std::string(CSV_HEADER) + "\n";
+  char line[256];
+  for (int i = 0; i < 1440; i++) {
+    BucketSample b{};
+    b.startEpoch = 1764547200 + i * 60;
+    b.avgWind = 3.2f + (i % 17) * 0.11f;
+    b.maxWind = b.avgWind * 1.4f;
+    b.avgTempC = 14.0f + (i % 120) * 0.05f;
+    b.avgHumRH = 62.5f;
+    b.avgPressHpa = 1013.25f;
+    b.avgPM1 = 3;
+    b.avgPM25 = 5;
+    b.avgPM10 = 8;
+    b.samples = 60;
+    size_t n = formatBucketCsvRow(b, line, sizeof(line));
+    text.append(line, n);
+    text += '\n';
+  }
+  {
+    File f = hal::storage().open("/day.csv", FILE_WRITE);
+    f.write((const uint8_t*)text.data(), text.size());
+  }
+  printf("\n%d parses of a 1440-row day file (%zu bytes)\n", days, text.size());
+
+  timeParser("readStringUntil + split", days, [] {
+    size_t rows = 0;
+    File f = hal::storage().open("/day.csv", FILE_READ);
+    while (f.available()) {
+      String line = f.readStringUntil('\n');
+      line.trim();
+      if (!line.length() || line.startsWith("datetime")) continue;
+      String parts[11];
+      refSplitCSVLine(line, parts, 11);
+      BucketSample b;
+      b.startEpoch = (time_t)parts[1].toInt();
+      b.avgWind = refParseFloatOrNan(parts[2]);
+      b.avgPM10 = refParseFloatOrNan(parts[9]);
+      rows += timeIsValid(b.startEpoch);
+    }
+    return rows;
+  });
+  timeParser("CsvReader + csvRowToBucket", days, [] {
+    size_t rows = 0;
+    File f = hal::storage().open("/day.csv", FILE_READ);
+    CsvReader r(f);
+    while (r.nextRow()) {
+      if (strncmp(r.field(0), "datetime", 8) == 0) continue;
+      BucketSample b;
+      rows += csvRowToBucket(r, b) && timeIsValid(b.startEpoch);
+    }
+    return rows;
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int files = 300;
+  uint32_t seed = 1;
+  int days = 30;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--files")) files = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (uint32_t)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--days")) days = atoi(argv[i + 1]);
+  }
+  char dir[] = "/tmp/csvfuzz.XXXXXX";
+  if (!mkdtemp(dir)) return 1;
+  host::setSdRoot(dir);
+  gSdOk = hal::storage().begin();
+
+  int n = 0;
+  for (const char* c : kFixedCases) {
+    char label[32];
+    snprintf(label, sizeof(label), "fixed case %d", n++);
+    if (!compareCase(c, label)) return 1;
+  }
+  gRng.seed(seed);
+  for (int i = 0; i < files; i++) {
+    std::string text = randomFile();
+    char label[48];
+    snprintf(label, sizeof(label), "seed %u file %d", seed, i);
+    if (!compareCase(text, label)) {
+      printf("(the file is %s/fuzz.csv)\n", dir);
+      return 1;
+    }
+  }
+  printf("%d fixed cases and %d random files: CsvReader matches the old parser\n", n, files);
+
+  bench(days);
+  std::string rm = std::string("rm -rf ") + dir;
+  return system(rm.c_str()) == 0 ? 0 : 1;
+}
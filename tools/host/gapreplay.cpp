@@ -0,0 +1,270 @@
+// Replays wall-clock steps (NTP corrections after an outage) on the simulator
+// and checks the rows the gap fill leaves on the card.
+//
+//   ./gapreplay               every scenario
+//   ./gapreplay --keep        keep the scratch cards (printed) for a look
+//
+// Each scenario boots on a fresh card, logs, steps the clock (forward, back,
+// across midnight, past GAP_FILL_MAX_HOURS, across a DST change) and logs on.
+// For the first two seconds after each forward step it reports the host time
+// and SD opens loop() spent catching up. Then, for every day:
+//   - /data CSV, /backup CSV and .bkt hold the same epochs
+//   - epochs rise strictly, sit on bucket boundaries and belong to the day
+//   - across days the rows are contiguous, except the part of a jump older
+//     than GAP_FILL_MAX_HOURS, which must be missing
+//   - rows with no samples are exactly the buckets the jumps skipped
+// and the RAM ring must rise strictly. One scenario jumps while the card
+// refuses writes: that jump's rows must be missing and counted as dropped. Exits non-zero on the first failure.
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+constexpr time_t B = LogConfig::BUCKET_SECONDS;
+constexpr time_t kMaxSpan = (time_t)LogConfig::GAP_FILL_MAX_HOURS * 3600;
+bool gKeep = false;
+
+time_t floorB(time_t t) { return floorToBucketBoundaryLocal(t); }
+
+time_t localTime(int y, int mo, int d, int h, int mi, int s) {
+  struct tm t = {};
+  t.tm_year = y - 1900;
+  t.tm_mon = mo - 1;
+  t.tm_mday = d;
+  t.tm_hour = h;
+  t.tm_min = mi;
+  t.tm_sec = s;
+  t.tm_isdst = -1;
+  return mktime(&t);
+}
+
+// ------------------- driver -------------------
+// Tracks what the card must end up with while the clock moves
+
+struct Driver {
+  time_t maxWall = 0;           // buckets never reopen: the open one is floorB(maxWall)
+  uint32_t expectEmpty = 0;
+  uint32_t expectDropped = 0;
+  std::vector<std::pair<time_t, time_t>> holes;  // [from, to) older than GAP_FILL_MAX_HOURS
+
+  void run(uint32_t minutes) {
+    for (uint32_t m = 0; m < minutes; m++) {
+      host::run(60000);
+      maxWall = std::max(maxWall, host::wallNow());
+    }
+  }
+
+  // refuse: the card refuses writes until loop() has caught up
+  void step(long seconds, bool refuse = false) {
+    const time_t open = floorB(maxWall);
+    host::stepWall(seconds);
+    const time_t now = host::wallNow();
+    printf("  step %+ld s to %s", seconds, fmtLocal(now).c_str());
+    if (floorB(now) > open + B) {
+      const time_t end = floorB(now);
+      time_t first = open + B;
+      if (refuse) {
+        holes.push_back({first, end});
+        expectDropped += (uint32_t)((end - first) / B);
+      } else if (end - first > kMaxSpan) {
+        holes.push_back({first, floorB(end - kMaxSpan)});
+        first = floorB(end - kMaxSpan);
+      }
+      if (!refuse) expectEmpty += (uint32_t)((end - first) / B);
+
+      const uint64_t opens0 = host::sdOpens();
+      auto t0 = std::chrono::steady_clock::now();
+      host::setSdWritesFail(refuse);
+      host::run(2000);
+      host::setSdWritesFail(false);
+      const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+      const uint64_t opens = host::sdOpens() - opens0;
+      printf(": %ld empty buckets, caught up in %.1f ms host, %llu SD opens\n", (long)((end - first) / B), ms,
+             (unsigned long long)opens);
+      // One append per file per day touched, not one per bucket
+      long days = 1;
+      for (time_t mid = localMidnight(first); (mid = subtractDaysLocalMidnight(mid, -1)) < end;) days++;
+      if (opens > (uint64_t)(16 * days)) {
+        printf("  %llu SD opens for %ld day(s) of empty rows\n", (unsigned long long)opens, days);
+        _Exit(1);
+      }
+    } else {
+      printf("\n");
+    }
+    maxWall = std::max(maxWall, host::wallNow());
+  }
+};
+
+// ------------------- card check -------------------
+
+struct Row {
+  time_t epoch;
+  uint32_t samples;
+};
+
+bool fail(const char* fmt, const char* a, long b = 0) {
+  printf("  ");
+  printf(fmt, a, b);
+  printf("\n");
+  return false;
+}
+
+std::vector<time_t> csvEpochs(const String& path, std::vector<Row>* rows) {
+  std::vector<time_t> out;
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return out;
+  CsvReader r(f);
+  while (r.nextRow()) {
+    BucketSample b;
+    if (!csvRowToBucket(r, b) || !timeIsValid(b.startEpoch)) continue;  // header
+    out.push_back(b.startEpoch);
+    if (rows) rows->push_back({b.startEpoch, b.samples});
+  }
+  return out;
+}
+
+bool checkCard(const Driver& d) {
+  flushLogBuffer();
+  std::vector<String> names;
+  DIR* dir = opendir((host::sdRoot() + "/data").c_str());
+  if (!dir) return fail("%s: no /data", host::sdRoot().c_str());
+  while (dirent* e = readdir(dir)) {
+    std::string n = e->d_name;
+    if (n.size() == 12 && n.substr(8) == ".csv") names.push_back(String(n.substr(0, 8).c_str()));
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end(), [](const String& a, const String& b) { return strcmp(a.c_str(), b.c_str()) < 0; });
+
+  std::vector<Row> all;
+  for (const String& ymd : names) {
+    time_t mid;
+    if (!parseYmdFromPath("/data/" + ymd + ".csv", mid)) return fail("%s: bad day file name", ymd.c_str());
+    const time_t next = subtractDaysLocalMidnight(mid, -1);
+    std::vector<Row> rows;
+    const std::vector<time_t> data = csvEpochs("/data/" + ymd + ".csv", &rows);
+    const std::vector<time_t> backup = csvEpochs("/backup/" + ymd + ".csv", nullptr);
+    std::vector<time_t> bkt;
+    forEachBucketRecord(bktPathForDay(mid), 0, [&](const BucketSample& b) { bkt.push_back(b.startEpoch); });
+    if (data != backup) return fail("%s: /data and /backup CSVs differ", ymd.c_str());
+    if (data != bkt) return fail("%s: CSV and .bkt differ (%ld .bkt records)", ymd.c_str(), (long)bkt.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      if (data[i] < mid || data[i] >= next) return fail("%s: row %ld is not from this day", ymd.c_str(), (long)i);
+      if (floorB(data[i]) != data[i]) return fail("%s: row %ld is off the bucket grid", ymd.c_str(), (long)i);
+      if (i && data[i] <= data[i - 1]) return fail("%s: row %ld repeats or goes back", ymd.c_str(), (long)i);
+    }
+    printf("  %s  %4zu rows\n", ymd.c_str(), data.size());
+    all.insert(all.end(), rows.begin(), rows.end());
+  }
+
+  uint32_t empty = 0;
+  size_t hole = 0;
+  for (size_t i = 0; i < all.size(); i++) {
+    if (all[i].samples == 0) empty++;
+    if (i == 0 || all[i].epoch == all[i - 1].epoch + B) continue;
+    if (hole < d.holes.size() && all[i - 1].epoch + B == d.holes[hole].first && all[i].epoch == d.holes[hole].second) {
+      hole++;
+      continue;
+    }
+    return fail("rows jump from %s to %ld", fmtLocal(all[i - 1].epoch).c_str(), (long)all[i].epoch);
+  }
+  if (hole != d.holes.size()) return fail("%s: the gap older than GAP_FILL_MAX_HOURS was filled", "");
+  if (empty != d.expectEmpty) {
+    printf("  %u empty rows, expected %u\n", empty, d.expectEmpty);
+    return false;
+  }
+  if (gLogRowsDropped != d.expectDropped) {
+    printf("  %u rows dropped, expected %u\n", gLogRowsDropped, d.expectDropped);
+    return false;
+  }
+
+  time_t last = 0;
+  bool ringOk = true;
+  gBucketRing.forEach([&](const BucketSample& b) {
+    if (timeIsValid(b.startEpoch) && b.startEpoch <= last) ringOk = false;
+    if (timeIsValid(b.startEpoch)) last = b.startEpoch;
+  });
+  if (!ringOk) return fail("%s: RAM ring repeats or goes back", "");
+  printf("  %zu rows, %u empty, %zu hole(s): ok\n", all.size(), empty, d.holes.size());
+  return true;
+}
+
+// ------------------- scenarios -------------------
+
+struct Scenario {
+  const char* name;
+  int y, mo, d, h, mi;  // local start, 30 s into the minute
+  void (*script)(Driver&);
+};
+
+const Scenario kScenarios[] = {
+    {"forward 2 h", 2025, 12, 15, 10, 0, [](Driver& d) { d.run(20); d.step(2 * 3600); d.run(20); }},
+    {"forward 30 h across midnight", 2025, 12, 15, 20, 0,
+     [](Driver& d) { d.run(20); d.step(30 * 3600); d.run(20); }},
+    {"forward 72 h (capped)", 2025, 12, 15, 10, 0,
+     [](Driver& d) { d.run(20); d.step(72 * 3600); d.run(20); }},
+    {"forward 2 h, card refuses the gap", 2025, 12, 15, 10, 0,
+     [](Driver& d) { d.run(20); d.step(2 * 3600, true); d.run(20); }},
+    {"back 10 min", 2025, 12, 15, 10, 0, [](Driver& d) { d.run(20); d.step(-600); d.run(30); }},
+    {"back 2 h, then forward 5 h", 2025, 12, 15, 23, 0,
+     [](Driver& d) { d.run(20); d.step(-2 * 3600); d.run(30); d.step(5 * 3600); d.run(20); }},
+    {"back across midnight", 2025, 12, 16, 0, 10,
+     [](Driver& d) { d.run(10); d.step(-3600); d.run(80); }},
+    // Sydney: 02:00 AEST becomes 03:00 AEDT on 2026-10-04, 03:00 AEDT becomes 02:00 AEST on 2026-04-05
+    {"forward 2 h over DST start", 2026, 10, 4, 1, 0,
+     [](Driver& d) { d.run(20); d.step(2 * 3600); d.run(20); }},
+    {"through DST end", 2026, 4, 5, 1, 30, [](Driver& d) { d.run(150); }},
+    {"forward 3 h over DST end", 2026, 4, 5, 1, 0,
+     [](Driver& d) { d.run(20); d.step(3 * 3600); d.run(20); }},
+};
+
+bool runScenario(const Scenario& s) {
+  char dir[] = "/tmp/gapreplay.XXXXXX";
+  if (!mkdtemp(dir)) return false;
+  host::setSdRoot(dir);
+  const time_t start = localTime(s.y, s.mo, s.d, s.h, s.mi, 30);
+  host::setWall(start);
+  printf("%s (from %s)\n", s.name, fmtLocal(start).c_str());
+  host::boot();
+  Driver d;
+  d.maxWall = host::wallNow();
+  s.script(d);
+  const bool ok = checkCard(d);
+  if (gKeep) printf("  card: %s\n", dir);
+  else if (system((std::string("rm -rf ") + dir).c_str()) != 0) return false;
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--keep")) gKeep = true;
+  }
+  setenv("HOST_QUIET", "1", 1);
+  setenv("TZ", NetworkConfig::TIMEZONE, 1);
+  tzset();
+  for (const Scenario& s : kScenarios) {
+    // Each in its own process so it boots on fresh sketch state
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      const bool ok = runScenario(s);
+      fflush(stdout);
+      _Exit(ok ? 0 : 1);  // the acquisition thread is still parked: skip static destructors
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      printf("%s: FAILED\n", s.name);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+// Replays synthetic anemometer pulse trains through WindPulseAnalyzer and the
+// acquisition task, and checks gust, 3 s mean and period-based speed.
+//
+//   ./gustreplay              every train, then the task check
+//   ./gustreplay --seed 7     other jitter and call times
+//
+// Each train is fed the way drainPulseRing() does it (pulses up to a call time,
+// then advanceTo and takeGust), once with a call every PPS window and once with
+// calls 0.1 to 10 s apart. Every value must equal a brute-force count over the
+// pulse list: the gust is the highest 3 s count over the 250 ms boundaries since
+// the previous call. Steady and step trains are also checked against their
+// closed-form values. Pulse times start 5 s before micros() wraps.
+//
+// The task check runs the sketch on the simulator with a 2 s gust in a steady
+// wind and reads the bucket's maxWind (the 3 s gust) back from the RAM ring.
+// Exits non-zero on the first mismatch.
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kStepUs = WindPulseAnalyzer::STEP_US;
+constexpr uint64_t kWindowUs = WindConfig::GUST_WINDOW_MS * 1000ULL;
+constexpr uint64_t kFullStep = WindPulseAnalyzer::STEPS;  // first boundary with a full window
+
+std::mt19937 gRng;
+
+double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(gRng); }
+
+float pulsesToMs(uint64_t pulses) {
+  return (float)pulses * 1000.0f / (float)WindConfig::GUST_WINDOW_MS * WindConfig::PPS_TO_MS;
+}
+
+// ------------------- trains -------------------
+// Pulse times in µs after the analyzer's reset, at least the ISR debounce apart
+
+using RateFn = double (*)(double s, double& state);
+
+std::vector<uint64_t> train(double seconds, double jitter, RateFn rate) {
+  std::vector<uint64_t> t;
+  double state = 0;
+  double now = 0.1e6;
+  while (now < seconds * 1e6) {
+    const double r = rate(now / 1e6, state);
+    if (r <= 0) {
+      now += 100000;
+      continue;
+    }
+    double period = 1e6 / r * (1.0 + jitter * uniform(-1, 1));
+    if (period < WindConfig::DEBOUNCE_US) period = WindConfig::DEBOUNCE_US;
+    t.push_back((uint64_t)now);
+    now += period;
+  }
+  return t;
+}
+
+double steady20(double, double&) { return 20; }
+double stepGust(double s, double&) { return (s >= 30 && s < 32) ? 60 : 10; }
+double shortSpike(double s, double&) { return (s >= 20 && s < 20.5) ? 200 : 10; }
+double gusty(double s, double& state) {  // 0 to 40 pps, a new rate every second
+  if ((int)s != (int)state) state = (int)s + (double)(gRng() % 41) / 1000.0;
+  return (state - (int)state) * 1000.0;
+}
+double calmGaps(double s, double&) { return (fmod(s, 17.0) < 4.0) ? 30 + 10 * sin(s) : 0; }
+
+// ------------------- reference -------------------
+
+struct Reference {
+  const std::vector<uint64_t>& p;
+
+  uint64_t countBefore(uint64_t t) const { return std::lower_bound(p.begin(), p.end(), t) - p.begin(); }
+  // Pulses in the 3 s window that closes at boundary k
+  uint64_t windowCount(uint64_t k) const { return countBefore(k * kStepUs) - countBefore(k * kStepUs - kWindowUs); }
+
+  float gust(uint64_t fromUs, uint64_t toUs) const {  // boundaries in (fromUs, toUs]
+    if (toUs / kStepUs < kFullStep) return NAN;
+    uint64_t best = 0;
+    for (uint64_t k = fromUs / kStepUs + 1; k <= toUs / kStepUs; k++) {
+      if (k >= kFullStep) best = std::max(best, windowCount(k));
+    }
+    return pulsesToMs(best);
+  }
+  float current(uint64_t nowUs) const {
+    const uint64_t k = nowUs / kStepUs;
+    return k < kFullStep ? NAN : pulsesToMs(windowCount(k));
+  }
+  float instant(uint64_t nowUs) const {
+    const uint64_t n = countBefore(nowUs + 1);
+    if (n == 0) return 0.0f;
+    const uint64_t last = p[n - 1];
+    const uint64_t prev = n > 1 ? p[n - 2] : 0;
+    if (nowUs - last > kWindowUs) return 0.0f;
+    const uint32_t periodUs = (uint32_t)std::max(nowUs - last, last - prev);
+    return 1e6f / (float)periodUs * WindConfig::PPS_TO_MS;
+  }
+};
+
+bool same(float a, float b) { return (isnan(a) && isnan(b)) || a == b; }
+
+// Feeds `pulses` as the acquisition task would, calling at `calls`; returns the
+// highest gust taken, or NAN on a mismatch
+float replay(const char* name, const std::vector<uint64_t>& pulses, const std::vector<uint64_t>& calls, uint32_t base) {
+  WindPulseAnalyzer a;
+  a.reset(base);
+  const Reference ref{pulses};
+  size_t next = 0;
+  uint64_t prev = 0;
+  float best = NAN;
+  for (uint64_t c : calls) {
+    for (; next < pulses.size() && pulses[next] <= c; next++) a.addPulse(base + (uint32_t)pulses[next]);
+    a.advanceTo(base + (uint32_t)c);
+    const float gust = a.takeGust(), cur = a.currentMs(), inst = a.instantMs(base + (uint32_t)c);
+    const float wantGust = ref.gust(prev, c), wantCur = ref.current(c), wantInst = ref.instant(c);
+    if (!same(gust, wantGust) || !same(cur, wantCur) || !same(inst, wantInst)) {
+      printf("%s: at %.3f s (previous call %.3f s) gust %.4f / 3 s %.4f / instant %.4f, expected %.4f / %.4f / %.4f\n",
+             name, c / 1e6, prev / 1e6, gust, cur, inst, wantGust, wantCur, wantInst);
+      return NAN;
+    }
+    if (isfinite(gust) && !(gust <= best)) best = gust;
+    prev = c;
+  }
+  return isfinite(best) ? best : 0.0f;
+}
+
+std::vector<uint64_t> everyWindow(double seconds) {
+  std::vector<uint64_t> c;
+  for (uint64_t t = WindConfig::PPS_WINDOW_MS * 1000ULL; t <= seconds * 1e6; t += WindConfig::PPS_WINDOW_MS * 1000ULL) {
+    c.push_back(t + gRng() % 3000);  // tick rounding of the task
+  }
+  return c;
+}
+
+std::vector<uint64_t> sparse(double seconds) {
+  std::vector<uint64_t> c;
+  for (double t = uniform(0.1, 10); t <= seconds; t += uniform(0.1, 10)) c.push_back((uint64_t)(t * 1e6));
+  c.push_back((uint64_t)(seconds * 1e6) + 4000000);  // past the last pulse's window
+  return c;
+}
+
+struct Train {
+  const char* name;
+  double seconds;
+  double jitter;
+  RateFn rate;
+  float expectGust;  // closed form, NAN if none
+  float tolerance;
+};
+
+bool runTrains() {
+  const float onePulse = pulsesToMs(1);
+  const Train trains[] = {
+      {"steady 20 pps", 60, 0, steady20, 1.75f, onePulse},
+      // 2 s at 60 pps in 10 pps: best window is the whole burst plus 1 s of base
+      {"2 s gust", 60, 0, stepGust, pulsesToMs(120 + 10), onePulse},
+      // 0.5 s at 200 pps: the 3 s mean spreads it over the window
+      {"0.5 s spike", 40, 0, shortSpike, pulsesToMs(100 + 25), onePulse},
+      {"gusty, 30% jitter", 900, 0.3, gusty, NAN, 0},
+      {"calm gaps", 300, 0.1, calmGaps, NAN, 0},
+  };
+  const uint32_t bases[] = {0x10000000u, 0xFFFFFFFFu - 5000000u};  // the second wraps micros()
+  printf("%-20s %7s %10s %12s %12s\n", "train", "pulses", "base", "gust (1 s)", "gust (sparse)");
+  for (const Train& t : trains) {
+    const std::vector<uint64_t> pulses = train(t.seconds, t.jitter, t.rate);
+    for (uint32_t base : bases) {
+      const float g1 = replay(t.name, pulses, everyWindow(t.seconds), base);
+      const float g2 = replay(t.name, pulses, sparse(t.seconds), base);
+      if (isnan(g1) || isnan(g2)) return false;
+      printf("%-20s %7zu %10x %12.3f %12.3f\n", t.name, pulses.size(), base, g1, g2);
+      if (isfinite(t.expectGust) && (fabsf(g1 - t.expectGust) > t.tolerance || fabsf(g2 - t.expectGust) > t.tolerance)) {
+        printf("%s: gust %.3f / %.3f m/s, expected %.3f +/- %.3f\n", t.name, g1, g2, t.expectGust, t.tolerance);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// ------------------- through the acquisition task -------------------
+
+const time_t kStart = 1765764000;  // on a bucket boundary
+const time_t kGustAt = kStart + LogConfig::BUCKET_SECONDS + 20;
+constexpr float kBaseMs = 4.0f, kGustMs = 10.0f;
+
+bool runTask() {
+  char dir[] = "/tmp/gustreplay.XXXXXX";
+  if (!mkdtemp(dir)) return false;
+  host::setSdRoot(dir);
+  setenv("HOST_QUIET", "1", 1);
+  host::setWall(kStart);
+  host::setWeather([](double epoch) {
+    host::Weather w;
+    w.windMs = (epoch >= kGustAt && epoch < kGustAt + 2) ? kGustMs : kBaseMs;
+    return w;
+  });
+  host::setPulseJitter(0);
+  host::boot();
+  host::run((uint32_t)(3 * LogConfig::BUCKET_SECONDS * 1000 + 2000));
+
+  // 2 s of gust and 1 s of base wind in the best window
+  const float wantGust = (2 * kGustMs + kBaseMs) / 3;
+  const float tolerance = 2 * pulsesToMs(1);
+  bool ok = true;
+  int seen = 0;
+  gBucketRing.forEach([&](const BucketSample& b) {
+    const bool gusty = b.startEpoch <= kGustAt && kGustAt < b.startEpoch + LogConfig::BUCKET_SECONDS;
+    const bool full = b.startEpoch >= kStart;
+    if (!full) return;
+    seen++;
+    const float want = gusty ? wantGust : kBaseMs;
+    printf("bucket %s  avg %.3f  max %.3f  std %.3f  (expected max %.3f)\n", fmtLocal(b.startEpoch).c_str(), b.avgWind,
+           b.maxWind, b.windStd, want);
+    if (!(fabsf(b.maxWind - want) <= tolerance)) ok = false;
+    if (!gusty && !(fabsf(b.avgWind - kBaseMs) <= tolerance && b.windStd < 0.1f)) ok = false;
+  });
+  if (seen < 2) {
+    printf("task: %d buckets committed, expected at least 2\n", seen);
+    ok = false;
+  }
+  std::string rm = std::string("rm -rf ") + dir;
+  if (system(rm.c_str()) != 0) return false;
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--seed")) seed = (uint32_t)atol(argv[i + 1]);
+  }
+  gRng.seed(seed);
+  if (!runTrains()) return 1;
+  printf("\n");
+  if (!runTask()) {
+    printf("task: bucket wind does not match the pulse train\n");
+    _Exit(1);
+  }
+  fflush(stdout);
+  _Exit(0);  // the acquisition thread is still parked: skip static destructors
+}
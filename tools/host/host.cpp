@@ -0,0 +1,1093 @@
+// Host simulator: virtual clock, acquisition task lockstep, weather feeders,
+// directory-backed SD card, sockets and the WebServer state machine.
+
+#include "host.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+#include "ArduinoOTA.h"
+#include "SD.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "config.h"
+#include "hal_host.h"
+
+void setup();
+void loop();
+
+// ------------------- HEAP COUNTERS -------------------
+
+static std::atomic<uint64_t> gAllocs{0};
+static std::atomic<uint64_t> gAllocBytes{0};
+static std::atomic<int64_t> gLiveBytes{0};
+
+void* operator new(size_t n) {
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  gAllocs++;
+  gAllocBytes += n;
+  gLiveBytes += (int64_t)malloc_usable_size(p);
+  return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept {
+  if (!p) return;
+  gLiveBytes -= (int64_t)malloc_usable_size(p);
+  free(p);
+}
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+namespace host {
+uint64_t allocations() { return gAllocs; }
+uint64_t allocatedBytes() { return gAllocBytes; }
+}  // namespace host
+
+// ------------------- CLOCK / TASK -------------------
+// The acquisition task runs on a thread that only proceeds while the driver
+// waits for it, so the sketch never sees two of its threads at once.
+
+namespace {
+
+uint64_t gUs = 0;                 // virtual µs since power-on
+int64_t gWallAtZeroUs = 0;        // wall epoch (µs) when gUs was 0
+
+struct Task {
+  TaskFunction_t fn = nullptr;
+  void* arg = nullptr;
+  std::thread::id id;
+  std::mutex m;
+  std::condition_variable cv;
+  bool running = false;
+  uint64_t wakeUs = 0;
+};
+Task* gTask = nullptr;  // never freed: the thread is still parked when the process exits
+
+void (*gIsr)() = nullptr;
+uint64_t gNextPulseUs = 0;
+uint64_t gNextPmsUs = 0;
+bool gPmsEnabled = true;
+float gPulseJitter = 0.0f;
+uint32_t gRandState = 0x2545F491u;
+
+host::WeatherFn gWeather;
+
+bool onTaskThread() { return gTask && std::this_thread::get_id() == gTask->id; }
+
+uint32_t nextRandom() {
+  gRandState ^= gRandState << 13;
+  gRandState ^= gRandState >> 17;
+  gRandState ^= gRandState << 5;
+  return gRandState;
+}
+
+// Lets the task run until it parks in vTaskDelayUntil again
+void resumeTask() {
+  std::unique_lock<std::mutex> lock(gTask->m);
+  gTask->running = true;
+  gTask->cv.notify_all();
+  gTask->cv.wait(lock, [] { return !gTask->running; });
+}
+
+void sendPmsFrame(const host::Weather& w) {
+  uint8_t f[32] = {0x42, 0x4D, 0x00, 28};
+  const uint16_t pm[3] = {(uint16_t)lroundf(w.pm1), (uint16_t)lroundf(w.pm25), (uint16_t)lroundf(w.pm10)};
+  for (int i = 0; i < 3; i++) {
+    f[4 + 2 * i] = f[10 + 2 * i] = (uint8_t)(pm[i] >> 8);  // CF=1 and atmospheric
+    f[5 + 2 * i] = f[11 + 2 * i] = (uint8_t)pm[i];
+  }
+  uint16_t sum = 0;
+  for (int i = 0; i < 30; i++) sum += f[i];
+  f[30] = (uint8_t)(sum >> 8);
+  f[31] = (uint8_t)sum;
+  hal::pmsPort().feed(f, sizeof(f));
+}
+
+void firePulse() {
+  if (gIsr) gIsr();
+  double v = host::weatherAt((double)host::wallNow()).windMs;
+  if (v < 0.05) {
+    gNextPulseUs = gUs + 100000;  // calm: look again in 100 ms
+    return;
+  }
+  double periodUs = 1e6 * WindConfig::PPS_TO_MS / v;
+  if (gPulseJitter > 0) periodUs *= 1.0 + gPulseJitter * ((nextRandom() & 0xFFFF) / 32768.0 - 1.0);
+  gNextPulseUs = gUs + (uint64_t)(periodUs < 1 ? 1 : periodUs);
+}
+
+// Processes everything due up to `to` in time order
+void advanceTo(uint64_t to) {
+  const bool fromTask = onTaskThread();
+  while (true) {
+    uint64_t next = to;
+    int what = 0;
+    if (gIsr && gNextPulseUs <= next) { next = gNextPulseUs; what = 1; }
+    if (gPmsEnabled && gNextPmsUs <= next) { next = gNextPmsUs; what = 2; }
+    if (!fromTask && gTask && gTask->wakeUs <= next) { next = gTask->wakeUs; what = 3; }
+    if (what == 0) break;
+    if (next > gUs) gUs = next;
+    if (what == 1) {
+      firePulse();
+    } else if (what == 2) {
+      sendPmsFrame(host::weatherAt((double)host::wallNow()));
+      gNextPmsUs = gUs + 1000000;
+    } else {
+      resumeTask();
+    }
+  }
+  if (to > gUs) gUs = to;
+}
+
+}  // namespace
+
+uint32_t millis() { return (uint32_t)(gUs / 1000); }
+uint32_t micros() { return (uint32_t)gUs; }
+void delay(uint32_t ms) { advanceTo(gUs + (uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { advanceTo(gUs + us); }
+void yield() {}
+
+void attachInterrupt(int, void (*isr)(), int) {
+  gIsr = isr;
+  gNextPulseUs = gUs;
+}
+void detachInterrupt(int) { gIsr = nullptr; }
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+  *previousWake += increment;
+  int32_t ahead = (int32_t)(*previousWake - millis());
+  if (ahead <= 0) return;  // already late: FreeRTOS returns at once
+  std::unique_lock<std::mutex> lock(gTask->m);
+  gTask->wakeUs = gUs + (uint64_t)ahead * 1000 - gUs % 1000;
+  gTask->running = false;
+  gTask->cv.notify_all();
+  gTask->cv.wait(lock, [] { return gTask->running; });
+}
+
+void vTaskDelay(TickType_t ticks) {
+  TickType_t t = millis();
+  vTaskDelayUntil(&t, ticks);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+  if (gTask) return pdFAIL;  // the sketch has one task
+  gTask = new Task();
+  gTask->fn = fn;
+  gTask->arg = arg;
+  gTask->running = true;
+  std::thread th([] {
+    gTask->id = std::this_thread::get_id();
+    gTask->fn(gTask->arg);
+  });
+  th.detach();
+  {
+    std::unique_lock<std::mutex> lock(gTask->m);
+    gTask->cv.wait(lock, [] { return !gTask->running; });
+  }
+  if (handle) *handle = (TaskHandle_t)gTask;
+  return pdPASS;
+}
+
+namespace host {
+
+uint64_t nowUs() { return gUs; }
+time_t wallNow() { return (time_t)((gWallAtZeroUs + (int64_t)gUs) / 1000000); }
+void setWall(time_t epoch) { gWallAtZeroUs = (int64_t)epoch * 1000000 - (int64_t)gUs; }
+void stepWall(long seconds) { gWallAtZeroUs += (int64_t)seconds * 1000000; }
+void advance(uint32_t ms) { advanceTo(gUs + (uint64_t)ms * 1000); }
+
+void boot() {
+  if (!gWeather) gWeather = diurnalWeather(1);
+  ::setup();
+}
+
+static double gLoopMs = 0;  // host time spent in loop(), for request()
+
+void loopOnce() {
+  auto t0 = std::chrono::steady_clock::now();
+  ::loop();
+  gLoopMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void run(uint32_t ms, uint32_t loopEveryMs) {
+  const uint64_t end = gUs + (uint64_t)ms * 1000;
+  while (gUs < end) {
+    uint64_t step = (uint64_t)loopEveryMs * 1000;
+    advanceTo(gUs + step < end ? gUs + step : end);
+    loopOnce();
+  }
+}
+
+// ------------------- weather -------------------
+
+void setWeather(WeatherFn fn) { gWeather = std::move(fn); }
+void setPmsEnabled(bool on) {
+  gPmsEnabled = on;
+  gNextPmsUs = gUs;
+}
+void setPulseJitter(float fraction) { gPulseJitter = fraction; }
+
+Weather weatherAt(double epoch) {
+  if (!gWeather) gWeather = diurnalWeather(1);
+  return gWeather(epoch);
+}
+
+WeatherFn diurnalWeather(uint32_t seed) {
+  return [seed](double t) {
+    // Smooth pseudo-noise: hashed minute values, interpolated
+    auto noise = [seed](double x) {
+      auto h = [seed](int64_t i) {
+        uint32_t v = (uint32_t)i * 2654435761u ^ seed * 40503u;
+        v ^= v >> 15; v *= 2246822519u; v ^= v >> 13;
+        return (v & 0xFFFF) / 65535.0;
+      };
+      int64_t i = (int64_t)floor(x);
+      double f = x - (double)i;
+      return h(i) + (h(i + 1) - h(i)) * f * f * (3 - 2 * f);
+    };
+    const double day = fmod(t, 86400.0) / 86400.0;
+    const double sun = sin(2 * M_PI * (day - 0.375));  // peaks mid-afternoon UTC+10-ish
+    Weather w;
+    w.tempC = (float)(14.0 + 7.0 * sun + 1.5 * (noise(t / 1800.0) - 0.5));
+    w.humRH = (float)(62.0 - 20.0 * sun + 6.0 * (noise(t / 2400.0 + 50) - 0.5));
+    w.pressurePa = (float)(94500.0 + 300.0 * sin(2 * M_PI * t / (5 * 86400.0)) + 40.0 * noise(t / 3600.0 + 90));
+    const double base = 2.5 + 2.0 * (sun > 0 ? sun : 0) + 2.0 * noise(t / 900.0 + 7);
+    const double gust = noise(t / 4.0 + 300);
+    w.windMs = (float)(base * (0.7 + 0.6 * gust * gust));
+    const double night = sun < 0 ? -sun : 0;
+    w.pm25 = (float)(4.0 + 10.0 * night * noise(t / 7200.0 + 11) + 2.0 * noise(t / 60.0 + 13));
+    w.pm1 = w.pm25 * 0.65f;
+    w.pm10 = w.pm25 * 1.6f + 1.0f;
+    return w;
+  };
+}
+
+bool loadWeatherScript(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  struct Row { double t; Weather w; };
+  auto rows = std::make_shared<std::vector<Row>>();
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    Row r;
+    float press = 0;
+    if (sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f", &r.t, &r.w.windMs, &r.w.tempC, &r.w.humRH, &press, &r.w.pm1,
+               &r.w.pm25, &r.w.pm10) != 8) {
+      continue;  // header or comment
+    }
+    r.w.pressurePa = press * 100.0f;
+    rows->push_back(r);
+  }
+  fclose(f);
+  if (rows->empty()) return false;
+  const double t0 = (double)wallNow();
+  gWeather = [rows, t0](double t) {
+    const std::vector<Row>& v = *rows;
+    double x = t - t0;
+    if (x <= v.front().t) return v.front().w;
+    for (size_t i = 1; i < v.size(); i++) {
+      if (x > v[i].t) continue;
+      double f = (x - v[i - 1].t) / (v[i].t - v[i - 1].t);
+      auto mix = [f](float a, float b) { return a + (b - a) * (float)f; };
+      const Weather& a = v[i - 1].w;
+      const Weather& b = v[i].w;
+      Weather w;
+      w.windMs = mix(a.windMs, b.windMs);
+      w.tempC = mix(a.tempC, b.tempC);
+      w.humRH = mix(a.humRH, b.humRH);
+      w.pressurePa = mix(a.pressurePa, b.pressurePa);
+      w.pm1 = mix(a.pm1, b.pm1);
+      w.pm25 = mix(a.pm25, b.pm25);
+      w.pm10 = mix(a.pm10, b.pm10);
+      return w;
+    }
+    return v.back().w;
+  };
+  return true;
+}
+
+}  // namespace host
+
+namespace hal {
+HardwareSerial& pmsPort() {
+  static HardwareSerial port(1);
+  return port;
+}
+}  // namespace hal
+
+// ------------------- ARDUINO CORE -------------------
+
+HardwareSerial Serial(0);
+EspClass ESP;
+TwoWire Wire;
+WiFiClass WiFi;
+ArduinoOTAClass ArduinoOTA;
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (_uart == 0 && !getenv("HOST_QUIET")) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+size_t Print::printf(const char* fmt, ...) {
+  char b[512];
+  va_list a;
+  va_start(a, fmt);
+  int n = vsnprintf(b, sizeof(b), fmt, a);
+  va_end(a);
+  if (n < 0) return 0;
+  return write((const uint8_t*)b, (size_t)n < sizeof(b) ? (size_t)n : sizeof(b) - 1);
+}
+
+static constexpr uint32_t kHeapSize = 320 * 1024;  // ESP32-C3 usable heap after WiFi
+uint32_t EspClass::getHeapSize() { return kHeapSize; }
+uint32_t EspClass::getFreeHeap() {
+  int64_t live = gLiveBytes;
+  return live >= (int64_t)kHeapSize ? 0 : kHeapSize - (uint32_t)live;
+}
+uint32_t EspClass::getMinFreeHeap() { return getFreeHeap(); }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+void EspClass::restart() {
+  fflush(stdout);
+  fprintf(stderr, "ESP.restart()\n");
+  _exit(3);
+}
+
+float temperatureRead() { return 41.5f; }
+uint32_t esp_random() { return nextRandom(); }
+
+// Arduino's dtostrf: String(float, digits) goes through it
+char* dtostrf(double number, signed int width, unsigned int prec, char* s) {
+  if (isnan(number)) { strcpy(s, "nan"); return s; }
+  if (isinf(number)) { strcpy(s, "inf"); return s; }
+  char* out = s;
+  int fill = width;
+  if (prec > 0) fill -= (int)(prec + 1);
+  bool negative = number < 0.0;
+  if (negative) { fill--; number = -number; }
+  double rounding = 2.0;
+  for (unsigned i = 0; i < prec; i++) rounding *= 10.0;
+  number += 1.0 / rounding;
+  double tenpow = 1.0;
+  int digits = 1;
+  while (number >= 10.0 * tenpow) { tenpow *= 10.0; digits++; }
+  number /= tenpow;
+  fill -= digits;
+  while (fill-- > 0) *out++ = ' ';
+  if (negative) *out++ = '-';
+  digits += (int)prec;
+  while (digits-- > 0) {
+    int d = (int)number;
+    if (d > 9) d = 9;
+    *out++ = (char)('0' | d);
+    if (digits == (int)prec && prec > 0) *out++ = '.';
+    number -= d;
+    number *= 10.0;
+  }
+  *out = '\0';
+  return s;
+}
+
+// ------------------- SD CARD -------------------
+
+namespace {
+std::string gSdRoot;
+bool gSdWritesFail = false;
+uint64_t gSdOpens = 0;
+}  // namespace
+
+namespace host {
+void setSdRoot(const std::string& dir) { gSdRoot = dir; }
+const std::string& sdRoot() {
+  if (gSdRoot.empty()) {
+    const char* env = getenv("SDROOT");
+    gSdRoot = env ? env : "sd";
+  }
+  return gSdRoot;
+}
+void setSdWritesFail(bool fail) { gSdWritesFail = fail; }
+uint64_t sdOpens() { return gSdOpens; }
+}  // namespace host
+
+fs::SDFS SD;
+
+namespace fs {
+
+struct FileImpl {
+  FILE* fp = nullptr;
+  DIR* dir = nullptr;
+  std::string hostPath;
+  std::string path;  // card path
+  std::string name;  // last component
+  ~FileImpl() {
+    if (fp) fclose(fp);
+    if (dir) closedir(dir);
+  }
+};
+
+static std::string hostPath(const char* path) { return host::sdRoot() + (path[0] == '/' ? "" : "/") + path; }
+
+static const char* baseName(const std::string& p) {
+  size_t s = p.rfind('/');
+  return p.c_str() + (s == std::string::npos ? 0 : s + 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t n) {
+  if (!_impl || !_impl->fp) return 0;
+  return fwrite(buf, 1, n, _impl->fp);
+}
+int File::available() {
+  if (!_impl || !_impl->fp) return 0;
+  long p = ftell(_impl->fp);
+  fseek(_impl->fp, 0, SEEK_END);
+  long e = ftell(_impl->fp);
+  fseek(_impl->fp, p, SEEK_SET);
+  return (int)(e - p);
+}
+int File::read() { return (_impl && _impl->fp) ? fgetc(_impl->fp) : -1; }
+int File::peek() {
+  if (!_impl || !_impl->fp) return -1;
+  int c = fgetc(_impl->fp);
+  if (c >= 0) ungetc(c, _impl->fp);
+  return c;
+}
+int File::read(uint8_t* buf, size_t n) {
+  if (!_impl || !_impl->fp) return -1;
+  return (int)fread(buf, 1, n, _impl->fp);
+}
+size_t File::readBytes(char* buf, size_t n) {
+  int r = read((uint8_t*)buf, n);
+  return r > 0 ? (size_t)r : 0;
+}
+bool File::seek(uint32_t pos, SeekMode mode) {
+  return _impl && _impl->fp && fseek(_impl->fp, (long)pos, (int)mode) == 0;
+}
+size_t File::position() const { return (_impl && _impl->fp) ? (size_t)ftell(_impl->fp) : 0; }
+size_t File::size() const {
+  if (!_impl) return 0;
+  if (_impl->fp) fflush(_impl->fp);
+  struct stat st;
+  return stat(_impl->hostPath.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+void File::flush() {
+  if (_impl && _impl->fp) fflush(_impl->fp);
+}
+const char* File::name() const { return _impl ? _impl->name.c_str() : ""; }
+const char* File::path() const { return _impl ? _impl->path.c_str() : ""; }
+bool File::isDirectory() const { return _impl && _impl->dir; }
+time_t File::getLastWrite() {
+  struct stat st;
+  if (!_impl || stat(_impl->hostPath.c_str(), &st) != 0) return 0;
+  return st.st_mtime;
+}
+File File::openNextFile(const char* mode) {
+  if (!_impl || !_impl->dir) return File();
+  while (struct dirent* e = readdir(_impl->dir)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    std::string p = _impl->path + (_impl->path == "/" ? "" : "/") + e->d_name;
+    return SD.open(p.c_str(), mode);
+  }
+  return File();
+}
+void File::rewindDirectory() {
+  if (_impl && _impl->dir) rewinddir(_impl->dir);
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+  gSdOpens++;
+  auto impl = std::make_shared<FileImpl>();
+  impl->path = path;
+  impl->hostPath = hostPath(path);
+  impl->name = baseName(impl->path);
+  struct stat st;
+  bool exists = stat(impl->hostPath.c_str(), &st) == 0;
+  if (exists && S_ISDIR(st.st_mode)) {
+    impl->dir = opendir(impl->hostPath.c_str());
+    return impl->dir ? File(impl) : File();
+  }
+  const bool reading = !strcmp(mode, "r");
+  if (!reading && gSdWritesFail) return File();
+  if (reading && !exists) return File();
+  const char* m = reading ? "rb" : !strcmp(mode, "w") ? "wb+" : !strcmp(mode, "r+") ? "rb+" : "ab+";
+  impl->fp = fopen(impl->hostPath.c_str(), m);
+  return impl->fp ? File(impl) : File();
+}
+bool FS::exists(const char* path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+bool FS::remove(const char* path) { return !gSdWritesFail && ::remove(hostPath(path).c_str()) == 0; }
+bool FS::rename(const char* from, const char* to) {
+  return !gSdWritesFail && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+bool FS::mkdir(const char* path) { return !gSdWritesFail && ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+bool FS::rmdir(const char* path) { return !gSdWritesFail && ::rmdir(hostPath(path).c_str()) == 0; }
+
+bool SDFS::begin(uint8_t) {
+  struct stat st;
+  if (stat(host::sdRoot().c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+  return ::mkdir(host::sdRoot().c_str(), 0755) == 0;
+}
+uint64_t SDFS::cardSize() { return 16ull << 30; }
+uint64_t SDFS::totalBytes() { return 16ull << 30; }
+uint64_t SDFS::usedBytes() { return 0; }
+
+}  // namespace fs
+
+// ------------------- SOCKETS -------------------
+
+struct HostSocket {
+  int fd = -1;
+  ~HostSocket() {
+    if (fd >= 0) ::close(fd);
+  }
+};
+
+WiFiClient WiFiClient::fromFd(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  WiFiClient c;
+  c._sock = std::make_shared<HostSocket>();
+  c._sock->fd = fd;
+  return c;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  stop();
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  if (inet_pton(AF_INET, strcmp(host, "localhost") ? host : "127.0.0.1", &a.sin_addr) != 1) return 0;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  if (::connect(fd, (sockaddr*)&a, sizeof(a)) != 0 && errno != EINPROGRESS) {
+    ::close(fd);
+    return 0;
+  }
+  pollfd p{fd, POLLOUT, 0};
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (::poll(&p, 1, timeoutMs) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err) {
+    ::close(fd);
+    return 0;
+  }
+  *this = fromFd(fd);
+  return 1;
+}
+
+int WiFiClient::fd() const { return _sock ? _sock->fd : -1; }
+
+uint8_t WiFiClient::connected() {
+  if (!_sock) return 0;
+  char c;
+  ssize_t r = recv(_sock->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (r == 0) return 0;
+  if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+  return 1;
+}
+
+// The core retries a full send buffer for up to 10 x 1 s before giving up
+size_t WiFiClient::write(const uint8_t* buf, size_t n) {
+  if (!_sock) return 0;
+  size_t off = 0;
+  int waits = 0;
+  while (off < n) {
+    ssize_t r = ::send(_sock->fd, buf + off, n - off, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (r > 0) {
+      off += (size_t)r;
+      waits = 0;
+      continue;
+    }
+    if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+    if (++waits > 10) break;
+    pollfd p{_sock->fd, POLLOUT, 0};
+    ::poll(&p, 1, 1000);
+  }
+  return off;
+}
+
+int WiFiClient::available() {
+  if (!_sock) return 0;
+  int n = 0;
+  char b[2048];
+  ssize_t r = recv(_sock->fd, b, sizeof(b), MSG_PEEK | MSG_DONTWAIT);
+  if (r > 0) n = (int)r;
+  return n;
+}
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+int WiFiClient::read(uint8_t* buf, size_t n) {
+  if (!_sock) return -1;
+  ssize_t r = recv(_sock->fd, buf, n, MSG_DONTWAIT);
+  return r > 0 ? (int)r : -1;
+}
+int WiFiClient::peek() {
+  if (!_sock) return -1;
+  uint8_t c;
+  return recv(_sock->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+IPAddress WiFiClient::remoteIP() const {
+  sockaddr_in a{};
+  socklen_t len = sizeof(a);
+  if (!_sock || getpeername(_sock->fd, (sockaddr*)&a, &len) != 0 || a.sin_family != AF_INET) return IPAddress();
+  return IPAddress(ntohl(a.sin_addr.s_addr));
+}
+
+// ------------------- WEBSERVER -------------------
+
+namespace {
+std::mutex gAcceptMutex;
+std::vector<int> gPendingFds;  // server ends of in-process requests
+int gListenFd = -1;
+constexpr int kServerSndBuf = 5744;  // lwIP TCP_SND_BUF on the ESP32 core
+
+int acceptClient() {
+  {
+    std::lock_guard<std::mutex> lock(gAcceptMutex);
+    if (!gPendingFds.empty()) {
+      int fd = gPendingFds.front();
+      gPendingFds.erase(gPendingFds.begin());
+      return fd;
+    }
+  }
+  if (gListenFd < 0) return -1;
+  int fd = accept(gListenFd, nullptr, nullptr);
+  if (fd < 0) return -1;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &kServerSndBuf, sizeof(kServerSndBuf));
+  return fd;
+}
+
+const char* reasonPhrase(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Request Entity Too Large";
+    case 416: return "Range not satisfiable";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+std::string urlDecode(const std::string& x) {
+  std::string out;
+  for (size_t i = 0; i < x.size(); i++) {
+    if (x[i] == '+') {
+      out += ' ';
+    } else if (x[i] == '%' && i + 2 < x.size()) {
+      out += (char)strtol(x.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else {
+      out += x[i];
+    }
+  }
+  return out;
+}
+
+// Reads from the client until `done` says enough, for at most HTTP_MAX_DATA_WAIT real ms
+template <typename Done>
+bool readUntil(WiFiClient& c, std::string& in, Done done) {
+  auto t0 = std::chrono::steady_clock::now();
+  while (!done()) {
+    uint8_t b[1024];
+    int n = c.read(b, sizeof(b));
+    if (n > 0) {
+      in.append((const char*)b, (size_t)n);
+      continue;
+    }
+    if (!c.connected()) return false;
+    if (std::chrono::steady_clock::now() - t0 > std::chrono::milliseconds(HTTP_MAX_DATA_WAIT)) return false;
+    pollfd p{c.fd(), POLLIN, 0};
+    ::poll(&p, 1, 5);
+  }
+  return true;
+}
+}  // namespace
+
+void WebServer::begin() {}
+
+void WebServer::collectHeaders(const char* headerKeys[], size_t count) {
+  _collect.clear();
+  for (size_t i = 0; i < count; i++) _collect.push_back(headerKeys[i]);
+}
+
+String WebServer::arg(const String& name) const {
+  for (const auto& a : _args) {
+    if (a.first == name.s) return String(a.second);
+  }
+  return String();
+}
+
+bool WebServer::hasArg(const String& name) const {
+  for (const auto& a : _args) {
+    if (a.first == name.s) return true;
+  }
+  return false;
+}
+
+String WebServer::header(const String& name) const {
+  for (const auto& h : _headers) {
+    if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return String(h.second);
+  }
+  return String();
+}
+
+bool WebServer::hasHeader(const String& name) const {
+  for (const auto& h : _headers) {
+    if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return true;
+  }
+  return false;
+}
+
+void WebServer::parseArgs(const std::string& query) {
+  size_t i = 0;
+  while (i < query.size()) {
+    size_t amp = query.find('&', i);
+    if (amp == std::string::npos) amp = query.size();
+    std::string kv = query.substr(i, amp - i);
+    size_t eq = kv.find('=');
+    if (!kv.empty()) {
+      _args.push_back({urlDecode(kv.substr(0, eq)), eq == std::string::npos ? "" : urlDecode(kv.substr(eq + 1))});
+    }
+    i = amp + 1;
+  }
+}
+
+bool WebServer::parseRequest() {
+  std::string in;
+  if (!readUntil(_currentClient, in, [&] { return in.find("\r\n\r\n") != std::string::npos; })) return false;
+  const size_t headEnd = in.find("\r\n\r\n");
+  const size_t lineEnd = in.find("\r\n");
+  const std::string line = in.substr(0, lineEnd);
+  const size_t s1 = line.find(' '), s2 = line.rfind(' ');
+  if (s1 == std::string::npos || s2 == s1) return false;
+  const std::string method = line.substr(0, s1);
+  const std::string url = line.substr(s1 + 1, s2 - s1 - 1);
+  _currentVersion = line.compare(s2 + 1, std::string::npos, "HTTP/1.0") == 0 ? 0 : 1;
+  _currentMethod = method == "POST" ? HTTP_POST : method == "HEAD" ? HTTP_HEAD : method == "PUT" ? HTTP_PUT
+                 : method == "DELETE" ? HTTP_DELETE : method == "OPTIONS" ? HTTP_OPTIONS : HTTP_GET;
+
+  _args.clear();
+  _headers.clear();
+  size_t q = url.find('?');
+  _currentUri = String(urlDecode(url.substr(0, q)));
+  if (q != std::string::npos) parseArgs(url.substr(q + 1));
+
+  size_t contentLength = 0;
+  std::string contentType;
+  for (size_t pos = lineEnd + 2; pos < headEnd;) {
+    size_t end = in.find("\r\n", pos);
+    std::string h = in.substr(pos, end - pos);
+    pos = end + 2;
+    size_t colon = h.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = h.substr(0, colon);
+    std::string value = h.substr(colon + 1);
+    while (!value.empty() && value[0] == ' ') value.erase(0, 1);
+    if (!strcasecmp(name.c_str(), "Content-Length")) contentLength = (size_t)atol(value.c_str());
+    if (!strcasecmp(name.c_str(), "Content-Type")) contentType = value;
+    for (const auto& k : _collect) {
+      if (!strcasecmp(k.c_str(), name.c_str())) _headers.push_back({k, value});
+    }
+  }
+
+  if (contentLength) {
+    if (!readUntil(_currentClient, in, [&] { return in.size() >= headEnd + 4 + contentLength; })) return false;
+    std::string body = in.substr(headEnd + 4, contentLength);
+    if (contentType.rfind("application/x-www-form-urlencoded", 0) == 0) parseArgs(body);
+    else _args.push_back({"plain", body});
+  }
+  return true;
+}
+
+void WebServer::handleRequest() {
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _chunked = false;
+  _responseHeaders.clear();
+  bool handled = false;
+  for (auto& r : _routes) {
+    if (r.uri != _currentUri.s) continue;
+    if (r.method != HTTP_ANY && r.method != _currentMethod) continue;
+    r.fn();
+    handled = true;
+    break;
+  }
+  if (!handled) {
+    if (_notFound) _notFound();
+    else send(404, "text/plain", String("Not found: ") + _currentUri);
+  }
+  if (_chunked) sendContent("", 0);  // the core's _finalizeResponse()
+}
+
+void WebServer::handleClient() {
+  if (_status == HC_NONE) {
+    int fd = acceptClient();
+    if (fd < 0) return;
+    _currentClient = WiFiClient::fromFd(fd);
+    _status = HC_WAIT_READ;
+    _statusChange = millis();
+  }
+  bool keep = false;
+  if (_currentClient.connected()) {
+    if (_status == HC_WAIT_READ) {
+      if (_currentClient.available()) {
+        if (parseRequest()) {
+          handleRequest();
+          if (_currentClient.connected()) {
+            _status = HC_WAIT_CLOSE;
+            _statusChange = millis();
+            keep = true;
+          }
+        }
+      } else if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+        keep = true;
+      }
+    } else if (_status == HC_WAIT_CLOSE) {
+      keep = millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT;
+    }
+  }
+  if (!keep) {
+    _currentClient = WiFiClient();
+    _status = HC_NONE;
+  }
+}
+
+void WebServer::write(const char* data, size_t len) { _currentClient.write((const uint8_t*)data, len); }
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+  std::string line = name.s + ": " + value.s + "\r\n";
+  if (first) _responseHeaders = line + _responseHeaders;
+  else _responseHeaders += line;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+  std::string head = "HTTP/1." + std::to_string(_currentVersion) + " " + std::to_string(code) + " " +
+                     reasonPhrase(code) + "\r\n";
+  sendHeader("Content-Type", contentType && *contentType ? contentType : "text/html", true);
+  if (_contentLength == CONTENT_LENGTH_NOT_SET) {
+    sendHeader("Content-Length", String((unsigned)content.length()));
+  } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+    sendHeader("Content-Length", String((unsigned long)_contentLength));
+  } else if (_currentVersion) {
+    _chunked = true;
+    sendHeader("Accept-Ranges", "none");
+    sendHeader("Transfer-Encoding", "chunked");
+  }
+  sendHeader("Connection", "close");
+  head += _responseHeaders + "\r\n";
+  _responseHeaders.clear();
+  write(head.data(), head.size());
+  if (content.length()) sendContent(content);
+}
+
+void WebServer::sendContent(const char* content, size_t len) {
+  if (_currentMethod == HTTP_HEAD) return;
+  if (_chunked) {
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", len);
+    write(size, (size_t)n);
+  }
+  write(content, len);
+  if (_chunked) {
+    write("\r\n", 2);
+    if (len == 0) _chunked = false;
+  }
+}
+
+// ------------------- IN-PROCESS REQUESTS -------------------
+
+namespace {
+
+// Incremental HTTP/1.x response parser (Content-Length, chunked or close-delimited)
+struct ResponseParser {
+  std::string in;
+  size_t pos = 0;
+  bool haveHead = false, chunked = false, untilClose = false, done = false;
+  size_t remaining = 0;  // body bytes (or bytes of the current chunk) still expected
+  bool inChunkData = false;
+  host::Response r;
+
+  void feed(const char* data, size_t n, bool eof, bool headRequest) {
+    in.append(data, n);
+    if (!haveHead) {
+      size_t e = in.find("\r\n\r\n");
+      if (e == std::string::npos) return;
+      r.headers = in.substr(0, e + 2);
+      r.status = atoi(r.headers.c_str() + 9);
+      pos = e + 4;
+      haveHead = true;
+      std::string te = r.header("Transfer-Encoding"), cl = r.header("Content-Length");
+      if (headRequest || r.status == 204 || r.status == 304) {
+        done = true;
+      } else if (te == "chunked") {
+        chunked = true;
+      } else if (!cl.empty()) {
+        remaining = (size_t)atol(cl.c_str());
+        done = remaining == 0;
+      } else {
+        untilClose = true;
+      }
+    }
+    while (!done) {
+      if (untilClose) {
+        r.body.append(in, pos, std::string::npos);
+        pos = in.size();
+        done = eof;
+        break;
+      }
+      if (!chunked || inChunkData) {
+        size_t take = std::min(remaining, in.size() - pos);
+        r.body.append(in, pos, take);
+        pos += take;
+        remaining -= take;
+        if (remaining) break;
+        if (!chunked) { done = true; break; }
+        if (in.size() - pos < 2) break;
+        pos += 2;  // CRLF after the chunk
+        inChunkData = false;
+        continue;
+      }
+      size_t e = in.find("\r\n", pos);
+      if (e == std::string::npos) break;
+      remaining = (size_t)strtoul(in.c_str() + pos, nullptr, 16);
+      pos = e + 2;
+      if (remaining == 0) { done = true; break; }
+      inChunkData = true;
+    }
+    if (pos > 65536) {
+      in.erase(0, pos);
+      pos = 0;
+    }
+  }
+};
+
+}  // namespace
+
+namespace host {
+
+std::string Response::header(const char* name) const {
+  const size_t n = strlen(name);
+  for (size_t pos = headers.find("\r\n"); pos != std::string::npos; pos = headers.find("\r\n", pos + 2)) {
+    size_t start = pos + 2;
+    if (headers.size() > start + n && headers[start + n] == ':' && !strncasecmp(headers.c_str() + start, name, n)) {
+      size_t v = start + n + 1;
+      while (v < headers.size() && headers[v] == ' ') v++;
+      return headers.substr(v, headers.find("\r\n", v) - v);
+    }
+  }
+  return "";
+}
+
+Response request(const std::string& target, const std::string& method, const std::string& extraHeaders,
+                 const std::string& body, uint32_t maxMs, bool http11) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return Response();
+  setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &kServerSndBuf, sizeof(kServerSndBuf));
+  std::string req = method + " " + target + (http11 ? " HTTP/1.1" : " HTTP/1.0") + "\r\nHost: station\r\n" +
+                    extraHeaders;
+  if (!body.empty()) req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  req += "\r\n" + body;
+  if (::send(sv[0], req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) {
+    ::close(sv[0]);
+    ::close(sv[1]);
+    return Response();
+  }
+  {
+    std::lock_guard<std::mutex> lock(gAcceptMutex);
+    gPendingFds.push_back(sv[1]);
+  }
+
+  // A reader thread drains the client end like a real peer would, so a
+  // handler writing more than the socket buffer never waits on this loop
+  std::mutex m;
+  std::string rx;
+  bool eof = false;
+  std::atomic<bool> stop{false};
+  std::thread reader([&] {
+    char b[16384];
+    while (!stop) {
+      pollfd pfd{sv[0], POLLIN, 0};
+      if (::poll(&pfd, 1, 2) <= 0) continue;
+      ssize_t n = recv(sv[0], b, sizeof(b), 0);
+      std::lock_guard<std::mutex> lock(m);
+      if (n <= 0) {
+        eof = true;
+        break;
+      }
+      rx.append(b, (size_t)n);
+    }
+  });
+
+  ResponseParser p;
+  const bool head = method == "HEAD";
+  const uint64_t start = gUs;
+  const double loop0 = gLoopMs;
+  while (gUs - start < (uint64_t)maxMs * 1000) {
+    loopOnce();
+    std::string got;
+    bool closed;
+    {
+      std::lock_guard<std::mutex> lock(m);
+      got.swap(rx);
+      closed = eof;
+    }
+    p.feed(got.data(), got.size(), closed, head);
+    if (p.done || closed) break;
+    advanceTo(gUs + 1000);
+  }
+  stop = true;
+  reader.join();
+  ::close(sv[0]);
+  p.r.complete = p.done;
+  p.r.renderMs = gLoopMs - loop0;
+  p.r.simMs = (uint32_t)((gUs - start) / 1000);
+  loopOnce();  // the server notices the close and is ready for the next client
+  return p.r;
+}
+
+bool listen(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (sockaddr*)&a, sizeof(a)) != 0 || ::listen(fd, 16) != 0) {
+    ::close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  gListenFd = fd;
+  return true;
+}
+
+}  // namespace host
@@ -0,0 +1,77 @@
+#pragma once
+
+// ==================== HOST SIMULATOR ====================
+// Drives the sketch off-device. One virtual clock feeds millis()/micros() and
+// hal::now(); advancing it runs the acquisition task once per PPS window,
+// fires the anemometer ISR at the pulse times the weather script implies and
+// delivers a PMS5003 frame every second. loop() only runs when the driver
+// calls it, so every run is deterministic for a given script.
+
+#include <stdint.h>
+#include <time.h>
+#include <functional>
+#include <string>
+
+namespace host {
+
+// ------------------- clock -------------------
+uint64_t nowUs();                  // virtual time since power-on
+time_t wallNow();                  // what hal::now() returns
+void setWall(time_t epoch);        // wall clock at the current instant
+void stepWall(long seconds);       // an NTP step (forward or backward)
+void advance(uint32_t ms);         // moves the clock; task windows, pulses and frames happen on the way
+
+// ------------------- sketch -------------------
+void boot();                                   // setup()
+void loopOnce();                               // one loop()
+void run(uint32_t ms, uint32_t loopEveryMs = 20);  // advance, calling loop() every loopEveryMs
+
+// ------------------- weather -------------------
+struct Weather {
+  float windMs = 0;
+  float tempC = 15;
+  float humRH = 60;
+  float pressurePa = 94500;  // station pressure
+  float pm1 = 3, pm25 = 5, pm10 = 8;
+};
+using WeatherFn = std::function<Weather(double epoch)>;
+
+void setWeather(WeatherFn fn);
+WeatherFn diurnalWeather(uint32_t seed);  // default: daily temperature cycle, gusty wind, a PM bump at night
+// CSV "seconds,wind_ms,temp_c,hum_rh,press_hpa,pm1,pm25,pm10", seconds from the
+// wall time at load; linear in between, the last row holds. False if unreadable.
+bool loadWeatherScript(const char* path);
+Weather weatherAt(double epoch);
+void setPmsEnabled(bool on);             // stop frames to simulate an unplugged sensor
+void setPulseJitter(float fraction);     // random +/- fraction on every pulse period
+
+// ------------------- SD card -------------------
+void setSdRoot(const std::string& dir);  // default: $SDROOT, else ./sd
+const std::string& sdRoot();
+void setSdWritesFail(bool fail);         // opens for writing fail (card full, removed, worn out)
+uint64_t sdOpens();                      // files/directories opened so far
+
+// ------------------- HTTP -------------------
+struct Response {
+  int status = 0;
+  std::string headers;  // raw header block
+  std::string body;     // chunked framing removed
+  bool complete = false;
+  double renderMs = 0;  // host time spent in loop() until the response was complete
+  uint32_t simMs = 0;   // virtual time it took
+
+  std::string header(const char* name) const;
+};
+
+// Sends one request through a socketpair and calls loop() until the response
+// is complete (or maxMs of virtual time pass). extraHeaders: "Name: value\r\n" lines.
+Response request(const std::string& target, const std::string& method = "GET",
+                 const std::string& extraHeaders = "", const std::string& body = "",
+                 uint32_t maxMs = 60000, bool http11 = true);
+bool listen(uint16_t port);  // also accept real TCP clients (127.0.0.1:port)
+
+// ------------------- heap -------------------
+uint64_t allocations();      // operator new calls so far
+uint64_t allocatedBytes();
+
+}  // namespace host
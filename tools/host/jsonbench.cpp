@@ -0,0 +1,255 @@
+// JsonWriter against String concatenation, the way the handlers built their
+// responses before it: the same documents rendered both ways, compared byte for
+// byte, then timed with heap allocations counted.
+//
+//   ./jsonbench               1440 buckets and 365 days, 20 renders each
+//   ./jsonbench --reps 200    more renders per document
+//   ./jsonbench --seed 7      other values
+//
+// Documents: a day of /api/buckets objects, a day of /api/buckets_compact
+// arrays and a year of /api/days summaries, with a tenth of the values NaN
+// and some on rounding edges. Both sides write into one reserved String (the
+// JsonWriter through its capture), so the counts are the formatting's own
+// allocations. The host String keeps short values inline like the ESP32 core
+// does, so the String side is not worse here than on the board.
+// Also checks num() against String(v, 1..4) over random values. Exits non-zero
+// on the first difference.
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::mt19937 gRng;
+
+float randomValue(float lo, float hi) {
+  std::uniform_real_distribution<float> u(lo, hi);
+  if (gRng() % 10 == 0) return NAN;
+  float v = u(gRng);
+  if (gRng() % 8 == 0) v = floorf(v * 100.0f) / 100.0f + 0.005f;  // a rounding edge
+  return v;
+}
+
+// ------------------- reference: String concatenation -------------------
+
+String numOrNull(float v, int digits) { return isfinite(v) ? String(v, digits) : String("null"); }
+
+String refBucket(const BucketSample& b) {
+  if (!isfinite(b.avgWind) && !isfinite(b.maxWind) &&
+      !isfinite(b.avgTempC) && !isfinite(b.avgHumRH) && !isfinite(b.avgPressHpa)) {
+    return "";
+  }
+  String out = "{\"timestamp\":";
+  out += String((uint32_t)b.startEpoch);
+  for (int c = 0; c < CH_COUNT; c++) {
+    if (c == CH_TEMP) {
+      out += ",\"wind_speed_samples\":";
+      out += String(b.samples);
+      out += ",\"wind_speed_std\":";
+      out += numOrNull(b.windStd, 3);
+      out += ",\"turbulence_intensity\":";
+      out += numOrNull(turbulenceIntensity(b), 3);
+    }
+    out += ",\"" + String(CHANNELS[c].apiName) + "\":";
+    out += numOrNull(b.*kBucketChannel[c], CHANNELS[c].decimals);
+  }
+  out += "}";
+  return out;
+}
+
+String refBucketCompact(const BucketSample& b) {
+  if (!compactBucketHasData(b)) return "";
+  String out = "[";
+  out += String((uint32_t)b.startEpoch);
+  for (int c = 0; c < CH_COUNT; c++) {
+    if (c == CH_TEMP) out += "," + String(b.samples);
+    out += ",";
+    out += numOrNull(b.*kBucketChannel[c], CHANNELS[c].decimals);
+  }
+  out += "]";
+  return out;
+}
+
+String refDay(const DaySummary& d) {
+  String out = "{";
+  out += "\"dayStartEpoch\":" + String((uint32_t)d.dayStartEpoch) + ",";
+  out += "\"dayStartLocal\":\"" + fmtLocal(d.dayStartEpoch) + "\"";
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    char key[16];
+    out += ",\"" + String(dayStatKey(kDayStats[i], key, sizeof(key))) + "\":";
+    out += numOrNull(d.*kDaySummaryFields[i], CHANNELS[kDayStats[i].ch].decimals);
+  }
+  for (int i = 0; i < HIST_COUNT; i++) {
+    const ChannelDef& ch = CHANNELS[HISTOGRAMS[i].channel];
+    for (uint8_t pct : HistConfig::PERCENTILES) {
+      out += ",\"p" + String(pct) + ch.name + "\":";
+      out += numOrNull(histQuantile(d.hist[i], HISTOGRAMS[i], pct / 100.0f), ch.decimals);
+    }
+  }
+  out += "}";
+  return out;
+}
+
+template <typename T>
+void refList(String& out, const std::vector<T>& items, String (*one)(const T&)) {
+  out += "[";
+  bool first = true;
+  for (const T& it : items) {
+    String s = one(it);
+    if (!s.length()) continue;
+    if (!first) out += ",";
+    first = false;
+    out += s;
+  }
+  out += "]";
+}
+
+template <typename T>
+void writerList(String& out, const std::vector<T>& items, void (*one)(JsonWriter&, const T&)) {
+  JsonWriter w(&out);
+  w.beginArray();
+  for (const T& it : items) one(w, it);
+  w.endArray();
+  w.flush();
+}
+
+// ------------------- documents -------------------
+
+std::vector<BucketSample> makeBuckets(time_t day) {
+  std::vector<BucketSample> v;
+  for (int i = 0; i < 86400 / LogConfig::BUCKET_SECONDS; i++) {
+    BucketSample b;
+    b.startEpoch = day + (time_t)i * LogConfig::BUCKET_SECONDS;
+    b.avgWind = randomValue(0, 15);
+    b.maxWind = isfinite(b.avgWind) ? b.avgWind * 1.5f : NAN;
+    b.samples = gRng() % (LogConfig::BUCKET_SECONDS + 1);
+    b.avgTempC = randomValue(-25, 45);
+    b.avgHumRH = randomValue(0, 100);
+    b.avgPressHpa = randomValue(950, 1050);
+    b.avgPM1 = randomValue(0, 80);
+    b.avgPM25 = randomValue(0, 150);
+    b.avgPM10 = randomValue(0, 300);
+    b.windStd = randomValue(0, 4);
+    if (gRng() % 50 == 0) b.avgWind = b.maxWind = b.avgTempC = b.avgHumRH = b.avgPressHpa = NAN;  // empty bucket
+    v.push_back(b);
+  }
+  return v;
+}
+
+std::vector<DaySummary> makeDays(time_t today, int n) {
+  std::vector<DaySummary> v;
+  for (int d = 0; d < n; d++) {
+    DayAgg a;
+    for (const BucketSample& b : makeBuckets(subtractDaysLocalMidnight(today, d))) {
+      if (gRng() % 4 == 0) accumulateDayAgg(a, b);  // a few hundred per day keeps this quick
+    }
+    DaySummary s;
+    daySummaryFromAgg(subtractDaysLocalMidnight(today, d), a, s);
+    v.push_back(s);
+  }
+  return v;
+}
+
+// ------------------- bench -------------------
+
+struct Result {
+  size_t bytes = 0;
+  double us = 0;
+  double allocs = 0;
+};
+
+template <typename Fn>
+Result timeRender(int reps, Fn&& render) {
+  String out;
+  out.reserve(512 * 1024);
+  Result r;
+  std::vector<double> us;
+  us.reserve(reps);
+  uint64_t allocs = 0;
+  for (int i = 0; i < reps; i++) {
+    out = "";
+    const uint64_t allocs0 = host::allocations();
+    auto t0 = std::chrono::steady_clock::now();
+    render(out);
+    us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    allocs += host::allocations() - allocs0;
+  }
+  std::sort(us.begin(), us.end());
+  r.bytes = out.length();
+  r.us = us[us.size() / 2];
+  r.allocs = (double)allocs / reps;
+  return r;
+}
+
+template <typename T>
+bool compareDoc(const char* name, int reps, const std::vector<T>& items, String (*ref)(const T&),
+                void (*one)(JsonWriter&, const T&)) {
+  String a, b;
+  refList(a, items, ref);
+  writerList(b, items, one);
+  if (a != b) {
+    size_t i = 0;
+    while (i < a.length() && i < b.length() && a[i] == b[i]) i++;
+    size_t from = i > 40 ? i - 40 : 0;
+    printf("%s: outputs differ at byte %zu\n  String:     %s\n  JsonWriter: %s\n", name, i,
+           a.substring(from, i + 40).c_str(), b.substring(from, i + 40).c_str());
+    return false;
+  }
+  const Result s = timeRender(reps, [&](String& out) { refList(out, items, ref); });
+  const Result w = timeRender(reps, [&](String& out) { writerList(out, items, one); });
+  printf("%-16s %8zu %5zu | %9.0f %7.1f %9.0f | %9.0f %7.1f %9.0f\n", name, s.bytes, items.size(), s.us,
+         (double)s.bytes / s.us, s.allocs, w.us, (double)w.bytes / w.us, w.allocs);
+  return true;
+}
+
+// num() against String(v, digits), the formatting the handlers used before
+bool compareNumbers(int count) {
+  std::uniform_real_distribution<double> mag(-7, 7);
+  for (int i = 0; i < count; i++) {
+    float v = (float)pow(10.0, mag(gRng));
+    if (gRng() % 2) v = -v;
+    if (gRng() % 8 == 0) v = (float)(floor(v * 100.0) / 100.0 + 0.005);
+    const int digits = 1 + (int)(gRng() % 4);  // String(v, 0) pads with a space; no handler uses 0
+    JsonWriter w;
+    w.num(v, digits);
+    const String want = numOrNull(v, digits);
+    if (String(w.data(), w.size()) != want) {
+      printf("num(%.9g, %d) wrote \"%.*s\", String(v, %d) is \"%s\"\n", v, digits, (int)w.size(), w.data(), digits,
+             want.c_str());
+      return false;
+    }
+  }
+  printf("num() matches String(v, digits) on %d values\n", count);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int reps = 20;
+  uint32_t seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--reps")) reps = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (uint32_t)atol(argv[i + 1]);
+  }
+  setenv("TZ", NetworkConfig::TIMEZONE, 1);
+  tzset();
+  gRng.seed(seed);
+  if (!compareNumbers(200000)) return 1;
+
+  const time_t today = localMidnight(1765764000);
+  const std::vector<BucketSample> buckets = makeBuckets(today);
+  const std::vector<DaySummary> days = makeDays(today, 365);
+
+  printf("\n%-16s %8s %5s | %-27s | %-27s\n", "", "", "", "String +=", "JsonWriter");
+  printf("%-16s %8s %5s | %9s %7s %9s | %9s %7s %9s\n", "document", "bytes", "items", "us", "MB/s", "allocs", "us",
+         "MB/s", "allocs");
+  if (!compareDoc("buckets", reps, buckets, refBucket, writeBucketJson)) return 1;
+  if (!compareDoc("buckets_compact", reps, buckets, refBucketCompact, writeBucketJsonCompact)) return 1;
+  if (!compareDoc("days", reps, days, refDay, writeDaySummaryJson)) return 1;
+  return 0;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+// ==================== ARDUINO CORE (HOST) ====================
+// The slice of the ESP32 Arduino core the sketch uses, on top of the C++
+// standard library. Time is virtual: millis()/micros()/delay() read and advance
+// the simulator clock in host.cpp, so a day of logging runs in seconds and
+// every run is reproducible.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <cmath>
+#include <functional>
+#include <string>
+
+using std::isfinite;
+using std::isinf;
+using std::isnan;
+
+#define IRAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define F(s) (s)
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+inline void pinMode(int, int) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int pin, void (*isr)(), int mode);
+void detachInterrupt(int pin);
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+float temperatureRead();
+uint32_t esp_random();
+inline void configTzTime(const char*, const char*, const char* = nullptr, const char* = nullptr) {}
+
+char* dtostrf(double number, signed int width, unsigned int prec, char* s);
+
+// ------------------- String -------------------
+// Arduino's String over std::string: same API, same number formatting.
+
+class String {
+ public:
+  std::string s;
+
+  String() {}
+  String(const char* c) { if (c) s = c; }
+  String(const std::string& x) : s(x) {}
+  String(const char* c, size_t n) : s(c, n) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(int v) : s(std::to_string(v)) {}
+  explicit String(unsigned v) : s(std::to_string(v)) {}
+  explicit String(long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long v) : s(std::to_string(v)) {}
+  explicit String(long long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long long v) : s(std::to_string(v)) {}
+  String(float v, unsigned digits = 2) { char b[64]; s = dtostrf(v, digits + 2, digits, b); }
+  String(double v, unsigned digits = 2) { char b[64]; s = dtostrf(v, digits + 2, digits, b); }
+
+  unsigned length() const { return (unsigned)s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  bool reserve(unsigned n) { s.reserve(n); return true; }
+  void clear() { s.clear(); }
+
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char o) { s += o; return *this; }
+  String& operator+=(int o) { s += std::to_string(o); return *this; }
+  String& operator+=(unsigned o) { s += std::to_string(o); return *this; }
+  String& operator+=(long o) { s += std::to_string(o); return *this; }
+  String& operator+=(unsigned long o) { s += std::to_string(o); return *this; }
+  String& operator+=(float o) { return *this += String(o); }
+  String& operator+=(double o) { return *this += String(o); }
+  bool concat(const char* c, unsigned n) { s.append(c, n); return true; }
+  bool concat(const String& o) { s += o.s; return true; }
+  bool concat(const char* c) { s += c; return true; }
+  bool concat(char c) { s += c; return true; }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+  bool operator<(const String& o) const { return s < o.s; }
+  bool equals(const String& o) const { return s == o.s; }
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+  char operator[](unsigned i) const { return i < s.size() ? s[i] : 0; }
+  char charAt(unsigned i) const { return (*this)[i]; }
+
+  int indexOf(char c, unsigned from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const String& c, unsigned from = 0) const { return pos(s.find(c.s, from)); }
+  int indexOf(const char* c, unsigned from = 0) const { return pos(s.find(c, from)); }
+  int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+  String substring(unsigned a) const { return a >= s.size() ? String() : String(s.substr(a)); }
+  String substring(unsigned a, unsigned b) const {
+    if (b > s.size()) b = (unsigned)s.size();
+    return (a >= b) ? String() : String(s.substr(a, b - a));
+  }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const {
+    return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+  }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return (float)atof(s.c_str()); }
+
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s.clear(); return; }
+    size_t b = s.find_last_not_of(" \t\r\n");
+    s = s.substr(a, b - a + 1);
+  }
+  void toLowerCase() { for (auto& c : s) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (auto& c : s) c = (char)toupper((unsigned char)c); }
+  void replace(const String& a, const String& b) {
+    if (a.s.empty()) return;
+    for (size_t p = 0; (p = s.find(a.s, p)) != std::string::npos; p += b.s.size()) s.replace(p, a.s.size(), b.s);
+  }
+  void remove(unsigned i) { if (i < s.size()) s.erase(i); }
+  void remove(unsigned i, unsigned n) { if (i < s.size()) s.erase(i, n); }
+
+ private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+};
+
+inline String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+inline String operator+(const String& a, const char* b) { return String(a.s + b); }
+inline String operator+(const char* a, const String& b) { return String(a + b.s); }
+inline String operator+(const String& a, char b) { return String(a.s + b); }
+
+// ------------------- Print / Stream -------------------
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t* buf, size_t n) = 0;
+  size_t write(const char* buf, size_t n) { return write((const uint8_t*)buf, n); }
+  size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+  size_t print(const String& x) { return write((const uint8_t*)x.c_str(), x.length()); }
+  size_t print(const char* x) { return write((const uint8_t*)x, strlen(x)); }
+  size_t print(char x) { return write((uint8_t)x); }
+  size_t print(int x) { return print(String(x)); }
+  size_t print(unsigned x) { return print(String(x)); }
+  size_t print(long x) { return print(String(x)); }
+  size_t print(unsigned long x) { return print(String(x)); }
+  size_t print(double x, int digits = 2) { return print(String(x, digits)); }
+  template<typename T> size_t println(const T& x) { return print(x) + print("\r\n"); }
+  size_t println() { return print("\r\n"); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+  void setTimeout(unsigned long) {}
+  String readStringUntil(char term) {
+    String r;
+    for (int c; (c = read()) >= 0 && c != term;) r += (char)c;
+    return r;
+  }
+};
+
+// UART: what the simulator feeds in comes out of read(); writes go to stdout
+// (Serial) or nowhere (sensor ports).
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uart) : _uart(uart) {}
+  void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+  int available() override { return (int)(_rx.size() - _rxPos); }
+  int read() override { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos++] : -1; }
+  int peek() override { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos] : -1; }
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+
+  // Simulator side: bytes the device would receive
+  void feed(const uint8_t* data, size_t n) {
+    if (_rxPos == _rx.size()) { _rx.clear(); _rxPos = 0; }
+    _rx.append((const char*)data, n);
+  }
+
+ private:
+  int _uart;
+  std::string _rx;
+  size_t _rxPos = 0;
+};
+
+extern HardwareSerial Serial;
+
+// ------------------- ESP / FreeRTOS -------------------
+
+struct EspClass {
+  uint32_t getFreeHeap();
+  uint32_t getHeapSize();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  [[noreturn]] void restart();
+};
+extern EspClass ESP;
+
+// One task besides loop(): it runs on its own thread in lockstep with the
+// simulator clock, so only one of the two ever executes at a time.
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline TickType_t xTaskGetTickCount() { return millis(); }
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackBytes, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle);
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
@@ -0,0 +1,17 @@
+#pragma once
+#include "Arduino.h"
+
+typedef int ota_error_t;
+
+class ArduinoOTAClass {
+ public:
+  void setHostname(const char*) {}
+  void setPassword(const char*) {}
+  void onStart(std::function<void()>) {}
+  void onEnd(std::function<void()>) {}
+  void onError(std::function<void(ota_error_t)>) {}
+  void begin() {}
+  void handle() {}
+};
+
+extern ArduinoOTAClass ArduinoOTA;
@@ -0,0 +1,82 @@
+#pragma once
+
+// ==================== FS / SD (HOST) ====================
+// The SD card is a directory on the host (host::sdRoot()). Paths are the
+// card's absolute paths; File mirrors the ESP32 core 2.x API, including
+// name() returning the last path component.
+
+#include "Arduino.h"
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+
+class File : public Stream {
+ public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> impl) : _impl(std::move(impl)) {}
+
+  operator bool() const { return (bool)_impl; }
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(uint8_t* buf, size_t n);
+  size_t readBytes(char* buf, size_t n);
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void flush();
+  void close() { _impl.reset(); }
+  const char* name() const;
+  const char* path() const;
+  bool isDirectory() const;
+  time_t getLastWrite();
+  File openNextFile(const char* mode = FILE_READ);
+  void rewindDirectory();
+
+ private:
+  std::shared_ptr<FileImpl> _impl;
+};
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = FILE_READ, bool create = false);
+  File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path) { return mkdir(path.c_str()); }
+  bool rmdir(const char* path);
+  bool rmdir(const String& path) { return rmdir(path.c_str()); }
+};
+
+class SDFS : public FS {
+ public:
+  bool begin(uint8_t ssPin = 5);
+  void end() {}
+  uint64_t cardSize();
+  uint64_t totalBytes();
+  uint64_t usedBytes();
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
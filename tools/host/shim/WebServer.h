@@ -0,0 +1,111 @@
+#pragma once
+
+// ==================== WebServer (HOST) ====================
+// The ESP32 core 2.x synchronous WebServer: one client at a time, the same
+// handleClient() state machine (wait for the request, run the handler, then
+// linger up to 2 s for the client to close) and the same header and chunked
+// framing. Connections come from a TCP port (host::listen) or from in-process
+// requests (host::request). multipart/form-data uploads are not parsed.
+
+#include "Arduino.h"
+#include "FS.h"
+#include "WiFi.h"
+#include <map>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+#define HTTP_UPLOAD_BUFLEN 1436
+#define HTTP_MAX_DATA_WAIT 5000
+#define HTTP_MAX_CLOSE_WAIT 2000
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize = 0;
+  size_t currentSize = 0;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class WebServer {
+ public:
+  typedef std::function<void()> THandlerFunction;
+
+  explicit WebServer(int port = 80) : _port(port) {}
+  virtual ~WebServer() {}
+
+  void begin();
+  void handleClient();
+
+  void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn) { _routes.push_back({uri.s, method, fn}); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction upload) {
+    (void)upload;
+    on(uri, method, fn);
+  }
+  void onNotFound(THandlerFunction fn) { _notFound = fn; }
+  void collectHeaders(const char* headerKeys[], size_t count);
+
+  String uri() const { return _currentUri; }
+  HTTPMethod method() const { return _currentMethod; }
+  WiFiClient client() { return _currentClient; }
+  HTTPUpload& upload() { return _upload; }
+
+  String arg(const String& name) const;
+  bool hasArg(const String& name) const;
+  int args() const { return (int)_args.size(); }
+  String header(const String& name) const;
+  bool hasHeader(const String& name) const;
+
+  void setContentLength(size_t len) { _contentLength = len; }
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void send(int code, const char* contentType = nullptr, const String& content = String());
+  void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+  void send(int code, const char* contentType, const char* content) { send(code, contentType, String(content)); }
+  void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, String(content)); }
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t len) {
+    send(code, contentType, String(content, len));
+  }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char* content, size_t len);
+  void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+  void sendContent_P(PGM_P content, size_t len) { sendContent(content, len); }
+
+ protected:
+  WiFiClient _currentClient;
+  uint8_t _currentVersion = 1;  // minor version: 0 = HTTP/1.0
+
+ private:
+  enum ClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+  };
+
+  bool parseRequest();
+  void handleRequest();
+  void parseArgs(const std::string& query);
+  void write(const char* data, size_t len);
+
+  int _port;
+  int _listenFd = -1;
+  ClientStatus _status = HC_NONE;
+  uint32_t _statusChange = 0;
+  std::vector<Route> _routes;
+  THandlerFunction _notFound;
+  String _currentUri;
+  HTTPMethod _currentMethod = HTTP_GET;
+  std::vector<std::pair<std::string, std::string>> _args;
+  std::vector<std::pair<std::string, std::string>> _headers;  // collected request headers
+  std::vector<std::string> _collect;
+  std::string _responseHeaders;
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  bool _chunked = false;
+  HTTPUpload _upload;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+// ==================== WIFI / SOCKETS (HOST) ====================
+// WiFiClient wraps a host socket: a TCP connection when the simulator listens
+// on a port, or one end of a socketpair for in-process requests. Copies share
+// the socket like the ESP32 core's handle does; write() blocks like the core's
+// (retrying up to ~10 s), so a stalled peer costs the same here as on the board.
+
+#include "Arduino.h"
+#include "Client.h"
+#include <memory>
+
+#define WIFI_STA 1
+#define WIFI_AP 2
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  explicit IPAddress(uint32_t v) : _v(v) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _v(((uint32_t)a << 24) | (b << 16) | (c << 8) | d) {}
+  bool operator==(const IPAddress& o) const { return _v == o._v; }
+  bool operator!=(const IPAddress& o) const { return _v != o._v; }
+  String toString() const {
+    char b[16];
+    snprintf(b, sizeof(b), "%u.%u.%u.%u", _v >> 24, (_v >> 16) & 255, (_v >> 8) & 255, _v & 255);
+    return String(b);
+  }
+
+ private:
+  uint32_t _v = 0;
+};
+
+struct HostSocket;
+
+class WiFiClient : public Client {
+ public:
+  WiFiClient() {}
+  static WiFiClient fromFd(int fd);  // takes ownership
+
+  int connect(const char* host, uint16_t port) override { return connect(host, port, 3000); }
+  int connect(const char* host, uint16_t port, int32_t timeoutMs);
+  uint8_t connected() override;
+  void stop() override { _sock.reset(); }
+  operator bool() const { return (bool)_sock; }
+
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t n);
+  int peek() override;
+  void flush() {}
+  void setNoDelay(bool) {}
+  int fd() const;
+  IPAddress remoteIP() const;
+
+ private:
+  std::shared_ptr<HostSocket> _sock;
+};
+
+class WiFiClass {
+ public:
+  void mode(int) {}
+  bool isConnected() { return true; }
+  int RSSI() { return -58; }
+  IPAddress localIP() { return IPAddress(192, 168, 1, 50); }
+  String macAddress() { return "02:00:00:00:00:01"; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,8 @@
+#pragma once
+#include "WiFi.h"
+
+class WiFiManager {
+ public:
+  void setConfigPortalTimeout(unsigned long) {}
+  bool autoConnect(const char*) { return true; }
+};
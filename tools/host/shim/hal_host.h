@@ -0,0 +1,51 @@
+#pragma once
+
+// ==================== HARDWARE SEAM (HOST) ====================
+// hal.h's names on top of the simulator: the card is a directory, the clock
+// is virtual, and the BME280 and PMS5003 read whatever the weather script in
+// host.cpp says is happening right now.
+
+#include <errno.h>
+#include <sys/socket.h>
+#include "Arduino.h"
+#include "SD.h"
+#include "WiFi.h"
+#include "config.h"
+#include "host.h"
+
+namespace hal {
+
+inline time_t now() { return host::wallNow(); }
+
+inline fs::SDFS& storage() { return SD; }
+
+struct EnvReading {
+  float tempC;
+  float humRH;
+  float pressurePa;  // station pressure
+};
+
+static constexpr uint32_t ENV_MEASURE_MS = 0;
+
+inline bool envBegin() { return true; }
+inline bool envTrigger() { return true; }
+
+inline bool envRead(EnvReading& out) {
+  host::Weather w = host::weatherAt((double)host::wallNow());
+  out.tempC = w.tempC;
+  out.humRH = w.humRH;
+  out.pressurePa = w.pressurePa;
+  return true;
+}
+
+HardwareSerial& pmsPort();
+inline void pmsBegin() {}
+
+inline int netWriteSome(WiFiClient& c, const uint8_t* data, size_t len) {
+  if (c.fd() < 0) return -1;
+  int n = (int)::send(c.fd(), data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n >= 0) return n;
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
+
+}  // namespace hal
@@ -0,0 +1,131 @@
+// Runs the sketch against a directory-backed card with simulated weather.
+//
+//   ./sim --sd sd --start 2025-12-01 --hours 48            log two days, accelerated
+//   ./sim --sd sd --hours 1 --get /api/now --get /api/days  then print the responses
+//   ./sim --sd sd --http 8080                              serve the web UI in real time
+//
+// Options:
+//   --sd DIR         card directory (default $SDROOT, else ./sd)
+//   --start T        wall time at power-on: epoch seconds or YYYY-MM-DD[THH:MM] UTC (default: now)
+//   --hours H        virtual hours to run before the requests / server (default 0)
+//   --script FILE    weather CSV (see host.h); default is a seeded diurnal model
+//   --seed N         seed of the diurnal model and pulse jitter
+//   --jitter F       +/- fraction of random pulse period jitter (default 0.05)
+//   --no-pms         no PMS5003 frames
+//   --step S         NTP step of S seconds after --hours (clock-jump test), then one more hour
+//   --get PATH       request PATH after the run and print status, headers and body (repeatable)
+//   --http PORT      then serve 127.0.0.1:PORT with the virtual clock following real time
+//   --quiet          no sketch Serial output
+
+#include "Arduino.h"
+#include "weather_station.ino"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static time_t parseStart(const char* s) {
+  int y, mo, d, h = 0, mi = 0;
+  if (sscanf(s, "%d-%d-%dT%d:%d", &y, &mo, &d, &h, &mi) >= 3) {
+    struct tm t = {};
+    t.tm_year = y - 1900;
+    t.tm_mon = mo - 1;
+    t.tm_mday = d;
+    t.tm_hour = h;
+    t.tm_min = mi;
+    return timegm(&t);
+  }
+  return (time_t)atoll(s);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: sim [--sd DIR] [--start T] [--hours H] [--script FILE] [--seed N] [--jitter F]\n"
+          "           [--no-pms] [--step S] [--get PATH]... [--http PORT] [--quiet]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  time_t start = time(nullptr);
+  double hours = 0;
+  const char* script = nullptr;
+  uint32_t seed = 1;
+  float jitter = 0.05f;
+  bool pms = true;
+  long step = 0;
+  int httpPort = 0;
+  std::vector<std::string> gets;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (a == "--sd") host::setSdRoot(next());
+    else if (a == "--start") start = parseStart(next());
+    else if (a == "--hours") hours = atof(next());
+    else if (a == "--script") script = next();
+    else if (a == "--seed") seed = (uint32_t)atol(next());
+    else if (a == "--jitter") jitter = (float)atof(next());
+    else if (a == "--no-pms") pms = false;
+    else if (a == "--step") step = atol(next());
+    else if (a == "--get") gets.push_back(next());
+    else if (a == "--http") httpPort = atoi(next());
+    else if (a == "--quiet") setenv("HOST_QUIET", "1", 1);
+    else usage();
+  }
+
+  host::setWall(start);
+  host::setWeather(host::diurnalWeather(seed));
+  if (script && !host::loadWeatherScript(script)) {
+    fprintf(stderr, "sim: cannot read %s\n", script);
+    return 1;
+  }
+  host::setPulseJitter(jitter);
+  host::setPmsEnabled(pms);
+
+  auto t0 = std::chrono::steady_clock::now();
+  host::boot();
+  const uint64_t hourMs = 3600ull * 1000;
+  for (uint64_t ms = (uint64_t)(hours * hourMs); ms > 0;) {
+    uint32_t slice = ms > hourMs ? (uint32_t)hourMs : (uint32_t)ms;
+    host::run(slice);
+    ms -= slice;
+  }
+  if (step) {
+    host::stepWall(step);
+    host::run((uint32_t)hourMs);
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  fprintf(stderr, "sim: %.1f virtual h in %.2f s, %llu SD opens\n", hours + (step ? 1 : 0), wallS,
+          (unsigned long long)host::sdOpens());
+
+  for (const std::string& g : gets) {
+    host::Response r = host::request(g);
+    printf("%s\r\n", r.headers.c_str());
+    fwrite(r.body.data(), 1, r.body.size(), stdout);
+    printf("\n");
+    fprintf(stderr, "sim: GET %s -> %d, %zu bytes, %.2f ms%s\n", g.c_str(), r.status, r.body.size(), r.renderMs,
+            r.complete ? "" : " (incomplete)");
+  }
+
+  if (httpPort) {
+    if (!host::listen((uint16_t)httpPort)) {
+      fprintf(stderr, "sim: cannot listen on %d\n", httpPort);
+      return 1;
+    }
+    fprintf(stderr, "sim: serving http://127.0.0.1:%d/\n", httpPort);
+    auto last = std::chrono::steady_clock::now();
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      auto now = std::chrono::steady_clock::now();
+      uint32_t ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
+      if (!ms) continue;
+      last += std::chrono::milliseconds(ms);
+      host::advance(ms);
+      host::loopOnce();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Latency of /api/now while a large ZIP download is running.
+
+  loadtest.py http://192.168.1.50 [--days 30] [--method deflate] [--zip-rate 200]
+
+First polls /api/now on its own for --idle seconds, then starts
+/download_zip?days=N and keeps polling until the archive has arrived, and
+prints p50/p90/p99/max of both phases. --zip-rate reads the ZIP at that many
+KB/s through a small receive buffer, the way a phone on a weak WiFi link does;
+0 reads as fast as the station sends. The archive is checked with zipfile at
+the end. Needs nothing beyond the Python standard library.
+"""
+
+import argparse
+import http.client
+import io
+import math
+import socket
+import sys
+import threading
+import time
+import urllib.parse
+import zipfile
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of a non-empty list."""
+    s = sorted(values)
+    k = max(0, min(len(s) - 1, math.ceil(p / 100.0 * len(s)) - 1))
+    return s[k]
+
+
+def get_now(host, port, timeout):
+    """One /api/now round trip in seconds (connect included); None on failure."""
+    t0 = time.perf_counter()
+    try:
+        conn = http.client.HTTPConnection(host, port, timeout=timeout)
+        conn.request("GET", "/api/now")
+        resp = conn.getresponse()
+        resp.read()
+        conn.close()
+        if resp.status != 200:
+            return None
+    except (OSError, http.client.HTTPException):
+        return None
+    return time.perf_counter() - t0
+
+
+class ZipDownload(threading.Thread):
+    """Pulls /download_zip over a raw socket so the read rate can be capped."""
+
+    def __init__(self, host, port, path, rate_kbs, timeout):
+        super().__init__(daemon=True)
+        self.host, self.port, self.path = host, port, path
+        self.rate = rate_kbs * 1024.0
+        self.timeout = timeout
+        self.status = None
+        self.body = b""
+        self.error = None
+        self.seconds = 0.0
+
+    def run(self):
+        t0 = time.perf_counter()
+        try:
+            s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            if self.rate > 0:
+                s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 8192)
+            s.settimeout(self.timeout)
+            s.connect((self.host, self.port))
+            s.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n"
+                       % (self.path, self.host)).encode())
+            raw = bytearray()
+            got = 0
+            while True:
+                chunk = s.recv(4096)
+                if not chunk:
+                    break
+                raw += chunk
+                got += len(chunk)
+                if self.rate > 0:
+                    ahead = got / self.rate - (time.perf_counter() - t0)
+                    if ahead > 0:
+                        time.sleep(ahead)
+            s.close()
+            self.status, self.body = parse_response(bytes(raw))
+        except (OSError, ValueError) as e:
+            self.error = str(e)
+        self.seconds = time.perf_counter() - t0
+
+
+def parse_response(raw):
+    head, _, body = raw.partition(b"\r\n\r\n")
+    lines = head.decode("latin-1").split("\r\n")
+    status = int(lines[0].split()[1])
+    headers = {}
+    for line in lines[1:]:
+        k, _, v = line.partition(":")
+        headers[k.strip().lower()] = v.strip()
+    if headers.get("transfer-encoding", "").lower() == "chunked":
+        out = bytearray()
+        while True:
+            size_line, _, body = body.partition(b"\r\n")
+            n = int(size_line.split(b";")[0], 16)
+            if n == 0:
+                break
+            out += body[:n]
+            body = body[n + 2:]
+        body = bytes(out)
+    return status, body
+
+
+def poll(host, port, interval, timeout, until, lat, failures):
+    while not until():
+        t = get_now(host, port, timeout)
+        if t is None:
+            failures[0] += 1
+        else:
+            lat.append(t)
+        time.sleep(interval)
+
+
+def report(name, lat, failures):
+    if not lat:
+        print("%-14s no successful requests (%d failed)" % (name, failures))
+        return
+    ms = [x * 1000.0 for x in lat]
+    print("%-14s n=%-5d p50=%7.1f ms  p90=%7.1f ms  p99=%7.1f ms  max=%7.1f ms  failed=%d" % (
+        name, len(ms), percentile(ms, 50), percentile(ms, 90), percentile(ms, 99), max(ms), failures))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("url", help="station base URL, e.g. http://192.168.1.50")
+    ap.add_argument("--days", type=int, default=30, help="days in the ZIP (default 30)")
+    ap.add_argument("--method", choices=("store", "deflate"), default="store")
+    ap.add_argument("--zip-rate", type=float, default=200.0, help="KB/s the ZIP is read at (0 = unthrottled)")
+    ap.add_argument("--interval", type=float, default=0.1, help="pause between /api/now polls, s")
+    ap.add_argument("--pollers", type=int, default=2, help="concurrent /api/now pollers")
+    ap.add_argument("--idle", type=float, default=5.0, help="seconds of polling before the download")
+    ap.add_argument("--timeout", type=float, default=30.0)
+    args = ap.parse_args()
+
+    u = urllib.parse.urlparse(args.url if "//" in args.url else "http://" + args.url)
+    host, port = u.hostname, u.port or 80
+
+    def run_phase(until):
+        lat, failures = [], [0]
+        threads = [threading.Thread(target=poll, daemon=True,
+                                    args=(host, port, args.interval, args.timeout, until, lat, failures))
+                   for _ in range(args.pollers)]
+        for t in threads:
+            t.start()
+        return threads, lat, failures
+
+    t_end = time.perf_counter() + args.idle
+    threads, idle_lat, idle_fail = run_phase(lambda: time.perf_counter() >= t_end)
+    for t in threads:
+        t.join()
+
+    path = "/download_zip?days=%d" % args.days
+    if args.method == "deflate":
+        path += "&method=deflate"
+    dl = ZipDownload(host, port, path, args.zip_rate, args.timeout)
+    dl.start()
+    threads, busy_lat, busy_fail = run_phase(lambda: not dl.is_alive())
+    dl.join()
+    for t in threads:
+        t.join()
+
+    print("%s  %s  zip-rate %s" % (args.url, path, "%g KB/s" % args.zip_rate if args.zip_rate > 0 else "unthrottled"))
+    report("idle", idle_lat, idle_fail[0])
+    report("during zip", busy_lat, busy_fail[0])
+    if dl.error or dl.status != 200:
+        print("zip: failed (%s)" % (dl.error or "HTTP %s" % dl.status))
+        return 1
+    try:
+        with zipfile.ZipFile(io.BytesIO(dl.body)) as z:
+            bad = z.testzip()
+            entries = len(z.infolist())
+    except zipfile.BadZipFile as e:
+        print("zip: %d bytes, not a valid archive (%s)" % (len(dl.body), e))
+        return 1
+    print("zip: %d bytes, %d entries in %.1f s (%.0f KB/s)%s" % (
+        len(dl.body), entries, dl.seconds, len(dl.body) / 1024.0 / max(dl.seconds, 1e-6),
+        "" if bad is None else ", CRC error in " + bad))
+    return 0 if bad is None else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -52,6 +52,10 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
   "local_time": "2025-12-18 22:25",
   "wind_pps": 0.7,
   "wind_ms": 1.2,
+  "wind_inst_ms": 1.31,
+  "wind_3s_ms": 1.17,
+  "wind_gust_ms": 2.45,
+  "wind_std_ms": 0.38,
   "bme280_ok": true,
   "temp_c": 23.4,
   "hum_rh": 55.1,
@@ -65,15 +69,46 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
   "aqi_pm10": 45,
   "aqi_pm10_category": "Good",
   "sd_ok": true,
+  "loading": false,
+  "sd_log_pending": 2,
+  "sd_flushes": 57,
+  "sd_flush_errors": 0,
+  "sd_flush_last_ms": 38,
+  "sd_flush_max_ms": 112,
+  "sd_bytes_written": 74210,
+  "sd_journal_bytes": 11840,
+  "sd_journal_replayed": 0,
+  "sd_rows_dropped": 0,
+  "acq_windows": 12340,
+  "acq_late_windows": 0,
+  "acq_overrun_avg_ms": 0.004,
+  "acq_overrun_max_ms": 1.012,
+  "acq_busy_max_ms": 3.870,
+  "acq_queue_full": 0,
+  "acq_gap_fills": 0,
+  "acq_clock_backsteps": 0,
+  "acq_stack_free": 2412,
+  "mqtt_connected": true,
+  "mqtt_queued": 0,
+  "mqtt_published": 1440,
+  "mqtt_dropped": 0,
+  "mqtt_connects": 1,
+  "mqtt_ack_ms": 12,
+  "mqtt_lag_s": 147,
   "cpu_temp_c": 45.2,
   "uptime_s": 12345,
   "retention_days": 360,
   "wifi_rssi": -65,
   "free_heap": 245000,
-  "heap_size": 327680
+  "heap_size": 327680,
+  "boot_http_ms": 1840,
+  "boot_first_request_ms": 2315,
+  "boot_history_ms": 9620
 }</code></pre>
     <table>
-      <tr><td><b>wind_ms</b></td><td>m/s</td><td>wind speed in meters per second</td></tr>
+      <tr><td><b>wind_ms</b></td><td>m/s</td><td>wind speed in meters per second (last 1 s window)</td></tr>
+      <tr><td><b>wind_inst_ms</b></td><td>m/s</td><td>instantaneous speed from the last pulse period</td></tr>
+      <tr><td><b>wind_3s_ms</b></td><td>m/s</td><td>mean over the last 3 s; wind_gust_ms / wind_std_ms: gust and std dev of the current bucket so far</td></tr>
       <tr><td><b>temp_c</b></td><td>°C</td><td>temperature in Celsius</td></tr>
       <tr><td><b>hum_rh</b></td><td>%</td><td>relative humidity percentage</td></tr>
       <tr><td><b>press_hpa</b></td><td>hPa</td><td>atmospheric pressure in hectopascals</td></tr>
@@ -83,9 +118,36 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
       <tr><td><b>cpu_temp_c</b></td><td>°C</td><td>CPU temperature in Celsius</td></tr>
       <tr><td><b>wifi_rssi</b></td><td>dBm</td><td>WiFi signal strength in decibel-milliwatts</td></tr>
       <tr><td><b>uptime_s</b></td><td>seconds</td><td>device uptime in seconds</td></tr>
+      <tr><td><b>loading</b></td><td></td><td>false once the history is read from SD after boot; until then {stage, stage_index, stages, files_done, files} (also in /api/days and /api/series)</td></tr>
+      <tr><td><b>boot_history_ms</b></td><td>ms</td><td>millis() when the history finished loading (boot_http_ms: server started, boot_first_request_ms: first request; 0 = not yet)</td></tr>
+      <tr><td><b>sd_log_pending</b></td><td>rows</td><td>buckets buffered in RAM, not yet written to the daily files</td></tr>
+      <tr><td><b>sd_flush_last_ms</b></td><td>ms</td><td>duration of the last batched SD write (max since boot in sd_flush_max_ms)</td></tr>
+      <tr><td><b>sd_bytes_written</b></td><td>bytes</td><td>bytes written to the daily files since boot (journal: sd_journal_bytes)</td></tr>
+      <tr><td><b>sd_rows_dropped</b></td><td>rows</td><td>buckets not logged because the buffer was full and the card kept refusing writes, or empty gap-fill rows the card refused (sd_journal_replayed: rows recovered from the journal at boot)</td></tr>
+      <tr><td><b>acq_overrun_avg_ms</b></td><td>ms</td><td>average amount a 1 s wind window ran long (max since boot in acq_overrun_max_ms; acq_late_windows counts windows &gt;10% long)</td></tr>
+      <tr><td><b>acq_queue_full</b></td><td>ticks</td><td>times a finished bucket waited because the web server was busy</td></tr>
+      <tr><td><b>acq_gap_fills</b></td><td>count</td><td>forward clock jumps; the skipped buckets are logged as empty rows (acq_clock_backsteps: backward steps)</td></tr>
+      <tr><td><b>mqtt_queued</b></td><td>buckets</td><td>waiting for the MQTT broker (RAM batch plus /mqtt.q on the SD card); mqtt_published / mqtt_dropped count since boot</td></tr>
+      <tr><td><b>mqtt_ack_ms</b></td><td>ms</td><td>PUBLISH to PUBACK of the last bucket batch (mqtt_lag_s: age of its newest bucket by then)</td></tr>
     </table>
   </div>
 
+  <div class="card">
+    <div><code>/api/stream</code></div>
+    <div class="muted">Server-Sent Events instead of polling /api/now. <b>now</b>: every second, the /api/now readings (epoch … loading);
+    <b>status</b>: every 10 s, cpu_temp_c, uptime_s, retention_days, wifi_rssi, free_heap, heap_size, boot_*_ms;
+    <b>bucket</b>: on each finalized bucket, {cursor, bucket} with the bucket as in /api/buckets.<br>
+    At most 4 streams at once (StreamConfig::MAX_CLIENTS); further requests get 503 {"ok":false,"error":"too_many_streams"}.</div>
+    <pre><code>event: now
+data: {"epoch":1734492345,"local_time":"2025-12-18 14:25:45","wind_pps":13.7,"wind_ms":1.2,...,"sd_ok":true}
+</code></pre>
+  </div>
+
+  <div class="card">
+    <div><code>/api/metrics</code></div>
+    <div class="muted">Prometheus text format: per-route request latency histograms, loop() and SD write timings, history loader time and bytes, boot milestones, heap low-water mark and largest free block, PMS5003 checksum errors. Compiled out with <code>METRICS_ENABLE 0</code>.</div>
+  </div>
+
   <div class="card">
     <div><code>/api/buckets</code></div>
     <div class="muted">Last 24h bucketed data with descriptive property names. Chunked transfer.</div>
@@ -98,6 +160,8 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
       "wind_speed_avg": 0.8,
       "wind_speed_max": 2.1,
       "wind_speed_samples": 12,
+      "wind_speed_std": 0.31,
+      "turbulence_intensity": null,
       "temperature": 22.9,
       "humidity": 56.0,
       "pressure": 1012.1,
@@ -110,7 +174,9 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
 </pre>
     <table>
       <tr><td><b>wind_speed_avg</b></td><td>m/s</td><td>average wind speed over 1min bucket</td></tr>
-      <tr><td><b>wind_speed_max</b></td><td>m/s</td><td>maximum wind speed in 1min bucket</td></tr>
+      <tr><td><b>wind_speed_max</b></td><td>m/s</td><td>gust: highest 3 s running mean in the bucket</td></tr>
+      <tr><td><b>wind_speed_std</b></td><td>m/s</td><td>standard deviation of the 1 s wind samples (null for buckets loaded from SD)</td></tr>
+      <tr><td><b>turbulence_intensity</b></td><td></td><td>wind_speed_std / mean wind; null below 1 m/s</td></tr>
       <tr><td><b>temperature</b></td><td>°C</td><td>temperature in Celsius</td></tr>
       <tr><td><b>humidity</b></td><td>%</td><td>relative humidity percentage</td></tr>
       <tr><td><b>pressure</b></td><td>hPa</td><td>atmospheric pressure in hectopascals</td></tr>
@@ -121,12 +187,14 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
   </div>
 
   <div class="card">
-    <div><code>/api/buckets_compact</code></div>
+    <div><code>/api/buckets_compact?since=</code></div>
     <div class="muted">Compact array format (no keys). Full precision floats. Chunked with batching.<br>
-    Array: [epoch, avgWind, maxWind, samples, tempC, humRH, pressHpa, pm1, pm25, pm10]</div>
+    Array: [epoch, avgWind, maxWind, samples, tempC, humRH, pressHpa, pm1, pm25, pm10]<br>
+    Optional since=&lt;cursor&gt;: only buckets newer than the cursor, plus the in-progress one.</div>
     <pre><code>{
   "now_epoch": 1734492345,
   "bucket_seconds": 60,
+  "cursor": 1734492240,
   "buckets": [
     [1734489600, 0.8, 2.1, 12, 22.9, 56.0, 1012.1, 5.2, 12.8, 18.4]
   ]
@@ -145,9 +213,33 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
     </table>
   </div>
 
+  <div class="card">
+    <div><code>/api/buckets.bin?since=</code></div>
+    <div class="muted">The buckets_compact data as little-endian binary columns (about 1/3 of the size).<br>
+    Header (24 B): "WSBB", u16 version, u16 valueColumns, u32 count, u32 now_epoch, u32 cursor, u16 bucket_seconds, u16 epochBytes.<br>
+    Then per column i16 scale, i16 offset (value = q / scale + offset); epochs as LEB128 varints (first absolute, then deltas, padded to 4 B);
+    u16 samples[count]; i16 values[count] per column: avgWind, maxWind, tempC, humRH, pressHpa, pm1, pm25, pm10. -32768 = no data.</div>
+  </div>
+
+  <div class="card">
+    <div><code>/api/series?from=&amp;to=&amp;points=</code></div>
+    <div class="muted">Downsampled history up to 30 days. Defaults: last 24h, 500 points (max 1000).<br>
+    Served from the raw 1-min buckets (48h), 10-min rollups (7 days) or hourly rollups (30 days): the coarsest one still finer than the requested spacing.<br>
+    Each point is a bin starting at epoch and keeps the bin's min/max, so peaks survive downsampling.</div>
+    <pre><code>{
+  "from": 1733887545, "to": 1734492345,
+  "source_seconds": 600, "bin_seconds": 1800,
+  "fields": ["epoch","avgWind","maxWind","avgTemp","minTemp","maxTemp","avgHum","minHum","maxHum",
+             "avgPress","minPress","maxPress","avgPM1","maxPM1","avgPM25","maxPM25","avgPM10","maxPM10"],
+  "points": [
+    [1733887200, 1.2, 4.8, 22.1, 21.7, 22.6, 55.0, 54.1, 56.2, 1012.1, 1011.9, 1012.3, 5.2, 6.0, 12.8, 14.1, 18.4, 21.0]
+  ]
+}</code></pre>
+  </div>
+
   <div class="card">
     <div><code>/api/days</code></div>
-    <div class="muted">Daily summaries.</div>
+    <div class="muted">Daily summaries. Sent with an ETag; If-None-Match gets 304 until a bucket or day is finalized.</div>
     <pre><code>{
   "days": [
     {
@@ -169,7 +261,13 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
       "avgPM25": 12.4,
       "maxPM25": 18.9,
       "avgPM10": 18.1,
-      "maxPM10": 25.7
+      "maxPM10": 25.7,
+      "p50Wind": 1.0,
+      "p95Wind": 3.9,
+      "p50Temp": 23.8,
+      "p95Temp": 27.6,
+      "p50PM25": 11.9,
+      "p95PM25": 17.2
     }
   ]
 }</code></pre>
@@ -191,15 +289,49 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
       <tr><td><b>maxPM25</b></td><td>μg/m³</td><td>maximum particulate matter 2.5 for the day</td></tr>
       <tr><td><b>avgPM10</b></td><td>μg/m³</td><td>average particulate matter 10 for the day</td></tr>
       <tr><td><b>maxPM10</b></td><td>μg/m³</td><td>maximum particulate matter 10 for the day</td></tr>
+      <tr><td><b>p50* / p95*</b></td><td></td><td>median / 95th percentile of the day's 1-min values (Wind, Temp, PM25), estimated from the day's histogram</td></tr>
     </table>
   </div>
 
   <div class="card">
-    <div><code>/api/files</code></div>
-    <div class="muted">List available CSV files.</div>
+    <div><code>/api/histogram?ch=&amp;days=</code> or <code>?ch=&amp;hours=</code></div>
+    <div class="muted">Distribution of 1-min values for wind_speed_avg, temperature and pm25 (ch omitted = all).<br>
+    days=N: today plus the N−1 days before it (default 1); hours=N: last N hours from RAM (max 48). above=x adds hours_above.<br>
+    counts[i] = buckets below edges[i]; the last count is at or above the last edge. p50/p95 are interpolated within a bin.</div>
+    <pre><code>{
+  "days": 7, "from": 1791723600, "bucket_seconds": 60,
+  "histograms": [
+    {
+      "channel": "wind_speed_avg", "unit": "m/s",
+      "edges": [0.5, 1.6, 3.4, 5.5, 8.0, 10.8, 13.9, 17.2, 20.8, 24.5, 28.5, 32.7],
+      "counts": [0, 853, 3085, 3454, 649, 0, 0, 0, 0, 0, 0, 0, 0],
+      "count": 8041, "min": 1.006, "max": 5.984, "p50": 3.450, "p95": 5.684, "hours_above": 24.52
+    }
+  ]
+}</code></pre>
+  </div>
+
+  <div class="card">
+    <div><code>/api/range?from=&amp;to=&amp;agg=hour|day|month&amp;fields=</code></div>
+    <div class="muted">Aggregates over the whole SD archive. Defaults: to = now, from = to − 30 days, agg = day, all fields.
+    fields: /api/days keys (maxWind, avgTemp, ...) or channel names (Temp = avg/min/max). Whole finished days come from days.idx;
+    other days are read from their files and indexed for next time. Errors: 400 bad_range, bad_agg, unknown_field, range_too_long.</div>
+    <pre><code>{
+  "from": 1759240800, "to": 1792206000, "agg": "month",
+  "fields": ["epoch","maxWind","avgTemp","minTemp","maxTemp"],
+  "rows": [[1759240800, 11.915, 11.00, 4.29, 17.88], [1761915600, 11.963, 14.97, 7.98, 21.95]],
+  "days_from_index": 380, "files_read": 1
+}</code></pre>
+  </div>
+
+  <div class="card">
+    <div><code>/api/files?page=&amp;per_page=&amp;from=&amp;to=</code></div>
+    <div class="muted">One page of the daily CSV files, newest first. from/to (YYYYMMDD or YYYY-MM-DD, inclusive) are optional; per_page is at most 500. Served from an in-RAM catalog filled once after boot (loading is true until then).</div>
     <pre><code>{
   "ok": true,
   "dir": "data",
+  "loading": false,
+  "total": 412, "page": 1, "per_page": 30, "pages": 14,
   "files": [
     { "path": "20251218.csv", "size": 12345 },
     { "path": "20251217.csv", "size": 12001 }
@@ -225,8 +357,9 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
   </div>
 
   <div class="card">
-    <div><code>/download_zip?days=N</code></div>
-    <div class="muted">Stream a ZIP of the last N daily CSV files.</div>
+    <div><code>/download_zip?days=N</code> or <code>?from=YYYYMMDD&amp;to=YYYYMMDD</code></div>
+    <div class="muted">Stream a ZIP of daily CSV files. Uncompressed by default, with Content-Length and Range support (resumable); add <code>&amp;method=deflate</code> for a compressed, chunked ZIP.</div>
+    <div class="muted mt-1">Both downloads are sent in the background, so other requests are answered meanwhile. At most 3 run at once (2 per client); more get 503 with <code>Retry-After</code>. The bucket, series, range and days responses are sent the same way and share 6 slots with the downloads.</div>
   </div>
 
   <h2 style="margin-top:32px;">Endpoints requiring a password</h2>
@@ -258,7 +391,8 @@ static const char API_HELP_HTML[] PROGMEM = R"HTML(
 
   <div class="card">
     <div><code>/upload</code> (POST, pw)</div>
-    <div class="muted">Upload files to the SD card. Requires multipart form data with <code>file</code>, <code>path</code>, and <code>pw</code> fields.</div>
+    <div class="muted">Upload files to the SD card. Requires multipart form data with <code>file</code>, <code>path</code>, and <code>pw</code> fields.<br>
+    A <code>&lt;path&gt;.gz</code> copy is served to browsers accepting gzip; uploading the plain file deletes the old one.</div>
     <div class="muted mt-1">Example:</div>
     <pre><code>curl -F "file=@index.html" -F "path=/web/index.html" -F "pw=yourpassword" http://device-ip/upload</code></pre>
     <div class="muted mt-1">Response:</div>
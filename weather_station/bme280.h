@@ -0,0 +1,118 @@
+#pragma once
+
+// ==================== BME280 REGISTERS & COMPENSATION ====================
+// Register map and the Bosch fixed-point compensation (BME280 datasheet 4.2.3).
+// One burst read of 0xF7..0xFE returns raw pressure, temperature and humidity;
+// compensate() turns it into 0.01 degC, Pa (Q24.8) and %RH (Q22.10) sharing a
+// single t_fine. No bus access here, so a host build can exercise it as is.
+
+#include <stdint.h>
+
+namespace bme280 {
+
+static constexpr uint8_t REG_CALIB_TP = 0x88;  // dig_T1..dig_P9, 0xA0 unused, dig_H1 at 0xA1
+static constexpr uint8_t CALIB_TP_LEN = 26;
+static constexpr uint8_t REG_CHIP_ID = 0xD0;
+static constexpr uint8_t CHIP_ID = 0x60;
+static constexpr uint8_t REG_RESET = 0xE0;
+static constexpr uint8_t RESET_WORD = 0xB6;
+static constexpr uint8_t REG_CALIB_H = 0xE1;   // dig_H2..dig_H6
+static constexpr uint8_t CALIB_H_LEN = 7;
+static constexpr uint8_t REG_CTRL_HUM = 0xF2;
+static constexpr uint8_t REG_STATUS = 0xF3;
+static constexpr uint8_t REG_CTRL_MEAS = 0xF4;
+static constexpr uint8_t REG_CONFIG = 0xF5;
+static constexpr uint8_t REG_DATA = 0xF7;      // press_msb .. hum_lsb
+static constexpr uint8_t DATA_LEN = 8;
+
+static constexpr uint8_t STATUS_IM_UPDATE = 0x01;  // NVM calibration still being copied
+static constexpr uint8_t MODE_SLEEP = 0;
+static constexpr uint8_t MODE_FORCED = 1;
+static constexpr uint8_t MODE_NORMAL = 3;
+static constexpr int32_t ADC_SKIPPED = 0x80000;    // 20-bit reset value: no conversion yet
+
+// Oversampling factor (1..16, 0 = skip) and IIR coefficient (0..16) to register codes
+constexpr uint8_t osrsCode(int x) { return x >= 16 ? 5 : x >= 8 ? 4 : x >= 4 ? 3 : x >= 2 ? 2 : x >= 1 ? 1 : 0; }
+constexpr uint8_t filterCode(int k) { return k >= 16 ? 4 : k >= 8 ? 3 : k >= 4 ? 2 : k >= 2 ? 1 : 0; }
+
+// Worst-case forced conversion time in microseconds (datasheet 9.1)
+constexpr uint32_t measureMaxUs(int osT, int osP, int osH) {
+  return 1250 + 2300 * (uint32_t)osT + (osP ? 2300 * (uint32_t)osP + 575 : 0) + (osH ? 2300 * (uint32_t)osH + 575 : 0);
+}
+
+struct Calib {
+  uint16_t T1; int16_t T2, T3;
+  uint16_t P1; int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+  uint8_t  H1; int16_t H2; uint8_t H3; int16_t H4, H5; int8_t H6;
+};
+
+// tp = 26 bytes from 0x88, h = 7 bytes from 0xE1
+inline bool parseCalib(const uint8_t* tp, const uint8_t* h, Calib& c) {
+  auto u16 = [](const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); };
+  c.T1 = u16(tp + 0);  c.T2 = (int16_t)u16(tp + 2);  c.T3 = (int16_t)u16(tp + 4);
+  c.P1 = u16(tp + 6);  c.P2 = (int16_t)u16(tp + 8);  c.P3 = (int16_t)u16(tp + 10);
+  c.P4 = (int16_t)u16(tp + 12); c.P5 = (int16_t)u16(tp + 14); c.P6 = (int16_t)u16(tp + 16);
+  c.P7 = (int16_t)u16(tp + 18); c.P8 = (int16_t)u16(tp + 20); c.P9 = (int16_t)u16(tp + 22);
+  c.H1 = tp[25];
+  c.H2 = (int16_t)u16(h + 0);
+  c.H3 = h[2];
+  c.H4 = (int16_t)(((int8_t)h[3] * 16) | (h[4] & 0x0F));
+  c.H5 = (int16_t)(((int8_t)h[5] * 16) | (h[4] >> 4));
+  c.H6 = (int8_t)h[6];
+  return c.T1 != 0 && c.P1 != 0;  // blank NVM or a failed read
+}
+
+struct Sample {
+  int32_t  tempC100;     // 0.01 degC
+  uint32_t pressQ24_8;   // Pa * 256
+  uint32_t humQ22_10;    // %RH * 1024
+};
+
+// d = 8 bytes from 0xF7. False when temperature wasn't converted (nothing to compensate).
+inline bool compensate(const Calib& c, const uint8_t* d, Sample& out) {
+  const int32_t adcP = ((int32_t)d[0] << 12) | ((int32_t)d[1] << 4) | (d[2] >> 4);
+  const int32_t adcT = ((int32_t)d[3] << 12) | ((int32_t)d[4] << 4) | (d[5] >> 4);
+  const int32_t adcH = ((int32_t)d[6] << 8) | d[7];
+  if (adcT == ADC_SKIPPED) return false;
+
+  // Temperature; t_fine feeds the other two
+  int32_t v1 = ((((adcT >> 3) - ((int32_t)c.T1 << 1))) * (int32_t)c.T2) >> 11;
+  int32_t v2 = (((((adcT >> 4) - (int32_t)c.T1) * ((adcT >> 4) - (int32_t)c.T1)) >> 12) * (int32_t)c.T3) >> 14;
+  const int32_t tFine = v1 + v2;
+  out.tempC100 = (tFine * 5 + 128) >> 8;
+
+  // Pressure, 64-bit variant
+  out.pressQ24_8 = 0;
+  if (adcP != ADC_SKIPPED) {
+    int64_t p1 = (int64_t)tFine - 128000;
+    int64_t p2 = p1 * p1 * (int64_t)c.P6;
+    p2 = p2 + ((p1 * (int64_t)c.P5) * 131072);
+    p2 = p2 + ((int64_t)c.P4 * 34359738368LL);
+    p1 = ((p1 * p1 * (int64_t)c.P3) >> 8) + ((p1 * (int64_t)c.P2) * 4096);
+    p1 = ((((int64_t)1 << 47) + p1) * (int64_t)c.P1) >> 33;
+    if (p1 != 0) {
+      int64_t p = 1048576 - adcP;
+      p = ((p * 2147483648LL - p2) * 3125) / p1;
+      p1 = ((int64_t)c.P9 * (p >> 13) * (p >> 13)) >> 25;
+      p2 = ((int64_t)c.P8 * p) >> 19;
+      p = ((p + p1 + p2) >> 8) + ((int64_t)c.P7 * 16);
+      out.pressQ24_8 = (uint32_t)p;
+    }
+  }
+
+  // Humidity
+  out.humQ22_10 = 0;
+  if (adcH != 0x8000) {
+    int32_t h = tFine - 76800;
+    h = (((((adcH << 14) - ((int32_t)c.H4 * 1048576) - ((int32_t)c.H5 * h)) + 16384) >> 15) *
+         (((((((h * (int32_t)c.H6) >> 10) * (((h * (int32_t)c.H3) >> 11) + 32768)) >> 10) + 2097152) *
+           (int32_t)c.H2 + 8192) >> 14));
+    h = h - (((((h >> 15) * (h >> 15)) >> 7) * (int32_t)c.H1) >> 4);
+    h = h < 0 ? 0 : h;
+    h = h > 419430400 ? 419430400 : h;
+    out.humQ22_10 = (uint32_t)(h >> 12);
+  }
+  return true;
+}
+
+} // namespace bme280
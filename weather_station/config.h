@@ -4,9 +4,9 @@
 
 // Security
 // UI and API password
-static const char* API_PASSWORD = "ChangeMe";
+static constexpr const char* API_PASSWORD = "ChangeMe";
 //Over the air update password
-static const char* OTA_PASSWORD = "PleaseChangeMe";
+static constexpr const char* OTA_PASSWORD = "PleaseChangeMe";
 
 // Wind Sensor (Pulse-based Anemometer)
 namespace WindConfig {
@@ -14,6 +14,10 @@ namespace WindConfig {
   static constexpr float PPS_TO_MS = 1.75f / 20.0f;     // Calibration: 20pps = 1.75m/s
   static constexpr uint32_t PPS_WINDOW_MS = 1000;       // Calculate every 1 second
   static constexpr uint32_t DEBOUNCE_US = 2000;         // 2ms debounce
+  static constexpr uint32_t PULSE_RING_SIZE = 1024;     // pulse timestamps buffered per PPS window; power of two
+  static constexpr uint32_t GUST_WINDOW_MS = 3000;      // gust = highest 3 s running mean (WMO)...
+  static constexpr uint32_t GUST_STEP_MS = 250;         // ...evaluated every 250 ms
+  static constexpr float    TI_MIN_WIND_MS = 1.0f;      // turbulence intensity only above this mean speed
 }
 
 // BME280 Environmental Sensor (I2C)
@@ -21,7 +25,12 @@ namespace BME280Config {
   static constexpr bool     ENABLE = true;
   static constexpr uint8_t  I2C_ADDR_PRIMARY = 0x76;
   static constexpr uint8_t  I2C_ADDR_FALLBACK = 0x77;
-  static constexpr uint32_t POLL_INTERVAL_MS = 2000;
+  static constexpr uint32_t POLL_INTERVAL_MS = 1000;  // One sample per PPS window; must divide the bucket
+  static constexpr bool     FORCED_MODE = true;        // One conversion per poll, started a window ahead (false = free-running)
+  static constexpr int      OVERSAMPLE_T = 2;          // 1, 2, 4, 8 or 16
+  static constexpr int      OVERSAMPLE_P = 16;
+  static constexpr int      OVERSAMPLE_H = 1;
+  static constexpr int      IIR_FILTER = 0;            // 0 (off), 2, 4, 8 or 16; bucket averaging already smooths
   static constexpr float    ALTITUDE_METERS = 580.0f;  // Station altitude for MSLP calculation (0 = sea level)
 }
 
@@ -29,10 +38,17 @@ namespace BME280Config {
 namespace PMS5003Config {
   static constexpr bool     ENABLE = true;
   static constexpr int      RX_PIN = 4;
-  static constexpr int      TX_PIN = 5;  // Not used, but required for Serial2.begin()
+  static constexpr int      TX_PIN = 5;  // Not used, but required for the UART begin()
   static constexpr uint32_t POLL_INTERVAL_MS = 2000;  // Poll every 2 seconds
 }
 
+// Sensor acquisition task (FreeRTOS); samples on its own cadence, independent of HTTP work in loop()
+namespace AcqConfig {
+  static constexpr uint32_t STACK_BYTES = 4096;
+  static constexpr int      PRIORITY = 3;               // loop() runs at 1
+  static constexpr uint32_t QUEUE_BUCKETS = 16;         // closed buckets waiting for loop(); power of two
+}
+
 // AQI (Air Quality Index) Calculation Standard
 // Choose which AQI standard to use:
 //   0 = EPA (United States Environmental Protection Agency)
@@ -52,6 +68,11 @@ namespace PMS5003Config {
 // IMPORTANT: If you change this, also update the color thresholds in web/app.js (setAQIPill function)
 #define AQI_STANDARD 1  // 0=EPA, 1=Australian
 
+// Performance metrics at /api/metrics (Prometheus text format): per-route
+// latency histograms, loop()/SD timings, heap and sensor counters.
+// 0 removes the endpoint and all instrumentation.
+#define METRICS_ENABLE 1
+
 // SD Card (SPI)
 namespace SDConfig {
   static constexpr bool ENABLE = true;
@@ -61,19 +82,43 @@ namespace SDConfig {
 // Data Logging
 namespace LogConfig {
   static constexpr int BUCKET_SECONDS = 60;             // Log interval (1 minute)
-  static constexpr int BUCKETS_24H = 24 * 60 * 60 / BUCKET_SECONDS;
+  static constexpr int RAM_HISTORY_HOURS = 48;          // Raw buckets kept in RAM (22 bytes each)
+  static constexpr int RAM_BUCKETS = RAM_HISTORY_HOURS * 60 * 60 / BUCKET_SECONDS;
   static constexpr int RETENTION_DAYS = 0;           // 0 = never delete
   static constexpr int DAYS_HISTORY = 30;               // RAM history
+  static constexpr int SD_FLUSH_INTERVAL_S = 300;       // Buffered rows are written to SD at least this often...
+  static constexpr int SD_FLUSH_MAX_BUCKETS = 10;       // ...or once this many are pending
+  static constexpr int GAP_FILL_MAX_HOURS = 48;         // Clock jumps forward log empty rows for at most this long
   static_assert((86400 % BUCKET_SECONDS) == 0, "BUCKET_SECONDS must divide evenly into 24h");
+  static_assert((BUCKET_SECONDS * 1000) % BME280Config::POLL_INTERVAL_MS == 0,
+                "BME280 polls must divide the bucket so every bucket gets the same sample count");
+}
+
+// Rollup tiers (RAM) for plotting beyond the raw bucket ring; 40 bytes per slot
+namespace RollupConfig {
+  static constexpr int TIER1_SECONDS = 10 * 60;          // 10-minute points...
+  static constexpr int TIER1_SLOTS = 7 * 24 * 6;         // ...for 7 days
+  static constexpr int TIER2_SECONDS = 60 * 60;          // hourly points...
+  static constexpr int TIER2_SLOTS = 30 * 24;            // ...for 30 days
+  static constexpr int SERIES_MAX_POINTS = 1000;         // cap for /api/series?points=
+  static_assert(TIER1_SECONDS % LogConfig::BUCKET_SECONDS == 0 && TIER2_SECONDS % TIER1_SECONDS == 0,
+                "rollup tiers must be multiples of the bucket interval");
+  static_assert((86400 % TIER2_SECONDS) == 0, "TIER2_SECONDS must divide evenly into 24h");
+}
+
+// /api/range: aggregates over the day files on the SD card
+namespace RangeConfig {
+  static constexpr int MAX_DAYS = 3660;                  // longest query; 4 bytes of RAM per day while it runs
+  static constexpr int YIELD_EVERY_DAYS = 32;            // days read from days.idx per loop() pass (a day file is a pass)
 }
 
 // Network & Time
 namespace NetworkConfig {
-  static const char* NTP_SERVER_1 = "pool.ntp.org";
-  static const char* NTP_SERVER_2 = "time.google.com";
-  static const char* NTP_SERVER_3 = "time.windows.com";
-  static const char* TIMEZONE = "AEST-10AEDT-11,M10.1.0/02:00:00,M4.1.0/03:00:00"; // Sydney
-  static const char* AP_NAME = "Anemometer-Setup";
+  static constexpr const char* NTP_SERVER_1 = "pool.ntp.org";
+  static constexpr const char* NTP_SERVER_2 = "time.google.com";
+  static constexpr const char* NTP_SERVER_3 = "time.windows.com";
+  static constexpr const char* TIMEZONE = "AEST-10AEDT-11,M10.1.0/02:00:00,M4.1.0/03:00:00"; // Sydney
+  static constexpr const char* AP_NAME = "Anemometer-Setup";
   static constexpr uint32_t AP_TIMEOUT_S = 180;
 }
 
@@ -81,8 +126,133 @@ namespace NetworkConfig {
 namespace UIConfig {
   static constexpr int FILES_PER_PAGE = 30;
   static constexpr int MAX_PLOT_POINTS = 500;
+  static constexpr size_t STATIC_CACHE_BYTES = 32 * 1024;  // RAM for index.html/app.js bodies (0 = always read SD)
+}
+
+// /api/stream (Server-Sent Events): one live update per PPS window, pushed to every open tab
+namespace StreamConfig {
+  static constexpr int      MAX_CLIENTS = 4;               // further tabs get 503 and poll /api/now
+  static constexpr uint32_t STATUS_INTERVAL_MS = 10000;    // RSSI / heap / CPU temperature
+  static constexpr uint32_t RETRY_MS = 3000;               // browser reconnect delay
 }
 
+// /download, /download_zip and the history API bodies are written from loop() as
+// each client's TCP window allows, so other requests are served while they run
+namespace HttpConfig {
+  static constexpr int      MAX_JOBS = 6;                  // bodies in progress at once (downloads + API); more get 503
+  static constexpr int      MAX_DOWNLOADS = 3;             // of which file downloads; more get 503 + Retry-After
+  static constexpr int      MAX_DOWNLOADS_PER_CLIENT = 2;  // per remote IP
+  static constexpr size_t   BLOCK_BYTES = 2048;            // body produced per download per loop() pass
+  static constexpr uint32_t STALL_TIMEOUT_MS = 30000;      // a client that takes nothing for this long is dropped
+  static_assert(BLOCK_BYTES >= 512, "BLOCK_BYTES must hold a few CSV rows");
+  static_assert(MAX_DOWNLOADS <= MAX_JOBS, "file downloads share the MAX_JOBS slots");
+}
+
+// MQTT publisher: pushes finalized buckets and live readings to a broker; buckets
+// it hasn't acknowledged wait on the SD card (/mqtt.q) until it is reachable again
+namespace MqttConfig {
+  static constexpr bool     ENABLE = false;
+  static constexpr const char* BROKER_HOST = "192.168.1.10";
+  static constexpr uint16_t BROKER_PORT = 1883;
+  static constexpr const char* CLIENT_ID = "weather-station";
+  static constexpr const char* USERNAME = "";                 // "" = anonymous
+  static constexpr const char* PASSWORD = "";
+  static constexpr const char* TOPIC_PREFIX = "weather_station";  // <prefix>/now, /buckets, /status
+  static constexpr uint16_t KEEPALIVE_S = 30;
+  static constexpr uint32_t LIVE_INTERVAL_MS = 10000;      // <prefix>/now (QoS 0, retained)
+  static constexpr int      BATCH_BUCKETS = 10;            // buckets per <prefix>/buckets message (QoS 1)...
+  static constexpr uint32_t BATCH_MAX_WAIT_S = 300;        // ...or fewer once the oldest has waited this long
+  static constexpr uint32_t REPLAY_INTERVAL_MS = 500;      // gap between queued batches after an outage
+  static constexpr uint32_t ACK_TIMEOUT_MS = 10000;        // CONNACK / PUBACK wait before reconnecting
+  static constexpr uint32_t CONNECT_TIMEOUT_MS = 1500;     // TCP connect; blocks loop() while the broker is down
+  static constexpr uint32_t RECONNECT_MIN_MS = 5000;       // retry delay, doubled per failure...
+  static constexpr uint32_t RECONNECT_MAX_MS = 300000;     // ...up to this
+  static constexpr int      QUEUE_MAX_DAYS = 7;            // SD queue cap (40 bytes per bucket); newer buckets are dropped
+  static_assert(BATCH_BUCKETS >= 1 && BATCH_BUCKETS <= 255, "BATCH_BUCKETS must be 1..255");
+}
+
+// ==================== SENSOR CHANNELS ====================
+// Every logged per-bucket quantity, in CSV column order. Bucket averaging, the
+// daily and rollup aggregates, the RAM bucket ring and the CSV / JSON writers
+// all loop over this table; a new sensor is a row here plus its poll code (and
+// a field in the on-disk records).
+
+enum ChannelStat : uint8_t {
+  STAT_AVG = 1 << 0,
+  STAT_MIN = 1 << 1,
+  STAT_MAX = 1 << 2,
+};
+
+struct ChannelDef {
+  const char* name;        // daily fields are avg<name> / min<name> / max<name>
+  const char* apiName;     // /api/buckets property
+  const char* unit;
+  uint8_t decimals;        // CSV / JSON digits
+  float qScale;            // RAM fixed point (int16): q = round((v - qOffset) * qScale)
+  float qOffset;
+  uint8_t dayStats;        // STAT_* kept per day and per rollup point
+  bool blankIfMissing;     // CSV writes an empty field instead of nan (optional sensor)
+};
+
+enum Channel : uint8_t {
+  CH_WIND, CH_GUST, CH_TEMP, CH_HUM, CH_PRESS, CH_PM1, CH_PM25, CH_PM10,
+  CH_COUNT
+};
+
+static constexpr ChannelDef CHANNELS[CH_COUNT] = {
+  // name    apiName           unit     dec  qScale  qOffset  day stats                        blank
+  {"Wind",  "wind_speed_avg", "m/s",    3, 100.0f,    0.0f, STAT_AVG,                        false},  // bucket mean
+  {"Wind",  "wind_speed_max", "m/s",    3, 100.0f,    0.0f, STAT_MAX,                        false},  // bucket 3 s gust
+  {"Temp",  "temperature",    "°C",     2, 100.0f,    0.0f, STAT_AVG | STAT_MIN | STAT_MAX,  false},
+  {"Hum",   "humidity",       "%",      2, 100.0f,    0.0f, STAT_AVG | STAT_MIN | STAT_MAX,  false},
+  {"Press", "pressure",       "hPa",    2, 100.0f, 1000.0f, STAT_AVG | STAT_MIN | STAT_MAX,  false},  // MSLP
+  {"PM1",   "pm1",            "μg/m³",  1,  10.0f,    0.0f, STAT_AVG | STAT_MAX,             true},
+  {"PM25",  "pm25",           "μg/m³",  1,  10.0f,    0.0f, STAT_AVG | STAT_MAX,             true},
+  {"PM10",  "pm10",           "μg/m³",  1,  10.0f,    0.0f, STAT_AVG | STAT_MAX,             true},
+};
+
+// Number of per-day values: one per STAT_* bit set above
+constexpr int channelDayStatCount() {
+  int n = 0;
+  for (const ChannelDef& c : CHANNELS) {
+    for (uint8_t s = STAT_AVG; s <= STAT_MAX; s <<= 1) n += (c.dayStats & s) ? 1 : 0;
+  }
+  return n;
+}
+
+static constexpr int DAY_STAT_COUNT = channelDayStatCount();
+
+// Daily histograms of bucket values, for /api/histogram and the p50/p95 fields of
+// /api/days. A bucket counts once, so a bin's count x BUCKET_SECONDS is the time
+// spent in it. Bins are given by ascending upper edges; the last bin is open-ended.
+namespace HistConfig {
+  static constexpr int MAX_EDGES = 15;                   // up to 16 bins; 40 bytes per histogram and day
+  static constexpr uint8_t PERCENTILES[] = {50, 95};     // reported in /api/days
+}
+
+struct HistogramDef {
+  uint8_t channel;                          // Channel
+  uint8_t edgeCount;
+  float edges[HistConfig::MAX_EDGES];
+};
+
+static constexpr HistogramDef HISTOGRAMS[] = {
+  // Beaufort scale (m/s)
+  {CH_WIND, 12, {0.5f, 1.6f, 3.4f, 5.5f, 8.0f, 10.8f, 13.9f, 17.2f, 20.8f, 24.5f, 28.5f, 32.7f}},
+  // 5 °C steps
+  {CH_TEMP, 11, {-10.0f, -5.0f, 0.0f, 5.0f, 10.0f, 15.0f, 20.0f, 25.0f, 30.0f, 35.0f, 40.0f}},
+#if AQI_STANDARD == 0
+  // US EPA AQI breakpoints (μg/m³), with 5 and 20 for the clean end
+  {CH_PM25, 7, {5.0f, 12.0f, 20.0f, 35.4f, 55.4f, 150.4f, 250.4f}},
+#else
+  // Australian AQI category limits (μg/m³), with 5 and 12.5 for the clean end
+  {CH_PM25, 7, {5.0f, 12.5f, 25.0f, 50.0f, 100.0f, 150.0f, 200.0f}},
+#endif
+};
+
+static constexpr int HIST_COUNT = sizeof(HISTOGRAMS) / sizeof(HISTOGRAMS[0]);
+static_assert(86400 / LogConfig::BUCKET_SECONDS <= 65535, "histogram bins count buckets in uint16");
+
 // ==================== PLOT CONFIGURATION ====================
 
 struct PlotSeries {
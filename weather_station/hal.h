@@ -0,0 +1,141 @@
+#pragma once
+
+// ==================== HARDWARE SEAM ====================
+// Everything the station logic needs from the board: wall clock, the data card,
+// the BME280, the PMS5003 byte stream and a non-blocking socket write. The sketch
+// only reaches hardware through hal:: so the core can be built off-device: the
+// host build in tools/host defines WS_HOST_BUILD and supplies hal_host.h with the
+// same names (directory-backed storage, a scriptable clock and sensor feeders).
+// millis()/micros()/attachInterrupt() stay the Arduino names; the host build
+// provides those in its Arduino.h shim.
+
+#if defined(WS_HOST_BUILD)
+#include "hal_host.h"
+#else
+
+#include <time.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+#include "config.h"
+#include "bme280.h"
+
+namespace hal {
+
+// Wall clock in epoch seconds (NTP-disciplined on the device)
+inline time_t now() { return time(nullptr); }
+
+// The data card; every /data and /web access goes through here
+inline fs::SDFS& storage() { return SD; }
+
+// One environmental reading, before the MSLP correction
+struct EnvReading {
+  float tempC;
+  float humRH;
+  float pressurePa;  // station pressure
+};
+
+// BME280 driven straight over Wire: calibration is read once, then each sample is
+// one 8-byte burst from 0xF7 plus the integer compensation in bme280.h. In forced
+// mode envTrigger() starts a conversion that envRead() collects on a later tick.
+struct BmeDevice {
+  uint8_t addr = 0;
+  bme280::Calib calib = {};
+};
+
+inline BmeDevice& bmeDevice() {
+  static BmeDevice dev;
+  return dev;
+}
+
+inline bool bmeWrite(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(bmeDevice().addr);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+inline bool bmeRead(uint8_t reg, uint8_t* buf, uint8_t len) {
+  Wire.beginTransmission(bmeDevice().addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(bmeDevice().addr, len) != len) return false;
+  for (uint8_t i = 0; i < len; i++) buf[i] = (uint8_t)Wire.read();
+  return true;
+}
+
+static constexpr uint8_t BME_CTRL_MEAS =
+  (bme280::osrsCode(BME280Config::OVERSAMPLE_T) << 5) | (bme280::osrsCode(BME280Config::OVERSAMPLE_P) << 2);
+
+// Worst-case conversion time for the configured oversampling
+static constexpr uint32_t ENV_MEASURE_MS =
+  (bme280::measureMaxUs(BME280Config::OVERSAMPLE_T, BME280Config::OVERSAMPLE_P, BME280Config::OVERSAMPLE_H) + 999) / 1000;
+
+inline bool envBegin() {
+  BmeDevice& dev = bmeDevice();
+  uint8_t id = 0;
+  dev.addr = BME280Config::I2C_ADDR_PRIMARY;
+  if (!bmeRead(bme280::REG_CHIP_ID, &id, 1) || id != bme280::CHIP_ID) {
+    dev.addr = BME280Config::I2C_ADDR_FALLBACK;
+    if (!bmeRead(bme280::REG_CHIP_ID, &id, 1) || id != bme280::CHIP_ID) return false;
+  }
+
+  bmeWrite(bme280::REG_RESET, bme280::RESET_WORD);
+  delay(3);
+  for (int i = 0; i < 20; i++) {
+    uint8_t status = 0;
+    if (bmeRead(bme280::REG_STATUS, &status, 1) && !(status & bme280::STATUS_IM_UPDATE)) break;
+    delay(2);
+  }
+
+  uint8_t tp[bme280::CALIB_TP_LEN], h[bme280::CALIB_H_LEN];
+  if (!bmeRead(bme280::REG_CALIB_TP, tp, sizeof(tp)) || !bmeRead(bme280::REG_CALIB_H, h, sizeof(h))) return false;
+  if (!bme280::parseCalib(tp, h, dev.calib)) return false;
+
+  // ctrl_hum only latches on the following ctrl_meas write. Standby 500 ms applies to normal mode only.
+  bmeWrite(bme280::REG_CTRL_HUM, bme280::osrsCode(BME280Config::OVERSAMPLE_H));
+  bmeWrite(bme280::REG_CONFIG, (4 << 5) | (bme280::filterCode(BME280Config::IIR_FILTER) << 2));
+  return bmeWrite(bme280::REG_CTRL_MEAS,
+                  BME_CTRL_MEAS | (BME280Config::FORCED_MODE ? bme280::MODE_SLEEP : bme280::MODE_NORMAL));
+}
+
+// Forced mode: start one conversion (ENV_MEASURE_MS later the result is readable)
+inline bool envTrigger() {
+  return bmeWrite(bme280::REG_CTRL_MEAS, BME_CTRL_MEAS | bme280::MODE_FORCED);
+}
+
+inline bool envRead(EnvReading& out) {
+  uint8_t d[bme280::DATA_LEN];
+  bme280::Sample s;
+  if (!bmeRead(bme280::REG_DATA, d, sizeof(d))) return false;
+  if (!bme280::compensate(bmeDevice().calib, d, s)) return false;
+  out.tempC = s.tempC100 / 100.0f;
+  out.pressurePa = s.pressQ24_8 ? s.pressQ24_8 / 256.0f : NAN;
+  out.humRH = BME280Config::OVERSAMPLE_H ? s.humQ22_10 / 1024.0f : NAN;
+  return true;
+}
+
+// PMS5003 UART. ESP32-C3 doesn't have Serial2 predefined, so UART1 is created here.
+inline HardwareSerial& pmsPort() {
+  static HardwareSerial port(1);
+  return port;
+}
+
+inline void pmsBegin() {
+  pmsPort().begin(9600, SERIAL_8N1, PMS5003Config::RX_PIN, PMS5003Config::TX_PIN);
+}
+
+// Writes what the socket's send buffer takes right now: 0 when it is full, -1
+// once the peer is gone. WiFiClient::write() would wait for the whole buffer.
+inline int netWriteSome(WiFiClient& c, const uint8_t* data, size_t len) {
+  int n = ::send(c.fd(), data, len, MSG_DONTWAIT);
+  if (n >= 0) return n;
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
+
+} // namespace hal
+
+#endif
@@ -0,0 +1,230 @@
+#pragma once
+
+// ==================== MQTT 3.1.1 SESSION ====================
+// The subset the publisher needs, over any Arduino Client: CONNECT (clean
+// session, last will, optional user/password), PUBLISH at QoS 0 or 1, PUBACK,
+// keep-alive pings and DISCONNECT. No subscriptions. Opening the socket is the
+// caller's job; after that nothing blocks: poll() parses whatever bytes have
+// arrived and sends PINGREQ when the link has been quiet for half the keep-alive.
+
+#include <Client.h>
+#include <string.h>
+
+namespace mqtt {
+
+static constexpr uint8_t CONNECT = 0x10;
+static constexpr uint8_t CONNACK = 0x20;
+static constexpr uint8_t PUBLISH = 0x30;
+static constexpr uint8_t PUBACK = 0x40;
+static constexpr uint8_t PINGREQ = 0xC0;
+static constexpr uint8_t PINGRESP = 0xD0;
+static constexpr uint8_t DISCONNECT = 0xE0;
+
+static constexpr size_t MAX_TOPIC = 128;
+
+// Remaining-length varint; returns bytes written (1..4)
+inline size_t putLength(uint8_t* out, uint32_t len) {
+  size_t n = 0;
+  do {
+    uint8_t b = len & 0x7F;
+    len >>= 7;
+    out[n++] = len ? (b | 0x80) : b;
+  } while (len && n < 4);
+  return n;
+}
+
+// UTF-8 string with its 16-bit length prefix
+inline size_t putString(uint8_t* out, const char* s, size_t len) {
+  out[0] = (uint8_t)(len >> 8);
+  out[1] = (uint8_t)len;
+  memcpy(out + 2, s, len);
+  return len + 2;
+}
+
+struct Will {
+  const char* topic;
+  const char* message;
+  bool retain;
+};
+
+class Session {
+ public:
+  enum State : uint8_t { IDLE, CONNECTING, CONNECTED };
+
+  explicit Session(Client& net) : _net(net) {}
+
+  State state() const { return _state; }
+  uint8_t connackCode() const { return _connack; }
+
+  // Sends CONNECT on an open socket; the session is CONNECTED once poll() sees the CONNACK
+  bool start(const char* clientId, const char* user, const char* pass, const Will& will,
+             uint16_t keepAliveS, uint32_t nowMs) {
+    const size_t idLen = strlen(clientId);
+    const size_t userLen = user ? strlen(user) : 0;
+    const size_t passLen = pass ? strlen(pass) : 0;
+    const size_t willTopicLen = will.topic ? strlen(will.topic) : 0;
+    const size_t willMsgLen = will.message ? strlen(will.message) : 0;
+    const uint32_t len = 10 + 2 + idLen + (willTopicLen ? 4 + willTopicLen + willMsgLen : 0) +
+                         (userLen ? 2 + userLen : 0) + (userLen && passLen ? 2 + passLen : 0);
+    if (len > 512) return false;
+
+    uint8_t buf[5 + 512];
+    size_t n = 0;
+    buf[n++] = CONNECT;
+    n += putLength(buf + n, len);
+    n += putString(buf + n, "MQTT", 4);
+    buf[n++] = 4;  // protocol level 3.1.1
+    uint8_t flags = 0x02;  // clean session
+    if (willTopicLen) flags |= 0x04 | (will.retain ? 0x20 : 0);
+    if (userLen) flags |= 0x80 | (passLen ? 0x40 : 0);
+    buf[n++] = flags;
+    buf[n++] = (uint8_t)(keepAliveS >> 8);
+    buf[n++] = (uint8_t)keepAliveS;
+    n += putString(buf + n, clientId, idLen);
+    if (willTopicLen) {
+      n += putString(buf + n, will.topic, willTopicLen);
+      n += putString(buf + n, will.message ? will.message : "", willMsgLen);
+    }
+    if (userLen) {
+      n += putString(buf + n, user, userLen);
+      if (passLen) n += putString(buf + n, pass, passLen);
+    }
+
+    _keepAliveMs = (uint32_t)keepAliveS * 1000UL;
+    _rxPos = 0;
+    _ack = 0;
+    _connack = 0xFF;
+    _pingOut = false;
+    _lastRxMs = nowMs;
+    _state = CONNECTING;
+    return send(buf, n, nowMs);
+  }
+
+  // packetId is echoed by the PUBACK (QoS 1 only); the payload goes out as is
+  bool publish(const char* topic, const uint8_t* payload, size_t len, bool qos1, bool retain,
+               uint16_t packetId, uint32_t nowMs) {
+    if (_state != CONNECTED) return false;
+    const size_t topicLen = strlen(topic);
+    if (topicLen > MAX_TOPIC) return false;
+    uint8_t buf[5 + 2 + MAX_TOPIC + 2];
+    size_t n = 0;
+    buf[n++] = PUBLISH | (qos1 ? 0x02 : 0) | (retain ? 0x01 : 0);
+    n += putLength(buf + n, (uint32_t)(2 + topicLen + (qos1 ? 2 : 0) + len));
+    n += putString(buf + n, topic, topicLen);
+    if (qos1) {
+      buf[n++] = (uint8_t)(packetId >> 8);
+      buf[n++] = (uint8_t)packetId;
+    }
+    return send(buf, n, nowMs) && (len == 0 || send(payload, len, nowMs));
+  }
+
+  // Reads what has arrived and keeps the link alive; false once the session is unusable
+  bool poll(uint32_t nowMs) {
+    if (_state == IDLE) return false;
+    if (!_net.connected()) return fail();
+    while (_net.available() > 0) {
+      int c = _net.read();
+      if (c < 0) break;
+      if (!feed((uint8_t)c, nowMs)) return fail();
+    }
+    if (_state != CONNECTED || _keepAliveMs == 0) return true;
+    if (nowMs - _lastRxMs > _keepAliveMs + _keepAliveMs / 2) return fail();  // broker went silent
+    // QoS 0 traffic keeps the broker happy but gets no reply, so quiet on either side triggers a ping
+    if (!_pingOut && (nowMs - _lastTxMs >= _keepAliveMs / 2 || nowMs - _lastRxMs >= _keepAliveMs / 2)) {
+      const uint8_t ping[2] = {PINGREQ, 0};
+      _pingOut = true;
+      return send(ping, sizeof(ping), nowMs);
+    }
+    return true;
+  }
+
+  // Packet id of a PUBACK received since the last call, 0 if none
+  uint16_t takeAck() {
+    uint16_t id = _ack;
+    _ack = 0;
+    return id;
+  }
+
+  void stop() {
+    if (_state == CONNECTED && _net.connected()) {
+      const uint8_t bye[2] = {DISCONNECT, 0};
+      _net.write(bye, sizeof(bye));
+    }
+    _net.stop();
+    _state = IDLE;
+  }
+
+ private:
+  bool send(const uint8_t* p, size_t n, uint32_t nowMs) {
+    if (_net.write(p, n) != n) return fail();
+    _lastTxMs = nowMs;
+    return true;
+  }
+
+  bool fail() {
+    _net.stop();
+    _state = IDLE;
+    return false;
+  }
+
+  // One byte of the incoming stream: fixed header, remaining length, then the
+  // first few body bytes (all CONNACK / PUBACK carry); longer packets are skipped
+  bool feed(uint8_t c, uint32_t nowMs) {
+    if (_rxPos == 0) {
+      _rxType = c;
+      _rxLen = 0;
+      _rxShift = 0;
+      _rxGot = 0;
+      _rxPos = 1;
+      return true;
+    }
+    if (_rxPos == 1) {
+      _rxLen |= (uint32_t)(c & 0x7F) << _rxShift;
+      _rxShift += 7;
+      if (c & 0x80) return _rxShift < 28;
+      _rxPos = 2;
+      return _rxLen ? true : packet(nowMs);
+    }
+    if (_rxGot < sizeof(_rxBody)) _rxBody[_rxGot] = c;
+    return ++_rxGot < _rxLen ? true : packet(nowMs);
+  }
+
+  bool packet(uint32_t nowMs) {
+    _rxPos = 0;
+    _lastRxMs = nowMs;
+    switch (_rxType & 0xF0) {
+      case CONNACK:
+        if (_state != CONNECTING || _rxLen < 2) return false;
+        _connack = _rxBody[1];
+        if (_connack != 0) return false;  // refused: bad credentials, client id, ...
+        _state = CONNECTED;
+        return true;
+      case PUBACK:
+        if (_rxLen >= 2) _ack = (uint16_t)((_rxBody[0] << 8) | _rxBody[1]);
+        return true;
+      case PINGRESP:
+        _pingOut = false;
+        return true;
+      default:
+        return true;
+    }
+  }
+
+  Client& _net;
+  State _state = IDLE;
+  uint32_t _keepAliveMs = 0;
+  uint32_t _lastTxMs = 0;
+  uint32_t _lastRxMs = 0;
+  bool _pingOut = false;
+  uint16_t _ack = 0;
+  uint8_t _connack = 0xFF;
+
+  uint8_t _rxPos = 0;       // 0 = fixed header, 1 = remaining length, 2 = body
+  uint8_t _rxType = 0;
+  uint8_t _rxShift = 0;
+  uint32_t _rxLen = 0;
+  uint32_t _rxGot = 0;
+  uint8_t _rxBody[4];
+};
+
+} // namespace mqtt
@@ -142,23 +142,32 @@ static const char UPLOAD_HTML[] PROGMEM = R"HTML(
       let failCount = 0;
       let messages = [];
 
-      for (const upload of uploads) {
+      async function send(blob, path) {
         const formData = new FormData();
-        formData.append('file', upload.file);
-        formData.append('path', '/web/' + upload.targetName);
+        formData.append('file', blob);
+        formData.append('path', path);
         formData.append('pw', password);
+        const response = await fetch('/upload', {
+          method: 'POST',
+          body: formData
+        });
+        return response.json();
+      }
 
+      for (const upload of uploads) {
         try {
-          const response = await fetch('/upload', {
-            method: 'POST',
-            body: formData
-          });
-
-          const result = await response.json();
+          const result = await send(upload.file, '/web/' + upload.targetName);
 
           if (result.ok) {
             successCount++;
-            messages.push('<p class="success">' + upload.targetName + ': Upload successful! (' + result.bytes + ' bytes)</p>');
+            let note = result.bytes + ' bytes';
+            // Also store a gzip copy; the device serves it to browsers that accept gzip
+            if (typeof CompressionStream !== 'undefined') {
+              const gz = await new Response(upload.file.stream().pipeThrough(new CompressionStream('gzip'))).blob();
+              const gzResult = await send(gz, '/web/' + upload.targetName + '.gz');
+              note += gzResult.ok ? ', gzip ' + gzResult.bytes + ' bytes' : ', gzip failed - ' + (gzResult.error || 'unknown error');
+            }
+            messages.push('<p class="success">' + upload.targetName + ': Upload successful! (' + note + ')</p>');
           } else {
             failCount++;
             messages.push('<p class="error">' + upload.targetName + ': Upload failed - ' + (result.error || 'unknown error') + '</p>');
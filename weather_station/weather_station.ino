@@ -9,11 +9,13 @@
   Logging:
   - Bucket-aligned logs (configurable duration, NTP time)
   - /data/YYYYMMDD.csv (daily, retained for LogConfig::RETENTION_DAYS)
+  - /data/YYYYMMDD.bkt (same rows, fixed-size binary records; used by the boot loaders)
 
   Downloads:
   - List:     /api/files?dir=data
   - CSV:      /download?path=/data/20251214.csv
-  - ZIP:      /download_zip?days=7  (streams ZIP of last N daily /data files, STORE mode)
+  - ZIP:      /download_zip?days=7  (streams ZIP of last N daily /data files, STORE mode
+              with Content-Length/Range; &method=deflate compresses; from=/to= pick dates)
 
   Notes:
   - GPIO0 is a boot strap pin on ESP32-C3; ensure sensor doesn't hold it LOW at boot.
@@ -26,31 +28,41 @@
 #include <time.h>
 
 #include <Wire.h>
-#include <Adafruit_BME280.h>
-
-#include <SPI.h>
-#include <SD.h>
 #include <ArduinoOTA.h>
 #include <pgmspace.h>
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <array>
 #include "config.h"
+#include "hal.h"
 #include "upload_page.h"
 #include "api_help_page.h"
-
-// ------------------- UART FOR PMS5003 -------------------
-// ESP32-C3 doesn't have Serial2 predefined, create custom HardwareSerial
-HardwareSerial Serial2(1);  // Use UART1 for PMS5003
+#include "mqtt.h"
 
 // ------------------- FORWARD DECLARATIONS -------------------
 
 struct BucketSample;
 struct DaySummary;
+struct DayAgg;
+class ChunkedResponse;
+class JsonWriter;
+static void accumulateDayAgg(DayAgg& agg, const BucketSample& b);
+static void daySummaryFromAgg(time_t day, const DayAgg& a, DaySummary& d);
 void saveDaySummariesCache(const DaySummary* curDay, bool hasCurDay);
 bool loadDaySummariesCache();
 void pushBucketSample(const BucketSample& b);
 void rebuildTodayAggregates();
+void appendDayIndexRecord(const DaySummary& d);
+static bool buildDaySummaryFromSD(time_t dayMid, DaySummary& out);
+static bool parseYmdFromPath(const String& path, time_t& outMidnightLocal);
+static void drainClosedBuckets();
+static void mqttSpillRam();
+static void writeMqttFields(JsonWriter& w);
+#if METRICS_ENABLE
+static void putMqttMetrics(ChunkedResponse& w);
+#endif
 
 // ------------------- DATA -------------------
 
@@ -65,6 +77,14 @@ struct BucketSample {
   float avgPM1;          // μg/m³ (NAN = invalid)
   float avgPM25;         // μg/m³ (NAN = invalid)
   float avgPM10;         // μg/m³ (NAN = invalid)
+  float windStd;         // m/s, std dev of the 1 s wind samples (NAN = unknown; RAM only, not logged)
+};
+
+// Bucket values binned by a HISTOGRAMS[] entry
+struct __attribute__((packed)) ValueHistogram {
+  uint16_t bins[HistConfig::MAX_EDGES + 1];  // saturate at 65535
+  float lo;                                  // extremes of the counted values
+  float hi;                                  // (meaningless while no bin is set)
 };
 
 struct DaySummary {
@@ -86,64 +106,368 @@ struct DaySummary {
   float maxPM25;
   float avgPM10;
   float maxPM10;
+  uint16_t buckets;     // raw buckets folded in; weights the averages when days are merged
+  ValueHistogram hist[HIST_COUNT];
+};
+
+// BucketSample field behind each channel, in CHANNELS order
+static constexpr float BucketSample::* kBucketChannel[CH_COUNT] = {
+  &BucketSample::avgWind, &BucketSample::maxWind, &BucketSample::avgTempC, &BucketSample::avgHumRH,
+  &BucketSample::avgPressHpa, &BucketSample::avgPM1, &BucketSample::avgPM25, &BucketSample::avgPM10,
+};
+
+// One per-day value: a channel and one of its STAT_* bits
+struct DayStat {
+  uint8_t ch;
+  uint8_t stat;
+};
+
+static constexpr std::array<DayStat, DAY_STAT_COUNT> makeDayStats() {
+  std::array<DayStat, DAY_STAT_COUNT> out{};
+  int n = 0;
+  for (int c = 0; c < CH_COUNT; c++) {
+    for (uint8_t s = STAT_AVG; s <= STAT_MAX; s <<= 1) {
+      if (CHANNELS[c].dayStats & s) out[n++] = DayStat{(uint8_t)c, s};
+    }
+  }
+  return out;
+}
+
+// Channel order, then avg / min / max; also the order of the DaySummary fields
+static constexpr std::array<DayStat, DAY_STAT_COUNT> kDayStats = makeDayStats();
+
+static constexpr float DaySummary::* kDaySummaryFields[] = {
+  &DaySummary::avgWind, &DaySummary::maxWind,
+  &DaySummary::avgTemp, &DaySummary::minTemp, &DaySummary::maxTemp,
+  &DaySummary::avgHum, &DaySummary::minHum, &DaySummary::maxHum,
+  &DaySummary::avgPress, &DaySummary::minPress, &DaySummary::maxPress,
+  &DaySummary::avgPM1, &DaySummary::maxPM1,
+  &DaySummary::avgPM25, &DaySummary::maxPM25,
+  &DaySummary::avgPM10, &DaySummary::maxPM10,
+};
+
+static_assert(sizeof(kDaySummaryFields) / sizeof(kDaySummaryFields[0]) == DAY_STAT_COUNT,
+              "DaySummary fields and CHANNELS day stats disagree");
+
+// JSON key of a per-day value ("avgTemp", "maxPM25", ...)
+static const char* dayStatKey(const DayStat& s, char* buf, size_t cap) {
+  const char* prefix = (s.stat == STAT_AVG) ? "avg" : (s.stat == STAT_MIN) ? "min" : "max";
+  snprintf(buf, cap, "%s%s", prefix, CHANNELS[s.ch].name);
+  return buf;
+}
+
+// ------------------- HISTOGRAMS -------------------
+// Fixed bins per HISTOGRAMS[] entry: constant size, mergeable across days, and
+// percentiles / time above a threshold come out by interpolating within a bin.
+
+static uint32_t histTotal(const ValueHistogram& h) {
+  uint32_t n = 0;
+  for (int b = 0; b <= HistConfig::MAX_EDGES; b++) n += h.bins[b];
+  return n;
+}
+
+static void histClear(ValueHistogram& h) {
+  memset(h.bins, 0, sizeof(h.bins));
+  h.lo = INFINITY;
+  h.hi = -INFINITY;
+}
+
+// Bin index = number of edges at or below v; no branches on the value
+static inline int histBin(const HistogramDef& def, float v) {
+  int b = 0;
+  for (int e = 0; e < def.edgeCount; e++) b += (v >= def.edges[e]) ? 1 : 0;
+  return b;
+}
+
+static inline void histAdd(ValueHistogram& h, const HistogramDef& def, float v) {
+  if (!isfinite(v)) return;
+  int b = histBin(def, v);
+  if (h.bins[b] < UINT16_MAX) h.bins[b]++;
+  h.lo = fminf(h.lo, v);
+  h.hi = fmaxf(h.hi, v);
+}
+
+static void histMerge(ValueHistogram& into, const ValueHistogram& h) {
+  if (histTotal(h) == 0) return;
+  if (histTotal(into) == 0) histClear(into);
+  for (int b = 0; b <= HistConfig::MAX_EDGES; b++) {
+    uint32_t n = (uint32_t)into.bins[b] + h.bins[b];
+    into.bins[b] = (uint16_t)(n < UINT16_MAX ? n : UINT16_MAX);
+  }
+  into.lo = fminf(into.lo, h.lo);
+  into.hi = fmaxf(into.hi, h.hi);
+}
+
+// Value range of bin b, narrowed to the values actually seen
+static void histBinRange(const ValueHistogram& h, const HistogramDef& def, int b, float& lo, float& hi) {
+  lo = (b == 0) ? h.lo : fmaxf(def.edges[b - 1], h.lo);
+  hi = (b == def.edgeCount) ? h.hi : fminf(def.edges[b], h.hi);
+  if (hi < lo) hi = lo;
+}
+
+// q in [0, 1]; values are taken as spread evenly within their bin
+static float histQuantile(const ValueHistogram& h, const HistogramDef& def, float q) {
+  uint32_t total = histTotal(h);
+  if (total == 0) return NAN;
+  float target = q * (float)total;
+  float below = 0.0f;
+  for (int b = 0; b <= def.edgeCount; b++) {
+    if (h.bins[b] == 0) continue;
+    if (below + h.bins[b] >= target) {
+      float lo, hi;
+      histBinRange(h, def, b, lo, hi);
+      return lo + (hi - lo) * ((target - below) / (float)h.bins[b]);
+    }
+    below += h.bins[b];
+  }
+  return h.hi;
+}
+
+// Buckets with a value above x (fractional within x's bin)
+static float histCountAbove(const ValueHistogram& h, const HistogramDef& def, float x) {
+  float n = 0.0f;
+  for (int b = 0; b <= def.edgeCount; b++) {
+    if (h.bins[b] == 0) continue;
+    float lo, hi;
+    histBinRange(h, def, b, lo, hi);
+    if (lo > x) n += h.bins[b];
+    else if (hi > x) n += h.bins[b] * (hi - x) / (hi - lo);
+  }
+  return n;
+}
+
+// Per-channel sum / count / extremes: a day, a rollup slot or a series bin
+struct DayAgg {
+  float sum[CH_COUNT];
+  uint32_t count[CH_COUNT];  // values in sum (weighted by bucket count for rollup points)
+  float lo[CH_COUNT];        // +inf / -inf until the first value
+  float hi[CH_COUNT];
+  ValueHistogram hist[HIST_COUNT];
+
+  DayAgg() {
+    for (int c = 0; c < CH_COUNT; c++) {
+      sum[c] = 0.0f;
+      count[c] = 0;
+      lo[c] = INFINITY;
+      hi[c] = -INFINITY;
+    }
+    for (auto& h : hist) histClear(h);
+  }
+
+  float stat(int c, uint8_t s) const {
+    if (s == STAT_AVG) return count[c] ? sum[c] / (float)count[c] : NAN;
+    float v = (s == STAT_MIN) ? lo[c] : hi[c];
+    return isfinite(v) ? v : NAN;
+  }
+
+  bool empty() const {
+    for (int c = 0; c < CH_COUNT; c++) {
+      if (count[c]) return false;
+    }
+    return true;
+  }
+};
+
+// int16 fixed point shared by the bucket ring, the rollup tiers and /api/buckets.bin
+static constexpr int16_t ROLLUP_NAN = INT16_MIN;
+
+static inline int16_t rollupQ(float v, float scale, float offset = 0.0f) {
+  if (!isfinite(v)) return ROLLUP_NAN;
+  float q = roundf((v - offset) * scale);
+  if (q > 32767.0f) q = 32767.0f;
+  if (q < -32767.0f) q = -32767.0f;
+  return (int16_t)q;
+}
+
+static inline float rollupDQ(int16_t q, float scale, float offset = 0.0f) {
+  return (q == ROLLUP_NAN) ? NAN : (float)q / scale + offset;
+}
+
+// Finalized buckets in RAM, 22 bytes each (less than half a BucketSample), so
+// RAM_HISTORY_HOURS of them fit where 24h used to. Values are int16 fixed
+// point (ROLLUP_NAN = no data); the epoch is a 16-bit bucket count from the
+// base of the slot's block. Readers get decoded BucketSamples from at()/forEach().
+struct PackedBucket {
+  uint16_t epochOffset;                 // buckets since the block base; PACKED_EMPTY = unused slot
+  uint16_t samples;                     // saturates at 65535
+  int16_t  ch[CH_COUNT];                // CHANNELS[].qScale / qOffset
+  int16_t  windStd;                     // 0.01 m/s
+};
+
+static_assert(sizeof(PackedBucket) == 22, "PackedBucket layout changed");
+
+static constexpr uint16_t PACKED_EMPTY = 0xFFFF;
+
+class BucketRing {
+public:
+  static constexpr int BLOCK = 32;
+  // One spare block: starting a block clears it, which drops up to BLOCK-1 old buckets early
+  static constexpr int CAPACITY = ((LogConfig::RAM_BUCKETS + BLOCK - 1) / BLOCK + 1) * BLOCK;
+
+  BucketRing() { clear(); }
+
+  void clear() {
+    for (auto& p : _slots) p.epochOffset = PACKED_EMPTY;
+    memset(_blockBase, 0, sizeof(_blockBase));
+    _write = 0;
+    _newest = 0;
+  }
+
+  // Buckets arrive oldest first. One that does not fit its block (clock stepped
+  // back, a gap beyond 16 bits, off the bucket grid) starts the next block.
+  void push(const BucketSample& b) {
+    uint32_t e = (uint32_t)b.startEpoch;
+    if (_write % BLOCK != 0) {
+      uint32_t base = _blockBase[_write / BLOCK];
+      uint32_t delta = e - base;
+      if (e < base || delta % LogConfig::BUCKET_SECONDS != 0 ||
+          delta / LogConfig::BUCKET_SECONDS >= PACKED_EMPTY) {
+        _write = (_write / BLOCK + 1) * BLOCK % CAPACITY;
+      }
+    }
+    if (_write % BLOCK == 0) {
+      _blockBase[_write / BLOCK] = e;
+      for (int i = _write; i < _write + BLOCK; i++) _slots[i].epochOffset = PACKED_EMPTY;
+    }
+    encode(b, (uint16_t)((e - _blockBase[_write / BLOCK]) / LogConfig::BUCKET_SECONDS), _slots[_write]);
+    _write = (_write + 1) % CAPACITY;
+    _newest = b.startEpoch;
+  }
+
+  // i-th slot counting from the oldest; false if the slot is unused
+  bool at(int i, BucketSample& out) const {
+    int idx = (_write + i) % CAPACITY;
+    const PackedBucket& p = _slots[idx];
+    if (p.epochOffset == PACKED_EMPTY) return false;
+    decode(p, (time_t)_blockBase[idx / BLOCK] + (time_t)p.epochOffset * LogConfig::BUCKET_SECONDS, out);
+    return true;
+  }
+
+  // Calls fn(const BucketSample&) for every stored bucket, oldest first
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    BucketSample b;
+    for (int i = 0; i < CAPACITY; i++) {
+      if (at(i, b)) fn(b);
+    }
+  }
+
+  // forEach from the first bucket at or after `from` (epochs are checked before
+  // decoding); stops early when fn(const BucketSample&) returns false
+  template <typename Fn>
+  void forEachFrom(time_t from, Fn&& fn) const {
+    BucketSample b;
+    for (int i = 0; i < CAPACITY; i++) {
+      int idx = (_write + i) % CAPACITY;
+      const PackedBucket& p = _slots[idx];
+      if (p.epochOffset == PACKED_EMPTY) continue;
+      time_t epoch = (time_t)_blockBase[idx / BLOCK] + (time_t)p.epochOffset * LogConfig::BUCKET_SECONDS;
+      if (epoch < from) continue;
+      decode(p, epoch, b);
+      if (!fn(b)) return;
+    }
+  }
+
+  time_t oldestEpoch() const {
+    BucketSample b;
+    for (int i = 0; i < CAPACITY; i++) {
+      if (at(i, b)) return b.startEpoch;
+    }
+    return 0;
+  }
+
+  time_t newestEpoch() const { return _newest; }
+
+private:
+  static void encode(const BucketSample& b, uint16_t offset, PackedBucket& p) {
+    p.epochOffset = offset;
+    p.samples = (uint16_t)std::min<uint32_t>(b.samples, UINT16_MAX);
+    for (int c = 0; c < CH_COUNT; c++) {
+      p.ch[c] = rollupQ(b.*kBucketChannel[c], CHANNELS[c].qScale, CHANNELS[c].qOffset);
+    }
+    p.windStd = rollupQ(b.windStd, 100.0f);
+  }
+
+  static void decode(const PackedBucket& p, time_t epoch, BucketSample& b) {
+    b.startEpoch = epoch;
+    b.samples = p.samples;
+    for (int c = 0; c < CH_COUNT; c++) {
+      b.*kBucketChannel[c] = rollupDQ(p.ch[c], CHANNELS[c].qScale, CHANNELS[c].qOffset);
+    }
+    b.windStd = rollupDQ(p.windStd, 100.0f);
+  }
+
+  PackedBucket _slots[CAPACITY];
+  uint32_t _blockBase[CAPACITY / BLOCK];   // epoch of each block's first bucket
+  int _write = 0;
+  time_t _newest = 0;
 };
 
-static BucketSample gBuckets[LogConfig::BUCKETS_24H];
-static int gBucketWrite = 0;
+static BucketRing gBucketRing;
 
 static DaySummary gDays[LogConfig::DAYS_HISTORY];
 static int gDayWrite = 0;
 static uint32_t gDaysCount = 0;
 
-// wind pulses
-static volatile uint32_t gPulseCount = 0;
+// Bumped whenever a finalized bucket or day summary is added; with the boot
+// id they form the ETags of /api/days and /api/config.
+static uint32_t gBootId = 0;
+static uint32_t gBucketGen = 0;
+static uint32_t gDayGen = 0;
+
+// History is loaded from SD after boot, one bounded slice per loop() (see
+// HISTORY BACKFILL), in BootLoad order. Until a stage is done its RAM structure
+// only holds buckets finalized since boot (startEpoch >= gBoot.until).
+enum BootLoad { BOOT_LOAD_DAYS, BOOT_LOAD_BUCKETS, BOOT_LOAD_ROLLUPS, BOOT_LOAD_FILES, BOOT_LOAD_COUNT };
+static const char* const kBootLoadNames[BOOT_LOAD_COUNT] = {"days", "buckets", "rollups", "files"};
+
+struct BootProgress {
+  int stage = BOOT_LOAD_DAYS;    // BootLoad being loaded; BOOT_LOAD_COUNT = all loaded
+  time_t until = 0;              // first bucket of this boot; older ones come from SD
+  std::vector<time_t> days;      // day files of the current stage, oldest first
+  size_t next = 0;               // days[next] is read by the next slice (files stage: entries walked)
+  uint32_t httpReadyMs = 0;      // millis() at server.begin()
+  uint32_t firstRequestMs = 0;   // millis() when the first request was handled
+  uint32_t historyMs = 0;        // millis() when the last stage finished
+};
+static BootProgress gBoot;
+
+static inline bool historyLoaded(BootLoad stage) { return gBoot.stage > stage; }
+static inline bool bootLoadDone() { return gBoot.stage >= BOOT_LOAD_COUNT; }
+
+// wind pulses: the ISR stores each pulse's micros() in a ring; gPulseHead
+// doubles as the running pulse count
+static_assert((WindConfig::PULSE_RING_SIZE & (WindConfig::PULSE_RING_SIZE - 1)) == 0,
+              "PULSE_RING_SIZE must be a power of two");
+static volatile uint32_t gPulseRing[WindConfig::PULSE_RING_SIZE];
+static volatile uint32_t gPulseHead = 0;
 static volatile uint32_t gLastPulseMicros = 0;
+static uint32_t gPulseTail = 0;            // acquisition task
+static uint32_t gPulseRingOverflows = 0;   // timestamps overwritten before they were read
 static float gNowWindMS = 0.0f;
 
 // timing / bucket accumulators
 static uint32_t gLastPpsMillis = 0;
 static time_t   gCurrentBucketStart = 0;
 static float    gBucketWindSum = 0.0f;
-static float    gBucketWindMax1 = 0.0f; // highest observed in bucket
-static float    gBucketWindMax2 = 0.0f; // second-highest observed in bucket
+static float    gBucketWindMax1 = 0.0f; // highest 1 s sample in bucket (gust fallback)
+static float    gBucketWindSqSum = 0.0f;
+static float    gBucketGust = NAN;      // highest 3 s mean in bucket
 static uint32_t gBucketSamples = 0;
 static uint32_t gBucketPulseCount = 0;
 static uint32_t gBucketPulseElapsedMs = 0;
-static float    gBucketTempSum = 0.0f;
-static float    gBucketHumSum = 0.0f;
-static float    gBucketPressSumPa = 0.0f;
-static uint32_t gBucketEnvSamples = 0;
-static float    gBucketPM1Sum = 0.0f;
-static float    gBucketPM25Sum = 0.0f;
-static float    gBucketPM10Sum = 0.0f;
-static uint32_t gBucketPmSamples = 0;
+static float    gBucketChSum[CH_COUNT];    // polled channels (wind comes from the pulses)
+static uint32_t gBucketChCount[CH_COUNT];
+
+static inline void addBucketValue(Channel c, float v) {
+  if (!isfinite(v)) return;
+  gBucketChSum[c] += v;
+  gBucketChCount[c]++;
+}
 
 // daily rollup
 static time_t   gTodayMidnightEpoch = 0;
-static float    gTodaySumOfBucketAvgs = 0.0f;
-static uint32_t gTodayBucketCount = 0;
-static float    gTodayMax = 0.0f;
-static float    gTodayTempSum = 0.0f;
-static uint32_t gTodayTempCount = 0;
-static float    gTodayTempMin = NAN;
-static float    gTodayTempMax = NAN;
-static float    gTodayHumSum = 0.0f;
-static uint32_t gTodayHumCount = 0;
-static float    gTodayHumMin = NAN;
-static float    gTodayHumMax = NAN;
-static float    gTodayPressSum = 0.0f;
-static uint32_t gTodayPressCount = 0;
-static float    gTodayPressMin = NAN;
-static float    gTodayPressMax = NAN;
-static float    gTodayPM1Sum = 0.0f;
-static uint32_t gTodayPM1Count = 0;
-static float    gTodayPM1Max = NAN;
-static float    gTodayPM25Sum = 0.0f;
-static uint32_t gTodayPM25Count = 0;
-static float    gTodayPM25Max = NAN;
-static float    gTodayPM10Sum = 0.0f;
-static uint32_t gTodayPM10Count = 0;
-static float    gTodayPM10Max = NAN;
+static DayAgg   gToday;
 
 // Auth / rate limit for password-protected endpoints
 static int      gPwAttempts = 0;
@@ -152,39 +476,16 @@ static time_t   gPwWindowStart = 0;
 // ------------------- HELPERS -------------------
 
 static void clearTodayAggregates() {
-  gTodaySumOfBucketAvgs = 0.0f;
-  gTodayBucketCount = 0;
-  gTodayMax = 0.0f;
-  gTodayTempSum = 0.0f;
-  gTodayTempCount = 0;
-  gTodayTempMin = NAN;
-  gTodayTempMax = NAN;
-  gTodayHumSum = 0.0f;
-  gTodayHumCount = 0;
-  gTodayHumMin = NAN;
-  gTodayHumMax = NAN;
-  gTodayPressSum = 0.0f;
-  gTodayPressCount = 0;
-  gTodayPressMin = NAN;
-  gTodayPressMax = NAN;
-  gTodayPM1Sum = 0.0f;
-  gTodayPM1Count = 0;
-  gTodayPM1Max = NAN;
-  gTodayPM25Sum = 0.0f;
-  gTodayPM25Count = 0;
-  gTodayPM25Max = NAN;
-  gTodayPM10Sum = 0.0f;
-  gTodayPM10Count = 0;
-  gTodayPM10Max = NAN;
+  gToday = DayAgg();
 }
 
 // BME280 latest
-static Adafruit_BME280 bme;
 static bool  gBmeOk = false;
 static float gTempC = NAN;
 static float gHumRH = NAN;
 static float gPressurePa = NAN;
 static uint32_t gLastBmePollMillis = 0;
+static bool gBmeConversionPending = false;  // forced conversion started, not yet read
 
 // PMS5003 latest readings
 static const int PMS_FRAME_SIZE = 32;
@@ -200,12 +501,22 @@ static uint32_t gLastPmsPollMillis = 0;
 
 // SD status
 static bool gSdOk = false;
-static constexpr uint32_t FILES_CACHE_TTL_MS = 30000; // 30s reuse to avoid slow SD scans on refresh
-static String gFilesCacheDataJson;
-static uint32_t gFilesCacheDataMs = 0;
 
-// Web
-static WebServer server(80);
+// Web. A handler that keeps its socket for loop() (event stream, downloads)
+// detaches it, so WebServer moves on to the next request straight away instead
+// of waiting up to HTTP_MAX_CLOSE_WAIT for the client to hang up.
+class StationServer : public WebServer {
+ public:
+  using WebServer::WebServer;
+
+  WiFiClient detachClient() {
+    WiFiClient c = _currentClient;
+    _currentClient = WiFiClient();
+    return c;
+  }
+  bool clientIsHttp11() const { return _currentVersion != 0; }
+};
+static StationServer server(80);
 
 // ------------------- ISR -------------------
 void IRAM_ATTR onPulse() {
@@ -216,12 +527,236 @@ void IRAM_ATTR onPulse() {
   if (elapsed < 2000) return;
 
   gLastPulseMicros = now;
-  gPulseCount++;
+  uint32_t h = gPulseHead;
+  gPulseRing[h & (WindConfig::PULSE_RING_SIZE - 1)] = now;
+  gPulseHead = h + 1;
+}
+
+// ------------------- WIND PULSE ANALYSIS -------------------
+// Fed with pulse timestamps (µs) by the acquisition task. Gusts follow the WMO
+// definition: the highest 3 s running mean, evaluated every 250 ms.
+
+class WindPulseAnalyzer {
+ public:
+  static constexpr uint32_t STEP_US = WindConfig::GUST_STEP_MS * 1000UL;
+  static constexpr int STEPS = WindConfig::GUST_WINDOW_MS / WindConfig::GUST_STEP_MS;
+  static_assert(WindConfig::GUST_WINDOW_MS % WindConfig::GUST_STEP_MS == 0, "gust window must be whole steps");
+
+  void reset(uint32_t nowUs) {
+    memset(_steps, 0, sizeof(_steps));
+    _idx = 0;
+    _filled = 0;
+    _windowPulses = 0;
+    _closedPulses = 0;
+    _stepStartUs = nowUs;
+    _gustPulses = 0;
+    _lastPulseUs = nowUs;
+    _lastPeriodUs = 0;
+  }
+
+  void addPulse(uint32_t tUs) {
+    advanceTo(tUs);
+    _steps[_idx]++;
+    _windowPulses++;
+    _lastPeriodUs = tUs - _lastPulseUs;
+    _lastPulseUs = tUs;
+  }
+
+  // Closes every 250 ms step that ended before nowUs
+  void advanceTo(uint32_t nowUs) {
+    while (nowUs - _stepStartUs >= STEP_US) {
+      if (_windowPulses == 0) {
+        // Empty window (at most STEPS closes after the last pulse): every step
+        // still to close is empty too
+        uint32_t steps = (nowUs - _stepStartUs) / STEP_US;
+        _filled = (steps >= (uint32_t)(STEPS - _filled)) ? STEPS : _filled + (int)steps;
+        _closedPulses = 0;
+        _stepStartUs += steps * STEP_US;
+        return;
+      }
+      if (_filled < STEPS) _filled++;
+      _closedPulses = _windowPulses;
+      if (_filled == STEPS && _windowPulses > _gustPulses) _gustPulses = _windowPulses;
+      _idx = (_idx + 1) % STEPS;
+      _windowPulses -= _steps[_idx];
+      _steps[_idx] = 0;
+      _stepStartUs += STEP_US;
+    }
+  }
+
+  // Highest 3 s mean since the last takeGust() (NAN before the first full window)
+  float takeGust() {
+    float g = (_filled == STEPS) ? pulsesToMs(_gustPulses, WindConfig::GUST_WINDOW_MS) : NAN;
+    _gustPulses = 0;
+    return g;
+  }
+  // Mean over the last 3 s (NAN before the first full window)
+  float currentMs() const {
+    return (_filled == STEPS) ? pulsesToMs(_closedPulses, WindConfig::GUST_WINDOW_MS) : NAN;
+  }
+
+  // Speed from the last pulse period; decays once the next pulse is overdue
+  float instantMs(uint32_t nowUs) const {
+    if (_lastPeriodUs == 0) return 0.0f;
+    uint32_t sinceUs = nowUs - _lastPulseUs;
+    if (sinceUs > WindConfig::GUST_WINDOW_MS * 1000UL) return 0.0f;
+    uint32_t periodUs = (sinceUs > _lastPeriodUs) ? sinceUs : _lastPeriodUs;
+    return 1e6f / (float)periodUs * WindConfig::PPS_TO_MS;
+  }
+
+ private:
+  static float pulsesToMs(uint32_t pulses, uint32_t windowMs) {
+    return (float)pulses * 1000.0f / (float)windowMs * WindConfig::PPS_TO_MS;
+  }
+
+  uint16_t _steps[STEPS] = {};
+  int _idx = 0;
+  int _filled = 0;              // closed steps so far, up to STEPS
+  uint32_t _windowPulses = 0;   // pulses in the current step and the STEPS-1 before it
+  uint32_t _closedPulses = 0;   // pulses in the last STEPS closed steps
+  uint32_t _stepStartUs = 0;
+  uint32_t _gustPulses = 0;     // best full-window count since takeGust()
+  uint32_t _lastPulseUs = 0;
+  uint32_t _lastPeriodUs = 0;
+};
+
+static WindPulseAnalyzer gWindPulses;  // acquisition task
+
+// ------------------- METRICS -------------------
+// Lightweight counters and latency histograms for /api/metrics (Prometheus
+// text format). With METRICS_ENABLE 0 in config.h the hooks below are empty
+// and the endpoint is not registered.
+
+#if METRICS_ENABLE
+
+// Histogram upper bounds (µs); one more bucket for +Inf
+static const uint32_t kLatencyBoundsUs[] = {100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000};
+static constexpr int LATENCY_BUCKETS = sizeof(kLatencyBoundsUs) / sizeof(kLatencyBoundsUs[0]) + 1;
+
+struct LatencyHistogram {
+  uint32_t counts[LATENCY_BUCKETS] = {};
+  uint32_t count = 0;
+  uint32_t maxUs = 0;
+  uint64_t sumUs = 0;
+
+  void observe(uint32_t us) {
+    int i = 0;
+    while (i < LATENCY_BUCKETS - 1 && us > kLatencyBoundsUs[i]) i++;
+    counts[i]++;
+    count++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+};
+
+struct RouteMetric {
+  const char* uri;
+  const char* method;
+  LatencyHistogram latency;
+};
+
+static constexpr int METRICS_MAX_ROUTES = 32;
+
+struct Metrics {
+  RouteMetric routes[METRICS_MAX_ROUTES];
+  int routeCount = 0;
+  LatencyHistogram loop;
+  LatencyHistogram sdLogBucket;   // logBucketToSD: RAM buffer + journal (+ flush when full)
+  LatencyHistogram sdFlush;       // flushLogBuffer: batched writes to the day files
+  LatencyHistogram mqttAck;       // MQTT bucket batch: PUBLISH to PUBACK
+  uint32_t sdReadBytes = 0;       // bytes read by the CSV/.bkt/index readers
+  uint32_t bootLoadUs[BOOT_LOAD_COUNT] = {};     // summed over the loader's slices
+  uint32_t bootLoadBytes[BOOT_LOAD_COUNT] = {};
+  uint32_t pmsFrames = 0;         // written by the acquisition task
+  uint32_t pmsChecksumErrors = 0;
+};
+static Metrics gMetrics;
+
+static inline void metricSdRead(int n) {
+  if (n > 0) gMetrics.sdReadBytes += (uint32_t)n;
+}
+static inline void metricPmsFrame(bool ok) {
+  gMetrics.pmsFrames++;
+  if (!ok) gMetrics.pmsChecksumErrors++;
+}
+static inline void metricMqttAck(uint32_t us) { gMetrics.mqttAck.observe(us); }
+
+// Wraps a route handler so its time (including sending the response) is recorded
+static WebServer::THandlerFunction timedRoute(const char* uri, const char* method, WebServer::THandlerFunction fn) {
+  if (gMetrics.routeCount >= METRICS_MAX_ROUTES) return fn;
+  RouteMetric* m = &gMetrics.routes[gMetrics.routeCount++];
+  m->uri = uri;
+  m->method = method;
+  return [m, fn]() {
+    uint32_t t0 = micros();
+    fn();
+    m->latency.observe(micros() - t0);
+  };
+}
+
+template <typename Fn>
+static void timedBootLoad(BootLoad which, Fn&& fn) {
+  uint32_t t0 = micros();
+  uint32_t b0 = gMetrics.sdReadBytes;
+  fn();
+  gMetrics.bootLoadUs[which] += micros() - t0;
+  gMetrics.bootLoadBytes[which] += gMetrics.sdReadBytes - b0;
+}
+
+// Times a scope into a histogram
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(LatencyHistogram& h) : _h(h), _t0(micros()) {}
+  ~ScopedLatency() { _h.observe(micros() - _t0); }
+
+ private:
+  LatencyHistogram& _h;
+  uint32_t _t0;
+};
+#define METRIC_SCOPE(hist) ScopedLatency metricScope_(gMetrics.hist)
+
+#else
+
+static inline void metricSdRead(int) {}
+static inline void metricPmsFrame(bool) {}
+static inline void metricMqttAck(uint32_t) {}
+static WebServer::THandlerFunction timedRoute(const char*, const char*, WebServer::THandlerFunction fn) { return fn; }
+template <typename Fn>
+static void timedBootLoad(BootLoad, Fn&& fn) { fn(); }
+#define METRIC_SCOPE(hist) do {} while (0)
+
+#endif
+
+static const char* httpMethodName(HTTPMethod method) {
+  switch (method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    default: return "ANY";
+  }
+}
+
+// Notes when the first request after boot was served
+static WebServer::THandlerFunction bootRoute(WebServer::THandlerFunction fn) {
+  return [fn]() {
+    if (gBoot.firstRequestMs == 0) gBoot.firstRequestMs = millis();
+    fn();
+  };
+}
+
+// server.on() with per-route latency metrics
+static void onRoute(const char* uri, WebServer::THandlerFunction fn) {
+  server.on(uri, timedRoute(uri, "ANY", bootRoute(fn)));
+}
+static void onRoute(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn) {
+  server.on(uri, method, timedRoute(uri, httpMethodName(method), bootRoute(fn)));
+}
+static void onRoute(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn, WebServer::THandlerFunction uploadFn) {
+  server.on(uri, method, timedRoute(uri, httpMethodName(method), bootRoute(fn)), uploadFn);
 }
 
 // ------------------- TIME HELPERS -------------------
 static inline bool timeIsValid(time_t t) { return t > 1577836800; } // > 2020-01-01
-static inline time_t epochNow() { return time(nullptr); }
+static inline time_t epochNow() { return hal::now(); }
 
 time_t localMidnight(time_t nowEpoch) {
   struct tm tmLocal;
@@ -255,19 +790,13 @@ static bool verifyPassword(const String& pw, bool& rateLimited) {
   return false;
 }
 
+// Buckets are counted in elapsed seconds from local midnight, so the result only
+// depends on the epoch: a DST change never re-floors a time into an hour that
+// repeats or doesn't exist, and within a day bucket k starts at midnight + k * B.
+// (With whole-hour offsets and B dividing an hour this is the wall-clock grid.)
 time_t floorToBucketBoundaryLocal(time_t nowEpoch) {
-  struct tm tmLocal;
-  localtime_r(&nowEpoch, &tmLocal);
-  tmLocal.tm_sec = 0;
-  int bucketMinutes = LogConfig::BUCKET_SECONDS / 60;
-  int bucketSeconds = LogConfig::BUCKET_SECONDS % 60;
-  if (bucketMinutes > 0) {
-    tmLocal.tm_min = (tmLocal.tm_min / bucketMinutes) * bucketMinutes;
-    tmLocal.tm_sec = (bucketSeconds > 0) ? (tmLocal.tm_sec / bucketSeconds) * bucketSeconds : 0;
-  } else {
-    tmLocal.tm_sec = (tmLocal.tm_sec / LogConfig::BUCKET_SECONDS) * LogConfig::BUCKET_SECONDS;
-  }
-  return mktime(&tmLocal);
+  time_t mid = localMidnight(nowEpoch);
+  return mid + (nowEpoch - mid) / LogConfig::BUCKET_SECONDS * LogConfig::BUCKET_SECONDS;
 }
 
 String fmtLocal(time_t t) {
@@ -294,242 +823,1025 @@ time_t subtractDaysLocalMidnight(time_t tMidnightLocal, int days) {
   return mktime(&tmLocal);
 }
 
+static time_t localMonthStart(time_t t) {
+  struct tm tmLocal;
+  localtime_r(&t, &tmLocal);
+  tmLocal.tm_mday = 1;
+  tmLocal.tm_hour = 0; tmLocal.tm_min = 0; tmLocal.tm_sec = 0; tmLocal.tm_isdst = -1;
+  return mktime(&tmLocal);
+}
+
 // ------------------- SD HELPERS -------------------
 
 bool ensureDir(const char* path) {
   if (!gSdOk) return false;
-  if (SD.exists(path)) return true;
-  return SD.mkdir(path);
+  if (hal::storage().exists(path)) return true;
+  return hal::storage().mkdir(path);
 }
 
-bool appendLine(const String& path, const String& line, const String& headerIfNew = "") {
-  if (!gSdOk) return false;
+// ------------------- FILE CATALOG -------------------
+// The daily CSVs in /data as (date, size) pairs sorted by date, 8 bytes per day.
+// One directory walk fills it during boot (the "files" stage of HISTORY
+// BACKFILL); after that the log writer, retention and the delete endpoints keep
+// it current in place, so /api/files never has to walk the directory.
 
-  bool exists = SD.exists(path.c_str());
-  File f = SD.open(path.c_str(), FILE_APPEND);
-  if (!f) return false;
+struct FileCatalogEntry {
+  uint32_t ymd;   // YYYYMMDD
+  uint32_t size;  // bytes in /data/YYYYMMDD.csv
+};
+static std::vector<FileCatalogEntry> gFileCatalog;
+static File gFileCatalogScanDir;   // open while the boot walk is running
+static bool gFileCatalogReady = false;
+static constexpr int FILE_CATALOG_SCAN_BATCH = 32;  // directory entries per loop() slice
+
+static uint32_t ymdNumber(time_t dayMid) {
+  struct tm t;
+  localtime_r(&dayMid, &t);
+  return (uint32_t)(t.tm_year + 1900) * 10000 + (uint32_t)(t.tm_mon + 1) * 100 + (uint32_t)t.tm_mday;
+}
 
-  if (!exists && headerIfNew.length()) {
-    f.print(headerIfNew);
-    if (headerIfNew[headerIfNew.length()-1] != '\n') f.print("\n");
+// "YYYYMMDD.csv" (any leading directories) -> YYYYMMDD
+static bool parseCatalogName(const char* path, uint32_t& ymd) {
+  const char* slash = strrchr(path, '/');
+  const char* name = slash ? slash + 1 : path;
+  if (strlen(name) != 12 || strcmp(name + 8, ".csv") != 0) return false;
+  ymd = 0;
+  for (int i = 0; i < 8; i++) {
+    if (!isdigit((unsigned char)name[i])) return false;
+    ymd = ymd * 10 + (uint32_t)(name[i] - '0');
   }
-  f.print(line);
-  if (line.length() && line[line.length()-1] != '\n') f.print("\n");
-  f.close();
   return true;
 }
 
-void deleteOldDailyFileIfNeeded(time_t todayMidnightLocal) {
-  // If LogConfig::RETENTION_DAYS is 0, never delete files
-  if (LogConfig::RETENTION_DAYS == 0) return;
-
-  time_t oldMidnight = subtractDaysLocalMidnight(todayMidnightLocal, LogConfig::RETENTION_DAYS + 1);
-  String ymd = ymdString(oldMidnight);
-  String dataPath = String("/data/") + ymd + ".csv";
-  if (gSdOk && SD.exists(dataPath.c_str())) SD.remove(dataPath.c_str());
+static std::vector<FileCatalogEntry>::iterator fileCatalogFind(uint32_t ymd) {
+  return std::lower_bound(gFileCatalog.begin(), gFileCatalog.end(), ymd,
+                          [](const FileCatalogEntry& e, uint32_t v) { return e.ymd < v; });
 }
 
-void logBucketToSD(const BucketSample& b) {
-  if (!gSdOk) return;
-
-  ensureDir("/data");
-  ensureDir("/backup");
-
-  time_t bucketMidnightLocal = localMidnight(b.startEpoch);
-  String ymd = ymdString(bucketMidnightLocal);
-  String dailyFile = String("/data/") + ymd + ".csv";
-  String backupFile = String("/backup/") + ymd + ".csv";
-
-  String header =
-    "datetime,epoch,wind_avg_ms,wind_max_ms,temp_c,hum_rh,press_hpa,pm1,pm25,pm10,samples";
-
-  String line =
-    fmtLocal(b.startEpoch) + "," +
-    String((uint32_t)b.startEpoch) + "," +
-    String(b.avgWind, 3) + "," +
-    String(b.maxWind, 3) + "," +
-    String(b.avgTempC, 2) + "," +
-    String(b.avgHumRH, 2) + "," +
-    String(b.avgPressHpa, 2) + "," +
-    String(isfinite(b.avgPM1) ? String(b.avgPM1, 1) : String("")) + "," +
-    String(isfinite(b.avgPM25) ? String(b.avgPM25, 1) : String("")) + "," +
-    String(isfinite(b.avgPM10) ? String(b.avgPM10, 1) : String("")) + "," +
-    String(b.samples);
-
-  appendLine(dailyFile, line, header);
-  appendLine(backupFile, line, header);
+static void fileCatalogSet(uint32_t ymd, uint32_t size) {
+  auto it = fileCatalogFind(ymd);
+  if (it != gFileCatalog.end() && it->ymd == ymd) it->size = size;
+  else gFileCatalog.insert(it, FileCatalogEntry{ymd, size});
 }
 
-static bool deleteDirFiles(const char* dirPath) {
-  File dir = SD.open(dirPath);
-  if (!dir) return false;
-  bool ok = true;
-  while (true) {
-    File entry = dir.openNextFile();
-    if (!entry) break;
-    if (entry.isDirectory()) {
-      entry.close();
-      continue;
-    }
-    String name = entry.name();
-    entry.close();
-    if (!SD.remove(name.c_str())) ok = false;
-  }
-  dir.close();
-  return ok;
+// Bytes appended to a day's CSV (creating its entry if the file is new)
+static void fileCatalogGrow(time_t dayMid, uint32_t bytes) {
+  uint32_t ymd = ymdNumber(dayMid);
+  auto it = fileCatalogFind(ymd);
+  if (it != gFileCatalog.end() && it->ymd == ymd) it->size += bytes;
+  else gFileCatalog.insert(it, FileCatalogEntry{ymd, bytes});
 }
 
-static float parseFloatOrNan(const String& s) {
-  if (!s.length()) return NAN;
-  String trimmed = s;
-  trimmed.trim();
-  if (!trimmed.length()) return NAN;
-  // Check for common invalid markers
-  if (trimmed == "nan" || trimmed == "NaN" || trimmed == "NAN") return NAN;
-  if (trimmed == "null" || trimmed == "NULL") return NAN;
-  if (trimmed == "-" || trimmed == "--") return NAN;
-  // toFloat() returns 0 for invalid input, so check if it's actually a valid number
-  // by verifying the string starts with a digit, minus, or decimal point
-  char first = trimmed.charAt(0);
-  if (first != '-' && first != '.' && !isdigit(first)) return NAN;
-  return trimmed.toFloat();
+static void fileCatalogErase(uint32_t ymd) {
+  auto it = fileCatalogFind(ymd);
+  if (it != gFileCatalog.end() && it->ymd == ymd) gFileCatalog.erase(it);
 }
 
-static bool splitCSVLine(const String& line, String parts[], int expectedParts) {
-  int start = 0;
-  int idx = 0;
-  while (idx < expectedParts - 1) {
-    int comma = line.indexOf(',', start);
-    if (comma < 0) break;
-    parts[idx++] = line.substring(start, comma);
-    start = comma + 1;
+static void fileCatalogBeginScan() {
+  gFileCatalogReady = false;
+  gFileCatalogScanDir = hal::storage().open("/data");
+  if (!gFileCatalogScanDir || !gFileCatalogScanDir.isDirectory()) {
+    gFileCatalogScanDir = File();
+    gFileCatalogReady = true;
   }
-  parts[idx++] = line.substring(start);
-  return idx == expectedParts;
 }
 
-static void invalidateFilesCache() {
-  gFilesCacheDataMs = 0;
-  gFilesCacheDataJson = "";
+// Up to FILE_CATALOG_SCAN_BATCH directory entries; false once the walk is done.
+// Sizes come from the directory, so an entry the writer created before the walk
+// reached its file is corrected here.
+static bool fileCatalogScanSlice() {
+  if (gFileCatalogReady) return false;
+  for (int i = 0; i < FILE_CATALOG_SCAN_BATCH; i++) {
+    File f = gFileCatalogScanDir.openNextFile();
+    if (!f) {
+      gFileCatalogScanDir.close();
+      gFileCatalogScanDir = File();
+      gFileCatalogReady = true;
+      return false;
+    }
+    uint32_t ymd = 0;
+    if (!f.isDirectory() && parseCatalogName(f.name(), ymd)) fileCatalogSet(ymd, (uint32_t)f.size());
+    f.close();
+  }
+  return true;
 }
 
-void loadRecentBucketsFromSD(time_t nowEpoch) {
-  if (!gSdOk || !timeIsValid(nowEpoch)) return;
+// ------------------- BINARY BUCKET LOG -------------------
+// /data/YYYYMMDD.bkt holds the same rows as the daily CSV as fixed-size records:
+//   [BktHeader][BktRecord x N][BktFooter]
+// The footer is rewritten on every append so min/max epoch are always known
+// without scanning; loaders binary-search the records to the first wanted epoch
+// and read() whole blocks instead of tokenizing text.
+
+static constexpr uint16_t BKT_VERSION = 1;
+static const char* CSV_HEADER =
+  "datetime,epoch,wind_avg_ms,wind_max_ms,temp_c,hum_rh,press_hpa,pm1,pm25,pm10,samples";
+
+struct __attribute__((packed)) BktHeader {
+  char     magic[4];      // "WSBK"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t bucketSeconds;
+  uint32_t dayStartEpoch; // local midnight of the file's day
+};
 
-  time_t cutoff = nowEpoch - 86400;
-  std::vector<BucketSample> loaded;
-  loaded.reserve(LogConfig::BUCKETS_24H);
+struct __attribute__((packed)) BktRecord {
+  uint32_t epoch;
+  float    avgWind;
+  float    maxWind;
+  float    avgTempC;
+  float    avgHumRH;
+  float    avgPressHpa;
+  float    avgPM1;
+  float    avgPM25;
+  float    avgPM10;
+  uint32_t samples;
+};
 
-  auto loadFile = [&](time_t dayMidnightLocal) {
-    String path = String("/data/") + ymdString(dayMidnightLocal) + ".csv";
-    if (!SD.exists(path.c_str())) return;
-    File f = SD.open(path.c_str(), FILE_READ);
-    if (!f) return;
-    while (f.available()) {
-      String line = f.readStringUntil('\n');
-      line.trim();
-      if (!line.length()) continue;
-      if (line.startsWith("datetime")) continue;
+struct __attribute__((packed)) BktFooter {
+  char     magic[4];      // "WSBF"
+  uint32_t count;
+  uint32_t minEpoch;
+  uint32_t maxEpoch;
+  uint32_t flags;         // BKT_FLAG_*
+};
 
-      // Count actual columns
-      int commaCount = 0;
-      for (int i = 0; i < line.length(); i++) {
-        if (line[i] == ',') commaCount++;
-      }
-      int numCols = commaCount + 1;
+static constexpr uint32_t BKT_FLAG_SORTED = 0x1; // records are in ascending epoch order
 
-      String parts[11];
-      splitCSVLine(line, parts, numCols < 11 ? numCols : 11);
+static_assert(sizeof(BktHeader) == 16, "BktHeader layout changed");
+static_assert(sizeof(BktRecord) == 40, "BktRecord layout changed");
+static_assert(sizeof(BktFooter) == 20, "BktFooter layout changed");
 
-      if (numCols < 8) continue;  // Need at least 8 fields
-      BucketSample b{};
-      b.startEpoch = (time_t)parts[1].toInt();
-      if (!timeIsValid(b.startEpoch) || b.startEpoch < cutoff) continue;
-      // Skip buckets that don't align with current LogConfig::BUCKET_SECONDS setting
-      if (b.startEpoch % LogConfig::BUCKET_SECONDS != 0) continue;
-      // Load floats directly from CSV
-      b.avgWind = parseFloatOrNan(parts[2]);
-      b.maxWind = parseFloatOrNan(parts[3]);
-      b.avgTempC = parseFloatOrNan(parts[4]);
-      b.avgHumRH = parseFloatOrNan(parts[5]);
-      b.avgPressHpa = parseFloatOrNan(parts[6]);
-      // PM fields (optional for backward compatibility)
-      b.avgPM1 = (numCols > 7) ? parseFloatOrNan(parts[7]) : NAN;
-      b.avgPM25 = (numCols > 8) ? parseFloatOrNan(parts[8]) : NAN;
-      b.avgPM10 = (numCols > 9) ? parseFloatOrNan(parts[9]) : NAN;
-      b.samples = (uint32_t)std::max<long>(0, parts[numCols > 10 ? 10 : 7].toInt());
-      loaded.push_back(b);
-    }
-    f.close();
-  };
+static String bktPathForDay(time_t dayMidnightLocal) {
+  return String("/data/") + ymdString(dayMidnightLocal) + ".bkt";
+}
 
-  time_t todayMidnight = localMidnight(nowEpoch);
-  loadFile(todayMidnight);
-  loadFile(subtractDaysLocalMidnight(todayMidnight, 1)); // bring in late-night buckets from previous day
+static void bucketToRecord(const BucketSample& b, BktRecord& r) {
+  r.epoch = (uint32_t)b.startEpoch;
+  r.avgWind = b.avgWind;
+  r.maxWind = b.maxWind;
+  r.avgTempC = b.avgTempC;
+  r.avgHumRH = b.avgHumRH;
+  r.avgPressHpa = b.avgPressHpa;
+  r.avgPM1 = b.avgPM1;
+  r.avgPM25 = b.avgPM25;
+  r.avgPM10 = b.avgPM10;
+  r.samples = b.samples;
+}
 
-  if (loaded.empty()) return;
+static void recordToBucket(const BktRecord& r, BucketSample& b) {
+  b.startEpoch = (time_t)r.epoch;
+  b.avgWind = r.avgWind;
+  b.maxWind = r.maxWind;
+  b.avgTempC = r.avgTempC;
+  b.avgHumRH = r.avgHumRH;
+  b.avgPressHpa = r.avgPressHpa;
+  b.avgPM1 = r.avgPM1;
+  b.avgPM25 = r.avgPM25;
+  b.avgPM10 = r.avgPM10;
+  b.samples = r.samples;
+  b.windStd = NAN;
+}
 
-  std::sort(loaded.begin(), loaded.end(), [](const BucketSample& a, const BucketSample& b) {
-    return a.startEpoch < b.startEpoch;
-  });
+// Validates header/footer and returns the record count. A missing or torn footer
+// (power loss mid-append) is rebuilt from the whole records that are present.
+static bool bktOpenInfo(File& f, BktHeader& hdr, BktFooter& ftr) {
+  size_t size = f.size();
+  if (size < sizeof(BktHeader)) return false;
+  f.seek(0);
+  if (f.read((uint8_t*)&hdr, sizeof(hdr)) != (int)sizeof(hdr)) return false;
+  if (memcmp(hdr.magic, "WSBK", 4) != 0 || hdr.version != BKT_VERSION ||
+      hdr.recordSize != sizeof(BktRecord)) {
+    return false;
+  }
 
-  if (loaded.size() > (size_t)LogConfig::BUCKETS_24H) {
-    loaded.erase(loaded.begin(), loaded.begin() + (loaded.size() - LogConfig::BUCKETS_24H));
+  if (size >= sizeof(BktHeader) + sizeof(BktFooter)) {
+    f.seek(size - sizeof(BktFooter));
+    if (f.read((uint8_t*)&ftr, sizeof(ftr)) == (int)sizeof(ftr) &&
+        memcmp(ftr.magic, "WSBF", 4) == 0 &&
+        sizeof(BktHeader) + (size_t)ftr.count * sizeof(BktRecord) + sizeof(BktFooter) == size) {
+      return true;
+    }
   }
 
-  memset(gBuckets, 0, sizeof(gBuckets));
-  gBucketWrite = 0;
-  for (const auto& b : loaded) {
-    pushBucketSample(b);
+  // Footer missing: derive it from the records (unsorted is the safe assumption)
+  memcpy(ftr.magic, "WSBF", 4);
+  ftr.count = (uint32_t)((size - sizeof(BktHeader)) / sizeof(BktRecord));
+  ftr.minEpoch = UINT32_MAX;
+  ftr.maxEpoch = 0;
+  ftr.flags = 0;
+  f.seek(sizeof(BktHeader));
+  BktRecord r;
+  for (uint32_t i = 0; i < ftr.count; i++) {
+    if (f.read((uint8_t*)&r, sizeof(r)) != (int)sizeof(r)) { ftr.count = i; break; }
+    if (r.epoch < ftr.minEpoch) ftr.minEpoch = r.epoch;
+    if (r.epoch > ftr.maxEpoch) ftr.maxEpoch = r.epoch;
   }
+  return true;
+}
 
-  rebuildTodayAggregates();
+static bool bktReadEpochAt(File& f, uint32_t index, uint32_t& epoch) {
+  if (!f.seek(sizeof(BktHeader) + (size_t)index * sizeof(BktRecord))) return false;
+  return f.read((uint8_t*)&epoch, sizeof(epoch)) == (int)sizeof(epoch);
 }
 
-// ------------------- BME280 -------------------
-// Convert station pressure to Mean Sea Level Pressure (MSLP)
-// Using the ICAO Standard Barometric Formula with measured temperature
-float convertToMSLP(float stationPressurePa, float tempC, float altitudeM) {
-  if (!isfinite(stationPressurePa) || !isfinite(tempC)) return stationPressurePa;
-  
-  // If altitude is essentially zero, return station pressure
-  if (altitudeM > -0.1f && altitudeM < 0.1f) return stationPressurePa;
+// Calls fn(const BucketSample&) for every record with epoch >= fromEpoch, in file order.
+// Returns false if the file is missing or not a valid bucket log.
+template <typename Fn>
+static bool forEachBucketRecord(const String& path, time_t fromEpoch, Fn&& fn) {
+  if (!gSdOk || !hal::storage().exists(path.c_str())) return false;
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return false;
 
-  const float L = 0.0065f;        // Standard lapse rate (K/m)
-  const float T_station = tempC + 273.15f; // Station temperature in Kelvin
-  const float exponent = 5.25588f; // g / (R * L)
+  BktHeader hdr;
+  BktFooter ftr;
+  if (!bktOpenInfo(f, hdr, ftr)) { f.close(); return false; }
+  if (ftr.count == 0 || (fromEpoch > 0 && ftr.maxEpoch < (uint32_t)fromEpoch)) {
+    f.close();
+    return true;
+  }
 
-  // Use the station temperature directly in the ratio
-  float ratio = 1.0f + (L * altitudeM / T_station);
-  float mslpPa = stationPressurePa * pow(ratio, exponent);
+  // Seek straight to the first record at/after the cutoff when order is known
+  uint32_t first = 0;
+  if ((ftr.flags & BKT_FLAG_SORTED) && fromEpoch > 0 && ftr.minEpoch < (uint32_t)fromEpoch) {
+    uint32_t lo = 0, hi = ftr.count;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      uint32_t e = 0;
+      if (!bktReadEpochAt(f, mid, e)) { hi = mid; break; }
+      if (e < (uint32_t)fromEpoch) lo = mid + 1; else hi = mid;
+    }
+    first = lo;
+  }
 
-  return mslpPa;
+  f.seek(sizeof(BktHeader) + (size_t)first * sizeof(BktRecord));
+  const uint32_t BLOCK = 32;
+  BktRecord block[BLOCK];
+  uint32_t remaining = ftr.count - first;
+  while (remaining > 0) {
+    uint32_t n = remaining < BLOCK ? remaining : BLOCK;
+    int got = f.read((uint8_t*)block, n * sizeof(BktRecord));
+    metricSdRead(got);
+    if (got <= 0) break;
+    n = (uint32_t)got / sizeof(BktRecord);
+    if (n == 0) break;
+    for (uint32_t i = 0; i < n; i++) {
+      if ((time_t)block[i].epoch < fromEpoch) continue;
+      BucketSample b{};
+      recordToBucket(block[i], b);
+      fn(b);
+    }
+    remaining -= n;
+  }
+  f.close();
+  return true;
 }
 
-void pollBME() {
-  if (!BME280Config::ENABLE || !gBmeOk) return;
-  gTempC = bme.readTemperature();
-  float stationPressurePa = bme.readPressure();
-  gHumRH = bme.readHumidity();
+// What computeBucketSample gives for a bucket that got no samples
+static BucketSample emptyBucketAt(time_t start) {
+  BucketSample b{};
+  b.startEpoch = start;
+  b.samples = 0;
+  for (int c = 0; c < CH_COUNT; c++) b.*kBucketChannel[c] = NAN;
+  b.avgWind = 0.0f;
+  b.maxWind = 0.0f;
+  b.windStd = NAN;
+  return b;
+}
 
-  // Convert to Mean Sea Level Pressure using station altitude
-  gPressurePa = convertToMSLP(stationPressurePa, gTempC, BME280Config::ALTITUDE_METERS);
+// Buckets for one day's files: an array, or a run of empty buckets from a
+// clock jump or outage, generated as they are written (start + i * BUCKET_SECONDS)
+struct BucketRun {
+  const BucketSample* rows;  // nullptr: the empty run
+  time_t start;
+  int n;
 
-  // Accumulate for per-bucket averages
-  if (timeIsValid(gCurrentBucketStart)) {
-    gBucketTempSum += gTempC;
-    gBucketHumSum += gHumRH;
-    gBucketPressSumPa += gPressurePa;
-    gBucketEnvSamples++;
+  BucketSample at(int i) const {
+    return rows ? rows[i] : emptyBucketAt(start + (time_t)i * LogConfig::BUCKET_SECONDS);
   }
-}
+  static BucketRun of(const BucketSample* b, int n) { return BucketRun{b, 0, n}; }
+  static BucketRun empty(time_t start, int n) { return BucketRun{nullptr, start, n}; }
+};
 
-// ------------------- PMS5003 -------------------
-void pollPMS() {
-  if (!PMS5003Config::ENABLE) return;
+// Appends n buckets to the day's log in one open/write/close, moving the footer
+// to the new end of file. With skipLogged, buckets at or before the last logged
+// epoch are dropped (journal replay, flush retry). Returns the bytes written,
+// 0 if the file could not be opened or a write came up short.
+static size_t appendBucketRecords(time_t dayMidnightLocal, const BucketRun& run, bool skipLogged) {
+  const int n = run.n;
+  if (!gSdOk || n <= 0) return 0;
+  String path = bktPathForDay(dayMidnightLocal);
+
+  BktHeader hdr;
+  BktFooter ftr;
+  File f;
+  bool valid = false;
+  if (hal::storage().exists(path.c_str())) {
+    f = hal::storage().open(path.c_str(), "r+");
+    if (!f) return 0;
+    valid = bktOpenInfo(f, hdr, ftr);
+  }
 
-  while (Serial2.available()) {
-    uint8_t byte = Serial2.read();
+  size_t written = 0, wanted = 0;
+  if (!valid) {
+    if (f) f.close();
+    f = hal::storage().open(path.c_str(), FILE_WRITE);
+    if (!f) return 0;
+    memcpy(hdr.magic, "WSBK", 4);
+    hdr.version = BKT_VERSION;
+    hdr.recordSize = sizeof(BktRecord);
+    hdr.bucketSeconds = LogConfig::BUCKET_SECONDS;
+    hdr.dayStartEpoch = (uint32_t)dayMidnightLocal;
+    written += f.write((const uint8_t*)&hdr, sizeof(hdr));
+    wanted += sizeof(hdr);
+    memcpy(ftr.magic, "WSBF", 4);
+    ftr.count = 0;
+    ftr.minEpoch = UINT32_MAX;
+    ftr.maxEpoch = 0;
+    ftr.flags = BKT_FLAG_SORTED;
+  }
+
+  f.seek(sizeof(BktHeader) + (size_t)ftr.count * sizeof(BktRecord));
+  uint32_t loggedMax = ftr.maxEpoch;
+  for (int i = 0; i < n; i++) {
+    BktRecord rec;
+    bucketToRecord(run.at(i), rec);
+    if (skipLogged && ftr.count > 0 && rec.epoch <= loggedMax) continue;
+    if (ftr.count > 0 && rec.epoch <= ftr.maxEpoch) ftr.flags &= ~BKT_FLAG_SORTED;
+    if (rec.epoch < ftr.minEpoch) ftr.minEpoch = rec.epoch;
+    if (rec.epoch > ftr.maxEpoch) ftr.maxEpoch = rec.epoch;
+    ftr.count++;
+    written += f.write((const uint8_t*)&rec, sizeof(rec));
+    wanted += sizeof(rec);
+  }
+  written += f.write((const uint8_t*)&ftr, sizeof(ftr));
+  wanted += sizeof(ftr);
+  f.close();
+  return written == wanted ? written : 0;
+}
+
+// Same text Arduino's String(float, prec) produces (dtostrf), without allocating.
+static size_t formatFixed(char* out, size_t cap, double v, int prec) {
+  if (isnan(v)) return (size_t)snprintf(out, cap, "nan");
+  if (isinf(v)) return (size_t)snprintf(out, cap, "inf");
+  char buf[48];
+  char* p = buf;
+  if (v < 0.0) { *p++ = '-'; v = -v; }
+  double rounding = 2.0;
+  for (int i = 0; i < prec; i++) rounding *= 10.0;
+  v += 1.0 / rounding;
+  double tenpow = 1.0;
+  int digitcount = 1;
+  while (v >= 10.0 * tenpow && digitcount < 39 - prec) { tenpow *= 10.0; digitcount++; }
+  v /= tenpow;
+  digitcount += prec;
+  while (digitcount-- > 0) {
+    int digit = (int)v;
+    if (digit > 9) digit = 9;
+    *p++ = (char)('0' | digit);
+    if (digitcount == prec && prec > 0) *p++ = '.';
+    v -= digit;
+    v *= 10.0;
+  }
+  *p = '\0';
+  size_t n = (size_t)(p - buf);
+  if (cap) {
+    size_t c = n < cap ? n : cap - 1;
+    memcpy(out, buf, c);
+    out[c] = '\0';
+  }
+  return n;
+}
+
+// One CSV row (no newline) in the /data file format.
+static size_t formatBucketCsvRow(const BucketSample& b, char* out, size_t cap) {
+  struct tm tmLocal;
+  time_t t = b.startEpoch;
+  localtime_r(&t, &tmLocal);
+  size_t n = strftime(out, cap, "%Y-%m-%d %H:%M:%S", &tmLocal);
+  auto sep = [&]() { if (n + 1 < cap) { out[n++] = ','; out[n] = '\0'; } };
+  auto num = [&](float v, int prec) { if (n < cap) n += formatFixed(out + n, cap - n, v, prec); };
+  auto numOrBlank = [&](float v, int prec) { if (isfinite(v)) num(v, prec); };
+
+  sep(); if (n < cap) n += snprintf(out + n, cap - n, "%lu", (unsigned long)(uint32_t)b.startEpoch);
+  for (int c = 0; c < CH_COUNT; c++) {
+    float v = b.*kBucketChannel[c];
+    sep();
+    if (CHANNELS[c].blankIfMissing) numOrBlank(v, CHANNELS[c].decimals);
+    else num(v, CHANNELS[c].decimals);
+  }
+  sep(); if (n < cap) n += snprintf(out + n, cap - n, "%lu", (unsigned long)b.samples);
+  return n < cap ? n : cap - 1;
+}
+
+// Renders a bucket log as the equivalent daily CSV (header included).
+template <typename Sink>
+static bool streamBucketLogAsCsv(const String& bktPath, Sink&& sink) {
+  sink((const uint8_t*)CSV_HEADER, strlen(CSV_HEADER));
+  sink((const uint8_t*)"\n", 1);
+  char batch[1024];
+  size_t used = 0;
+  bool ok = forEachBucketRecord(bktPath, 0, [&](const BucketSample& b) {
+    char row[160];
+    size_t n = formatBucketCsvRow(b, row, sizeof(row));
+    row[n++] = '\n';
+    if (used + n > sizeof(batch)) {
+      sink((const uint8_t*)batch, used);
+      used = 0;
+    }
+    memcpy(batch + used, row, n);
+    used += n;
+  });
+  if (used) sink((const uint8_t*)batch, used);
+  return ok;
+}
+
+void deleteOldDailyFileIfNeeded(time_t todayMidnightLocal) {
+  // If LogConfig::RETENTION_DAYS is 0, never delete files
+  if (LogConfig::RETENTION_DAYS == 0) return;
+
+  time_t oldMidnight = subtractDaysLocalMidnight(todayMidnightLocal, LogConfig::RETENTION_DAYS + 1);
+  String ymd = ymdString(oldMidnight);
+  String dataPath = String("/data/") + ymd + ".csv";
+  if (gSdOk && hal::storage().exists(dataPath.c_str())) hal::storage().remove(dataPath.c_str());
+  fileCatalogErase(ymdNumber(oldMidnight));
+  String bktPath = bktPathForDay(oldMidnight);
+  if (gSdOk && hal::storage().exists(bktPath.c_str())) hal::storage().remove(bktPath.c_str());
+}
+
+// ------------------- SD WRITE-BEHIND LOG -------------------
+// Finalized buckets are held in RAM and written in batches, one
+// open/write/close per day file per flush instead of three per minute. Each
+// bucket also goes to a fixed-size journal whose handle stays open, so rows
+// still in RAM survive a brown-out and are replayed at boot.
+
+static const char* JOURNAL_PATH = "/log.jnl";
+static constexpr uint16_t JOURNAL_VERSION = 1;
+
+struct __attribute__((packed)) JournalHeader {
+  char     magic[4];      // "WSJN"
+  uint16_t version;
+  uint16_t recordSize;
+  uint16_t slots;
+  uint16_t reserved;
+  uint32_t flushedEpoch;  // slots at or before this epoch are already in the day files
+};
+
+static BucketSample gLogPending[LogConfig::SD_FLUSH_MAX_BUCKETS];
+static int      gLogPendingCount = 0;
+static uint32_t gLogPendingSinceMs = 0;
+static bool     gLogRetry = false;        // a flush left rows behind: the retry skips rows already in the files
+static File     gJournalFile;
+static bool     gLogDirsOk = false;       // /data and /backup known to exist
+static time_t   gLogDayFilesKnown = 0;    // day whose CSVs are known to exist (header written)
+static char     gLogRowBuf[LogConfig::SD_FLUSH_MAX_BUCKETS * 160 + 128];
+
+// Flush statistics (reported by /api/now)
+static uint32_t gLogFlushCount = 0;
+static uint32_t gLogFlushErrors = 0;
+static uint32_t gLogFlushLastMs = 0;
+static uint32_t gLogFlushMaxMs = 0;
+static uint32_t gLogBytesWritten = 0;
+static uint32_t gLogJournalBytes = 0;
+static uint32_t gLogRowsDropped = 0;     // buffer full while the card refused writes, or a refused gap fill
+static uint32_t gLogJournalReplayed = 0; // rows recovered from the journal at boot
+
+// Call after anything deletes or replaces files under /data or /backup.
+static void invalidateLogFileCache() {
+  gLogDirsOk = false;
+  gLogDayFilesKnown = 0;
+}
+
+static bool openJournal() {
+  if (gJournalFile) return true;
+  if (!gSdOk) return false;
+  const size_t expectedSize = sizeof(JournalHeader) + (size_t)LogConfig::SD_FLUSH_MAX_BUCKETS * sizeof(BktRecord);
+  if (hal::storage().exists(JOURNAL_PATH)) {
+    File f = hal::storage().open(JOURNAL_PATH, "r+");
+    JournalHeader h;
+    if (f && f.size() == expectedSize && f.read((uint8_t*)&h, sizeof(h)) == (int)sizeof(h) &&
+        memcmp(h.magic, "WSJN", 4) == 0 && h.version == JOURNAL_VERSION &&
+        h.recordSize == sizeof(BktRecord) && h.slots == LogConfig::SD_FLUSH_MAX_BUCKETS) {
+      gJournalFile = f;
+      return true;
+    }
+    if (f) f.close();
+  }
+
+  // Preallocate every slot so appends never grow the file
+  File f = hal::storage().open(JOURNAL_PATH, FILE_WRITE);
+  if (!f) return false;
+  JournalHeader h{};
+  memcpy(h.magic, "WSJN", 4);
+  h.version = JOURNAL_VERSION;
+  h.recordSize = sizeof(BktRecord);
+  h.slots = LogConfig::SD_FLUSH_MAX_BUCKETS;
+  f.write((const uint8_t*)&h, sizeof(h));
+  BktRecord empty{};
+  for (int i = 0; i < LogConfig::SD_FLUSH_MAX_BUCKETS; i++) f.write((const uint8_t*)&empty, sizeof(empty));
+  f.close();
+  gJournalFile = hal::storage().open(JOURNAL_PATH, "r+");
+  return (bool)gJournalFile;
+}
+
+static void journalWriteSlot(int slot, const BucketSample& b) {
+  if (!openJournal()) return;
+  BktRecord rec;
+  bucketToRecord(b, rec);
+  gJournalFile.seek(sizeof(JournalHeader) + (size_t)slot * sizeof(BktRecord));
+  gJournalFile.write((const uint8_t*)&rec, sizeof(rec));
+  gJournalFile.flush();
+  gLogJournalBytes += sizeof(rec);
+}
+
+static void journalMarkFlushed(time_t epoch) {
+  if (!openJournal()) return;
+  JournalHeader h{};
+  memcpy(h.magic, "WSJN", 4);
+  h.version = JOURNAL_VERSION;
+  h.recordSize = sizeof(BktRecord);
+  h.slots = LogConfig::SD_FLUSH_MAX_BUCKETS;
+  h.flushedEpoch = (uint32_t)epoch;
+  gJournalFile.seek(0);
+  gJournalFile.write((const uint8_t*)&h, sizeof(h));
+  gJournalFile.flush();
+  gLogJournalBytes += sizeof(h);
+}
+
+// Epoch of the last complete row of a daily CSV (0 if none).
+static time_t lastCsvEpoch(const String& path) {
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return 0;
+  char tail[256];
+  size_t size = f.size();
+  size_t n = size < sizeof(tail) - 1 ? size : sizeof(tail) - 1;
+  f.seek(size - n);
+  n = f.read((uint8_t*)tail, n);
+  f.close();
+  tail[n] = '\0';
+  time_t last = 0;
+  char* line = tail;
+  while (line && *line) {
+    char* next = strchr(line, '\n');
+    if (!next) break;  // torn last line: not counted
+    const char* comma = strchr(line, ',');
+    if (comma && comma < next) {
+      unsigned long e = strtoul(comma + 1, nullptr, 10);
+      if (timeIsValid((time_t)e)) last = (time_t)e;
+    }
+    line = next + 1;
+  }
+  return last;
+}
+
+// Formats into gLogRowBuf and writes it out whenever it fills, so a run longer
+// than the buffer still takes a single open/close. False if the file could not
+// be opened or took fewer bytes than given; what did go out is added to written.
+static bool appendCsvRows(const String& path, bool needHeader, const BucketRun& run, bool skipLogged,
+                          size_t& written) {
+  time_t after = skipLogged ? lastCsvEpoch(path) : 0;
+  File f;
+  size_t len = 0;
+  int rows = 0;
+  if (needHeader) len += snprintf(gLogRowBuf, sizeof(gLogRowBuf), "%s\n", CSV_HEADER);
+  for (int i = 0; i < run.n; i++) {
+    BucketSample b = run.at(i);
+    if (b.startEpoch <= after) continue;
+    if (len + 160 > sizeof(gLogRowBuf)) {
+      if (!f) f = hal::storage().open(path.c_str(), FILE_APPEND);
+      if (!f) return false;
+      size_t n = f.write((const uint8_t*)gLogRowBuf, len);
+      written += n;
+      if (n != len) return false;
+      len = 0;
+    }
+    len += formatBucketCsvRow(b, gLogRowBuf + len, sizeof(gLogRowBuf) - len);
+    gLogRowBuf[len++] = '\n';
+    rows++;
+  }
+  if (rows == 0) return true;
+  if (!f) f = hal::storage().open(path.c_str(), FILE_APPEND);
+  if (!f) return false;
+  size_t n = f.write((const uint8_t*)gLogRowBuf, len);
+  written += n;
+  f.close();
+  return n == len;
+}
+
+// Writes a run of buckets that all belong to one local day to its three files.
+// With skipLogged, rows a file already ends with are left out. False if any of
+// the three writes failed.
+static bool writeBucketsToDay(time_t dayMid, const BucketRun& run, bool skipLogged) {
+  if (!gLogDirsOk) {
+    gLogDirsOk = ensureDir("/data") && ensureDir("/backup");
+  }
+  String ymd = ymdString(dayMid);
+  String dailyFile = String("/data/") + ymd + ".csv";
+  String backupFile = String("/backup/") + ymd + ".csv";
+
+  bool known = (gLogDayFilesKnown == dayMid);
+  bool dailyNew = !known && !hal::storage().exists(dailyFile.c_str());
+  bool backupNew = !known && !hal::storage().exists(backupFile.c_str());
+
+  size_t w1 = 0, w2 = 0;
+  bool ok = appendCsvRows(dailyFile, dailyNew, run, skipLogged, w1);
+  ok = appendCsvRows(backupFile, backupNew, run, skipLogged, w2) && ok;
+  size_t w3 = appendBucketRecords(dayMid, run, skipLogged);
+  gLogBytesWritten += w1 + w2 + w3;
+  if (w1) fileCatalogGrow(dayMid, (uint32_t)w1);
+
+  ok = ok && w3 > 0;
+  if (ok) gLogDayFilesKnown = dayMid;
+  return ok;
+}
+
+// Writes the buffered rows one day run at a time. A run that fails stays in
+// gLogPending (and in its journal slot) for the next due flush; the journal is
+// stamped only below the oldest row still waiting.
+bool flushLogBuffer() {
+  if (gLogPendingCount == 0) return true;
+  if (!gSdOk) return false;
+  METRIC_SCOPE(sdFlush);
+  uint32_t t0 = millis();
+  const bool skipLogged = gLogRetry;
+  time_t newestWritten = 0, oldestKept = 0;
+  int kept = 0;
+  int start = 0;
+  while (start < gLogPendingCount) {
+    time_t dayMid = localMidnight(gLogPending[start].startEpoch);
+    int end = start + 1;
+    while (end < gLogPendingCount && localMidnight(gLogPending[end].startEpoch) == dayMid) end++;
+    if (writeBucketsToDay(dayMid, BucketRun::of(gLogPending + start, end - start), skipLogged)) {
+      for (int i = start; i < end; i++) {
+        if (gLogPending[i].startEpoch > newestWritten) newestWritten = gLogPending[i].startEpoch;
+      }
+    } else {
+      for (int i = start; i < end; i++, kept++) {
+        if (!oldestKept || gLogPending[i].startEpoch < oldestKept) oldestKept = gLogPending[i].startEpoch;
+        if (kept == i) continue;
+        gLogPending[kept] = gLogPending[i];
+        journalWriteSlot(kept, gLogPending[kept]);  // slots [0, kept) must hold the rows still waiting
+      }
+    }
+    start = end;
+  }
+  if (newestWritten) journalMarkFlushed(oldestKept && oldestKept <= newestWritten ? oldestKept - 1 : newestWritten);
+  const bool ok = kept == 0;
+  gLogPendingCount = kept;
+  gLogRetry = !ok;
+  if (!ok) gLogPendingSinceMs = millis();  // retried one interval from now
+
+  uint32_t dt = millis() - t0;
+  gLogFlushCount++;
+  if (!ok) gLogFlushErrors++;
+  gLogFlushLastMs = dt;
+  if (dt > gLogFlushMaxMs) gLogFlushMaxMs = dt;
+  return ok;
+}
+
+void logBucketToSD(const BucketSample& b) {
+  if (!gSdOk) return;
+  METRIC_SCOPE(sdLogBucket);
+  if (gLogPendingCount >= LogConfig::SD_FLUSH_MAX_BUCKETS) flushLogBuffer();
+  if (gLogPendingCount >= LogConfig::SD_FLUSH_MAX_BUCKETS) {
+    gLogRowsDropped++;  // the card keeps refusing writes: the rows already waiting win
+    return;
+  }
+  if (gLogPendingCount == 0) gLogPendingSinceMs = millis();
+  journalWriteSlot(gLogPendingCount, b);
+  gLogPending[gLogPendingCount++] = b;
+  if (gLogPendingCount >= LogConfig::SD_FLUSH_MAX_BUCKETS) flushLogBuffer();
+}
+
+static void flushLogBufferIfDue(uint32_t msNow) {
+  if (gLogPendingCount == 0) return;
+  if (msNow - gLogPendingSinceMs >= (uint32_t)LogConfig::SD_FLUSH_INTERVAL_S * 1000UL) flushLogBuffer();
+}
+
+// Boot: rows journaled but not flushed before a reset are appended to their
+// day files, skipping any that made it to a file before the reset. Rows that
+// still can't be written go back into gLogPending for the regular flush.
+void replayLogJournal() {
+  if (!openJournal()) return;
+  JournalHeader h;
+  gJournalFile.seek(0);
+  if (gJournalFile.read((uint8_t*)&h, sizeof(h)) != (int)sizeof(h)) return;
+
+  BucketSample pending[LogConfig::SD_FLUSH_MAX_BUCKETS];
+  int n = 0;
+  for (int i = 0; i < LogConfig::SD_FLUSH_MAX_BUCKETS; i++) {
+    BktRecord rec;
+    if (gJournalFile.read((uint8_t*)&rec, sizeof(rec)) != (int)sizeof(rec)) break;
+    if (!timeIsValid((time_t)rec.epoch) || rec.epoch <= h.flushedEpoch) continue;
+    recordToBucket(rec, pending[n++]);
+  }
+  if (n == 0) return;
+
+  // GCC 12 sees std::sort's insertion pass running off this fixed array (it can't)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+  std::sort(pending, pending + n, [](const BucketSample& a, const BucketSample& b) {
+    return a.startEpoch < b.startEpoch;
+  });
+#pragma GCC diagnostic pop
+  int start = 0;
+  while (start < n) {
+    time_t dayMid = localMidnight(pending[start].startEpoch);
+    int end = start + 1;
+    while (end < n && localMidnight(pending[end].startEpoch) == dayMid) end++;
+    if (!writeBucketsToDay(dayMid, BucketRun::of(pending + start, end - start), true)) {
+      for (int i = start; i < end; i++) {
+        journalWriteSlot(gLogPendingCount, pending[i]);
+        gLogPending[gLogPendingCount++] = pending[i];
+      }
+    }
+    start = end;
+  }
+  gLogJournalReplayed = (uint32_t)(n - gLogPendingCount);
+  if (gLogPendingCount == 0) {
+    journalMarkFlushed(pending[n - 1].startEpoch);
+    return;
+  }
+  if (gLogPending[0].startEpoch > pending[0].startEpoch) journalMarkFlushed(gLogPending[0].startEpoch - 1);
+  gLogRetry = true;
+  gLogPendingSinceMs = millis();
+}
+
+static bool deleteDirFiles(const char* dirPath) {
+  File dir = hal::storage().open(dirPath);
+  if (!dir) return false;
+  bool ok = true;
+  while (true) {
+    File entry = dir.openNextFile();
+    if (!entry) break;
+    if (entry.isDirectory()) {
+      entry.close();
+      continue;
+    }
+    String name = entry.name();
+    entry.close();
+    if (!hal::storage().remove(name.c_str())) ok = false;
+  }
+  dir.close();
+  return ok;
+}
+
+// ------------------- STREAMING CSV READER -------------------
+// Reads a File in CSV_READ_BUF_SIZE blocks and splits each row into fields in
+// place, so loaders never allocate a String per line or per field. Field
+// pointers are only valid until the next nextRow() call.
+
+static constexpr size_t CSV_READ_BUF_SIZE = 4096;
+static char gCsvReadBuf[CSV_READ_BUF_SIZE + 1];  // shared: loaders run one at a time
+
+struct CsvReader {
+  static constexpr int MAX_FIELDS = 20;
+
+  File& file;
+  char* buf;
+  size_t len = 0;
+  size_t pos = 0;
+  bool eof = false;
+  bool skipping = false;  // inside an over-long line, dropping up to its newline
+  const char* fields[MAX_FIELDS];
+  int numFields = 0;   // fields stored (<= MAX_FIELDS)
+  int numCols = 0;     // columns in the row (commas + 1), may exceed MAX_FIELDS
+  uint32_t bytesRead = 0;
+
+  explicit CsvReader(File& f) : file(f), buf(gCsvReadBuf) {}
+
+  const char* field(int i) const { return (i < numFields) ? fields[i] : ""; }
+
+  // Advances to the next non-blank row. Lines longer than the buffer are skipped.
+  bool nextRow() {
+    while (true) {
+      char* line = nullptr;
+      size_t lineLen = 0;
+      if (!takeLine(line, lineLen)) return false;
+
+      // trim
+      while (lineLen && isspace((unsigned char)line[lineLen - 1])) lineLen--;
+      while (lineLen && isspace((unsigned char)*line)) { line++; lineLen--; }
+      if (!lineLen) continue;
+      line[lineLen] = '\0';
+
+      numFields = 0;
+      numCols = 1;
+      fields[numFields++] = line;
+      for (size_t i = 0; i < lineLen; i++) {
+        if (line[i] != ',') continue;
+        line[i] = '\0';
+        numCols++;
+        if (numFields < MAX_FIELDS) fields[numFields++] = line + i + 1;
+      }
+      return true;
+    }
+  }
+
+ private:
+  bool fill() {
+    if (eof) return false;
+    if (pos > 0) {
+      memmove(buf, buf + pos, len - pos);
+      len -= pos;
+      pos = 0;
+    }
+    if (len >= CSV_READ_BUF_SIZE) return false;
+    int n = file.read((uint8_t*)buf + len, CSV_READ_BUF_SIZE - len);
+    metricSdRead(n);
+    if (n <= 0) { eof = true; return false; }
+    len += (size_t)n;
+    bytesRead += (uint32_t)n;
+    return true;
+  }
+
+  bool takeLine(char*& line, size_t& lineLen) {
+    while (true) {
+      char* start = buf + pos;
+      char* nl = (char*)memchr(start, '\n', len - pos);
+      if (nl) {
+        line = start;
+        lineLen = (size_t)(nl - start);
+        pos += lineLen + 1;
+        if (skipping) {  // the tail of an over-long line
+          skipping = false;
+          continue;
+        }
+        return true;
+      }
+      if (!fill()) {
+        if (len - pos >= CSV_READ_BUF_SIZE) {
+          // Over-long line: drop what we have and resync at the next newline
+          pos = len;
+          skipping = true;
+          continue;
+        }
+        if (pos < len && !skipping) {  // last line without trailing newline
+          line = buf + pos;
+          lineLen = len - pos;
+          pos = len;
+          return true;
+        }
+        return false;
+      }
+    }
+  }
+};
+
+// Blank, nan/null markers and non-numeric text all read as NAN.
+static float csvFloat(const char* s) {
+  while (*s == ' ' || *s == '\t') s++;
+  if (!*s) return NAN;
+  char first = *s;
+  if (first != '-' && first != '.' && !isdigit((unsigned char)first)) return NAN;  // nan, NaN, null, ...
+  if (first == '-' && (s[1] == '\0' || s[1] == '-')) return NAN;                   // "-" / "--"
+  return strtof(s, nullptr);
+}
+
+static long csvInt(const char* s) {
+  return strtol(s, nullptr, 10);
+}
+
+// Fills a bucket from a /data CSV row. Accepts the 7/8-column legacy layouts
+// (no PM, samples in column 7 when present) up to the current 11 columns.
+static bool csvRowToBucket(const CsvReader& r, BucketSample& b) {
+  if (r.numCols < 7) return false;
+  b.startEpoch = (time_t)csvInt(r.field(1));
+  b.avgWind = csvFloat(r.field(2));
+  b.maxWind = csvFloat(r.field(3));
+  b.avgTempC = csvFloat(r.field(4));
+  b.avgHumRH = csvFloat(r.field(5));
+  b.avgPressHpa = csvFloat(r.field(6));
+  // PM fields (optional for backward compatibility)
+  b.avgPM1 = (r.numCols > 7) ? csvFloat(r.field(7)) : NAN;
+  b.avgPM25 = (r.numCols > 8) ? csvFloat(r.field(8)) : NAN;
+  b.avgPM10 = (r.numCols > 9) ? csvFloat(r.field(9)) : NAN;
+  b.samples = (uint32_t)std::max<long>(0, csvInt(r.field(r.numCols > 10 ? 10 : 7)));
+  b.windStd = NAN;
+  return true;
+}
+
+// Visits one day's buckets from fromEpoch on: binary log if present, else the CSV.
+template<typename Fn>
+static bool forEachDayBucket(time_t dayMid, time_t fromEpoch, Fn&& fn) {
+  if (forEachBucketRecord(bktPathForDay(dayMid), fromEpoch, fn)) return true;
+  String path = String("/data/") + ymdString(dayMid) + ".csv";
+  if (!hal::storage().exists(path.c_str())) return false;
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return false;
+  CsvReader r(f);
+  while (r.nextRow()) {
+    if (strncmp(r.field(0), "datetime", 8) == 0) continue;
+    // Parse available columns (old format has 7-8 cols, new format has 11)
+    BucketSample b{};
+    if (!csvRowToBucket(r, b)) continue;  // Need at least 7 columns for basic data
+    if (b.startEpoch < fromEpoch) continue;
+    fn(b);
+  }
+  f.close();
+  return true;
+}
+
+// Pushes one day's buckets in [cutoff, until) onto `out`; days are read oldest
+// first, so the ring stays in order and drops the oldest once it is full. A row
+// that is not newer than the last one pushed (a hand-edited file) is skipped.
+static void collectRecentBuckets(time_t dayMidnightLocal, time_t cutoff, time_t until, BucketRing& out) {
+  auto keep = [&](const BucketSample& b) {
+    if (!timeIsValid(b.startEpoch) || b.startEpoch < cutoff || b.startEpoch >= until) return;
+    if (b.startEpoch <= out.newestEpoch()) return;
+    // Skip buckets that don't align with current LogConfig::BUCKET_SECONDS setting
+    if (b.startEpoch % LogConfig::BUCKET_SECONDS != 0) return;
+    out.push(b);
+  };
+
+  // Binary log first: seeks straight to the cutoff instead of parsing text
+  if (forEachBucketRecord(bktPathForDay(dayMidnightLocal), cutoff, keep)) return;
+
+  String path = String("/data/") + ymdString(dayMidnightLocal) + ".csv";
+  if (!hal::storage().exists(path.c_str())) return;
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return;
+  CsvReader r(f);
+  while (r.nextRow()) {
+    if (strncmp(r.field(0), "datetime", 8) == 0) continue;
+    if (r.numCols < 8) continue;  // Need at least 8 fields
+    BucketSample b{};
+    if (!csvRowToBucket(r, b)) continue;
+    keep(b);
+  }
+  f.close();
+}
+
+// Appends the buckets finalized since boot (in the RAM ring, all >= until) to
+// the loaded ones, makes the result the RAM ring and recomputes today's aggregates.
+static void installRecentBuckets(BucketRing& loaded, time_t until) {
+  if (!timeIsValid(loaded.newestEpoch())) return;
+  gBucketRing.forEach([&](const BucketSample& b) {
+    if (b.startEpoch >= until) loaded.push(b);
+  });
+  gBucketRing = loaded;
+  gBucketGen++;
+  rebuildTodayAggregates();
+}
+
+// ------------------- BME280 -------------------
+// Convert station pressure to Mean Sea Level Pressure (MSLP)
+// Using the ICAO Standard Barometric Formula with measured temperature:
+// MSLP = p * (1 + L*h / T)^5.25588. The factor only depends on T for the fixed
+// station altitude, so it is tabulated per degree once and interpolated per poll.
+static constexpr int MSLP_TABLE_MIN_C = -50;
+static constexpr int MSLP_TABLE_MAX_C = 60;
+static float gMslpFactor[MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C + 1];
+
+static void initMslpTable() {
+  const float L = 0.0065f;         // Standard lapse rate (K/m)
+  const float exponent = 5.25588f; // g / (R * L)
+  for (int i = 0; i <= MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C; i++) {
+    const float tStationK = (float)(MSLP_TABLE_MIN_C + i) + 273.15f;
+    gMslpFactor[i] = pow(1.0f + L * BME280Config::ALTITUDE_METERS / tStationK, exponent);
+  }
+}
+
+float convertToMSLP(float stationPressurePa, float tempC) {
+  if (!isfinite(stationPressurePa) || !isfinite(tempC)) return stationPressurePa;
+
+  // If altitude is essentially zero, return station pressure
+  if (BME280Config::ALTITUDE_METERS > -0.1f && BME280Config::ALTITUDE_METERS < 0.1f) return stationPressurePa;
+
+  float x = tempC - MSLP_TABLE_MIN_C;
+  if (x < 0.0f) x = 0.0f;
+  if (x > MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C) x = MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C;
+  int i = (int)x;
+  if (i >= MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C) i = MSLP_TABLE_MAX_C - MSLP_TABLE_MIN_C - 1;
+  const float f = x - i;
+  return stationPressurePa * (gMslpFactor[i] + (gMslpFactor[i + 1] - gMslpFactor[i]) * f);
+}
+
+void pollBME() {
+  if (!BME280Config::ENABLE || !gBmeOk) return;
+  hal::EnvReading env;
+  if (!hal::envRead(env)) return;
+  gTempC = env.tempC;
+  gHumRH = env.humRH;
+
+  // Convert to Mean Sea Level Pressure using station altitude
+  gPressurePa = convertToMSLP(env.pressurePa, gTempC);
+
+  // Accumulate for per-bucket averages
+  if (timeIsValid(gCurrentBucketStart)) {
+    addBucketValue(CH_TEMP, gTempC);
+    addBucketValue(CH_HUM, gHumRH);
+    addBucketValue(CH_PRESS, gPressurePa / 100.0f);
+  }
+}
+
+// ------------------- PMS5003 -------------------
+void pollPMS() {
+  if (!PMS5003Config::ENABLE) return;
+
+  Stream& port = hal::pmsPort();
+  while (port.available()) {
+    uint8_t byte = port.read();
 
     // Frame synchronization - looking for header 0x42 0x4d
     if (gPmsFrameIndex == 0 && byte != PMS_HEADER_1) continue;
@@ -548,6 +1860,7 @@ void pollPMS() {
       }
       uint16_t frameChecksum = ((uint16_t)gPmsFrameBuffer[30] << 8) | gPmsFrameBuffer[31];
 
+      metricPmsFrame(checksum == frameChecksum);
       if (checksum == frameChecksum) {
         // Extract PM values (CF=1 readings, proven working)
         // Bytes 4-5: PM1.0, 6-7: PM2.5, 8-9: PM10
@@ -561,10 +1874,9 @@ void pollPMS() {
 
         // Accumulate for per-bucket averages
         if (timeIsValid(gCurrentBucketStart)) {
-          gBucketPM1Sum += gPM1;
-          gBucketPM25Sum += gPM25;
-          gBucketPM10Sum += gPM10;
-          gBucketPmSamples++;
+          addBucketValue(CH_PM1, gPM1);
+          addBucketValue(CH_PM25, gPM25);
+          addBucketValue(CH_PM10, gPM10);
         }
       }
 
@@ -573,101 +1885,157 @@ void pollPMS() {
   }
 }
 
+// ------------------- ACQUISITION HANDOFF -------------------
+// The acquisition task (see LOOP HELPERS) owns the sensors and the bucket
+// accumulators above; loop() owns everything else. Closed buckets cross over
+// through a single-producer/single-consumer queue and live readings through a
+// seqlock, so neither side ever blocks the other.
+
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+ public:
+  // Producer only; false when full
+  bool push(const T& v) {
+    uint32_t h = _head.load(std::memory_order_relaxed);
+    if (h - _tail.load(std::memory_order_acquire) == N) return false;
+    _buf[h & (N - 1)] = v;
+    _head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  // Consumer only; false when empty
+  bool pop(T& v) {
+    uint32_t t = _tail.load(std::memory_order_relaxed);
+    if (t == _head.load(std::memory_order_acquire)) return false;
+    v = _buf[t & (N - 1)];
+    _tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T _buf[N];
+  std::atomic<uint32_t> _head{0};
+  std::atomic<uint32_t> _tail{0};
+};
+
+// One writer, any number of readers; a reader that raced a write retries
+template <typename T>
+class SeqLock {
+ public:
+  void write(const T& v) {
+    uint32_t seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _val = v;
+    _seq.store(seq + 2, std::memory_order_release);
+  }
+  T read() const {
+    T v;
+    uint32_t before, after;
+    do {
+      before = _seq.load(std::memory_order_acquire);
+      v = _val;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = _seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return v;
+  }
+
+ private:
+  std::atomic<uint32_t> _seq{0};
+  T _val{};
+};
+
+// Sampling cadence, measured on the PPS window (nominal WindConfig::PPS_WINDOW_MS)
+struct AcqStats {
+  uint32_t windows = 0;        // PPS windows closed
+  uint32_t lateWindows = 0;    // windows more than 10% longer than nominal
+  uint32_t overrunMaxUs = 0;   // longest window minus nominal
+  uint64_t overrunSumUs = 0;
+  uint32_t busyMaxUs = 0;      // longest tick of sensor + bucket work
+  uint32_t queueFull = 0;      // ticks a closed bucket had to wait for loop()
+  uint32_t gapFills = 0;       // closes followed by a run of empty buckets (clock jumped forward)
+  uint32_t clockBacksteps = 0; // times the clock stepped back past the open bucket's start
+};
+
+struct LiveSnapshot {
+  float windMs = 0.0f;
+  float windInstMs = 0.0f;   // from the last pulse period
+  float windGust3sMs = NAN;  // current 3 s running mean
+  float tempC = NAN;
+  float humRH = NAN;
+  float pressurePa = NAN;
+  float pm1 = NAN;
+  float pm25 = NAN;
+  float pm10 = NAN;
+  BucketSample bucket{};   // in-progress bucket (startEpoch 0 until started)
+  AcqStats stats;
+};
+
+// A closed bucket and the start of the one opened after it. Buckets in between
+// got no samples (the clock jumped forward); loop() fills them in as one run.
+struct ClosedBucket {
+  BucketSample bucket;
+  time_t nextStart;
+};
+
+static SpscQueue<ClosedBucket, AcqConfig::QUEUE_BUCKETS> gBucketQueue;
+static SeqLock<LiveSnapshot> gLive;
+static AcqStats gAcqStats;           // acquisition task only; readers use gLive
+static TaskHandle_t gAcqTask = nullptr;
+
 // ------------------- BUCKETS / DAILY -------------------
 
 void startBucketAt(time_t bucketStart) {
   gCurrentBucketStart = bucketStart;
   gBucketWindSum = 0.0f;
   gBucketWindMax1 = 0.0f;
-  gBucketWindMax2 = 0.0f;
+  gBucketWindSqSum = 0.0f;
+  gBucketGust = NAN;
   gBucketSamples = 0;
   gBucketPulseCount = 0;
   gBucketPulseElapsedMs = 0;
-  gBucketTempSum = 0.0f;
-  gBucketHumSum = 0.0f;
-  gBucketPressSumPa = 0.0f;
-  gBucketEnvSamples = 0;
-  gBucketPM1Sum = 0.0f;
-  gBucketPM25Sum = 0.0f;
-  gBucketPM10Sum = 0.0f;
-  gBucketPmSamples = 0;
+  memset(gBucketChSum, 0, sizeof(gBucketChSum));
+  memset(gBucketChCount, 0, sizeof(gBucketChCount));
 }
 
 void pushBucketSample(const BucketSample& b) {
-  gBuckets[gBucketWrite] = b;
-  gBucketWrite = (gBucketWrite + 1) % LogConfig::BUCKETS_24H;
+  gBucketRing.push(b);
+  gBucketGen++;
 }
 
 static void accumulateTodayFromBucket(const BucketSample& b) {
-  // Use full precision floats for daily summary
-  if (isfinite(b.avgWind)) {
-    gTodaySumOfBucketAvgs += b.avgWind;
-    gTodayBucketCount++;
-  }
-  if (isfinite(b.maxWind)) {
-    if (b.maxWind > gTodayMax) gTodayMax = b.maxWind;
-  }
-  if (isfinite(b.avgTempC)) {
-    if (!isfinite(gTodayTempMin) || b.avgTempC < gTodayTempMin) gTodayTempMin = b.avgTempC;
-    if (!isfinite(gTodayTempMax) || b.avgTempC > gTodayTempMax) gTodayTempMax = b.avgTempC;
-    gTodayTempSum += b.avgTempC;
-    gTodayTempCount++;
-  }
-  if (isfinite(b.avgHumRH)) {
-    if (!isfinite(gTodayHumMin) || b.avgHumRH < gTodayHumMin) gTodayHumMin = b.avgHumRH;
-    if (!isfinite(gTodayHumMax) || b.avgHumRH > gTodayHumMax) gTodayHumMax = b.avgHumRH;
-    gTodayHumSum += b.avgHumRH;
-    gTodayHumCount++;
-  }
-  if (isfinite(b.avgPressHpa)) {
-    if (!isfinite(gTodayPressMin) || b.avgPressHpa < gTodayPressMin) gTodayPressMin = b.avgPressHpa;
-    if (!isfinite(gTodayPressMax) || b.avgPressHpa > gTodayPressMax) gTodayPressMax = b.avgPressHpa;
-    gTodayPressSum += b.avgPressHpa;
-    gTodayPressCount++;
-  }
-  // PM accumulation (average only, no min/max)
-  if (isfinite(b.avgPM1)) {
-    gTodayPM1Sum += b.avgPM1;
-    gTodayPM1Count++;
-    if (!isfinite(gTodayPM1Max) || b.avgPM1 > gTodayPM1Max) gTodayPM1Max = b.avgPM1;
-  }
-  if (isfinite(b.avgPM25)) {
-    gTodayPM25Sum += b.avgPM25;
-    gTodayPM25Count++;
-    if (!isfinite(gTodayPM25Max) || b.avgPM25 > gTodayPM25Max) gTodayPM25Max = b.avgPM25;
-  }
-  if (isfinite(b.avgPM10)) {
-    gTodayPM10Sum += b.avgPM10;
-    gTodayPM10Count++;
-    if (!isfinite(gTodayPM10Max) || b.avgPM10 > gTodayPM10Max) gTodayPM10Max = b.avgPM10;
-  }
-}
-
-void pushDaySummary(time_t dayStart, float avgWind, float maxWind, float avgTemp, float minTemp, float maxTemp, float avgHum, float minHum, float maxHum, float avgPress = NAN, float minPress = NAN, float maxPress = NAN, float avgPM1 = NAN, float maxPM1 = NAN, float avgPM25 = NAN, float maxPM25 = NAN, float avgPM10 = NAN, float maxPM10 = NAN) {
-  if (!timeIsValid(dayStart)) return;
-  DaySummary d{};
-  d.dayStartEpoch = dayStart;
-  d.avgWind = avgWind;
-  d.maxWind = maxWind;
-  d.avgTemp = avgTemp;
-  d.minTemp = minTemp;
-  d.maxTemp = maxTemp;
-  d.avgHum = avgHum;
-  d.minHum = minHum;
-  d.maxHum = maxHum;
-  d.avgPress = avgPress;
-  d.minPress = minPress;
-  d.maxPress = maxPress;
-  d.avgPM1 = avgPM1;
-  d.maxPM1 = maxPM1;
-  d.avgPM25 = avgPM25;
-  d.maxPM25 = maxPM25;
-  d.avgPM10 = avgPM10;
-  d.maxPM10 = maxPM10;
-
-  gDays[gDayWrite] = d;
-  gDayWrite = (gDayWrite + 1) % LogConfig::DAYS_HISTORY;
-  if (gDaysCount < (uint32_t)LogConfig::DAYS_HISTORY) gDaysCount++;
+  accumulateDayAgg(gToday, b);
+}
+
+// Keeps gDays oldest first even when the boot backfill delivers a day after a
+// newer one (a midnight rollover while it runs); a day already held is replaced.
+void pushDaySummary(const DaySummary& d) {
+  if (!timeIsValid(d.dayStartEpoch)) return;
+  const int N = LogConfig::DAYS_HISTORY;
+  int oldest = (gDayWrite - (int)gDaysCount + N) % N;
+  for (uint32_t i = 0; i < gDaysCount; i++) {
+    DaySummary& e = gDays[(oldest + i) % N];
+    if (e.dayStartEpoch == d.dayStartEpoch) {
+      e = d;
+      gDayGen++;
+      return;
+    }
+  }
+  if (gDaysCount == (uint32_t)N && d.dayStartEpoch < gDays[oldest].dayStartEpoch) return;
+
+  int pos = gDayWrite;
+  gDayWrite = (gDayWrite + 1) % N;
+  if (gDaysCount < (uint32_t)N) gDaysCount++;
+  for (uint32_t i = 1; i < gDaysCount; i++) {  // shift newer days up one slot
+    int prev = (pos - 1 + N) % N;
+    if (gDays[prev].dayStartEpoch < d.dayStartEpoch) break;
+    gDays[pos] = gDays[prev];
+    pos = prev;
+  }
+  gDays[pos] = d;
+  gDayGen++;
 }
 
 void maybeRolloverDay(time_t nowEpoch) {
@@ -679,15 +2047,20 @@ void maybeRolloverDay(time_t nowEpoch) {
   }
 
   if (midnight != gTodayMidnightEpoch) {
-    if (gTodayBucketCount > 0) {
-      float avgWind = gTodaySumOfBucketAvgs / (float)gTodayBucketCount;
-      float avgTemp = (gTodayTempCount > 0) ? (gTodayTempSum / (float)gTodayTempCount) : NAN;
-      float avgHum  = (gTodayHumCount > 0) ? (gTodayHumSum / (float)gTodayHumCount) : NAN;
-      float avgPress = (gTodayPressCount > 0) ? (gTodayPressSum / (float)gTodayPressCount) : NAN;
-      float avgPM1 = (gTodayPM1Count > 0) ? (gTodayPM1Sum / (float)gTodayPM1Count) : NAN;
-      float avgPM25 = (gTodayPM25Count > 0) ? (gTodayPM25Sum / (float)gTodayPM25Count) : NAN;
-      float avgPM10 = (gTodayPM10Count > 0) ? (gTodayPM10Sum / (float)gTodayPM10Count) : NAN;
-      pushDaySummary(gTodayMidnightEpoch, avgWind, gTodayMax, avgTemp, gTodayTempMin, gTodayTempMax, avgHum, gTodayHumMin, gTodayHumMax, avgPress, gTodayPressMin, gTodayPressMax, avgPM1, gTodayPM1Max, avgPM25, gTodayPM25Max, avgPM10, gTodayPM10Max);
+    DaySummary d;
+    bool haveDay;
+    if (historyLoaded(BOOT_LOAD_BUCKETS)) {
+      haveDay = gToday.count[CH_WIND] > 0;
+      if (haveDay) daySummaryFromAgg(gTodayMidnightEpoch, gToday, d);
+    } else {
+      // gToday only has this boot's buckets yet: summarize the day file instead
+      flushLogBuffer();
+      haveDay = buildDaySummaryFromSD(gTodayMidnightEpoch, d) && isfinite(d.avgWind);
+    }
+    if (haveDay) {
+      pushDaySummary(d);
+      flushLogBuffer();  // the index records the day's final file sizes
+      appendDayIndexRecord(d);
     }
 
     gTodayMidnightEpoch = midnight;
@@ -696,45 +2069,27 @@ void maybeRolloverDay(time_t nowEpoch) {
   }
 }
 
-struct DayAgg {
-  float sumWind = 0.0f;
-  uint32_t countWind = 0;
-  float maxWind = NAN;
-  float tempSum = 0.0f;
-  uint32_t tempCount = 0;
-  float tempMin = NAN;
-  float tempMax = NAN;
-  float humSum = 0.0f;
-  uint32_t humCount = 0;
-  float humMin = NAN;
-  float humMax = NAN;
-  float pressSum = 0.0f;
-  uint32_t pressCount = 0;
-  float pressMin = NAN;
-  float pressMax = NAN;
-  float pm1Sum = 0.0f;
-  uint32_t pm1Count = 0;
-  float pm1Max = NAN;
-  float pm25Sum = 0.0f;
-  uint32_t pm25Count = 0;
-  float pm25Max = NAN;
-  float pm10Sum = 0.0f;
-  uint32_t pm10Count = 0;
-  float pm10Max = NAN;
-};
+// Branch-free over the channels; fminf/fmaxf skip NaN (no data)
+static void accumulateDayAgg(DayAgg& agg, const BucketSample& b) {
+  float v[CH_COUNT];
+  for (int c = 0; c < CH_COUNT; c++) v[c] = b.*kBucketChannel[c];
+  for (int c = 0; c < CH_COUNT; c++) {
+    bool ok = isfinite(v[c]);
+    agg.sum[c] += ok ? v[c] : 0.0f;
+    agg.count[c] += ok ? 1 : 0;
+    agg.lo[c] = fminf(agg.lo[c], v[c]);
+    agg.hi[c] = fmaxf(agg.hi[c], v[c]);
+  }
+  for (int i = 0; i < HIST_COUNT; i++) histAdd(agg.hist[i], HISTOGRAMS[i], v[HISTOGRAMS[i].channel]);
+}
 
 static void computeBucketSample(BucketSample& b, time_t bucketStart) {
   b.startEpoch = bucketStart;
   b.samples = gBucketSamples;
 
-  if (gBucketEnvSamples > 0) {
-    b.avgTempC = gBucketTempSum / (float)gBucketEnvSamples;
-    b.avgHumRH = gBucketHumSum / (float)gBucketEnvSamples;
-    b.avgPressHpa = (gBucketPressSumPa / (float)gBucketEnvSamples) / 100.0f;
-  } else {
-    b.avgTempC = NAN;
-    b.avgHumRH = NAN;
-    b.avgPressHpa = NAN;
+  // Polled channels: mean of the bucket's readings
+  for (int c = 0; c < CH_COUNT; c++) {
+    b.*kBucketChannel[c] = gBucketChCount[c] ? gBucketChSum[c] / (float)gBucketChCount[c] : NAN;
   }
 
   // Wind
@@ -747,232 +2102,1141 @@ static void computeBucketSample(BucketSample& b, time_t bucketStart) {
   }
   b.avgWind = avgWindMs;
 
-  float maxWindMs = gBucketWindMax1;
+  // 3 s gust; the 1 s maximum until the gust window has filled once
+  float maxWindMs = gBucketGust;
+  if (!isfinite(maxWindMs)) maxWindMs = gBucketWindMax1;
   if (maxWindMs < avgWindMs) maxWindMs = avgWindMs;
   b.maxWind = maxWindMs;
 
-  // PM averages
-  if (gBucketPmSamples > 0) {
-    b.avgPM1 = gBucketPM1Sum / (float)gBucketPmSamples;
-    b.avgPM25 = gBucketPM25Sum / (float)gBucketPmSamples;
-    b.avgPM10 = gBucketPM10Sum / (float)gBucketPmSamples;
+  if (gBucketSamples > 1) {
+    float mean = gBucketWindSum / (float)gBucketSamples;
+    float var = gBucketWindSqSum / (float)gBucketSamples - mean * mean;
+    b.windStd = sqrtf(var > 0.0f ? var : 0.0f);
   } else {
-    b.avgPM1 = NAN;
-    b.avgPM25 = NAN;
-    b.avgPM10 = NAN;
+    b.windStd = NAN;
   }
 }
 
-void loadDaySummariesFromSD(time_t nowEpoch) {
-  if (!gSdOk) return;
-  // Reset
-  memset(gDays, 0, sizeof(gDays));
-  gDayWrite = 0;
-  gDaysCount = 0;
-
-  time_t todayMid = localMidnight(nowEpoch);
-  String todayYmd = ymdString(todayMid);
+static void daySummaryFromAgg(time_t day, const DayAgg& a, DaySummary& d) {
+  d = DaySummary{};
+  d.dayStartEpoch = day;
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    d.*kDaySummaryFields[i] = a.stat(kDayStats[i].ch, kDayStats[i].stat);
+  }
+  uint32_t n = 0;
+  for (int c = 0; c < CH_COUNT; c++) n = std::max(n, a.count[c]);
+  d.buckets = (uint16_t)std::min<uint32_t>(n, UINT16_MAX);
+  memcpy(d.hist, a.hist, sizeof(d.hist));
+}
 
-  File dir = SD.open("/data");
-  if (!dir) return;
+// Aggregates one day's file (binary log, or CSV for days logged before it existed).
+static bool buildDaySummaryFromSD(time_t dayMid, DaySummary& out) {
+  DayAgg agg;
+  bool found = forEachDayBucket(dayMid, 0, [&](const BucketSample& b) {
+    accumulateDayAgg(agg, b);
+  });
+  if (!found) return false;
+  daySummaryFromAgg(dayMid, agg, out);
+  return true;
+}
 
-  // Collect per-day aggregates
-  struct Entry { time_t day; DayAgg agg; };
-  Entry entries[30];  // Reduced from 64 to avoid stack overflow
-  int entryCount = 0;
+// ------------------- CRC32 -------------------
 
-  while (true) {
-    File f = dir.openNextFile();
-    if (!f) break;
-    if (f.isDirectory()) { f.close(); continue; }
-    String name = f.name();
-    if (!name.endsWith(".csv")) { f.close(); continue; }
-    time_t dayMid = 0;
-    if (!parseYmdFromPath(name, dayMid) || !timeIsValid(dayMid)) {
-      f.close(); continue;
-    }
-    // Skip current in-progress day by name as well as by computed midnight to avoid DST skew duplicates.
-    if (dayMid == todayMid || name.indexOf(todayYmd) >= 0) { f.close(); continue; }
-
-    // find or add entry
-    DayAgg* agg = nullptr;
-    for (int i=0;i<entryCount;i++){
-      if (entries[i].day == dayMid) { agg = &entries[i].agg; break; }
-    }
-    if (!agg && entryCount < (int)(sizeof(entries)/sizeof(entries[0]))) {
-      entries[entryCount].day = dayMid;
-      agg = &entries[entryCount].agg;
-      entryCount++;
-    }
-    if (!agg) { f.close(); continue; }
-
-    // parse file
-    while (f.available()) {
-      String line = f.readStringUntil('\n');
-      line.trim();
-      if (!line.length()) continue;
-      if (line.startsWith("datetime")) continue;
-
-      // Count actual columns
-      int commaCount = 0;
-      for (int i = 0; i < line.length(); i++) {
-        if (line[i] == ',') commaCount++;
-      }
-      int numCols = commaCount + 1;
-
-      String parts[11];
-      splitCSVLine(line, parts, numCols < 11 ? numCols : 11);
-
-      // Parse available columns (old format has 8 cols, new format has 11)
-      if (numCols < 7) continue;  // Need at least 7 columns for basic data
-      float windAvg = parseFloatOrNan(parts[2]);
-      float windMax = parseFloatOrNan(parts[3]);
-      float temp    = parseFloatOrNan(parts[4]);
-      float hum     = parseFloatOrNan(parts[5]);
-      float press   = parseFloatOrNan(parts[6]);
-      float pm1     = (numCols > 7) ? parseFloatOrNan(parts[7]) : NAN;
-      float pm25    = (numCols > 8) ? parseFloatOrNan(parts[8]) : NAN;
-      float pm10    = (numCols > 9) ? parseFloatOrNan(parts[9]) : NAN;
-
-      if (isfinite(windAvg)) { agg->sumWind += windAvg; agg->countWind++; }
-      if (isfinite(windMax)) { if (!isfinite(agg->maxWind) || windMax > agg->maxWind) agg->maxWind = windMax; }
-      if (isfinite(temp)) {
-        if (!isfinite(agg->tempMin) || temp < agg->tempMin) agg->tempMin = temp;
-        if (!isfinite(agg->tempMax) || temp > agg->tempMax) agg->tempMax = temp;
-        agg->tempSum += temp; agg->tempCount++;
-      }
-      if (isfinite(hum)) {
-        if (!isfinite(agg->humMin) || hum < agg->humMin) agg->humMin = hum;
-        if (!isfinite(agg->humMax) || hum > agg->humMax) agg->humMax = hum;
-        agg->humSum += hum; agg->humCount++;
-      }
-      if (isfinite(press)) {
-        if (!isfinite(agg->pressMin) || press < agg->pressMin) agg->pressMin = press;
-        if (!isfinite(agg->pressMax) || press > agg->pressMax) agg->pressMax = press;
-        agg->pressSum += press; agg->pressCount++;
-      }
-      if (isfinite(pm1)) {
-        if (!isfinite(agg->pm1Max) || pm1 > agg->pm1Max) agg->pm1Max = pm1;
-        agg->pm1Sum += pm1; agg->pm1Count++;
-      }
-      if (isfinite(pm25)) {
-        if (!isfinite(agg->pm25Max) || pm25 > agg->pm25Max) agg->pm25Max = pm25;
-        agg->pm25Sum += pm25; agg->pm25Count++;
-      }
-      if (isfinite(pm10)) {
-        if (!isfinite(agg->pm10Max) || pm10 > agg->pm10Max) agg->pm10Max = pm10;
-        agg->pm10Sum += pm10; agg->pm10Count++;
-      }
-    }
-    f.close();
-  }
-  dir.close();
+static uint32_t crc32_table[256];
+static bool crc32_init_done = false;
 
-  // sort by day ascending
-  for (int i=0;i<entryCount;i++){
-    for (int j=i+1;j<entryCount;j++){
-      if (entries[j].day < entries[i].day){
-        Entry tmp = entries[i]; entries[i]=entries[j]; entries[j]=tmp;
-      }
-    }
-  }
-  // push into ring (keep last LogConfig::DAYS_HISTORY)
-  int startIdx = entryCount > LogConfig::DAYS_HISTORY ? entryCount - LogConfig::DAYS_HISTORY : 0;
-  for (int i=startIdx; i<entryCount; i++){
-    DayAgg& a = entries[i].agg;
-    if (!timeIsValid(entries[i].day)) continue;
-    float avgWind = (a.countWind > 0) ? (a.sumWind / (float)a.countWind) : NAN;
-    float maxWind = a.maxWind;
-    float avgTemp = (a.tempCount > 0) ? (a.tempSum / (float)a.tempCount) : NAN;
-    float avgPress = (a.pressCount > 0) ? (a.pressSum / (float)a.pressCount) : NAN;
-    float avgPM1 = (a.pm1Count > 0) ? (a.pm1Sum / (float)a.pm1Count) : NAN;
-    float avgPM25 = (a.pm25Count > 0) ? (a.pm25Sum / (float)a.pm25Count) : NAN;
-    float avgPM10 = (a.pm10Count > 0) ? (a.pm10Sum / (float)a.pm10Count) : NAN;
-    pushDaySummary(entries[i].day, avgWind, maxWind, avgTemp, a.tempMin, a.tempMax,
-                   (a.humCount > 0) ? (a.humSum / (float)a.humCount) : NAN,
-                   a.humMin, a.humMax, avgPress, a.pressMin, a.pressMax,
-                   avgPM1, a.pm1Max, avgPM25, a.pm25Max, avgPM10, a.pm10Max);
+static void crc32_init() {
+  if (crc32_init_done) return;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+    crc32_table[i] = c;
   }
+  crc32_init_done = true;
 }
 
-
-void finalizeCurrentBucket(time_t bucketStart) {
-  BucketSample b{};
-  computeBucketSample(b, bucketStart);
+static inline uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+  uint32_t c = crc;
+  for (size_t i = 0; i < len; i++) c = crc32_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+  return c;
+}
+
+// CRC32 and size of a whole file; false if it can't be opened
+static bool fileCrc32(const char* path, uint32_t& crc, uint32_t& size) {
+  File f = hal::storage().open(path, FILE_READ);
+  if (!f) return false;
+  crc32_init();
+  uint32_t c = 0xFFFFFFFFUL;
+  uint32_t total = 0;
+  uint8_t buf[512];
+  int n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) {
+    c = crc32_update(c, buf, (size_t)n);
+    total += (uint32_t)n;
+  }
+  f.close();
+  crc = c ^ 0xFFFFFFFFUL;
+  size = total;
+  return true;
+}
+
+// ------------------- DAY SUMMARY INDEX -------------------
+// /data/days.idx: append-only [DayIndexHeader][DayIndexRecord...]. A record is
+// written when a day is finalized (maybeRolloverDay) and carries the size/mtime
+// of that day's files, so boot can trust it without reparsing the day, and the
+// CSV's CRC32 for the ZIP export. Later records for the same day supersede
+// earlier ones.
+
+static const char* DAY_INDEX_PATH = "/data/days.idx";
+static constexpr uint16_t DAY_INDEX_VERSION = 4;  // 3: per-day histograms and their layout, 4: bucket count and flags
+static constexpr int DAY_INDEX_MAX_UNINDEXED_LOOKBACK = 400; // days probed by name before falling back to a dir scan
+
+// Stored bins only mean something with the edges they were counted with; an
+// index written with other HISTOGRAMS[] (or another AQI_STANDARD) is rebuilt
+static constexpr uint32_t histLayoutFingerprint() {
+  uint32_t h = 2166136261u;  // FNV-1a over channel, edge count and edges in thousandths
+  for (const HistogramDef& d : HISTOGRAMS) {
+    h = (h ^ d.channel) * 16777619u;
+    h = (h ^ d.edgeCount) * 16777619u;
+    for (int e = 0; e < d.edgeCount; e++) h = (h ^ (uint32_t)(int32_t)(d.edges[e] * 1000.0f)) * 16777619u;
+  }
+  return h;
+}
+
+struct __attribute__((packed)) DayIndexHeader {
+  char     magic[4];   // "WSDI"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t histLayout; // histLayoutFingerprint() when written
+};
+
+struct __attribute__((packed)) DayIndexRecord {
+  uint32_t dayStartEpoch;
+  uint32_t csvSize;    // 0 = file absent
+  uint32_t bktSize;
+  uint32_t csvMtime;
+  uint32_t csvCrc;     // 0 = not computed yet (rebuilt records)
+  uint16_t buckets;
+  uint16_t flags;      // DAY_INDEX_*
+  float avgWind, maxWind;
+  float avgTemp, minTemp, maxTemp;
+  float avgHum, minHum, maxHum;
+  float avgPress, minPress, maxPress;
+  float avgPM1, maxPM1;
+  float avgPM25, maxPM25;
+  float avgPM10, maxPM10;
+  ValueHistogram hist[HIST_COUNT];
+};
+
+static_assert(sizeof(DayIndexRecord) == 92 + HIST_COUNT * sizeof(ValueHistogram), "DayIndexRecord layout changed");
+
+// Written by /api/range for an old day: not a boot candidate, so readDayIndexTail
+// skips it and can still stop after the newest days
+static constexpr uint16_t DAY_INDEX_FROM_RANGE = 1 << 0;
+
+static void statDayFiles(time_t dayMid, DayIndexRecord& r) {
+  String ymd = ymdString(dayMid);
+  String csvPath = String("/data/") + ymd + ".csv";
+  String bktPath = bktPathForDay(dayMid);
+  r.csvSize = 0;
+  r.csvMtime = 0;
+  r.csvCrc = 0;
+  r.bktSize = 0;
+  if (hal::storage().exists(csvPath.c_str())) {
+    File f = hal::storage().open(csvPath.c_str(), FILE_READ);
+    if (f) {
+      r.csvSize = (uint32_t)f.size();
+      r.csvMtime = (uint32_t)f.getLastWrite();
+      f.close();
+    }
+  }
+  if (hal::storage().exists(bktPath.c_str())) {
+    File f = hal::storage().open(bktPath.c_str(), FILE_READ);
+    if (f) {
+      r.bktSize = (uint32_t)f.size();
+      f.close();
+    }
+  }
+}
+
+static void dayIndexFromSummary(const DaySummary& d, DayIndexRecord& r) {
+  r.dayStartEpoch = (uint32_t)d.dayStartEpoch;
+  r.buckets = d.buckets;
+  r.avgWind = d.avgWind;   r.maxWind = d.maxWind;
+  r.avgTemp = d.avgTemp;   r.minTemp = d.minTemp;   r.maxTemp = d.maxTemp;
+  r.avgHum = d.avgHum;     r.minHum = d.minHum;     r.maxHum = d.maxHum;
+  r.avgPress = d.avgPress; r.minPress = d.minPress; r.maxPress = d.maxPress;
+  r.avgPM1 = d.avgPM1;     r.maxPM1 = d.maxPM1;
+  r.avgPM25 = d.avgPM25;   r.maxPM25 = d.maxPM25;
+  r.avgPM10 = d.avgPM10;   r.maxPM10 = d.maxPM10;
+  memcpy(r.hist, d.hist, sizeof(r.hist));
+}
+
+static void summaryFromDayIndex(const DayIndexRecord& r, DaySummary& d) {
+  d.dayStartEpoch = (time_t)r.dayStartEpoch;
+  d.buckets = r.buckets;
+  d.avgWind = r.avgWind;   d.maxWind = r.maxWind;
+  d.avgTemp = r.avgTemp;   d.minTemp = r.minTemp;   d.maxTemp = r.maxTemp;
+  d.avgHum = r.avgHum;     d.minHum = r.minHum;     d.maxHum = r.maxHum;
+  d.avgPress = r.avgPress; d.minPress = r.minPress; d.maxPress = r.maxPress;
+  d.avgPM1 = r.avgPM1;     d.maxPM1 = r.maxPM1;
+  d.avgPM25 = r.avgPM25;   d.maxPM25 = r.maxPM25;
+  d.avgPM10 = r.avgPM10;   d.maxPM10 = r.maxPM10;
+  memcpy(d.hist, r.hist, sizeof(d.hist));
+}
+
+static bool writeDayIndexRecord(const DayIndexRecord& r) {
+  if (!gSdOk) return false;
+  ensureDir("/data");
+
+  bool valid = false;
+  if (hal::storage().exists(DAY_INDEX_PATH)) {
+    File f = hal::storage().open(DAY_INDEX_PATH, FILE_READ);
+    if (f) {
+      DayIndexHeader h;
+      valid = f.read((uint8_t*)&h, sizeof(h)) == (int)sizeof(h) &&
+              memcmp(h.magic, "WSDI", 4) == 0 && h.version == DAY_INDEX_VERSION &&
+              h.recordSize == sizeof(DayIndexRecord) && h.histLayout == histLayoutFingerprint() &&
+              (f.size() - sizeof(h)) % sizeof(DayIndexRecord) == 0;
+      f.close();
+    }
+  }
+
+  // Unknown version or torn tail: the index is only a cache, start it over
+  File f = hal::storage().open(DAY_INDEX_PATH, valid ? FILE_APPEND : FILE_WRITE);
+  if (!f) return false;
+  if (!valid) {
+    DayIndexHeader h;
+    memcpy(h.magic, "WSDI", 4);
+    h.version = DAY_INDEX_VERSION;
+    h.recordSize = sizeof(DayIndexRecord);
+    h.histLayout = histLayoutFingerprint();
+    f.write((const uint8_t*)&h, sizeof(h));
+  }
+  f.write((const uint8_t*)&r, sizeof(r));
+  f.close();
+  return true;
+}
+
+void appendDayIndexRecord(const DaySummary& d) {
+  if (!gSdOk || !timeIsValid(d.dayStartEpoch)) return;
+  DayIndexRecord r{};
+  dayIndexFromSummary(d, r);
+  statDayFiles(d.dayStartEpoch, r);
+  // The day is final now, so its CRC stays valid for every later ZIP export
+  if (r.csvSize > 0) {
+    uint32_t crc = 0, size = 0;
+    String csvPath = String("/data/") + ymdString(d.dayStartEpoch) + ".csv";
+    if (fileCrc32(csvPath.c_str(), crc, size) && size == r.csvSize) r.csvCrc = crc;
+  }
+  writeDayIndexRecord(r);
+}
+
+// Opens the index for reading and counts its records; false if it is missing,
+// of another version or counted with other histogram edges.
+static bool openDayIndex(File& f, uint32_t& count) {
+  if (!gSdOk || !hal::storage().exists(DAY_INDEX_PATH)) return false;
+  f = hal::storage().open(DAY_INDEX_PATH, FILE_READ);
+  if (!f) return false;
+  DayIndexHeader h;
+  if (f.read((uint8_t*)&h, sizeof(h)) != (int)sizeof(h) || memcmp(h.magic, "WSDI", 4) != 0 ||
+      h.version != DAY_INDEX_VERSION || h.recordSize != sizeof(DayIndexRecord) ||
+      h.histLayout != histLayoutFingerprint()) {
+    f.close();
+    return false;
+  }
+  count = (uint32_t)((f.size() - sizeof(h)) / sizeof(DayIndexRecord));
+  return true;
+}
+
+static bool readDayIndexRecordAt(File& f, uint32_t n, DayIndexRecord& r) {
+  if (!f.seek(sizeof(DayIndexHeader) + (size_t)n * sizeof(DayIndexRecord))) return false;
+  int got = f.read((uint8_t*)&r, sizeof(r));
+  metricSdRead(got);
+  return got == (int)sizeof(r);
+}
+
+// Reads the index backwards until maxDays distinct days are collected (newest
+// record per day wins). Returns false if there is no usable index.
+static bool readDayIndexTail(int maxDays, std::vector<DayIndexRecord>& out) {
+  out.clear();
+  File f;
+  uint32_t count = 0;
+  if (!openDayIndex(f, count)) return false;
+
+  const uint32_t BLOCK = 16;
+  DayIndexRecord block[BLOCK];
+  uint32_t end = count;
+  while (end > 0 && (int)out.size() < maxDays) {
+    uint32_t start = end > BLOCK ? end - BLOCK : 0;
+    f.seek(sizeof(DayIndexHeader) + (size_t)start * sizeof(DayIndexRecord));
+    int got = f.read((uint8_t*)block, (end - start) * sizeof(DayIndexRecord));
+    metricSdRead(got);
+    if (got != (int)((end - start) * sizeof(DayIndexRecord))) break;
+    for (int i = (int)(end - start) - 1; i >= 0 && (int)out.size() < maxDays; i--) {
+      if (block[i].flags & DAY_INDEX_FROM_RANGE) continue;
+      bool seen = false;
+      for (const auto& r : out) {
+        if (r.dayStartEpoch == block[i].dayStartEpoch) { seen = true; break; }
+      }
+      if (!seen) out.push_back(block[i]);
+    }
+    end = start;
+  }
+  f.close();
+  return true;
+}
+
+// For slots.size() consecutive days from firstDay: the number of the newest
+// record of each (UINT32_MAX = not indexed). One forward pass over the index.
+static bool readDayIndexSlots(time_t firstDay, std::vector<uint32_t>& slots) {
+  std::fill(slots.begin(), slots.end(), UINT32_MAX);
+  File f;
+  uint32_t count = 0;
+  if (!openDayIndex(f, count)) return false;
+
+  const uint32_t BLOCK = 16;
+  DayIndexRecord block[BLOCK];
+  for (uint32_t start = 0; start < count; start += BLOCK) {
+    uint32_t n = std::min(BLOCK, count - start);
+    int got = f.read((uint8_t*)block, n * sizeof(DayIndexRecord));
+    metricSdRead(got);
+    if (got != (int)(n * sizeof(DayIndexRecord))) break;
+    for (uint32_t i = 0; i < n; i++) {
+      // Rounded to whole days: midnights are 23 or 25 hours apart across DST
+      time_t day = (time_t)block[i].dayStartEpoch;
+      if (day + 43200 < firstDay) continue;
+      size_t slot = (size_t)((day - firstDay + 43200) / 86400);
+      if (slot < slots.size()) slots[slot] = start + i;
+    }
+  }
+  f.close();
+  return true;
+}
+
+// A record without files: supersedes the day's summary once its files are deleted
+static void dropDayIndexRecord(time_t dayMid) {
+  if (!gSdOk || !hal::storage().exists(DAY_INDEX_PATH)) return;
+  DayIndexRecord r{};
+  r.dayStartEpoch = (uint32_t)dayMid;
+  writeDayIndexRecord(r);
+}
+
+static bool dayFilesExist(time_t dayMid) {
+  String csvPath = String("/data/") + ymdString(dayMid) + ".csv";
+  return hal::storage().exists(csvPath.c_str()) || hal::storage().exists(bktPathForDay(dayMid).c_str());
+}
+
+// Every day that has a file in /data (one directory walk; used when no index exists yet).
+static void scanDataDirDays(time_t todayMid, std::vector<time_t>& days) {
+  File dir = hal::storage().open("/data");
+  if (!dir) return;
+  String todayYmd = ymdString(todayMid);
+  while (true) {
+    File f = dir.openNextFile();
+    if (!f) break;
+    bool isDir = f.isDirectory();
+    String name = f.name();
+    f.close();
+    if (isDir) continue;
+    if (!name.endsWith(".csv") && !name.endsWith(".bkt")) continue;
+    time_t dayMid = 0;
+    if (!parseYmdFromPath(name, dayMid) || !timeIsValid(dayMid)) continue;
+    // Skip current in-progress day by name as well as by computed midnight to avoid DST skew duplicates.
+    if (dayMid == todayMid || name.indexOf(todayYmd) >= 0) continue;
+    if (std::find(days.begin(), days.end(), dayMid) == days.end()) days.push_back(dayMid);
+  }
+  dir.close();
+}
+
+// The newest DAYS_HISTORY days before todayMid that have files, oldest first,
+// plus the index records that may vouch for them
+static void listSummaryDays(time_t todayMid, std::vector<DayIndexRecord>& indexed, std::vector<time_t>& days) {
+  indexed.clear();
+  days.clear();
+  bool haveIndex = readDayIndexTail(LogConfig::DAYS_HISTORY, indexed);
+  time_t newestIndexed = 0;
+  for (const auto& r : indexed) {
+    if ((time_t)r.dayStartEpoch > newestIndexed) newestIndexed = (time_t)r.dayStartEpoch;
+  }
+
+  // Days newer than anything indexed (e.g. the last day before a power cut) are
+  // found by probing names; without an index, walk the directory once instead.
+  bool needScan = !haveIndex;
+  if (haveIndex) {
+    time_t d = subtractDaysLocalMidnight(todayMid, 1);
+    for (int i = 0; d > newestIndexed; i++) {
+      if (i >= DAY_INDEX_MAX_UNINDEXED_LOOKBACK) { needScan = true; break; }
+      if (dayFilesExist(d)) days.push_back(d);
+      d = subtractDaysLocalMidnight(d, 1);
+    }
+  }
+  if (needScan) {
+    days.clear();
+    scanDataDirDays(todayMid, days);
+  }
+  for (const auto& r : indexed) {
+    time_t d = (time_t)r.dayStartEpoch;
+    if (d != todayMid && std::find(days.begin(), days.end(), d) == days.end()) days.push_back(d);
+  }
+
+  // keep the newest LogConfig::DAYS_HISTORY, oldest first
+  std::sort(days.begin(), days.end());
+  if (days.size() > (size_t)LogConfig::DAYS_HISTORY) {
+    days.erase(days.begin(), days.begin() + (days.size() - LogConfig::DAYS_HISTORY));
+  }
+}
+
+// One day into gDays: from its index record if the files are unchanged since,
+// else rebuilt from the file and re-indexed
+static void loadDaySummary(time_t day, const std::vector<DayIndexRecord>& indexed) {
+  if (!timeIsValid(day)) return;
+  const DayIndexRecord* rec = nullptr;
+  for (const auto& r : indexed) {
+    if ((time_t)r.dayStartEpoch == day) { rec = &r; break; }
+  }
+
+  DayIndexRecord cur{};
+  statDayFiles(day, cur);
+  if (cur.csvSize == 0 && cur.bktSize == 0) return;  // deleted since it was indexed
+
+  DaySummary d{};
+  if (rec && rec->csvSize == cur.csvSize && rec->bktSize == cur.bktSize && rec->csvMtime == cur.csvMtime) {
+    summaryFromDayIndex(*rec, d);
+  } else {
+    if (!buildDaySummaryFromSD(day, d)) return;
+    dayIndexFromSummary(d, cur);
+    writeDayIndexRecord(cur);
+  }
+  pushDaySummary(d);
+}
+
+// ------------------- ROLLUP TIERS -------------------
+// Coarser RAM rings so the UI can plot a week or a month. Every finalized
+// bucket is folded into the open slot of each tier (a DayAgg, so a point has
+// the same avg/min/max set as a daily summary); a bucket past the slot end
+// quantizes the slot into the ring. Rebuilt from SD at boot.
+
+struct RollupPoint {
+  uint32_t startEpoch;
+  uint16_t buckets;                // raw buckets folded in
+  int16_t  stat[DAY_STAT_COUNT];   // kDayStats order, CHANNELS[].qScale / qOffset
+};
+
+static_assert(sizeof(RollupPoint) <= 8 + 2 * DAY_STAT_COUNT, "RollupPoint has unexpected padding");
+
+struct RollupTier {
+  uint32_t seconds;
+  RollupPoint* ring;
+  int capacity;
+  int write;
+  int count;
+  time_t openStart;      // start of the slot being accumulated (0 = none yet)
+  time_t openEnd;
+  uint16_t openBuckets;
+  DayAgg open;
+};
+
+static RollupPoint gRollupRing1[RollupConfig::TIER1_SLOTS];
+static RollupPoint gRollupRing2[RollupConfig::TIER2_SLOTS];
+static RollupTier gRollupTiers[] = {
+  {RollupConfig::TIER1_SECONDS, gRollupRing1, RollupConfig::TIER1_SLOTS, 0, 0, 0, 0, 0, DayAgg()},
+  {RollupConfig::TIER2_SECONDS, gRollupRing2, RollupConfig::TIER2_SLOTS, 0, 0, 0, 0, 0, DayAgg()},
+};
+static constexpr int ROLLUP_TIER_COUNT = sizeof(gRollupTiers) / sizeof(gRollupTiers[0]);
+static time_t gRollupLastBucket = 0;
+
+static void rollupPointFromAgg(time_t start, const DayAgg& a, uint16_t buckets, RollupPoint& p) {
+  p.startEpoch = (uint32_t)start;
+  p.buckets = buckets;
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    const ChannelDef& c = CHANNELS[kDayStats[i].ch];
+    p.stat[i] = rollupQ(a.stat(kDayStats[i].ch, kDayStats[i].stat), c.qScale, c.qOffset);
+  }
+}
+
+// Folds a rollup point back into an aggregate, weighting its averages by bucket count.
+static void mergeRollupPoint(DayAgg& agg, const RollupPoint& p) {
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    int ch = kDayStats[i].ch;
+    float v = rollupDQ(p.stat[i], CHANNELS[ch].qScale, CHANNELS[ch].qOffset);
+    if (!isfinite(v)) continue;
+    switch (kDayStats[i].stat) {
+      case STAT_AVG: agg.sum[ch] += v * p.buckets; agg.count[ch] += p.buckets; break;
+      case STAT_MIN: agg.lo[ch] = fminf(agg.lo[ch], v); break;
+      default:       agg.hi[ch] = fmaxf(agg.hi[ch], v); break;
+    }
+  }
+}
+
+// Same for a day summary (weighted by its bucket count)
+static void mergeDaySummary(DayAgg& agg, const DaySummary& d) {
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    int ch = kDayStats[i].ch;
+    float v = d.*kDaySummaryFields[i];
+    if (!isfinite(v)) continue;
+    switch (kDayStats[i].stat) {
+      case STAT_AVG: agg.sum[ch] += v * d.buckets; agg.count[ch] += d.buckets; break;
+      case STAT_MIN: agg.lo[ch] = fminf(agg.lo[ch], v); break;
+      default:       agg.hi[ch] = fmaxf(agg.hi[ch], v); break;
+    }
+  }
+  for (int i = 0; i < HIST_COUNT; i++) histMerge(agg.hist[i], d.hist[i]);
+}
+
+static void mergeDayAgg(DayAgg& into, const DayAgg& a) {
+  for (int c = 0; c < CH_COUNT; c++) {
+    into.sum[c] += a.sum[c];
+    into.count[c] += a.count[c];
+    into.lo[c] = fminf(into.lo[c], a.lo[c]);
+    into.hi[c] = fmaxf(into.hi[c], a.hi[c]);
+  }
+  for (int i = 0; i < HIST_COUNT; i++) histMerge(into.hist[i], a.hist[i]);
+}
+
+// Slots are aligned to local time so hourly points fall on the hour in any timezone.
+static time_t rollupSlotStart(time_t t, uint32_t seconds) {
+  struct tm tmLocal;
+  localtime_r(&t, &tmLocal);
+  uint32_t secOfDay = (uint32_t)(tmLocal.tm_hour * 3600 + tmLocal.tm_min * 60 + tmLocal.tm_sec);
+  return t - (time_t)(secOfDay % seconds);
+}
+
+static void rollupCloseSlot(RollupTier& t) {
+  if (t.openBuckets == 0) return;
+  rollupPointFromAgg(t.openStart, t.open, t.openBuckets, t.ring[t.write]);
+  t.write = (t.write + 1) % t.capacity;
+  if (t.count < t.capacity) t.count++;
+  t.open = DayAgg();
+  t.openBuckets = 0;
+}
+
+static void resetRollups() {
+  for (auto& t : gRollupTiers) {
+    memset(t.ring, 0, sizeof(RollupPoint) * t.capacity);
+    t.write = 0;
+    t.count = 0;
+    t.openStart = 0;
+    t.openEnd = 0;
+    t.openBuckets = 0;
+    t.open = DayAgg();
+  }
+  gRollupLastBucket = 0;
+}
+
+void rollupAddBucket(const BucketSample& b) {
+  if (!timeIsValid(b.startEpoch)) return;
+  // Buckets must arrive in order; a repeat (e.g. the bucket open across a reboot) is dropped
+  if (b.startEpoch <= gRollupLastBucket) return;
+  gRollupLastBucket = b.startEpoch;
+  for (auto& t : gRollupTiers) {
+    if (t.openStart == 0 || b.startEpoch >= t.openEnd) {
+      rollupCloseSlot(t);
+      t.openStart = rollupSlotStart(b.startEpoch, t.seconds);
+      t.openEnd = t.openStart + t.seconds;
+    }
+    accumulateDayAgg(t.open, b);
+    if (t.openBuckets < UINT16_MAX) t.openBuckets++;
+  }
+}
+
+// Oldest epoch a tier can answer for (0 = empty)
+static time_t rollupOldest(const RollupTier& t) {
+  if (t.count > 0) return (time_t)t.ring[(t.write - t.count + t.capacity) % t.capacity].startEpoch;
+  return t.openBuckets > 0 ? t.openStart : 0;
+}
+
+// First bucket the longest tier can hold at nowEpoch
+static time_t rollupBackfillStart(time_t nowEpoch) {
+  uint32_t spanSec = 0;
+  for (const auto& t : gRollupTiers) {
+    if (t.seconds * (uint32_t)t.capacity > spanSec) spanSec = t.seconds * (uint32_t)t.capacity;
+  }
+  return rollupSlotStart(nowEpoch - (time_t)spanSec, RollupConfig::TIER2_SECONDS);
+}
+
+// Folds one day file's buckets in [fromEpoch, until) into the tiers
+static void loadRollupDay(time_t dayMid, time_t fromEpoch, time_t until) {
+  forEachDayBucket(dayMid, fromEpoch, [&](const BucketSample& b) {
+    if (b.startEpoch % LogConfig::BUCKET_SECONDS != 0 || b.startEpoch >= until) return;
+    rollupAddBucket(b);
+  });
+}
+
+// loop() side of a closed bucket: RAM history, day aggregates, rollups, SD.
+// Until the rollup backfill is done the bucket reaches the tiers from the ring.
+void commitBucket(const BucketSample& b) {
   pushBucketSample(b);
   accumulateTodayFromBucket(b);
+  if (historyLoaded(BOOT_LOAD_ROLLUPS)) rollupAddBucket(b);
   logBucketToSD(b);
 }
 
+// Buckets [first, end) got no samples. RAM gets the same rows commitBucket()
+// would have added one by one; each day's share goes to its files as a single
+// append instead of through the write-behind buffer. Only the newest
+// LogConfig::GAP_FILL_MAX_HOURS are filled; anything older stays missing, as
+// after a power cut. A day the card refuses counts as a flush error and its
+// rows as dropped.
+static void commitEmptyRun(time_t first, time_t end) {
+  const time_t B = LogConfig::BUCKET_SECONDS;
+  const time_t maxSpan = (time_t)LogConfig::GAP_FILL_MAX_HOURS * 3600;
+  if (first >= end) return;
+  if (end - first > maxSpan) first = floorToBucketBoundaryLocal(end - maxSpan);
+  flushLogBuffer();  // rows already waiting come first in the files
+  for (time_t t = first; t < end;) {
+    time_t dayMid = localMidnight(t);
+    time_t stop = std::min(end, subtractDaysLocalMidnight(dayMid, -1));
+    int n = (int)((stop - t + B - 1) / B);
+    maybeRolloverDay(t);
+    for (int i = 0; i < n; i++) {
+      BucketSample b = emptyBucketAt(t + (time_t)i * B);
+      gBucketRing.push(b);
+      accumulateTodayFromBucket(b);
+      if (historyLoaded(BOOT_LOAD_ROLLUPS)) rollupAddBucket(b);
+    }
+    gBucketGen++;
+    if (gSdOk && !writeBucketsToDay(dayMid, BucketRun::empty(t, n), false)) {
+      // Not retried: the rows buffered after the gap would reach the files first
+      gLogFlushErrors++;
+      gLogRowsDropped += (uint32_t)n;
+    }
+    t = stop;
+  }
+}
+
 void rebuildTodayAggregates() {
   clearTodayAggregates();
   if (!timeIsValid(gTodayMidnightEpoch)) return;
-  for (int i = 0; i < LogConfig::BUCKETS_24H; i++) {
-    const BucketSample& b = gBuckets[i];
-    if (!timeIsValid(b.startEpoch)) continue;
-    if (b.startEpoch < gTodayMidnightEpoch) continue;
+  gBucketRing.forEach([](const BucketSample& b) {
+    if (!timeIsValid(b.startEpoch)) return;
+    if (b.startEpoch < gTodayMidnightEpoch) return;
     accumulateTodayFromBucket(b);
+  });
+}
+
+// ------------------- HISTORY BACKFILL -------------------
+// setup() serves HTTP and samples before any history is read; loop() then calls
+// backfillStep(), which reads at most one day file per call. Each stage lists
+// its files when it starts and merges what was finalized meanwhile when it ends.
+// The last stage walks /data in batches to fill the FILE CATALOG.
+
+static std::vector<DayIndexRecord> gBackfillIndex;    // days stage
+static BucketRing* gBackfillBuckets = nullptr;        // buckets stage, packed like the RAM ring
+static time_t gBackfillRollupFrom = 0;                // rollups stage
+
+// The stage's day files (oldest first) and its state
+static void backfillBeginStage() {
+  gBoot.days.clear();
+  gBoot.next = 0;
+  time_t bootMid = localMidnight(gBoot.until);
+  switch (gBoot.stage) {
+    case BOOT_LOAD_DAYS:
+      timedBootLoad(BOOT_LOAD_DAYS, [&]() { listSummaryDays(bootMid, gBackfillIndex, gBoot.days); });
+      break;
+    case BOOT_LOAD_BUCKETS:
+      // The day before the cutoff's brings in its late-night buckets
+      for (int i = LogConfig::RAM_HISTORY_HOURS / 24 + 1; i >= 0; i--) {
+        gBoot.days.push_back(subtractDaysLocalMidnight(bootMid, i));
+      }
+      gBackfillBuckets = new BucketRing;
+      break;
+    case BOOT_LOAD_ROLLUPS:
+      resetRollups();
+      gBackfillRollupFrom = rollupBackfillStart(gBoot.until);
+      for (int i = (int)((gBoot.until - gBackfillRollupFrom) / 86400) + 1; i >= 0; i--) {
+        gBoot.days.push_back(subtractDaysLocalMidnight(bootMid, i));
+      }
+      break;
+    case BOOT_LOAD_FILES:
+      fileCatalogBeginScan();
+      break;
   }
 }
 
-bool buildCurrentDaySummary(DaySummary& out) {
-  if (!timeIsValid(gTodayMidnightEpoch)) return false;
+static void backfillEndStage() {
+  switch (gBoot.stage) {
+    case BOOT_LOAD_DAYS:
+      std::vector<DayIndexRecord>().swap(gBackfillIndex);
+      break;
+    case BOOT_LOAD_BUCKETS:
+      timedBootLoad(BOOT_LOAD_BUCKETS, [&]() { installRecentBuckets(*gBackfillBuckets, gBoot.until); });
+      delete gBackfillBuckets;
+      gBackfillBuckets = nullptr;
+      gDayGen++;  // today's row now covers the whole day
+      break;
+    case BOOT_LOAD_ROLLUPS:
+      // Buckets finalized since boot skipped the tiers; the ring still has them all
+      gBucketRing.forEach([](const BucketSample& b) {
+        if (b.startEpoch >= gBoot.until) rollupAddBucket(b);
+      });
+      break;
+  }
+  gBoot.days.clear();
+  gBoot.stage++;
+  if (gBoot.stage == BOOT_LOAD_COUNT) gBoot.historyMs = millis();
+}
+
+static void startHistoryBackfill(time_t firstBucket) {
+  gBoot.until = firstBucket;
+  if (!gSdOk) {
+    gBoot.stage = BOOT_LOAD_COUNT;
+    gBoot.historyMs = millis();
+    return;
+  }
+  // Without a clock there is no history to place, but the file list is still read
+  gBoot.stage = timeIsValid(firstBucket) ? BOOT_LOAD_DAYS : BOOT_LOAD_FILES;
+  backfillBeginStage();
+}
 
-  float sumWind = gTodaySumOfBucketAvgs;
-  uint32_t windCount = gTodayBucketCount;
-  float maxWind = gTodayMax;
-
-  float tempSum = gTodayTempSum;
-  uint32_t tempCount = gTodayTempCount;
-  float tempMin = gTodayTempMin;
-  float tempMax = gTodayTempMax;
-
-  float humSum = gTodayHumSum;
-  uint32_t humCount = gTodayHumCount;
-  float humMin = gTodayHumMin;
-  float humMax = gTodayHumMax;
-
-  float pressSum = gTodayPressSum;
-  uint32_t pressCount = gTodayPressCount;
-  float pressMin = gTodayPressMin;
-  float pressMax = gTodayPressMax;
-
-  // Do not incluide the in-progress bucket's data in this step.
-
-  bool hasData = (windCount > 0) || (tempCount > 0) || (humCount > 0) || (pressCount > 0);
-  if (!hasData) return false;
-
-  out.dayStartEpoch = gTodayMidnightEpoch;
-  out.avgWind = (windCount > 0) ? (sumWind / (float)windCount) : NAN;
-  out.maxWind = (windCount > 0) ? maxWind : NAN;
-  out.avgTemp = (tempCount > 0) ? (tempSum / (float)tempCount) : NAN;
-  out.minTemp = tempMin;
-  out.maxTemp = tempMax;
-  out.avgHum = (humCount > 0) ? (humSum / (float)humCount) : NAN;
-  out.minHum = humMin;
-  out.maxHum = humMax;
-  out.avgPress = (pressCount > 0) ? (pressSum / (float)pressCount) : NAN;
-  out.minPress = pressMin;
-  out.maxPress = pressMax;
-
-  // PM data
-  out.avgPM1 = (gTodayPM1Count > 0) ? (gTodayPM1Sum / (float)gTodayPM1Count) : NAN;
-  out.maxPM1 = gTodayPM1Max;
-  out.avgPM25 = (gTodayPM25Count > 0) ? (gTodayPM25Sum / (float)gTodayPM25Count) : NAN;
-  out.maxPM25 = gTodayPM25Max;
-  out.avgPM10 = (gTodayPM10Count > 0) ? (gTodayPM10Sum / (float)gTodayPM10Count) : NAN;
-  out.maxPM10 = gTodayPM10Max;
+// One slice from loop(): a day file, a batch of directory entries, or closing a
+// stage and starting the next
+static void backfillStep() {
+  if (bootLoadDone()) return;
+  if (gBoot.stage == BOOT_LOAD_FILES) {
+    bool more = false;
+    timedBootLoad(BOOT_LOAD_FILES, [&]() { more = fileCatalogScanSlice(); });
+    gBoot.next = gFileCatalog.size();
+    if (!more) backfillEndStage();
+    return;
+  }
+  if (gBoot.next >= gBoot.days.size()) {
+    backfillEndStage();
+    if (gBoot.stage < BOOT_LOAD_COUNT) backfillBeginStage();
+    return;
+  }
+
+  time_t day = gBoot.days[gBoot.next++];
+  BootLoad stage = (BootLoad)gBoot.stage;
+  timedBootLoad(stage, [&]() {
+    switch (stage) {
+      case BOOT_LOAD_DAYS:
+        loadDaySummary(day, gBackfillIndex);
+        break;
+      case BOOT_LOAD_BUCKETS:
+        collectRecentBuckets(day, gBoot.until - (time_t)LogConfig::RAM_HISTORY_HOURS * 3600, gBoot.until, *gBackfillBuckets);
+        break;
+      case BOOT_LOAD_ROLLUPS:
+        loadRollupDay(day, gBackfillRollupFrom, gBoot.until);
+        break;
+      default:
+        break;
+    }
+  });
+}
 
+bool buildCurrentDaySummary(DaySummary& out) {
+  if (!timeIsValid(gTodayMidnightEpoch)) return false;
+  // Finalized buckets only; the in-progress bucket is not included
+  if (gToday.empty()) return false;
+  daySummaryFromAgg(gTodayMidnightEpoch, gToday, out);
   return true;
 }
 
 BucketSample currentBucketSnapshot() {
-  BucketSample b{};
-  if (!timeIsValid(gCurrentBucketStart)) return b;
-  computeBucketSample(b, gCurrentBucketStart);
-  return b;
+  return gLive.read().bucket;
+}
+
+// Acquisition task only
+static void publishLiveSnapshot() {
+  LiveSnapshot live;
+  live.windMs = gNowWindMS;
+  live.windInstMs = gWindPulses.instantMs(micros());
+  live.windGust3sMs = gWindPulses.currentMs();
+  live.tempC = gTempC;
+  live.humRH = gHumRH;
+  live.pressurePa = gPressurePa;
+  live.pm1 = gPM1;
+  live.pm25 = gPM25;
+  live.pm10 = gPM10;
+  if (timeIsValid(gCurrentBucketStart)) computeBucketSample(live.bucket, gCurrentBucketStart);
+  live.stats = gAcqStats;
+  gLive.write(live);
+}
+
+// ------------------- JSON STREAM WRITER -------------------
+// ChunkedResponse fills a fixed buffer and sends it as chunks, so handlers
+// don't build large Strings on the heap. JsonWriter adds JSON on top: commas
+// are inserted automatically, NaN numbers become null, and numbers are
+// formatted exactly like String(v, digits) (without its leading space at 0 digits).
+
+class ChunkedResponse {
+ public:
+  static constexpr size_t BUF_SIZE = 1436;  // one TCP segment incl. chunk framing
+
+  // capture: optional String that also receives everything sent (response caches)
+  explicit ChunkedResponse(String* capture = nullptr) : _capture(capture) {}
+  ~ChunkedResponse() { flush(); }
+
+  // contentLength: exact body size if known, else the response is chunked
+  void begin(int code = 200, const char* contentType = "application/json",
+             size_t contentLength = CONTENT_LENGTH_UNKNOWN) {
+    server.setContentLength(contentLength);
+    server.send(code, contentType, "");
+    _started = true;
+  }
+
+  void put(char c) {
+    if (_len >= BUF_SIZE) flush();
+    _buf[_len++] = c;
+  }
+  void put(const char* s) { put(s, strlen(s)); }
+  void put(const char* s, size_t n) {
+    if (_len + n > BUF_SIZE) flush();
+    if (n > BUF_SIZE) {
+      if (_capture) _capture->concat(s, n);
+      if (_started) server.sendContent(s, n);
+      else if (!_capture) _overflowed = true;
+      return;
+    }
+    memcpy(_buf + _len, s, n);
+    _len += n;
+  }
+  // Raw little-endian value (binary responses)
+  template <typename T>
+  void putRaw(const T& v) { put(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+  void flush() {
+    if (_len == 0) return;
+    if (_capture) _capture->concat(_buf, _len);
+    if (_started) server.sendContent(_buf, _len);
+    else if (!_capture) _overflowed = true;
+    _len = 0;
+  }
+
+  // A writer that is never begun and has no capture keeps its output in the
+  // buffer: data()/size() are all of it unless overflowed()
+  const char* data() const { return _buf; }
+  size_t size() const { return _len; }
+  bool overflowed() const { return _overflowed; }
+
+ protected:
+  void rewind() {
+    _len = 0;
+    _overflowed = false;
+  }
+
+ private:
+  char _buf[BUF_SIZE];
+  size_t _len = 0;
+  bool _started = false;
+  bool _overflowed = false;  // bytes were dropped (never begun, no capture)
+  String* _capture;
+};
+
+class JsonWriter : public ChunkedResponse {
+ public:
+  static constexpr int MAX_DEPTH = 8;
+
+  explicit JsonWriter(String* capture = nullptr) : ChunkedResponse(capture) {}
+
+  // Empties the buffer for the next document (writers that are never begun)
+  void reset() {
+    rewind();
+    _depth = 0;
+    _hasItem = 0;
+    _afterKey = false;
+  }
+
+  void beginObject() { sep(); put('{'); push(); }
+  void endObject()   { pop(); put('}'); }
+  void beginArray()  { sep(); put('['); push(); }
+  void endArray()    { pop(); put(']'); }
+
+  void key(const char* k) { sep(); putQuoted(k); put(':'); _afterKey = true; }
+
+  void str(const char* v) { sep(); putQuoted(v); }
+  void boolean(bool v)    { sep(); put(v ? "true" : "false"); }
+  void null()             { sep(); put("null"); }
+  void u32(uint32_t v)    { sep(); char b[12]; put(b, snprintf(b, sizeof(b), "%lu", (unsigned long)v)); }
+  void i32(int32_t v)     { sep(); char b[12]; put(b, snprintf(b, sizeof(b), "%ld", (long)v)); }
+  void num(float v, int digits) {
+    sep();
+    if (!isfinite(v)) { put("null"); return; }
+    char b[32];
+    put(b, formatFixed(b, sizeof(b), v, digits));
+  }
+  // Local "YYYY-mm-dd HH:MM:SS" string, as fmtLocal()
+  void localTime(time_t t) {
+    struct tm tmLocal;
+    localtime_r(&t, &tmLocal);
+    char b[32];
+    size_t n = strftime(b, sizeof(b), "%Y-%m-%d %H:%M:%S", &tmLocal);
+    sep(); put('"'); put(b, n); put('"');
+  }
+
+ private:
+  void sep() {
+    if (_afterKey) { _afterKey = false; return; }
+    if (_depth == 0) return;
+    if (_hasItem & (1u << (_depth - 1))) put(',');
+    _hasItem |= (1u << (_depth - 1));
+  }
+  void push() { if (_depth < MAX_DEPTH) { _hasItem &= ~(1u << _depth); _depth++; } }
+  void pop()  { if (_depth > 0) _depth--; }
+
+  void putQuoted(const char* s) {
+    put('"');
+    for (; *s; s++) {
+      char c = *s;
+      if (c == '"' || c == '\\') { put('\\'); put(c); }
+      else if ((uint8_t)c < 0x20) { char e[8]; put(e, snprintf(e, sizeof(e), "\\u%04x", (unsigned)(uint8_t)c)); }
+      else put(c);
+    }
+    put('"');
+  }
+
+  int _depth = 0;
+  uint32_t _hasItem = 0;   // bit per nesting level: a member/element was written
+  bool _afterKey = false;
+};
+
+// ------------------- BACKGROUND DOWNLOADS -------------------
+// /download, /download_zip and the history API routes (/api/buckets*,
+// /api/series, /api/days, /api/range) check their arguments, then hand the
+// socket and a body producer to a slot here and return. loop() asks each
+// producer for at most HttpConfig::BLOCK_BYTES per pass and writes only what the
+// client's TCP window takes, so a browser pulling a 30-day ZIP or a year of
+// /api/range over a weak link costs the other routes one short slice per pass
+// instead of the whole transfer. Day files are opened and closed within a slice;
+// nothing stays open while the log writer appends to today's files.
+
+static const char* httpReason(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 416: return "Range Not Satisfiable";
+    default: return "";
+  }
+}
+
+struct Download {
+  WiFiClient client;
+  IPAddress peer;
+  bool active = false;
+  bool file = false;            // /download or /download_zip: counts against MAX_DOWNLOADS
+  bool http11 = true;
+  bool chunked = false;         // length unknown up front (HTTP/1.0 clients: the body ends with the connection)
+  bool done = false;            // producer finished; close once `out` is sent
+  std::vector<uint8_t> out;     // response bytes the socket hasn't taken yet
+  size_t outPos = 0;
+  size_t bodyFrom = 0;          // first body byte of this block in `out` (after the head)
+  uint32_t lastProgressMs = 0;
+  void* body = nullptr;
+  bool (*fill)(void* body, Download& d) = nullptr;  // appends the next block; false once complete
+  void (*release)(void* body) = nullptr;
+
+  // Status line and headers; `headers` holds complete "Name: value\r\n" lines
+  void head(int code, const char* type, size_t length, const String& headers) {
+    const bool known = length != CONTENT_LENGTH_UNKNOWN;
+    chunked = !known && http11;
+    char line[128];
+    int n = snprintf(line, sizeof(line), "HTTP/1.%d %d %s\r\nContent-Type: %s\r\n",
+                     http11 ? 1 : 0, code, httpReason(code), type);
+    put(line, (size_t)n);
+    if (known) {
+      n = snprintf(line, sizeof(line), "Content-Length: %lu\r\n", (unsigned long)length);
+      put(line, (size_t)n);
+    } else if (chunked) {
+      put("Transfer-Encoding: chunked\r\n");
+    }
+    put(headers.c_str(), headers.length());
+    put("Connection: close\r\n\r\n");
+    bodyFrom = out.size();
+  }
+
+  void put(const char* s) { put(s, strlen(s)); }
+  void put(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    out.insert(out.end(), p, p + len);
+  }
+  // A block's worth of body is queued: producers stop here until the next pass
+  bool full() const { return out.size() - bodyFrom >= HttpConfig::BLOCK_BYTES; }
+};
+
+static Download gDownloads[HttpConfig::MAX_JOBS];
+static uint32_t gDownloadsRefused = 0;
+static uint32_t gDownloadBytes = 0;
+
+static int downloadCount() {
+  int n = 0;
+  for (const auto& d : gDownloads) {
+    if (d.active) n++;
+  }
+  return n;
+}
+
+// True if the requesting client may start another background response;
+// otherwise answers 503. File downloads are also held to MAX_DOWNLOADS and
+// MAX_DOWNLOADS_PER_CLIENT; API responses only need a free slot.
+static bool downloadAdmit(bool file = true) {
+  IPAddress peer = server.client().remoteIP();
+  int files = 0, mine = 0;
+  for (const auto& d : gDownloads) {
+    if (!d.active || !d.file) continue;
+    files++;
+    if (d.peer == peer) mine++;
+  }
+  if (downloadCount() < HttpConfig::MAX_JOBS &&
+      (!file || (files < HttpConfig::MAX_DOWNLOADS && mine < HttpConfig::MAX_DOWNLOADS_PER_CLIENT))) {
+    return true;
+  }
+  gDownloadsRefused++;
+  server.sendHeader("Retry-After", "5");
+  server.send(503, "text/plain", "Too many downloads in progress, try again shortly");
+  return false;
+}
+
+// Takes over the request's socket; `body` (allocated with new, bool fill(Download&))
+// is deleted when the download ends. Only after downloadAdmit(file) said yes.
+template <typename T>
+static Download& downloadStart(T* body, bool file = true) {
+  Download* d = &gDownloads[0];
+  for (auto& s : gDownloads) {
+    if (!s.active) { d = &s; break; }
+  }
+  d->http11 = server.clientIsHttp11();
+  d->client = server.detachClient();
+  d->peer = d->client.remoteIP();
+  d->active = true;
+  d->file = file;
+  d->chunked = false;
+  d->done = false;
+  d->out.clear();
+  d->out.reserve(HttpConfig::BLOCK_BYTES + 256);
+  d->outPos = 0;
+  d->bodyFrom = 0;
+  d->lastProgressMs = millis();
+  d->body = body;
+  d->fill = [](void* b, Download& dl) { return static_cast<T*>(b)->fill(dl); };
+  d->release = [](void* b) { delete static_cast<T*>(b); };
+  return *d;
+}
+
+static void downloadEnd(Download& d) {
+  d.client.stop();
+  d.client = WiFiClient();
+  d.release(d.body);
+  d.body = nullptr;
+  std::vector<uint8_t>().swap(d.out);
+  d.active = false;
+}
+
+// Next block from the producer, framed as one chunk when the length isn't known
+static void downloadProduce(Download& d) {
+  d.out.clear();
+  d.outPos = 0;
+  d.bodyFrom = 0;
+  bool more = d.fill(d.body, d);
+  size_t n = d.out.size() - d.bodyFrom;
+  if (d.chunked && n > 0) {
+    char size[12];
+    int h = snprintf(size, sizeof(size), "%x\r\n", (unsigned)n);
+    d.out.insert(d.out.begin() + d.bodyFrom, size, size + h);
+    d.put("\r\n");
+  }
+  if (!more) {
+    if (d.chunked) d.put("0\r\n\r\n");
+    d.done = true;
+  }
+}
+
+static void pumpDownloads(uint32_t msNow) {
+  for (auto& d : gDownloads) {
+    if (!d.active) continue;
+    if (d.outPos == d.out.size()) {
+      if (d.done) {
+        downloadEnd(d);
+        continue;
+      }
+      downloadProduce(d);
+    }
+    size_t left = d.out.size() - d.outPos;
+    if (left == 0) continue;
+    int n = hal::netWriteSome(d.client, d.out.data() + d.outPos, left);
+    if (n < 0) {
+      downloadEnd(d);
+    } else if (n > 0) {
+      d.outPos += (size_t)n;
+      d.lastProgressMs = msNow;
+      gDownloadBytes += (uint32_t)n;
+    } else if (msNow - d.lastProgressMs > HttpConfig::STALL_TIMEOUT_MS) {
+      downloadEnd(d);
+    }
+  }
 }
 
+// JSON bodies from loop(): the producer writes whole items through `w` until
+// full(), then hands the captured text to the download
+struct JsonBlock {
+  String text;
+  JsonWriter w{&text};
+
+  bool full() const { return text.length() + w.size() >= HttpConfig::BLOCK_BYTES; }
+  void sendTo(Download& d) {
+    w.flush();
+    d.put(text.c_str(), text.length());
+    text = "";
+  }
+};
+
+// Resumable read of one day's CSV text: the file itself, or rendered from the
+// day's bucket log (header line, then a row per record)
+struct DayCsvReader {
+  static constexpr size_t ROW_MAX = 160;  // formatBucketCsvRow() plus the newline
+
+  String path;
+  bool fromBinary = false;
+  uint32_t offset = 0;       // file bytes, or bucket records, consumed so far
+  bool headerDone = false;
+
+  // Up to cap bytes (at least ROW_MAX when fromBinary); 0 at the end or if the file is gone
+  size_t read(uint8_t* buf, size_t cap) {
+    File f = hal::storage().open(path.c_str(), FILE_READ);
+    if (!f) return 0;
+    size_t n = 0;
+    if (fromBinary) {
+      n = readRows(f, (char*)buf, cap);
+    } else if (offset == 0 || f.seek(offset)) {
+      int got = f.read(buf, cap);
+      metricSdRead(got);
+      if (got > 0) n = (size_t)got;
+      offset += (uint32_t)n;
+    }
+    f.close();
+    return n;
+  }
+
+ private:
+  size_t readRows(File& f, char* buf, size_t cap) {
+    BktHeader hdr;
+    BktFooter ftr;
+    if (!bktOpenInfo(f, hdr, ftr)) return 0;
+    size_t n = 0;
+    if (!headerDone) {
+      n = (size_t)snprintf(buf, cap, "%s\n", CSV_HEADER);
+      headerDone = true;
+    }
+    BktRecord block[8];
+    while (offset < ftr.count && n + ROW_MAX <= cap) {
+      uint32_t want = std::min<uint32_t>(ftr.count - offset, 8);
+      if (!f.seek(sizeof(BktHeader) + (size_t)offset * sizeof(BktRecord))) break;
+      int got = f.read((uint8_t*)block, want * sizeof(BktRecord));
+      metricSdRead(got);
+      uint32_t k = (got > 0) ? (uint32_t)got / sizeof(BktRecord) : 0;
+      if (k == 0) break;
+      // Rows that don't fit are read again by the next call
+      for (uint32_t i = 0; i < k && n + ROW_MAX <= cap; i++, offset++) {
+        BucketSample b{};
+        recordToBucket(block[i], b);
+        n += formatBucketCsvRow(b, buf + n, ROW_MAX);
+        buf[n++] = '\n';
+      }
+    }
+    return n;
+  }
+};
+
 // ------------------- DOWNLOAD / FILE LIST -------------------
 
 static bool isAllowedFilename(const String& filename) {
@@ -1007,905 +3271,2765 @@ static bool parseYmdFromPath(const String& path, time_t& outMidnightLocal) {
   return true;
 }
 
-void handleDownload() {
-  if (!gSdOk) {
-    server.send(503, "text/plain", "SD not available");
-    return;
-  }
-
-  String filename = server.arg("filename");
-  if (!isAllowedFilename(filename)) {
-    server.send(400, "text/plain", "Invalid filename");
-    return;
+// /download body: the CSV with its length as of the request, or the bucket log rendered (chunked)
+struct CsvDownload {
+  DayCsvReader src;
+  String filename;
+  uint32_t left = 0;
+  bool started = false;
+  uint8_t buf[HttpConfig::BLOCK_BYTES];
+
+  bool fill(Download& d) {
+    if (!started) {
+      started = true;
+      d.head(200, "text/csv", src.fromBinary ? CONTENT_LENGTH_UNKNOWN : left,
+             "Content-Disposition: attachment; filename=\"" + filename + "\"\r\nCache-Control: no-store\r\n");
+    }
+    size_t n = src.read(buf, sizeof(buf));
+    if (!src.fromBinary) {
+      if (n > left) n = left;
+      left -= (uint32_t)n;
+    }
+    d.put(buf, n);
+    return n > 0 && (src.fromBinary || left > 0);
+  }
+};
+
+void handleDownload() {
+  if (!gSdOk) {
+    server.send(503, "text/plain", "SD not available");
+    return;
+  }
+  flushLogBuffer();  // include rows still buffered in RAM
+
+  String filename = server.arg("filename");
+  if (!isAllowedFilename(filename)) {
+    server.send(400, "text/plain", "Invalid filename");
+    return;
+  }
+
+  String path = "/data/" + filename;
+  uint32_t size = 0;
+  bool fromBinary = !hal::storage().exists(path.c_str());
+  if (fromBinary) {
+    // No CSV on the card: render it from the binary bucket log if that exists
+    path = "/data/" + filename.substring(0, filename.length() - 4) + ".bkt";
+    if (!hal::storage().exists(path.c_str())) {
+      server.send(404, "text/plain", "Not found");
+      return;
+    }
+  } else {
+    File f = hal::storage().open(path.c_str(), FILE_READ);
+    if (!f) {
+      server.send(500, "text/plain", "Failed to open file");
+      return;
+    }
+    size = (uint32_t)f.size();
+    f.close();
+  }
+  if (!downloadAdmit()) return;
+
+  CsvDownload* body = new CsvDownload;
+  body->src.path = path;
+  body->src.fromBinary = fromBinary;
+  body->filename = filename;
+  body->left = size;
+  downloadStart(body);
+}
+
+static constexpr int FILES_MAX_PER_PAGE = 500;
+
+// "YYYYMMDD" or "YYYY-MM-DD" -> YYYYMMDD
+static bool parseYmdArg(String v, uint32_t& ymd) {
+  v.replace("-", "");
+  return parseCatalogName((v + ".csv").c_str(), ymd);
+}
+
+// One page of the file catalog, newest first; from/to (inclusive) narrow it to a date range
+void handleApiFiles() {
+  if (!gSdOk) {
+    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
+    return;
+  }
+  uint32_t fromYmd = 0, toYmd = 99999999;
+  if ((server.hasArg("from") && !parseYmdArg(server.arg("from"), fromYmd)) ||
+      (server.hasArg("to") && !parseYmdArg(server.arg("to"), toYmd))) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"bad_date\"}");
+    return;
+  }
+  int perPage = server.hasArg("per_page") ? server.arg("per_page").toInt() : UIConfig::FILES_PER_PAGE;
+  perPage = std::max(1, std::min(perPage, FILES_MAX_PER_PAGE));
+  int page = server.arg("page").toInt();
+  if (page < 1) page = 1;
+  flushLogBuffer();
+
+  size_t lo = fileCatalogFind(fromYmd) - gFileCatalog.begin();
+  size_t hi = fileCatalogFind(toYmd + 1) - gFileCatalog.begin();
+  if (hi < lo) hi = lo;
+  uint32_t total = (uint32_t)(hi - lo);
+  uint32_t pages = (total + perPage - 1) / perPage;
+
+  JsonWriter w;
+  w.begin();
+  w.beginObject();
+  w.key("ok"); w.boolean(true);
+  w.key("dir"); w.str("data");
+  w.key("loading"); w.boolean(!gFileCatalogReady);
+  w.key("total"); w.u32(total);
+  w.key("page"); w.i32(page);
+  w.key("per_page"); w.i32(perPage);
+  w.key("pages"); w.u32(pages);
+  w.key("files"); w.beginArray();
+  uint64_t skip = (uint64_t)(page - 1) * perPage;
+  size_t first = (skip >= total) ? lo : hi - (size_t)skip;  // one past the newest on this page
+  size_t last = (first - lo > (size_t)perPage) ? first - perPage : lo;
+  for (size_t i = first; i > last; i--) {
+    const FileCatalogEntry& e = gFileCatalog[i - 1];
+    char name[16];
+    snprintf(name, sizeof(name), "%08lu.csv", (unsigned long)e.ymd);
+    w.beginObject();
+    w.key("path"); w.str(name);
+    w.key("size"); w.u32(e.size);
+    w.endObject();
+  }
+  w.endArray();
+  w.endObject();
+  w.flush();
+}
+
+// ------------------- DEFLATE (streaming, fixed Huffman) -------------------
+// Small LZ77 + fixed-Huffman DEFLATE encoder (RFC 1951) for the ZIP export:
+// a 4 KB window and a short hash chain, about 24 KB of heap while a download
+// runs. Daily CSVs are very repetitive, so this is enough for a large ratio.
+
+class DeflateStream {
+ public:
+  typedef void (*Sink)(void* ctx, const uint8_t* data, size_t len);
+
+  ~DeflateStream() {
+    free(_win);
+    free(_head);
+    free(_prev);
+  }
+
+  // Allocates the buffers; false if out of memory
+  bool init() {
+    if (!_win) _win = (uint8_t*)malloc(2 * WSIZE);
+    if (!_head) _head = (uint16_t*)malloc(HASH_SIZE * sizeof(uint16_t));
+    if (!_prev) _prev = (uint16_t*)malloc(WSIZE * sizeof(uint16_t));
+    return _win && _head && _prev;
+  }
+
+  // Starts a new raw DEFLATE stream (one final fixed-Huffman block)
+  void reset(Sink sink, void* ctx) {
+    _sink = sink;
+    _ctx = ctx;
+    memset(_head, 0, HASH_SIZE * sizeof(uint16_t));
+    memset(_prev, 0, WSIZE * sizeof(uint16_t));
+    _fill = _pos = 0;
+    _bits = 0;
+    _nbits = 0;
+    _outLen = 0;
+    putBits(1, 1);  // BFINAL
+    putBits(1, 2);  // BTYPE = fixed Huffman
+  }
+
+  void write(const uint8_t* data, size_t len) {
+    while (len > 0) {
+      if (_fill == 2 * WSIZE) slide();
+      size_t n = 2 * WSIZE - _fill;
+      if (n > len) n = len;
+      memcpy(_win + _fill, data, n);
+      _fill += n;
+      data += n;
+      len -= n;
+      compress(false);
+    }
+  }
+
+  void finish() {
+    compress(true);
+    putLitLen(256);  // end of block
+    if (_nbits > 0) putByte((uint8_t)_bits);
+    _bits = 0;
+    _nbits = 0;
+    if (_outLen) _sink(_ctx, _out, _outLen);
+    _outLen = 0;
+  }
+
+ private:
+  static constexpr size_t WSIZE = 4096;     // window, power of two
+  static constexpr size_t HASH_SIZE = 4096;
+  static constexpr size_t MIN_MATCH = 3;
+  static constexpr size_t MAX_MATCH = 258;
+  static constexpr size_t LOOKAHEAD = MAX_MATCH + MIN_MATCH + 1;
+  static constexpr int MAX_CHAIN = 16;
+
+  static uint32_t hash3(const uint8_t* p) {
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (uint32_t)(v * 2654435761u) >> 20;  // top 12 bits -> HASH_SIZE
+  }
+
+  // Positions are stored + 1 so 0 means "none"; they fit uint16 since _win is 2 * WSIZE
+  void insert(size_t pos) {
+    uint32_t h = hash3(_win + pos);
+    _prev[pos & (WSIZE - 1)] = _head[h];
+    _head[h] = (uint16_t)(pos + 1);
+  }
+
+  void slide() {
+    memmove(_win, _win + WSIZE, WSIZE);
+    _fill -= WSIZE;
+    _pos -= WSIZE;
+    for (size_t i = 0; i < HASH_SIZE; i++) _head[i] = (_head[i] > WSIZE) ? (uint16_t)(_head[i] - WSIZE) : 0;
+    for (size_t i = 0; i < WSIZE; i++) _prev[i] = (_prev[i] > WSIZE) ? (uint16_t)(_prev[i] - WSIZE) : 0;
+  }
+
+  void compress(bool flush) {
+    while (flush ? _pos < _fill : _fill - _pos >= LOOKAHEAD) {
+      size_t avail = _fill - _pos;
+      size_t bestLen = 0, bestDist = 0;
+      if (avail >= MIN_MATCH) {
+        size_t maxLen = avail < MAX_MATCH ? avail : MAX_MATCH;
+        const uint8_t* cur = _win + _pos;
+        uint16_t cand = _head[hash3(cur)];
+        for (int chain = 0; cand != 0 && chain < MAX_CHAIN; chain++) {
+          size_t p = cand - 1;
+          size_t dist = _pos - p;
+          if (dist == 0 || dist >= WSIZE) break;
+          const uint8_t* m = _win + p;
+          if (m[bestLen] == cur[bestLen]) {
+            size_t l = 0;
+            while (l < maxLen && m[l] == cur[l]) l++;
+            if (l > bestLen) {
+              bestLen = l;
+              bestDist = dist;
+              if (l == maxLen) break;
+            }
+          }
+          uint16_t next = _prev[p & (WSIZE - 1)];
+          if (next == 0 || (size_t)(next - 1) >= p) break;
+          cand = next;
+        }
+        insert(_pos);
+      }
+      if (bestLen >= MIN_MATCH) {
+        putMatch(bestLen, bestDist);
+        for (size_t k = 1; k < bestLen; k++) {
+          if (_pos + k + MIN_MATCH <= _fill) insert(_pos + k);
+        }
+        _pos += bestLen;
+      } else {
+        putLitLen(_win[_pos]);
+        _pos++;
+      }
+    }
+  }
+
+  void putByte(uint8_t b) {
+    _out[_outLen++] = b;
+    if (_outLen == sizeof(_out)) {
+      _sink(_ctx, _out, _outLen);
+      _outLen = 0;
+    }
+  }
+  void putBits(uint32_t v, int n) {
+    _bits |= v << _nbits;
+    _nbits += n;
+    while (_nbits >= 8) {
+      putByte((uint8_t)_bits);
+      _bits >>= 8;
+      _nbits -= 8;
+    }
+  }
+  // Huffman codes go out most significant bit first
+  void putCode(uint32_t code, int len) {
+    uint32_t r = 0;
+    for (int i = 0; i < len; i++) r |= ((code >> i) & 1) << (len - 1 - i);
+    putBits(r, len);
+  }
+  void putLitLen(int sym) {
+    if (sym < 144) putCode(0x30 + sym, 8);
+    else if (sym < 256) putCode(0x190 + (sym - 144), 9);
+    else if (sym < 280) putCode(sym - 256, 7);
+    else putCode(0xC0 + (sym - 280), 8);
+  }
+  void putMatch(size_t len, size_t dist) {
+    static const uint16_t kLenBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                           8193, 12289, 16385, 24577};
+    static const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    int li = 28;
+    while (li > 0 && kLenBase[li] > len) li--;
+    putLitLen(257 + li);
+    if (kLenExtra[li]) putBits((uint32_t)(len - kLenBase[li]), kLenExtra[li]);
+    int di = 29;
+    while (di > 0 && kDistBase[di] > dist) di--;
+    putCode((uint32_t)di, 5);
+    if (kDistExtra[di]) putBits((uint32_t)(dist - kDistBase[di]), kDistExtra[di]);
+  }
+
+  uint8_t* _win = nullptr;    // 2 * WSIZE input bytes
+  uint16_t* _head = nullptr;  // HASH_SIZE: newest position with this hash
+  uint16_t* _prev = nullptr;  // WSIZE: previous position with the same hash
+  size_t _fill = 0;           // bytes in _win
+  size_t _pos = 0;            // next byte to encode
+  uint32_t _bits = 0;
+  int _nbits = 0;
+  uint8_t _out[256];
+  size_t _outLen = 0;
+  Sink _sink = nullptr;
+  void* _ctx = nullptr;
+};
+
+// ------------------- ZIP (streamed) -------------------
+// STORE (default): every entry's CRC and size is known before the first byte
+// (finalized days from the day index, today's file hashed on the spot), so the
+// ZIP has an exact Content-Length, no data descriptors, an ETag, and can be
+// resumed with Range. method=deflate: entries are compressed on the fly and
+// sent chunked with data descriptors.
+
+static void dosDateTime(time_t t, uint16_t &dosDate, uint16_t &dosTime) {
+  struct tm tmLocal;
+  localtime_r(&t, &tmLocal);
+  int year = tmLocal.tm_year + 1900;
+  if (year < 1980) year = 1980;
+  dosDate = (uint16_t)(((year - 1980) << 9) | ((tmLocal.tm_mon + 1) << 5) | (tmLocal.tm_mday));
+  dosTime = (uint16_t)((tmLocal.tm_hour << 11) | (tmLocal.tm_min << 5) | ((tmLocal.tm_sec / 2) & 0x1F));
+}
+
+struct ZipEntryInfo {
+  String name;          // inside-zip name like "data/20251214.csv"
+  String sdPath;        // "/data/20251214.csv" (or the .bkt log when fromBinary)
+  time_t dayMid = 0;
+  bool fromBinary = false; // CSV is rendered from the bucket log while streaming
+  uint32_t size = 0;    // uncompressed size
+  uint32_t compSize = 0;
+  uint32_t crc = 0;
+  uint32_t lho = 0;     // local header offset
+  uint16_t dosDate = 0;
+  uint16_t dosTime = 0;
+};
+
+// Existing daily files from fromMid to toMid (local midnights, inclusive), oldest first
+static std::vector<ZipEntryInfo> buildDayRangeList(time_t fromMid, time_t toMid) {
+  std::vector<ZipEntryInfo> out;
+
+  for (time_t dayMidnight = toMid; dayMidnight >= fromMid;
+       dayMidnight = subtractDaysLocalMidnight(dayMidnight, 1)) {
+    String ymd = ymdString(dayMidnight);
+    String sdPath = String("/data/") + ymd + ".csv";
+
+    if (gSdOk && hal::storage().exists(sdPath.c_str())) {
+      File f = hal::storage().open(sdPath.c_str(), FILE_READ);
+      if (f) {
+        ZipEntryInfo e;
+        e.sdPath = sdPath;
+        e.name = String("data/") + ymd + ".csv";
+        e.dayMid = dayMidnight;
+        e.size = (uint32_t)f.size();
+        dosDateTime(dayMidnight, e.dosDate, e.dosTime);
+        f.close();
+        out.push_back(e);
+      }
+    } else if (gSdOk) {
+      String bktPath = bktPathForDay(dayMidnight);
+      if (hal::storage().exists(bktPath.c_str())) {
+        ZipEntryInfo e;
+        e.sdPath = bktPath;
+        e.name = String("data/") + ymd + ".csv";
+        e.dayMid = dayMidnight;
+        e.fromBinary = true;
+        dosDateTime(dayMidnight, e.dosDate, e.dosTime);
+        out.push_back(e);
+      }
+    }
+  }
+
+  // Oldest -> newest
+  std::reverse(out.begin(), out.end());
+  return out;
+}
+
+// Fills e.crc/e.size before anything is sent. Finalized days come from the day
+// index record number `slot` (UINT32_MAX = none) when its size/mtime still
+// match; otherwise the file is hashed once and the result is indexed for the
+// next export.
+static bool resolveZipEntryCrc(ZipEntryInfo& e, uint32_t slot, time_t todayMid) {
+  if (e.fromBinary) {
+    crc32_init();
+    uint32_t crc = 0xFFFFFFFFUL;
+    uint32_t size = 0;
+    streamBucketLogAsCsv(e.sdPath, [&](const uint8_t* data, size_t len) {
+      crc = crc32_update(crc, data, len);
+      size += (uint32_t)len;
+    });
+    e.crc = crc ^ 0xFFFFFFFFUL;
+    e.size = size;
+    return true;
+  }
+
+  DayIndexRecord cur{};
+  statDayFiles(e.dayMid, cur);
+  DayIndexRecord found;
+  const DayIndexRecord* rec = nullptr;
+  File index;
+  uint32_t count = 0;
+  if (slot != UINT32_MAX && openDayIndex(index, count)) {
+    if (readDayIndexRecordAt(index, slot, found) && (time_t)found.dayStartEpoch == e.dayMid) rec = &found;
+    index.close();
+  }
+  if (e.dayMid != todayMid && rec && rec->csvCrc != 0 &&
+      rec->csvSize == cur.csvSize && rec->csvMtime == cur.csvMtime) {
+    e.crc = rec->csvCrc;
+    e.size = rec->csvSize;
+    return true;
+  }
+
+  uint32_t crc = 0, size = 0;
+  if (!fileCrc32(e.sdPath.c_str(), crc, size)) return false;
+  e.crc = crc;
+  e.size = size;
+  if (e.dayMid == todayMid || size != cur.csvSize) return true;
+
+  DayIndexRecord r = cur;
+  if (rec) {
+    DaySummary d{};
+    summaryFromDayIndex(*rec, d);
+    dayIndexFromSummary(d, r);
+    r.flags = rec->flags;
+  } else {
+    DaySummary d{};
+    if (!buildDaySummaryFromSD(e.dayMid, d)) return true;
+    dayIndexFromSummary(d, r);
+    // Older than the days boot loads: keep the index tail for those
+    if (e.dayMid < subtractDaysLocalMidnight(todayMid, LogConfig::DAYS_HISTORY)) r.flags = DAY_INDEX_FROM_RANGE;
+  }
+  r.csvCrc = crc;
+  writeDayIndexRecord(r);
+  return true;
+}
+
+// Byte sink that tracks the ZIP offset and only sends [from, to) (a Range request)
+struct ZipOut {
+  Download* d;
+  uint32_t pos;
+  uint32_t from;
+  uint32_t to;
+
+  void bytes(const uint8_t* data, size_t len) {
+    uint32_t start = pos, end = pos + (uint32_t)len;
+    pos = end;
+    if (end <= from || start >= to) return;
+    uint32_t a = (start < from) ? from - start : 0;
+    uint32_t b = (end > to) ? (uint32_t)len - (end - to) : (uint32_t)len;
+    d->put(data + a, b - a);
+  }
+  void u16(uint16_t v) { uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)}; bytes(b, 2); }
+  void u32(uint32_t v) {
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    bytes(b, 4);
+  }
+};
+
+static void zipLocalHeader(ZipOut& out, const ZipEntryInfo& e, bool deflate) {
+  out.u32(0x04034b50);                      // signature
+  out.u16(20);                              // version
+  out.u16(deflate ? 0x0008 : 0);            // flags: data descriptor follows (deflate)
+  out.u16(deflate ? 8 : 0);                 // method: DEFLATE / STORE
+  out.u16(e.dosTime);
+  out.u16(e.dosDate);
+  out.u32(deflate ? 0 : e.crc);             // crc
+  out.u32(deflate ? 0 : e.size);            // comp size
+  out.u32(deflate ? 0 : e.size);            // uncomp size
+  out.u16((uint16_t)e.name.length());       // name len
+  out.u16(0);                               // extra len
+  out.bytes((const uint8_t*)e.name.c_str(), e.name.length());
+}
+
+static void zipCentralRecord(ZipOut& out, const ZipEntryInfo& e, bool deflate) {
+  out.u32(0x02014b50);                      // signature
+  out.u16(20);                              // version made by
+  out.u16(20);                              // version needed
+  out.u16(deflate ? 0x0008 : 0);            // flags
+  out.u16(deflate ? 8 : 0);                 // method
+  out.u16(e.dosTime);
+  out.u16(e.dosDate);
+  out.u32(e.crc);
+  out.u32(e.compSize);
+  out.u32(e.size);
+  out.u16((uint16_t)e.name.length());       // name len
+  out.u16(0);                               // extra len
+  out.u16(0);                               // comment len
+  out.u16(0);                               // disk start
+  out.u16(0);                               // internal attrs
+  out.u32(0);                               // external attrs
+  out.u32(e.lho);                           // local header offset
+  out.bytes((const uint8_t*)e.name.c_str(), e.name.length());
+}
+
+static void zipEndOfDirectory(ZipOut& out, size_t count, uint32_t cdStart) {
+  uint32_t cdSize = out.pos - cdStart;
+  out.u32(0x06054b50);
+  out.u16(0);
+  out.u16(0);
+  out.u16((uint16_t)count);
+  out.u16((uint16_t)count);
+  out.u32(cdSize);
+  out.u32(cdStart);
+  out.u16(0);
+}
+
+static constexpr int ZIP_MAX_RANGE_DAYS = 366;
+
+// "YYYYMMDD" or "YYYY-MM-DD" -> local midnight
+static bool parseZipDate(String v, time_t& outMid) {
+  v.replace("-", "");
+  if (v.length() != 8) return false;
+  for (unsigned int i = 0; i < v.length(); i++) {
+    if (!isdigit((unsigned char)v.charAt(i))) return false;
+  }
+  return parseYmdFromPath(v, outMid);
+}
+
+// "bytes=a-b", "bytes=a-" or "bytes=-n" against a body of `total` bytes
+static bool parseByteRange(const String& h, uint32_t total, uint32_t& from, uint32_t& to) {
+  if (!h.startsWith("bytes=") || h.indexOf(',') >= 0) return false;
+  int dash = h.indexOf('-');
+  if (dash < 0) return false;
+  String a = h.substring(6, dash);
+  String b = h.substring(dash + 1);
+  a.trim();
+  b.trim();
+  if (a.length() == 0) {
+    uint32_t n = (uint32_t)b.toInt();
+    if (n == 0) return false;
+    from = (n >= total) ? 0 : total - n;
+    to = total;
+    return true;
+  }
+  from = (uint32_t)a.toInt();
+  to = (b.length() == 0) ? total : (uint32_t)b.toInt() + 1;
+  if (to > total) to = total;
+  return true;
+}
+
+// /download_zip body. STORE resolves one entry's CRC per pass, then lays the
+// archive out (exact length, ETag, Range) and sends the head; DEFLATE sends the
+// head at once and compresses as it goes. Either way a pass moves at most one
+// block of day data.
+struct ZipDownload {
+  enum Phase : uint8_t { RESOLVE, ENTRY, DATA, DIRECTORY };
+
+  std::vector<ZipEntryInfo> entries;
+  std::vector<uint32_t> slots;        // STORE: day index record of each day from fromMid
+  time_t fromMid = 0;
+  time_t todayMid = 0;
+  String headers;                     // Content-Disposition etc., sent with the head
+  String range;
+  String ifRange;
+  bool deflate = false;
+  DeflateStream deflater;
+
+  Phase phase = RESOLVE;
+  size_t i = 0;                       // entry in progress
+  ZipOut out{nullptr, 0, 0, UINT32_MAX};
+  DayCsvReader src;
+  uint32_t left = 0;                  // STORE: bytes of the entry still to send
+  uint32_t crc = 0;                   // DEFLATE: running CRC / sizes of the entry
+  uint32_t size = 0;
+  uint32_t compSize = 0;
+  uint32_t cdStart = 0;
+  uint8_t buf[HttpConfig::BLOCK_BYTES];
+
+  bool fill(Download& d) {
+    out.d = &d;
+    switch (phase) {
+      case RESOLVE: return resolveStep(d);
+      case ENTRY: return entryStart();
+      case DATA: return deflate ? deflateStep() : storeStep();
+      case DIRECTORY: return directoryStep();
+    }
+    return false;
+  }
+
+ private:
+  bool resolveStep(Download& d) {
+    if (i < entries.size()) {
+      size_t slot = (size_t)((entries[i].dayMid - fromMid + 43200) / 86400);
+      if (resolveZipEntryCrc(entries[i], slot < slots.size() ? slots[slot] : UINT32_MAX, todayMid)) i++;
+      else entries.erase(entries.begin() + i);
+      return true;
+    }
+    std::vector<uint32_t>().swap(slots);
+
+    uint32_t total = 0;
+    uint32_t etagCrc = 0xFFFFFFFFUL;
+    for (auto& e : entries) {
+      e.compSize = e.size;
+      e.lho = total;
+      total += 30 + e.name.length() + e.size;
+      etagCrc = crc32_update(etagCrc, (const uint8_t*)e.name.c_str(), e.name.length());
+      etagCrc = crc32_update(etagCrc, (const uint8_t*)&e.crc, sizeof(e.crc));
+      etagCrc = crc32_update(etagCrc, (const uint8_t*)&e.size, sizeof(e.size));
+    }
+    for (const auto& e : entries) total += 46 + e.name.length();
+    total += 22;
+
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)(etagCrc ^ 0xFFFFFFFFUL));
+    headers += "ETag: ";
+    headers += etag;
+    headers += "\r\nAccept-Ranges: bytes\r\n";
+
+    uint32_t from = 0, to = total;
+    bool partial = false;
+    if (range.length() > 0 && (ifRange.length() == 0 || ifRange == etag)) {
+      if (parseByteRange(range, total, from, to)) {
+        if (from >= to) {
+          static const char kMsg[] = "Range not satisfiable";
+          d.head(416, "text/plain", sizeof(kMsg) - 1, headers + "Content-Range: bytes */" + String(total) + "\r\n");
+          d.put(kMsg, sizeof(kMsg) - 1);
+          return false;
+        }
+        partial = true;
+        headers += "Content-Range: bytes " + String(from) + "-" + String(to - 1) + "/" + String(total) + "\r\n";
+      }
+    }
+    d.head(partial ? 206 : 200, "application/zip", to - from, headers);
+    out.from = from;
+    out.to = to;
+    i = 0;
+    phase = ENTRY;
+    return true;
+  }
+
+  bool entryStart() {
+    if (i == entries.size()) {
+      cdStart = out.pos;
+      i = 0;
+      phase = DIRECTORY;
+      return true;
+    }
+    ZipEntryInfo& e = entries[i];
+    src = DayCsvReader();
+    src.path = e.sdPath;
+    src.fromBinary = e.fromBinary;
+    phase = DATA;
+
+    if (deflate) {
+      if (!e.fromBinary && !hal::storage().exists(e.sdPath.c_str())) {
+        entries.erase(entries.begin() + i);
+        phase = ENTRY;
+        return true;
+      }
+      e.lho = out.pos;
+      zipLocalHeader(out, e, true);
+      crc = 0xFFFFFFFFUL;
+      size = 0;
+      compSize = 0;
+      deflater.reset([](void* ctx, const uint8_t* data, size_t len) {
+        ZipDownload* z = (ZipDownload*)ctx;
+        z->out.bytes(data, len);
+        z->compSize += (uint32_t)len;
+      }, this);
+      return true;
+    }
+
+    zipLocalHeader(out, e, false);
+    left = e.size;
+    if (out.pos + e.size <= out.from || out.pos >= out.to) {
+      out.pos += e.size;  // entirely outside the range
+      left = 0;
+    } else if (!e.fromBinary && out.from > out.pos) {
+      // Stored file data of a known size; the part before the range is skipped by seeking
+      uint32_t skip = out.from - out.pos;
+      src.offset = skip;
+      out.pos += skip;
+      left -= skip;
+    }
+    return out.pos < out.to;
+  }
+
+  bool storeStep() {
+    if (left > 0 && out.pos < out.to) {
+      size_t n = src.read(buf, sizeof(buf));
+      if (n > left) n = left;
+      if (n == 0) {
+        // File shrank since it was hashed: keep the promised length (the CRC will flag it)
+        n = left < sizeof(buf) ? left : sizeof(buf);
+        memset(buf, 0, n);
+      }
+      out.bytes(buf, n);
+      left -= (uint32_t)n;
+      return true;
+    }
+    out.pos += left;
+    left = 0;
+    i++;
+    phase = ENTRY;
+    return out.pos < out.to;
+  }
+
+  bool deflateStep() {
+    size_t n = src.read(buf, sizeof(buf));
+    if (n > 0) {
+      crc = crc32_update(crc, buf, n);
+      size += (uint32_t)n;
+      deflater.write(buf, n);
+      return true;
+    }
+    deflater.finish();
+    ZipEntryInfo& e = entries[i];
+    e.crc = crc ^ 0xFFFFFFFFUL;
+    e.size = size;
+    e.compSize = compSize;
+
+    // Data descriptor
+    out.u32(0x08074b50);
+    out.u32(e.crc);
+    out.u32(e.compSize);
+    out.u32(e.size);
+    i++;
+    phase = ENTRY;
+    return true;
+  }
+
+  bool directoryStep() {
+    for (int k = 0; k < 16 && i < entries.size(); k++, i++) zipCentralRecord(out, entries[i], deflate);
+    if (i < entries.size()) return out.pos < out.to;
+    zipEndOfDirectory(out, entries.size(), cdStart);
+    return false;
+  }
+};
+
+void handleDownloadZip() {
+  if (!gSdOk) {
+    server.send(503, "text/plain", "SD not available");
+    return;
+  }
+  flushLogBuffer();
+
+  time_t todayMid = localMidnight(epochNow());
+  time_t fromMid = todayMid, toMid = todayMid;
+  String filename;
+  if (server.hasArg("from") || server.hasArg("to")) {
+    // Date range, inclusive; a missing end defaults to the other one / today
+    bool ok = true;
+    if (server.hasArg("to")) ok = parseZipDate(server.arg("to"), toMid);
+    if (ok && server.hasArg("from")) ok = parseZipDate(server.arg("from"), fromMid);
+    else if (ok) fromMid = toMid;
+    if (!ok || fromMid > toMid) {
+      server.send(400, "text/plain", "Bad from/to date (use YYYYMMDD or YYYY-MM-DD)");
+      return;
+    }
+    if (toMid - fromMid > (time_t)ZIP_MAX_RANGE_DAYS * 86400) {
+      server.send(400, "text/plain", "Range too long (max " + String(ZIP_MAX_RANGE_DAYS) + " days)");
+      return;
+    }
+    filename = "data_" + ymdString(fromMid) + "_" + ymdString(toMid) + ".zip";
+  } else {
+    int days = server.arg("days").toInt();
+    if (days <= 0) days = 7;
+    // If LogConfig::RETENTION_DAYS is 0 (never delete), allow any number of days
+    if (LogConfig::RETENTION_DAYS > 0 && days > LogConfig::RETENTION_DAYS) days = LogConfig::RETENTION_DAYS;
+    if (days < 1) days = 1;
+    fromMid = subtractDaysLocalMidnight(todayMid, days - 1);
+    filename = "last_" + String(days) + "_days.zip";
+  }
+
+  auto entries = buildDayRangeList(fromMid, toMid);
+  if (entries.empty()) {
+    server.send(404, "text/plain", "No daily CSV files found");
+    return;
+  }
+  if (!downloadAdmit()) return;
+
+  crc32_init();
+  ZipDownload* zip = new ZipDownload;
+  zip->entries = std::move(entries);
+  zip->todayMid = todayMid;
+  zip->headers = "Content-Disposition: attachment; filename=\"" + filename + "\"\r\nCache-Control: no-store\r\n";
+  zip->deflate = server.arg("method") == "deflate" && zip->deflater.init();
+  if (!zip->deflate) {
+    // STORE: CRCs of finalized days come from the day index
+    zip->fromMid = zip->entries.front().dayMid;  // the oldest day with a file
+    zip->slots.resize((size_t)((toMid - zip->fromMid) / 86400) + 2);
+    readDayIndexSlots(zip->fromMid, zip->slots);
+    zip->range = server.header("Range");
+    zip->ifRange = server.header("If-Range");
+  }
+  Download& d = downloadStart(zip);
+  if (zip->deflate) {
+    d.head(200, "application/zip", CONTENT_LENGTH_UNKNOWN, zip->headers);
+    zip->phase = ZipDownload::ENTRY;
+  }
+}
+
+// ------------------- STATIC ASSETS -------------------
+// index.html and app.js are served from /web with an ETag (CRC32 of the file)
+// and, when the browser accepts it, from the "<file>.gz" variant the upload
+// page stores next to them. Each file's CRC is kept in a "<file>.crc" sidecar
+// ("crc size"), written on upload or on first use. Small bodies stay in RAM so
+// page loads don't touch the SD bus.
+
+struct StaticVariant {
+  bool present = false;
+  uint32_t crc = 0;
+  uint32_t size = 0;
+};
+
+struct StaticAsset {
+  const char* path;
+  const char* contentType;
+  bool known;               // variants below are loaded
+  StaticVariant plain;
+  StaticVariant gzip;
+  uint8_t* ram;             // cached body of the gzip (ramGzip) or plain variant
+  size_t ramLen;
+  bool ramGzip;
+};
+
+static StaticAsset gStaticAssets[] = {
+  {"/web/index.html", "text/html", false, {}, {}, nullptr, 0, false},
+  {"/web/app.js", "application/javascript", false, {}, {}, nullptr, 0, false},
+};
+static constexpr int STATIC_ASSET_COUNT = sizeof(gStaticAssets) / sizeof(gStaticAssets[0]);
+static size_t gStaticCacheUsed = 0;
+
+static void writeStaticCrc(const String& path, uint32_t crc, uint32_t size) {
+  String crcPath = path + ".crc";
+  if (hal::storage().exists(crcPath.c_str())) hal::storage().remove(crcPath.c_str());
+  File f = hal::storage().open(crcPath.c_str(), FILE_WRITE);
+  if (!f) return;
+  char line[24];
+  int n = snprintf(line, sizeof(line), "%08lx %lu", (unsigned long)crc, (unsigned long)size);
+  f.write((const uint8_t*)line, n);
+  f.close();
+}
+
+static bool loadStaticVariant(const String& path, StaticVariant& v) {
+  v = StaticVariant();
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return false;
+  v.size = (uint32_t)f.size();
+
+  File c = hal::storage().open((path + ".crc").c_str(), FILE_READ);
+  if (c) {
+    char line[24];
+    int n = c.read((uint8_t*)line, sizeof(line) - 1);
+    c.close();
+    unsigned long crc = 0, size = 0;
+    if (n > 0) {
+      line[n] = '\0';
+      if (sscanf(line, "%lx %lu", &crc, &size) == 2 && size == v.size) {
+        f.close();
+        v.crc = (uint32_t)crc;
+        v.present = true;
+        return true;
+      }
+    }
+  }
+
+  // No (or stale) sidecar: hash the file once
+  f.close();
+  if (!fileCrc32(path.c_str(), v.crc, v.size)) return false;
+  v.present = true;
+  writeStaticCrc(path, v.crc, v.size);
+  return true;
+}
+
+static void invalidateStaticAsset(const String& path) {
+  for (int i = 0; i < STATIC_ASSET_COUNT; i++) {
+    StaticAsset& a = gStaticAssets[i];
+    if (!path.startsWith(a.path)) continue;
+    if (a.ram) {
+      free(a.ram);
+      gStaticCacheUsed -= a.ramLen;
+    }
+    a.ram = nullptr;
+    a.ramLen = 0;
+    a.known = false;
+  }
+}
+
+static bool clientAcceptsGzip() {
+  String ae = server.header("Accept-Encoding");
+  return ae.indexOf("gzip") >= 0;
+}
+
+// Serves the asset and returns true; false if it isn't on the SD card.
+static bool serveStaticAsset(StaticAsset& a) {
+  if (!gSdOk) return false;
+  if (!a.known) {
+    loadStaticVariant(a.path, a.plain);
+    loadStaticVariant(String(a.path) + ".gz", a.gzip);
+    a.known = true;
+  }
+  bool gz = a.gzip.present && clientAcceptsGzip();
+  if (!gz && !a.plain.present) return false;
+  const StaticVariant& v = gz ? a.gzip : a.plain;
+
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)v.crc);
+  // A ?v=<crc> URL never changes content; a plain URL has to be revalidated
+  bool versioned = server.hasArg("v") && strtoul(server.arg("v").c_str(), nullptr, 16) == v.crc;
+  server.sendHeader("Vary", "Accept-Encoding");
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", versioned ? "public, max-age=31536000, immutable" : "no-cache");
+  String inm = server.header("If-None-Match");
+  if (inm.length() > 0 && strstr(inm.c_str(), etag) != nullptr) {
+    server.send(304);
+    return true;
+  }
+  if (gz) server.sendHeader("Content-Encoding", "gzip");
+
+  if (a.ram && a.ramGzip == gz) {
+    server.send_P(200, a.contentType, (const char*)a.ram, a.ramLen);
+    return true;
+  }
+
+  String path = gz ? String(a.path) + ".gz" : String(a.path);
+  File f = hal::storage().open(path.c_str(), FILE_READ);
+  if (!f) return false;
+  size_t size = f.size();
+
+  // Keep the variant this client got if it fits the cache budget (replacing the other one)
+  size_t othersUsed = gStaticCacheUsed - (a.ram ? a.ramLen : 0);
+  if (size > 0 && othersUsed + size <= UIConfig::STATIC_CACHE_BYTES) {
+    uint8_t* body = (uint8_t*)malloc(size);
+    if (body && f.read(body, size) == (int)size) {
+      f.close();
+      free(a.ram);
+      a.ram = body;
+      a.ramLen = size;
+      a.ramGzip = gz;
+      gStaticCacheUsed = othersUsed + size;
+      server.send_P(200, a.contentType, (const char*)a.ram, a.ramLen);
+      return true;
+    }
+    free(body);
+    f.seek(0);
+  }
+
+  server.setContentLength(size);
+  server.send(200, a.contentType, "");
+  uint8_t buf[1436];
+  int n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) server.sendContent((const char*)buf, (size_t)n);
+  f.close();
+  return true;
+}
+
+// ------------------- WEB UI + API -------------------
+
+void handleRoot() {
+  if (serveStaticAsset(gStaticAssets[0])) return;
+
+  const char* fallbackHtml = R"HTML(
+<!DOCTYPE html>
+<html>
+<head>
+  <meta charset="utf-8"/>
+  <meta name="viewport" content="width=device-width, initial-scale=1"/>
+  <title>Weather Station - Setup Required</title>
+  <style>
+    body { font-family: system-ui, sans-serif; margin: 20px; max-width: 600px; }
+    h1 { color: #333; }
+    a { color: #0275d8; text-decoration: none; }
+    a:hover { text-decoration: underline; }
+    ul { line-height: 1.8; }
+  </style>
+</head>
+<body>
+  <h1>Weather Station - Setup Required</h1>
+  <p>Web interface files not found on SD card.</p>
+  <ul>
+    <li><a href="/upload">Upload UI files (index.html, app.js)</a></li>
+    <li><a href="/api/now">View current sensor data (JSON)</a></li>
+    <li><a href="/api/buckets">View bucket data (JSON)</a></li>
+    <li><a href="/api/days">View daily summaries (JSON)</a></li>
+    <li><a href="/api/config">View configuration (JSON)</a></li>
+    <li><a href="/api_help">API documentation</a></li>
+  </ul>
+</body>
+</html>
+)HTML";
+
+  server.send(200, "text/html", fallbackHtml);
+}
+
+void handleApiHelp() {
+  server.send_P(200, "text/html", API_HELP_HTML);
+}
+
+void handleRootJs() {
+  if (serveStaticAsset(gStaticAssets[1])) return;
+
+  server.send(200, "application/javascript", "console.log('app.js not found on SD card');");
+}
+
+void handleApiClearData() {
+  String pw = server.arg("pw");
+  bool rateLimited = false;
+  if (!verifyPassword(pw, rateLimited)) {
+    server.send(rateLimited ? 429 : 401, "application/json",
+                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
+                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
+    return;
+  }
+  if (!SDConfig::ENABLE || !gSdOk) {
+    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
+    return;
+  }
+  flushLogBuffer();
+  bool ok = deleteDirFiles("/data");
+  gFileCatalog.clear();
+  if (!ok) {
+    // Whatever survived is listed again
+    fileCatalogBeginScan();
+    while (fileCatalogScanSlice()) {}
+  }
+  invalidateLogFileCache();
+  String out = String("{\"ok\":") + (ok ? "true" : "false") + "}";
+  server.send(ok ? 200 : 500, "application/json", out);
+}
+
+void handleApiDelete() {
+  String pw = server.arg("pw");
+  bool rateLimited = false;
+  if (!verifyPassword(pw, rateLimited)) {
+    server.send(rateLimited ? 429 : 401, "application/json",
+                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
+                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
+    return;
+  }
+  if (!gSdOk) {
+    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
+    return;
+  }
+  String filename = server.arg("filename");
+  if (!isAllowedFilename(filename)) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"invalid_filename\"}");
+    return;
+  }
+  flushLogBuffer();
+  String path = "/data/" + filename;
+  if (!hal::storage().exists(path.c_str())) {
+    server.send(404, "application/json", "{\"ok\":false,\"error\":\"not_found\"}");
+    return;
+  }
+  bool ok = hal::storage().remove(path.c_str());
+  if (!ok) {
+    server.send(500, "application/json", "{\"ok\":false,\"error\":\"delete_failed\"}");
+    return;
+  }
+  String bktPath = "/data/" + filename.substring(0, filename.length() - 4) + ".bkt";
+  if (hal::storage().exists(bktPath.c_str())) hal::storage().remove(bktPath.c_str());
+  time_t dayMid = 0;
+  if (parseYmdFromPath(filename, dayMid)) dropDayIndexRecord(dayMid);
+  uint32_t ymd = 0;
+  if (parseCatalogName(filename.c_str(), ymd)) fileCatalogErase(ymd);
+  invalidateLogFileCache();
+  server.send(200, "application/json", "{\"ok\":true}");
+}
+
+void handleApiReboot() {
+  String pw = server.arg("pw");
+  bool rateLimited = false;
+  if (!verifyPassword(pw, rateLimited)) {
+    server.send(rateLimited ? 429 : 401, "application/json",
+                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
+                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
+    return;
+  }
+  flushLogBuffer();
+  mqttSpillRam();
+  server.send(200, "application/json", "{\"ok\":true}");
+  delay(100);
+  ESP.restart();
+}
+
+// ------------------- AQI CALCULATION -------------------
+#if AQI_STANDARD == 0
+// EPA (US) AQI Standard
+// Calculate EPA AQI for PM2.5 (24-hour average, but we use current reading)
+int calculateAQI_PM25(float pm25) {
+  if (!isfinite(pm25) || pm25 < 0) return -1;
+
+  // EPA AQI breakpoints for PM2.5 (μg/m³)
+  if (pm25 <= 12.0) return map((int)(pm25 * 10), 0, 120, 0, 50);
+  else if (pm25 <= 35.4) return map((int)(pm25 * 10), 121, 354, 51, 100);
+  else if (pm25 <= 55.4) return map((int)(pm25 * 10), 355, 554, 101, 150);
+  else if (pm25 <= 150.4) return map((int)(pm25 * 10), 555, 1504, 151, 200);
+  else if (pm25 <= 250.4) return map((int)(pm25 * 10), 1505, 2504, 201, 300);
+  else if (pm25 <= 500.4) return map((int)(pm25 * 10), 2505, 5004, 301, 500);
+  else return 500;
+}
+
+// Calculate EPA AQI for PM10 (24-hour average, but we use current reading)
+int calculateAQI_PM10(float pm10) {
+  if (!isfinite(pm10) || pm10 < 0) return -1;
+
+  // EPA AQI breakpoints for PM10 (μg/m³)
+  if (pm10 <= 54) return map((int)pm10, 0, 54, 0, 50);
+  else if (pm10 <= 154) return map((int)pm10, 55, 154, 51, 100);
+  else if (pm10 <= 254) return map((int)pm10, 155, 254, 101, 150);
+  else if (pm10 <= 354) return map((int)pm10, 255, 354, 151, 200);
+  else if (pm10 <= 424) return map((int)pm10, 355, 424, 201, 300);
+  else if (pm10 <= 604) return map((int)pm10, 425, 604, 301, 500);
+  else return 500;
+}
+
+// Get EPA AQI category string
+const char* getAQICategory(int aqi) {
+  if (aqi < 0) return "N/A";
+  else if (aqi <= 50) return "Good";
+  else if (aqi <= 100) return "Moderate";
+  else if (aqi <= 150) return "Unhealthy for Sensitive";
+  else if (aqi <= 200) return "Unhealthy";
+  else if (aqi <= 300) return "Very Unhealthy";
+  else return "Hazardous";
+}
+
+#elif AQI_STANDARD == 1
+// Australian AQI Standard
+// Calculate Australian AQI for PM2.5 (24-hour average, but we use current reading)
+int calculateAQI_PM25(float pm25) {
+  if (!isfinite(pm25) || pm25 < 0) return -1;
+
+  // Australian AQI breakpoints for PM2.5 (μg/m³)
+  // Scale: 0-200+ with categories: Very Good, Good, Fair, Poor, Very Poor, Hazardous
+  if (pm25 <= 25.0) return map((int)(pm25 * 10), 0, 250, 0, 33);
+  else if (pm25 <= 50.0) return map((int)(pm25 * 10), 251, 500, 34, 66);
+  else if (pm25 <= 100.0) return map((int)(pm25 * 10), 501, 1000, 67, 99);
+  else if (pm25 <= 150.0) return map((int)(pm25 * 10), 1001, 1500, 100, 149);
+  else if (pm25 <= 200.0) return map((int)(pm25 * 10), 1501, 2000, 150, 200);
+  else return 200; // Hazardous
+}
+
+// Calculate Australian AQI for PM10 (24-hour average, but we use current reading)
+int calculateAQI_PM10(float pm10) {
+  if (!isfinite(pm10) || pm10 < 0) return -1;
+
+  // Australian AQI breakpoints for PM10 (μg/m³)
+  if (pm10 <= 50.0) return map((int)(pm10 * 10), 0, 500, 0, 33);
+  else if (pm10 <= 100.0) return map((int)(pm10 * 10), 501, 1000, 34, 66);
+  else if (pm10 <= 200.0) return map((int)(pm10 * 10), 1001, 2000, 67, 99);
+  else if (pm10 <= 300.0) return map((int)(pm10 * 10), 2001, 3000, 100, 149);
+  else if (pm10 <= 400.0) return map((int)(pm10 * 10), 3001, 4000, 150, 200);
+  else return 200; // Hazardous
+}
+
+// Get Australian AQI category string
+const char* getAQICategory(int aqi) {
+  if (aqi < 0) return "N/A";
+  else if (aqi <= 33) return "Very Good";
+  else if (aqi <= 66) return "Good";
+  else if (aqi <= 99) return "Fair";
+  else if (aqi <= 149) return "Poor";
+  else if (aqi <= 200) return "Very Poor";
+  else return "Hazardous";
+}
+
+#else
+#error "Invalid AQI_STANDARD. Must be 0 (EPA) or 1 (Australian)"
+#endif
+
+// "loading": false, or which stage is running and how far it got
+static void writeLoadingField(JsonWriter& w) {
+  w.key("loading");
+  if (bootLoadDone()) {
+    w.boolean(false);
+    return;
+  }
+  w.beginObject();
+  w.key("stage"); w.str(kBootLoadNames[gBoot.stage]);
+  w.key("stage_index"); w.i32(gBoot.stage);
+  w.key("stages"); w.i32(BOOT_LOAD_COUNT);
+  w.key("files_done"); w.u32((uint32_t)gBoot.next);
+  w.key("files"); w.u32((uint32_t)gBoot.days.size());
+  w.endObject();
+}
+
+// Readings and sensor flags shared by /api/now and the stream's "now" event
+static void writeLiveFields(JsonWriter& w, const LiveSnapshot& live, time_t nowE) {
+  float pps = (WindConfig::PPS_TO_MS > 0.0f) ? (live.windMs / WindConfig::PPS_TO_MS) : 0.0f;
+  float press_hpa = isfinite(live.pressurePa) ? (live.pressurePa / 100.0f) : NAN;
+
+  w.key("epoch"); w.u32((uint32_t)nowE);
+  w.key("local_time"); w.localTime(nowE);
+
+  w.key("wind_pps"); w.num(pps, 3);
+  w.key("wind_ms"); w.num(live.windMs, 3);
+  w.key("wind_inst_ms"); w.num(live.windInstMs, 3);
+  w.key("wind_3s_ms"); w.num(live.windGust3sMs, 3);
+  w.key("wind_gust_ms"); w.num(live.bucket.maxWind, 3);
+  w.key("wind_std_ms"); w.num(live.bucket.windStd, 3);
+
+  w.key("bme280_ok"); w.boolean(gBmeOk);
+  w.key("temp_c"); w.num(live.tempC, 2);
+  w.key("hum_rh"); w.num(live.humRH, 2);
+  w.key("press_hpa"); w.num(press_hpa, 2);
+
+  w.key("pms5003_ok"); w.boolean(gPmsOk);
+  w.key("pm1"); w.num(live.pm1, 1);
+  w.key("pm25"); w.num(live.pm25, 1);
+  w.key("pm10"); w.num(live.pm10, 1);
+
+  // Calculate AQI values
+  int aqiPM25 = calculateAQI_PM25(live.pm25);
+  int aqiPM10 = calculateAQI_PM10(live.pm10);
+  w.key("aqi_pm25"); if (aqiPM25 >= 0) w.i32(aqiPM25); else w.null();
+  w.key("aqi_pm25_category"); w.str(getAQICategory(aqiPM25));
+  w.key("aqi_pm10"); if (aqiPM10 >= 0) w.i32(aqiPM10); else w.null();
+  w.key("aqi_pm10_category"); w.str(getAQICategory(aqiPM10));
+
+  w.key("sd_ok"); w.boolean(gSdOk);
+  writeLoadingField(w);
+}
+
+// Slow-changing device health, sent on its own interval by the stream
+static void writeStatusFields(JsonWriter& w) {
+  w.key("cpu_temp_c"); w.num(temperatureRead(), 1);
+  w.key("uptime_s"); w.u32((uint32_t)(millis() / 1000));
+  w.key("retention_days"); w.i32(LogConfig::RETENTION_DAYS);
+  w.key("wifi_rssi"); w.i32(WiFi.RSSI());
+  w.key("free_heap"); w.u32(ESP.getFreeHeap());
+  w.key("heap_size"); w.u32(ESP.getHeapSize());
+  w.key("boot_http_ms"); w.u32(gBoot.httpReadyMs);
+  w.key("boot_first_request_ms"); w.u32(gBoot.firstRequestMs);
+  w.key("boot_history_ms"); w.u32(gBoot.historyMs);
+}
+
+void handleApiNow() {
+  LiveSnapshot live = gLive.read();
+
+  JsonWriter w;
+  w.begin();
+  w.beginObject();
+  writeLiveFields(w, live, epochNow());
+  w.key("sd_log_pending"); w.i32(gLogPendingCount);
+  w.key("sd_flushes"); w.u32(gLogFlushCount);
+  w.key("sd_flush_errors"); w.u32(gLogFlushErrors);
+  w.key("sd_flush_last_ms"); w.u32(gLogFlushLastMs);
+  w.key("sd_flush_max_ms"); w.u32(gLogFlushMaxMs);
+  w.key("sd_bytes_written"); w.u32(gLogBytesWritten);
+  w.key("sd_journal_bytes"); w.u32(gLogJournalBytes);
+  w.key("sd_journal_replayed"); w.u32(gLogJournalReplayed);
+  w.key("sd_rows_dropped"); w.u32(gLogRowsDropped);
+  const AcqStats& acq = live.stats;
+  w.key("acq_windows"); w.u32(acq.windows);
+  w.key("acq_late_windows"); w.u32(acq.lateWindows);
+  w.key("acq_overrun_avg_ms"); w.num(acq.windows ? (float)acq.overrunSumUs / (float)acq.windows / 1000.0f : 0.0f, 3);
+  w.key("acq_overrun_max_ms"); w.num(acq.overrunMaxUs / 1000.0f, 3);
+  w.key("acq_busy_max_ms"); w.num(acq.busyMaxUs / 1000.0f, 3);
+  w.key("acq_queue_full"); w.u32(acq.queueFull);
+  w.key("acq_gap_fills"); w.u32(acq.gapFills);
+  w.key("acq_clock_backsteps"); w.u32(acq.clockBacksteps);
+  w.key("acq_stack_free"); w.u32(gAcqTask ? (uint32_t)uxTaskGetStackHighWaterMark(gAcqTask) : 0);
+  writeMqttFields(w);
+  writeStatusFields(w);
+  w.endObject();
+}
+
+#if METRICS_ENABLE
+static void putMetricLine(ChunkedResponse& w, const char* name, const char* suffix, const char* labels, const char* value) {
+  w.put(name);
+  w.put(suffix);
+  if (labels && *labels) {
+    w.put('{');
+    w.put(labels);
+    w.put('}');
   }
+  w.put(' ');
+  w.put(value);
+  w.put('\n');
+}
 
-  String path = "/data/" + filename;
-  if (!SD.exists(path.c_str())) {
-    server.send(404, "text/plain", "Not found");
-    return;
-  }
+static void putMetricHelp(ChunkedResponse& w, const char* name, const char* type, const char* help) {
+  w.put("# HELP "); w.put(name); w.put(' '); w.put(help); w.put('\n');
+  w.put("# TYPE "); w.put(name); w.put(' '); w.put(type); w.put('\n');
+}
 
-  File f = SD.open(path.c_str(), FILE_READ);
-  if (!f) {
-    server.send(500, "text/plain", "Failed to open file");
-    return;
-  }
+static void putMetricCount(ChunkedResponse& w, const char* name, const char* labels, uint32_t v) {
+  char num[12];
+  snprintf(num, sizeof(num), "%lu", (unsigned long)v);
+  putMetricLine(w, name, "", labels, num);
+}
 
-  server.sendHeader("Content-Type", "text/csv");
-  server.sendHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
-  server.sendHeader("Cache-Control", "no-store");
-  server.streamFile(f, "text/csv");
-  f.close();
+static void putMetricSeconds(ChunkedResponse& w, const char* name, const char* suffix, const char* labels, uint64_t us) {
+  char num[24];
+  snprintf(num, sizeof(num), "%lu.%06lu", (unsigned long)(us / 1000000ULL), (unsigned long)(us % 1000000ULL));
+  putMetricLine(w, name, suffix, labels, num);
 }
 
-void handleApiFiles() {
-  if (!gSdOk) {
-    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
-    return;
+// labels: "" or e.g. route="/api/now",method="GET" (le is appended)
+static void putHistogram(ChunkedResponse& w, const char* name, const char* labels, const LatencyHistogram& h) {
+  char lbl[128];
+  char num[24];
+  const char* sep = *labels ? "," : "";
+  uint32_t cumulative = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    cumulative += h.counts[i];
+    if (i < LATENCY_BUCKETS - 1) {
+      snprintf(lbl, sizeof(lbl), "%s%sle=\"%g\"", labels, sep, kLatencyBoundsUs[i] / 1e6);
+    } else {
+      snprintf(lbl, sizeof(lbl), "%s%sle=\"+Inf\"", labels, sep);
+    }
+    snprintf(num, sizeof(num), "%lu", (unsigned long)cumulative);
+    putMetricLine(w, name, "_bucket", lbl, num);
   }
+  putMetricSeconds(w, name, "_sum", labels, h.sumUs);
+  snprintf(num, sizeof(num), "%lu", (unsigned long)h.count);
+  putMetricLine(w, name, "_count", labels, num);
+}
 
-  // Always use /data directory
-  String dir = "data";
-  String base = "/data";
+void handleApiMetrics() {
+  ChunkedResponse w;
+  w.begin(200, "text/plain; version=0.0.4");
+  char lbl[128];
 
-  if (!SD.exists(base.c_str())) {
-    server.send(200, "application/json", String("{\"ok\":true,\"dir\":\"") + dir + "\",\"files\":[]}");
-    return;
+  putMetricHelp(w, "ws_http_request_duration_seconds", "histogram", "Handler time per route, including sending the response.");
+  for (int i = 0; i < gMetrics.routeCount; i++) {
+    const RouteMetric& r = gMetrics.routes[i];
+    snprintf(lbl, sizeof(lbl), "route=\"%s\",method=\"%s\"", r.uri, r.method);
+    putHistogram(w, "ws_http_request_duration_seconds", lbl, r.latency);
+  }
+  putMetricHelp(w, "ws_http_request_duration_max_seconds", "gauge", "Slowest request per route since boot.");
+  for (int i = 0; i < gMetrics.routeCount; i++) {
+    const RouteMetric& r = gMetrics.routes[i];
+    if (r.latency.count == 0) continue;
+    snprintf(lbl, sizeof(lbl), "route=\"%s\",method=\"%s\"", r.uri, r.method);
+    putMetricSeconds(w, "ws_http_request_duration_max_seconds", "", lbl, r.latency.maxUs);
   }
 
-  uint32_t nowMs = millis();
-  if (gFilesCacheDataMs != 0 && (nowMs - gFilesCacheDataMs) < FILES_CACHE_TTL_MS && gFilesCacheDataJson.length() > 0) {
-    server.send(200, "application/json", gFilesCacheDataJson);
-    return;
+  putMetricHelp(w, "ws_http_downloads_active", "gauge", "Downloads and history API responses being written from loop().");
+  putMetricCount(w, "ws_http_downloads_active", "", downloadCount());
+  putMetricHelp(w, "ws_http_downloads_refused_total", "counter", "Downloads and history API requests answered 503 because a limit was reached.");
+  putMetricCount(w, "ws_http_downloads_refused_total", "", gDownloadsRefused);
+  putMetricHelp(w, "ws_http_download_bytes_total", "counter", "Download bytes taken by the clients' sockets.");
+  putMetricCount(w, "ws_http_download_bytes_total", "", gDownloadBytes);
+
+  putMetricHelp(w, "ws_loop_duration_seconds", "histogram", "Time of one loop() iteration.");
+  putHistogram(w, "ws_loop_duration_seconds", "", gMetrics.loop);
+  putMetricHelp(w, "ws_sd_log_bucket_duration_seconds", "histogram", "logBucketToSD (RAM buffer and journal, plus the flush when the buffer is full).");
+  putHistogram(w, "ws_sd_log_bucket_duration_seconds", "", gMetrics.sdLogBucket);
+  putMetricHelp(w, "ws_sd_flush_duration_seconds", "histogram", "Batched write of buffered rows to the day files.");
+  putHistogram(w, "ws_sd_flush_duration_seconds", "", gMetrics.sdFlush);
+
+  putMetricHelp(w, "ws_sd_read_bytes_total", "counter", "Bytes read by the CSV, bucket log and day index readers.");
+  putMetricCount(w, "ws_sd_read_bytes_total", "", gMetrics.sdReadBytes);
+  putMetricHelp(w, "ws_sd_flush_errors_total", "counter", "Flushes and gap fills the card refused (rows kept for a retry, or dropped).");
+  putMetricCount(w, "ws_sd_flush_errors_total", "", gLogFlushErrors);
+  putMetricHelp(w, "ws_sd_rows_dropped_total", "counter", "Rows never written: buffer full while the card refused writes, or a refused gap fill.");
+  putMetricCount(w, "ws_sd_rows_dropped_total", "", gLogRowsDropped);
+  putMetricHelp(w, "ws_boot_load_seconds", "gauge", "Time spent in each boot loader (sum of its slices in loop()).");
+  for (int i = 0; i < BOOT_LOAD_COUNT; i++) {
+    snprintf(lbl, sizeof(lbl), "loader=\"%s\"", kBootLoadNames[i]);
+    putMetricSeconds(w, "ws_boot_load_seconds", "", lbl, gMetrics.bootLoadUs[i]);
+  }
+  putMetricHelp(w, "ws_boot_load_bytes", "gauge", "SD bytes read by each boot loader.");
+  for (int i = 0; i < BOOT_LOAD_COUNT; i++) {
+    snprintf(lbl, sizeof(lbl), "loader=\"%s\"", kBootLoadNames[i]);
+    putMetricCount(w, "ws_boot_load_bytes", lbl, gMetrics.bootLoadBytes[i]);
   }
+  putMetricHelp(w, "ws_boot_milestone_seconds", "gauge", "Time since power-on at each boot milestone (0 = not reached).");
+  putMetricSeconds(w, "ws_boot_milestone_seconds", "", "milestone=\"http_ready\"", (uint64_t)gBoot.httpReadyMs * 1000ULL);
+  putMetricSeconds(w, "ws_boot_milestone_seconds", "", "milestone=\"first_request\"", (uint64_t)gBoot.firstRequestMs * 1000ULL);
+  putMetricSeconds(w, "ws_boot_milestone_seconds", "", "milestone=\"history_loaded\"", (uint64_t)gBoot.historyMs * 1000ULL);
+
+  putMetricHelp(w, "ws_heap_free_bytes", "gauge", "Free heap.");
+  putMetricCount(w, "ws_heap_free_bytes", "", ESP.getFreeHeap());
+  putMetricHelp(w, "ws_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+  putMetricCount(w, "ws_heap_min_free_bytes", "", ESP.getMinFreeHeap());
+  putMetricHelp(w, "ws_heap_max_alloc_bytes", "gauge", "Largest free heap block.");
+  putMetricCount(w, "ws_heap_max_alloc_bytes", "", ESP.getMaxAllocHeap());
+
+  putMetricHelp(w, "ws_pms_frames_total", "counter", "PMS5003 frames received.");
+  putMetricCount(w, "ws_pms_frames_total", "", gMetrics.pmsFrames);
+  putMetricHelp(w, "ws_pms_checksum_errors_total", "counter", "PMS5003 frames dropped for a bad checksum.");
+  putMetricCount(w, "ws_pms_checksum_errors_total", "", gMetrics.pmsChecksumErrors);
+
+  AcqStats acq = gLive.read().stats;
+  putMetricHelp(w, "ws_acq_windows_total", "counter", "Wind PPS windows measured by the acquisition task.");
+  putMetricCount(w, "ws_acq_windows_total", "", acq.windows);
+  putMetricHelp(w, "ws_acq_late_windows_total", "counter", "PPS windows more than 10% longer than nominal.");
+  putMetricCount(w, "ws_acq_late_windows_total", "", acq.lateWindows);
+  putMetricHelp(w, "ws_acq_window_overrun_max_seconds", "gauge", "Longest PPS window overrun since boot.");
+  putMetricSeconds(w, "ws_acq_window_overrun_max_seconds", "", "", acq.overrunMaxUs);
+  putMetricHelp(w, "ws_acq_gap_fills_total", "counter", "Bucket closes followed by a run of empty buckets (clock jumped forward).");
+  putMetricCount(w, "ws_acq_gap_fills_total", "", acq.gapFills);
+  putMetricHelp(w, "ws_acq_clock_backsteps_total", "counter", "Times the clock stepped back past the open bucket's start.");
+  putMetricCount(w, "ws_acq_clock_backsteps_total", "", acq.clockBacksteps);
+
+  putMqttMetrics(w);
+
+  putMetricHelp(w, "ws_pulse_ring_overflows_total", "counter", "Wind pulse timestamps overwritten before the acquisition task read them.");
+  putMetricCount(w, "ws_pulse_ring_overflows_total", "", gPulseRingOverflows);
+
+  putMetricHelp(w, "ws_uptime_seconds", "counter", "Seconds since boot.");
+  putMetricCount(w, "ws_uptime_seconds", "", millis() / 1000);
+  w.flush();
+}
+#endif
 
-  File root = SD.open(base.c_str());
-  if (!root || !root.isDirectory()) {
-    server.send(500, "application/json", "{\"ok\":false,\"error\":\"failed_to_open_dir\"}");
+// Std dev over mean wind; undefined in near-calm conditions
+static float turbulenceIntensity(const BucketSample& b) {
+  if (!isfinite(b.windStd) || !(b.avgWind >= WindConfig::TI_MIN_WIND_MS)) return NAN;
+  return b.windStd / b.avgWind;
+}
+
+static void writeBucketJson(JsonWriter& w, const BucketSample& b) {
+  // Full descriptive property names; skip buckets with no valid sensor data
+  if (!isfinite(b.avgWind) && !isfinite(b.maxWind) &&
+      !isfinite(b.avgTempC) && !isfinite(b.avgHumRH) && !isfinite(b.avgPressHpa)) {
     return;
   }
 
-  String out;
-  out.reserve(4096);
-  out += "{\"ok\":true,\"dir\":\"" + dir + "\",\"files\":[";
-  bool first = true;
-
-  File f = root.openNextFile();
-  while (f) {
-    if (!f.isDirectory()) {
-      String name = f.name();
-      // Skip internal cache files
-      if (name.indexOf("day_summaries_cache") >= 0) {
-        f.close();
-        f = root.openNextFile();
-        continue;
-      }
-      if (name.endsWith(".csv")) {
-        if (!first) out += ",";
-        first = false;
-        out += "{";
-        // Just the filename, directory is specified in "dir" field
-        out += "\"path\":\"" + name + "\",";
-        out += "\"size\":" + String((uint32_t)f.size());
-        out += "}";
-      }
+  w.beginObject();
+  w.key("timestamp"); w.u32((uint32_t)b.startEpoch);
+  for (int c = 0; c < CH_COUNT; c++) {
+    if (c == CH_TEMP) {  // wind statistics follow the wind pair
+      w.key("wind_speed_samples"); w.u32(b.samples);
+      w.key("wind_speed_std"); w.num(b.windStd, 3);
+      w.key("turbulence_intensity"); w.num(turbulenceIntensity(b), 3);
     }
-    f.close();
-    f = root.openNextFile();
+    w.key(CHANNELS[c].apiName); w.num(b.*kBucketChannel[c], CHANNELS[c].decimals);
   }
-  root.close();
+  w.endObject();
+}
 
-  out += "]}";
-  gFilesCacheDataJson = out;
-  gFilesCacheDataMs = nowMs;
-  server.send(200, "application/json", out);
+// Buckets sent by the compact and binary endpoints: skip those with no valid sensor data
+static bool compactBucketHasData(const BucketSample& b) {
+  if (!timeIsValid(b.startEpoch)) return false;
+  return isfinite(b.avgWind) || isfinite(b.maxWind) ||
+         isfinite(b.avgTempC) || isfinite(b.avgHumRH) || isfinite(b.avgPressHpa);
 }
 
-// ------------------- ZIP (streamed, STORE method) -------------------
+static void writeBucketJsonCompact(JsonWriter& w, const BucketSample& b) {
+  // Compact format for internal UI - array format at the ring's precision
+  // Format: [epoch, avgWind, maxWind, samples, tempC, humRH, pressHpa, pm1, pm25, pm10]
+  if (!compactBucketHasData(b)) return;
 
-static uint32_t crc32_table[256];
-static bool crc32_init_done = false;
+  w.beginArray();
+  w.u32((uint32_t)b.startEpoch);
+  for (int c = 0; c < CH_COUNT; c++) {
+    if (c == CH_TEMP) w.u32(b.samples);  // after the wind pair
+    w.num(b.*kBucketChannel[c], CHANNELS[c].decimals);
+  }
+  w.endArray();
+}
 
-static void crc32_init() {
-  if (crc32_init_done) return;
-  for (uint32_t i = 0; i < 256; i++) {
-    uint32_t c = i;
-    for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
-    crc32_table[i] = c;
+// ------------------- LIVE STREAM (SSE) -------------------
+// /api/stream keeps the socket after the handler returns; loop() then pushes
+//   event: now     once per PPS window (the /api/now readings)
+//   event: status  every STATUS_INTERVAL_MS (RSSI, heap, CPU temperature, uptime)
+//   event: bucket  when a bucket is committed (an /api/buckets row)
+// Each event is formatted once into gStreamEvent's buffer and offered to every
+// subscriber with a non-blocking write; a client that can't take the whole
+// event is dropped (the browser reconnects on its own).
+
+static WiFiClient gStreamClients[StreamConfig::MAX_CLIENTS];
+static JsonWriter gStreamEvent;           // never begun: the event stays in its buffer
+static uint32_t gStreamWindow = 0;        // acq window of the last "now" event
+static uint32_t gStreamStatusMs = 0;
+
+// Releases the sockets of closed tabs; returns the subscribers left
+static int streamClientCount() {
+  int n = 0;
+  for (auto& c : gStreamClients) {
+    if (c.connected()) n++;
+    else if (c) c = WiFiClient();
   }
-  crc32_init_done = true;
+  return n;
 }
 
-static inline uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
-  uint32_t c = crc;
-  for (size_t i = 0; i < len; i++) c = crc32_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
-  return c;
+static void streamSendTo(WiFiClient& c, const char* ev, size_t len) {
+  if (!c.connected()) return;
+  if (hal::netWriteSome(c, (const uint8_t*)ev, len) == (int)len) return;
+  c.stop();
+  c = WiFiClient();
 }
 
-static void dosDateTime(time_t t, uint16_t &dosDate, uint16_t &dosTime) {
-  struct tm tmLocal;
-  localtime_r(&t, &tmLocal);
-  int year = tmLocal.tm_year + 1900;
-  if (year < 1980) year = 1980;
-  dosDate = (uint16_t)(((year - 1980) << 9) | ((tmLocal.tm_mon + 1) << 5) | (tmLocal.tm_mday));
-  dosTime = (uint16_t)((tmLocal.tm_hour << 11) | (tmLocal.tm_min << 5) | ((tmLocal.tm_sec / 2) & 0x1F));
+// Formats "event: <name>\ndata: {...}\n\n" once; fill writes the object's members
+template <typename Fn>
+static void streamEvent(const char* name, WiFiClient* only, Fn&& fill) {
+  JsonWriter& w = gStreamEvent;
+  w.reset();
+  w.put("event: ");
+  w.put(name);
+  w.put("\ndata: ");
+  w.beginObject();
+  fill(w);
+  w.endObject();
+  w.put("\n\n");
+  if (w.overflowed()) return;  // longer than the buffer: not sent
+  if (only) {
+    streamSendTo(*only, w.data(), w.size());
+    return;
+  }
+  for (auto& c : gStreamClients) streamSendTo(c, w.data(), w.size());
 }
 
-struct ZipEntryInfo {
-  String name;          // inside-zip name like "data/20251214.csv"
-  String sdPath;        // "/data/20251214.csv"
-  uint32_t size = 0;    // uncompressed size
-  uint32_t crc = 0;     // computed while streaming
-  uint32_t lho = 0;     // local header offset
-  uint16_t dosDate = 0;
-  uint16_t dosTime = 0;
-};
+static void streamNowEvent(WiFiClient* only) {
+  LiveSnapshot live = gLive.read();
+  gStreamWindow = live.stats.windows;
+  streamEvent("now", only, [&](JsonWriter& w) { writeLiveFields(w, live, epochNow()); });
+}
 
-static std::vector<ZipEntryInfo> buildLastNDaysList(int days) {
-  std::vector<ZipEntryInfo> out;
-  out.reserve(days);
+static void streamStatusEvent(WiFiClient* only) {
+  streamEvent("status", only, [](JsonWriter& w) { writeStatusFields(w); });
+}
 
-  time_t nowE = epochNow();
-  time_t todayMidnight = localMidnight(nowE);
+// Called from the commit path in loop(), never from the acquisition task
+static void streamBucketEvent(const BucketSample& b) {
+  if (streamClientCount() == 0) return;
+  streamEvent("bucket", nullptr, [&](JsonWriter& w) {
+    w.key("cursor"); w.u32((uint32_t)b.startEpoch);  // just pushed: the ring's newest
+    w.key("bucket");
+    if (compactBucketHasData(b)) writeBucketJson(w, b);
+    else w.null();
+  });
+}
 
-  for (int i = 0; i < days; i++) {
-    time_t dayMidnight = subtractDaysLocalMidnight(todayMidnight, i);
-    String ymd = ymdString(dayMidnight);
-    String sdPath = String("/data/") + ymd + ".csv";
+static void pumpLiveStream(uint32_t msNow) {
+  if (streamClientCount() == 0) return;
+  if (gLive.read().stats.windows != gStreamWindow) streamNowEvent(nullptr);
+  if (msNow - gStreamStatusMs >= StreamConfig::STATUS_INTERVAL_MS) {
+    gStreamStatusMs = msNow;
+    streamStatusEvent(nullptr);
+  }
+}
 
-    if (gSdOk && SD.exists(sdPath.c_str())) {
-      File f = SD.open(sdPath.c_str(), FILE_READ);
-      if (f) {
-        ZipEntryInfo e;
-        e.sdPath = sdPath;
-        e.name = String("data/") + ymd + ".csv";
-        e.size = (uint32_t)f.size();
-        dosDateTime(dayMidnight, e.dosDate, e.dosTime);
-        f.close();
-        out.push_back(e);
-      }
-    }
+void handleApiStream() {
+  WiFiClient* slot = nullptr;
+  streamClientCount();  // frees slots of closed tabs
+  for (auto& c : gStreamClients) {
+    if (!c.connected()) { slot = &c; break; }
+  }
+  if (!slot) {
+    server.send(503, "application/json", "{\"ok\":false,\"error\":\"too_many_streams\"}");
+    return;
   }
 
-  // Oldest -> newest
-  std::reverse(out.begin(), out.end());
-  return out;
+  // The headers go out by hand: WebServer would close the socket after a send()
+  WiFiClient c = server.detachClient();
+  c.setNoDelay(true);
+  c.print("HTTP/1.1 200 OK\r\n"
+          "Content-Type: text/event-stream\r\n"
+          "Cache-Control: no-cache\r\n"
+          "Connection: keep-alive\r\n\r\n");
+  c.printf("retry: %lu\n\n", (unsigned long)StreamConfig::RETRY_MS);
+  *slot = c;
+  streamNowEvent(slot);
+  streamStatusEvent(slot);
 }
 
-void handleDownloadZip() {
-  if (!gSdOk) {
-    server.send(503, "text/plain", "SD not available");
-    return;
+// The RAM ring from `cutoff` on, then the in-progress bucket if not yet
+// finalized, as they were at the request. Resumable across loop() passes: the
+// walk keeps the next epoch, and buckets finalized meanwhile are left out.
+struct RecentBuckets {
+  time_t cutoff = 0;
+  time_t last = 0;          // newest finalized bucket at the request
+  BucketSample cur;         // in-progress bucket at the request (startEpoch 0: none)
+  time_t next = 0;
+  bool curDone = false;
+
+  explicit RecentBuckets(time_t from = 0) : cutoff(from) {
+    last = gBucketRing.newestEpoch();
+    cur = currentBucketSnapshot();
+    if (!timeIsValid(cur.startEpoch) || cur.startEpoch < cutoff || cur.startEpoch == last) cur.startEpoch = 0;
+    rewind();
   }
 
-  int days = server.arg("days").toInt();
-  if (days <= 0) days = 7;
-  // If LogConfig::RETENTION_DAYS is 0 (never delete), allow any number of days
-  if (LogConfig::RETENTION_DAYS > 0 && days > LogConfig::RETENTION_DAYS) days = LogConfig::RETENTION_DAYS;
-  if (days < 1) days = 1;
+  void rewind() {
+    next = cutoff;
+    curDone = false;
+  }
 
-  auto entries = buildLastNDaysList(days);
-  if (entries.empty()) {
-    server.send(404, "text/plain", "No daily CSV files found");
-    return;
+  // Calls fn(const BucketSample&) for the next buckets until it returns false;
+  // returns false once every bucket was visited
+  template <typename Fn>
+  bool step(Fn&& fn) {
+    bool stopped = false;
+    gBucketRing.forEachFrom(next, [&](const BucketSample& b) {
+      if (b.startEpoch > last) return false;
+      next = b.startEpoch + 1;
+      if (!timeIsValid(b.startEpoch)) return true;
+      stopped = !fn(b);
+      return !stopped;
+    });
+    if (stopped) return true;
+    next = last + 1;
+    if (!curDone) {
+      curDone = true;
+      if (cur.startEpoch != 0) fn(cur);
+    }
+    return false;
   }
+};
 
-  crc32_init();
+static bool clientHasEtag(const char* etag) {
+  String inm = server.header("If-None-Match");
+  return inm.length() > 0 && strstr(inm.c_str(), etag) != nullptr;
+}
 
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.sendHeader("Content-Type", "application/zip");
-  server.sendHeader("Content-Disposition", "attachment; filename=\"last_" + String(days) + "_days.zip\"");
-  server.sendHeader("Cache-Control", "no-store");
-  server.send(200);
+// Sends the ETag; answers 304 and returns true if the client already has it.
+static bool respondNotModified(const char* etag) {
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (!clientHasEtag(etag)) return false;
+  server.send(304);
+  return true;
+}
 
-  uint32_t offset = 0;
+// /api/buckets and /api/buckets_compact bodies
+struct BucketsJsonBody {
+  JsonBlock out;
+  RecentBuckets src;
+  time_t nowE = 0;
+  bool compact = false;
+  bool started = false;
+
+  BucketsJsonBody(time_t cutoff, time_t now, bool compactRows) : src(cutoff), nowE(now), compact(compactRows) {}
+
+  bool fill(Download& d) {
+    JsonWriter& w = out.w;
+    if (!started) {
+      started = true;
+      d.head(200, "application/json", CONTENT_LENGTH_UNKNOWN, "");
+      w.beginObject();
+      w.key("now_epoch"); w.u32((uint32_t)nowE);
+      w.key("bucket_seconds"); w.i32(LogConfig::BUCKET_SECONDS);
+      // Newest finalized bucket; pass it back as since= on the next poll
+      if (compact) { w.key("cursor"); w.u32(timeIsValid(src.last) ? (uint32_t)src.last : 0); }
+      w.key("buckets"); w.beginArray();
+    }
+    bool more = src.step([&](const BucketSample& b) {
+      if (compact) writeBucketJsonCompact(w, b);
+      else writeBucketJson(w, b);
+      return !out.full();
+    });
+    if (!more) {
+      w.endArray();
+      w.endObject();
+    }
+    out.sendTo(d);
+    return more;
+  }
+};
 
-  const size_t BUF_SZ = 512;
-  uint8_t buf[BUF_SZ];
+void handleApiBuckets() {
+  time_t nowE = epochNow();
+  if (!downloadAdmit(false)) return;
+  // Finalized buckets from today only
+  downloadStart(new BucketsJsonBody(localMidnight(nowE), nowE, false), false);
+}
 
-  // Helper to write data via sendContent
-  auto sendBytes = [&](const uint8_t* data, size_t len) {
-    server.sendContent((const char*)data, len);
-    offset += len;
-  };
+// Oldest bucket epoch to send: the last 24h, or only buckets after ?since=
+static time_t bucketsCutoff(time_t nowE) {
+  time_t cutoff = nowE - 86400;
+  if (server.hasArg("since")) {
+    time_t since = (time_t)server.arg("since").toInt();
+    if (since >= cutoff) cutoff = since + 1;
+  }
+  return cutoff;
+}
 
-  auto sendU16 = [&](uint16_t v) {
-    uint8_t b[2] = {(uint8_t)(v & 0xFF), (uint8_t)((v >> 8) & 0xFF)};
-    sendBytes(b, 2);
-  };
+void handleApiBucketsCompact() {
+  // Compact format for internal UI use - saves bandwidth
+  time_t nowE = epochNow();
+  if (!downloadAdmit(false)) return;
+  // Last 24 hours; since=<epoch>: only buckets newer than the client's cursor
+  downloadStart(new BucketsJsonBody(bucketsCutoff(nowE), nowE, true), false);
+}
 
-  auto sendU32 = [&](uint32_t v) {
-    uint8_t b[4] = {
-      (uint8_t)(v & 0xFF), (uint8_t)((v >> 8) & 0xFF),
-      (uint8_t)((v >> 16) & 0xFF), (uint8_t)((v >> 24) & 0xFF)
-    };
-    sendBytes(b, 4);
-  };
+// /api/buckets.bin: the compact bucket list as columns (little-endian).
+//   BucketsBinHeader
+//   BucketsBinColumn[valueColumns]      scale/offset: value = q / scale + offset
+//   epochs    LEB128 varints: first epoch, then deltas; padded to 4 bytes
+//   samples   uint16[count]
+//   values    int16[count] per value column; BUCKETS_BIN_NAN = no data
+struct __attribute__((packed)) BucketsBinHeader {
+  char     magic[4];       // "WSBB"
+  uint16_t version;
+  uint16_t valueColumns;
+  uint32_t count;
+  uint32_t nowEpoch;
+  uint32_t cursor;         // as in /api/buckets_compact
+  uint16_t bucketSeconds;
+  uint16_t epochBytes;     // epoch block size incl. padding
+};
 
-  // Local headers + data + data descriptors
-  for (auto &e : entries) {
-    File f = SD.open(e.sdPath.c_str(), FILE_READ);
-    if (!f) continue;
+struct __attribute__((packed)) BucketsBinColumn {
+  int16_t scale;
+  int16_t offset;
+};
 
-    e.lho = offset;
+static_assert(sizeof(BucketsBinHeader) == 24, "BucketsBinHeader layout changed");
 
-    // Local file header
-    sendU32(0x04034b50);                      // signature
-    sendU16(20);                              // version
-    sendU16(0x0008);                          // flags: data descriptor present
-    sendU16(0);                               // method: STORE
-    sendU16(e.dosTime);
-    sendU16(e.dosDate);
-    sendU32(0);                               // crc
-    sendU32(0);                               // comp size
-    sendU32(0);                               // uncomp size
-    sendU16((uint16_t)e.name.length());       // name len
-    sendU16(0);                               // extra len
+static constexpr uint16_t BUCKETS_BIN_VERSION = 1;
+static constexpr int16_t BUCKETS_BIN_NAN = ROLLUP_NAN;
 
-    sendBytes((const uint8_t*)e.name.c_str(), e.name.length());
+// One column per channel, in the compact arrays' order (minus epoch and
+// samples), with the channel's own fixed point: the same int16 the RAM ring holds
+static constexpr int BUCKETS_BIN_VALUE_COLUMNS = CH_COUNT;
 
-    // Data stream + CRC32
-    uint32_t crc = 0xFFFFFFFFUL;
-    uint32_t sent = 0;
-    while (f.available()) {
-      int n = f.read(buf, BUF_SZ);
-      if (n <= 0) break;
-      sendBytes(buf, n);
-      crc = crc32_update(crc, buf, (size_t)n);
-      sent += (uint32_t)n;
-      yield();
-    }
-    f.close();
+static constexpr BucketsBinColumn bucketsBinColumn(int ch) {
+  return BucketsBinColumn{(int16_t)CHANNELS[ch].qScale, (int16_t)CHANNELS[ch].qOffset};
+}
 
-    e.crc = crc ^ 0xFFFFFFFFUL;
-    e.size = sent;
+static constexpr bool bucketsBinScalesExact() {
+  for (int c = 0; c < CH_COUNT; c++) {
+    if ((float)bucketsBinColumn(c).scale != CHANNELS[c].qScale) return false;
+    if ((float)bucketsBinColumn(c).offset != CHANNELS[c].qOffset) return false;
+  }
+  return true;
+}
+static_assert(bucketsBinScalesExact(), "/api/buckets.bin sends qScale / qOffset as int16: keep them whole numbers");
 
-    // Data descriptor
-    sendU32(0x08074b50);
-    sendU32(e.crc);
-    sendU32(e.size);
-    sendU32(e.size);
-
-    yield();
-  }
-
-  // Central directory
-  uint32_t cdStart = offset;
-
-  for (auto &e : entries) {
-    sendU32(0x02014b50);                    // signature
-    sendU16(20);                            // version made by
-    sendU16(20);                            // version needed
-    sendU16(0x0008);                        // flags
-    sendU16(0);                             // method
-    sendU16(e.dosTime);
-    sendU16(e.dosDate);
-    sendU32(e.crc);
-    sendU32(e.size);
-    sendU32(e.size);
-    sendU16((uint16_t)e.name.length());     // name len
-    sendU16(0);                             // extra len
-    sendU16(0);                             // comment len
-    sendU16(0);                             // disk start
-    sendU16(0);                             // internal attrs
-    sendU32(0);                             // external attrs
-    sendU32(e.lho);                         // local header offset
-
-    sendBytes((const uint8_t*)e.name.c_str(), e.name.length());
-    yield();
-  }
-
-  uint32_t cdSize = offset - cdStart;
-
-  // End of central directory
-  sendU32(0x06054b50);
-  sendU16(0);
-  sendU16(0);
-  sendU16((uint16_t)entries.size());
-  sendU16((uint16_t)entries.size());
-  sendU32(cdSize);
-  sendU32(cdStart);
-  sendU16(0);
-
-  server.sendContent("");  // End chunked transfer
+static float bucketsBinValue(const BucketSample& b, int col) {
+  return b.*kBucketChannel[col];
 }
 
-// ------------------- WEB UI + API -------------------
+static size_t varintSize(uint32_t v) {
+  size_t n = 1;
+  while (v >= 0x80) { v >>= 7; n++; }
+  return n;
+}
 
-void handleRoot() {
-  if (gSdOk && SD.exists("/web/index.html")) {
-    File f = SD.open("/web/index.html", FILE_READ);
-    if (f) {
-      server.streamFile(f, "text/html");
-      f.close();
-      return;
+// /api/buckets.bin body: the header, then one pass over the buckets per column
+struct BucketsBinBody {
+  enum Phase : int { HEAD = -2, EPOCHS = -1, SAMPLES = 0 };  // then value column c at SAMPLES + 1 + c
+
+  RecentBuckets src;
+  BucketsBinHeader h;
+  int phase = HEAD;
+  uint32_t prev = 0;        // EPOCHS: last epoch sent
+  size_t epochPad = 0;
+
+  explicit BucketsBinBody(time_t cutoff) : src(cutoff) {}
+
+  bool fill(Download& d) {
+    if (phase == HEAD) {
+      d.head(200, "application/octet-stream", CONTENT_LENGTH_UNKNOWN, "");
+      d.put(&h, sizeof(h));
+      for (int col = 0; col < BUCKETS_BIN_VALUE_COLUMNS; col++) {
+        BucketsBinColumn c = bucketsBinColumn(col);
+        d.put(&c, sizeof(c));
+      }
+      phase = EPOCHS;
+    }
+    while (phase <= SAMPLES + BUCKETS_BIN_VALUE_COLUMNS) {
+      bool more = src.step([&](const BucketSample& b) {
+        if (compactBucketHasData(b)) putColumn(d, b);
+        return !d.full();
+      });
+      if (more) return true;
+      if (phase == EPOCHS) {
+        for (size_t i = 0; i < epochPad; i++) d.put("", 1);
+      }
+      phase++;
+      src.rewind();
     }
+    return false;
   }
 
-  const char* fallbackHtml = R"HTML(
-<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="utf-8"/>
-  <meta name="viewport" content="width=device-width, initial-scale=1"/>
-  <title>Weather Station - Setup Required</title>
-  <style>
-    body { font-family: system-ui, sans-serif; margin: 20px; max-width: 600px; }
-    h1 { color: #333; }
-    a { color: #0275d8; text-decoration: none; }
-    a:hover { text-decoration: underline; }
-    ul { line-height: 1.8; }
-  </style>
-</head>
-<body>
-  <h1>Weather Station - Setup Required</h1>
-  <p>Web interface files not found on SD card.</p>
-  <ul>
-    <li><a href="/upload">Upload UI files (index.html, app.js)</a></li>
-    <li><a href="/api/now">View current sensor data (JSON)</a></li>
-    <li><a href="/api/buckets">View bucket data (JSON)</a></li>
-    <li><a href="/api/days">View daily summaries (JSON)</a></li>
-    <li><a href="/api/config">View configuration (JSON)</a></li>
-    <li><a href="/api_help">API documentation</a></li>
-  </ul>
-</body>
-</html>
-)HTML";
+ private:
+  void putColumn(Download& d, const BucketSample& b) {
+    if (phase == EPOCHS) {
+      uint8_t v[5];
+      size_t n = 0;
+      uint32_t delta = (uint32_t)b.startEpoch - prev;
+      prev = (uint32_t)b.startEpoch;
+      while (delta >= 0x80) { v[n++] = (uint8_t)((delta & 0x7F) | 0x80); delta >>= 7; }
+      v[n++] = (uint8_t)delta;
+      d.put(v, n);
+    } else if (phase == SAMPLES) {
+      uint16_t n = (b.samples > 0xFFFF) ? 0xFFFF : (uint16_t)b.samples;
+      d.put(&n, sizeof(n));
+    } else {
+      int col = phase - SAMPLES - 1;
+      int16_t q = rollupQ(bucketsBinValue(b, col), CHANNELS[col].qScale, CHANNELS[col].qOffset);
+      d.put(&q, sizeof(q));
+    }
+  }
+};
 
-  server.send(200, "text/html", fallbackHtml);
+void handleApiBucketsBin() {
+  time_t nowE = epochNow();
+  if (!downloadAdmit(false)) return;
+  // One snapshot, so every column pass sees the same buckets
+  BucketsBinBody* body = new BucketsBinBody(bucketsCutoff(nowE));
+
+  uint32_t count = 0;
+  size_t epochBytes = 0;
+  uint32_t prev = 0;
+  RecentBuckets walk = body->src;
+  walk.step([&](const BucketSample& b) {
+    if (!compactBucketHasData(b)) return true;
+    epochBytes += varintSize((uint32_t)b.startEpoch - prev);
+    prev = (uint32_t)b.startEpoch;
+    count++;
+    return true;
+  });
+  body->epochPad = (4 - epochBytes % 4) % 4;
+
+  BucketsBinHeader& h = body->h;
+  memcpy(h.magic, "WSBB", 4);
+  h.version = BUCKETS_BIN_VERSION;
+  h.valueColumns = BUCKETS_BIN_VALUE_COLUMNS;
+  h.count = count;
+  h.nowEpoch = (uint32_t)nowE;
+  h.cursor = timeIsValid(body->src.last) ? (uint32_t)body->src.last : 0;
+  h.bucketSeconds = LogConfig::BUCKET_SECONDS;
+  h.epochBytes = (uint16_t)(epochBytes + body->epochPad);
+  downloadStart(body, false);
 }
 
-void handleApiHelp() {
-  server.send_P(200, "text/html", API_HELP_HTML);
+static void writeSeriesRow(JsonWriter& w, time_t start, const DayAgg& a) {
+  w.beginArray();
+  w.u32((uint32_t)start);
+  for (const DayStat& s : kDayStats) w.num(a.stat(s.ch, s.stat), CHANNELS[s.ch].decimals);
+  w.endArray();
 }
 
-void handleRootJs() {
-  if (gSdOk && SD.exists("/web/app.js")) {
-    File f = SD.open("/web/app.js", FILE_READ);
-    if (f) {
-      server.streamFile(f, "application/javascript");
-      f.close();
-      return;
+// /api/series body. Each bin keeps the min/max of everything folded into it, so
+// extremes survive downsampling; averages are weighted by raw bucket count.
+// A pass folds source points (from `next` on) until a block of rows is written.
+struct SeriesBody {
+  JsonBlock out;
+  time_t fromE = 0, toE = 0, originE = 0;
+  int src = 0;              // 0: the raw bucket ring, else rollup tier src - 1
+  uint32_t srcSec = 0, binSec = 0;
+  time_t next = 0;          // first source point not folded yet
+  BucketSample cur;         // raw source: the in-progress bucket at the request
+  DayAgg bin;
+  time_t binStart = 0;
+  bool binUsed = false;
+  bool started = false;
+
+  bool fill(Download& d) {
+    JsonWriter& w = out.w;
+    if (!started) {
+      started = true;
+      d.head(200, "application/json", CONTENT_LENGTH_UNKNOWN, "");
+      w.beginObject();
+      w.key("from"); w.u32((uint32_t)fromE);
+      w.key("to"); w.u32((uint32_t)toE);
+      writeLoadingField(w);
+      w.key("source_seconds"); w.u32(srcSec);
+      w.key("bin_seconds"); w.u32(binSec);
+      w.key("fields"); w.beginArray();
+      w.str("epoch");
+      for (const DayStat& s : kDayStats) {
+        char key[16];
+        w.str(dayStatKey(s, key, sizeof(key)));
+      }
+      w.endArray();
+      w.key("points"); w.beginArray();
     }
+    bool more = src <= 0 ? foldBuckets() : foldRollups(gRollupTiers[src - 1]);
+    if (!more) {
+      flushBin();
+      w.endArray();
+      w.endObject();
+    }
+    out.sendTo(d);
+    return more;
   }
 
-  server.send(200, "application/javascript", "console.log('app.js not found on SD card');");
-}
+ private:
+  void flushBin() {
+    if (binUsed) writeSeriesRow(out.w, binStart, bin);
+    bin = DayAgg();
+    binUsed = false;
+  }
 
-void handleApiClearData() {
-  String pw = server.arg("pw");
-  bool rateLimited = false;
-  if (!verifyPassword(pw, rateLimited)) {
-    server.send(rateLimited ? 429 : 401, "application/json",
-                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
-                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
-    return;
+  DayAgg* binFor(time_t epoch) {
+    if (epoch < originE || epoch >= toE) return nullptr;
+    time_t start = originE + (time_t)(((uint32_t)(epoch - originE) / binSec) * binSec);
+    if (start != binStart) {
+      flushBin();
+      binStart = start;
+    }
+    binUsed = true;
+    return &bin;
   }
-  if (!SDConfig::ENABLE || !gSdOk) {
-    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
-    return;
+
+  // True while points are left
+  bool foldBuckets() {
+    bool stopped = false;
+    gBucketRing.forEachFrom(next, [&](const BucketSample& b) {
+      if (b.startEpoch >= toE) return false;
+      next = b.startEpoch + 1;
+      if (DayAgg* a = binFor(b.startEpoch)) accumulateDayAgg(*a, b);
+      stopped = out.full();
+      return !stopped;
+    });
+    if (stopped) return true;
+    // Folded already if it was finalized meanwhile
+    if (timeIsValid(cur.startEpoch) && cur.startEpoch >= next) {
+      if (DayAgg* a = binFor(cur.startEpoch)) accumulateDayAgg(*a, cur);
+    }
+    return false;
   }
-  bool ok = deleteDirFiles("/data");
-  invalidateFilesCache();
-  String out = String("{\"ok\":") + (ok ? "true" : "false") + "}";
-  server.send(ok ? 200 : 500, "application/json", out);
-}
 
-void handleApiDelete() {
-  String pw = server.arg("pw");
-  bool rateLimited = false;
-  if (!verifyPassword(pw, rateLimited)) {
-    server.send(rateLimited ? 429 : 401, "application/json",
-                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
-                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
-    return;
+  bool foldRollups(const RollupTier& t) {
+    for (int i = 0; i < t.count; i++) {
+      const RollupPoint& p = t.ring[(t.write - t.count + i + t.capacity) % t.capacity];
+      if ((time_t)p.startEpoch < next) continue;
+      if ((time_t)p.startEpoch >= toE) break;
+      next = (time_t)p.startEpoch + 1;
+      if (DayAgg* a = binFor((time_t)p.startEpoch)) mergeRollupPoint(*a, p);
+      if (out.full()) return true;
+    }
+    if (t.openBuckets > 0 && t.openStart >= next) {
+      if (DayAgg* a = binFor(t.openStart)) mergeDayAgg(*a, t.open);
+    }
+    return false;
   }
-  if (!gSdOk) {
-    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
+};
+
+void handleApiSeries() {
+  time_t nowE = epochNow();
+  time_t toE = server.hasArg("to") ? (time_t)server.arg("to").toInt() : nowE;
+  time_t fromE = server.hasArg("from") ? (time_t)server.arg("from").toInt() : toE - 86400;
+  long points = server.hasArg("points") ? server.arg("points").toInt() : UIConfig::MAX_PLOT_POINTS;
+  if (!timeIsValid(fromE) || !timeIsValid(toE) || toE <= fromE) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"bad_range\"}");
     return;
   }
-  String filename = server.arg("filename");
-  if (!isAllowedFilename(filename)) {
-    server.send(400, "application/json", "{\"ok\":false,\"error\":\"invalid_filename\"}");
-    return;
+  if (points < 1) points = 1;
+  if (points > RollupConfig::SERIES_MAX_POINTS) points = RollupConfig::SERIES_MAX_POINTS;
+
+  // Source 0 is the raw bucket ring, then the rollup tiers from fine to coarse.
+  // Use the coarsest source that covers `from` and is still at least as fine
+  // as the requested bin width; otherwise the finest source that covers it.
+  uint32_t span = (uint32_t)(toE - fromE);
+  uint32_t wantSec = (span + (uint32_t)points - 1) / (uint32_t)points;
+
+  time_t rawOldest = gBucketRing.oldestEpoch();
+  int src = -1;
+  bool srcCovers = false;
+  time_t srcOldest = 0;
+  for (int i = 0; i <= ROLLUP_TIER_COUNT; i++) {
+    time_t oldest = (i == 0) ? rawOldest : rollupOldest(gRollupTiers[i - 1]);
+    uint32_t sec = (i == 0) ? (uint32_t)LogConfig::BUCKET_SECONDS : gRollupTiers[i - 1].seconds;
+    if (oldest == 0) continue;
+    if (oldest < fromE + (time_t)sec) {  // holds the point that contains `from`
+      if (!srcCovers || sec <= wantSec) { src = i; srcCovers = true; srcOldest = oldest; }
+    } else if (!srcCovers && (src < 0 || oldest < srcOldest)) {
+      src = i;  // nothing covers `from` (yet): prefer the longest history
+      srcOldest = oldest;
+    }
   }
-  String path = "/data/" + filename;
-  if (!SD.exists(path.c_str())) {
-    server.send(404, "application/json", "{\"ok\":false,\"error\":\"not_found\"}");
-    return;
+  uint32_t srcSec = (src <= 0) ? (uint32_t)LogConfig::BUCKET_SECONDS : gRollupTiers[src - 1].seconds;
+  uint32_t binSec = ((wantSec + srcSec - 1) / srcSec) * srcSec;
+  if (binSec < srcSec) binSec = srcSec;
+  if (!downloadAdmit(false)) return;
+
+  SeriesBody* body = new SeriesBody;
+  body->fromE = fromE;
+  body->toE = toE;
+  body->src = src;
+  body->srcSec = srcSec;
+  body->binSec = binSec;
+  // Bins start on the source grid so no source point straddles two bins
+  body->originE = rollupSlotStart(fromE, srcSec);
+  body->next = body->originE;
+  body->cur = currentBucketSnapshot();
+  downloadStart(body, false);
+}
+
+static void writeDaySummaryJson(JsonWriter& w, const DaySummary& d) {
+  w.beginObject();
+  w.key("dayStartEpoch"); w.u32((uint32_t)d.dayStartEpoch);
+  w.key("dayStartLocal"); w.localTime(d.dayStartEpoch);
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    char key[16];
+    w.key(dayStatKey(kDayStats[i], key, sizeof(key)));
+    w.num(d.*kDaySummaryFields[i], CHANNELS[kDayStats[i].ch].decimals);
   }
-  bool ok = SD.remove(path.c_str());
-  if (!ok) {
-    server.send(500, "application/json", "{\"ok\":false,\"error\":\"delete_failed\"}");
-    return;
+  for (int i = 0; i < HIST_COUNT; i++) {
+    const ChannelDef& ch = CHANNELS[HISTOGRAMS[i].channel];
+    for (uint8_t pct : HistConfig::PERCENTILES) {
+      char key[20];
+      snprintf(key, sizeof(key), "p%u%s", (unsigned)pct, ch.name);
+      w.key(key);
+      w.num(histQuantile(d.hist[i], HISTOGRAMS[i], pct / 100.0f), ch.decimals);
+    }
   }
-  invalidateFilesCache();
-  server.send(200, "application/json", "{\"ok\":true}");
+  w.endObject();
 }
 
-void handleApiReboot() {
-  String pw = server.arg("pw");
-  bool rateLimited = false;
-  if (!verifyPassword(pw, rateLimited)) {
-    server.send(rateLimited ? 429 : 401, "application/json",
-                rateLimited ? "{\"ok\":false,\"error\":\"rate_limited\"}"
-                            : "{\"ok\":false,\"error\":\"unauthorized\"}");
+// /api/days body: today, then the finished days newest first. A pass resumes
+// below the last day sent, so a day rolling over mid-response moves nothing.
+struct DaysBody {
+  JsonBlock out;
+  String headers;
+  time_t before = 0;        // next day sent is the newest one older than this (0: any)
+  bool started = false;
+
+  bool fill(Download& d) {
+    JsonWriter& w = out.w;
+    if (!started) {
+      started = true;
+      d.head(200, "application/json", CONTENT_LENGTH_UNKNOWN, headers);
+      w.beginObject();
+      writeLoadingField(w);
+      w.key("days"); w.beginArray();
+      DaySummary curDay{};
+      if (buildCurrentDaySummary(curDay)) writeDaySummaryJson(w, curDay);
+    }
+    bool more = true;
+    while (more && !out.full()) {
+      const DaySummary* next = nullptr;
+      int startIdx = (gDayWrite - (int)gDaysCount + LogConfig::DAYS_HISTORY) % LogConfig::DAYS_HISTORY;
+      for (uint32_t i = 0; i < gDaysCount; i++) {
+        const DaySummary& day = gDays[(startIdx + i) % LogConfig::DAYS_HISTORY];
+        if (!timeIsValid(day.dayStartEpoch) || (before != 0 && day.dayStartEpoch >= before)) continue;
+        if (!next || day.dayStartEpoch > next->dayStartEpoch) next = &day;
+      }
+      if (next) {
+        writeDaySummaryJson(w, *next);
+        before = next->dayStartEpoch;
+      } else {
+        more = false;
+      }
+    }
+    if (!more) {
+      w.endArray();
+      w.endObject();
+    }
+    out.sendTo(d);
+    return more;
+  }
+};
+
+void handleApiDays() {
+  // Today's row changes with every finalized bucket
+  char etag[40];
+  snprintf(etag, sizeof(etag), "\"d%08lx-%lx-%lx\"",
+           (unsigned long)gBootId, (unsigned long)gDayGen, (unsigned long)gBucketGen);
+  if (clientHasEtag(etag)) {
+    respondNotModified(etag);
     return;
   }
-  server.send(200, "application/json", "{\"ok\":true}");
-  delay(100);
-  ESP.restart();
+  if (!downloadAdmit(false)) return;
+
+  DaysBody* body = new DaysBody;
+  body->headers = String("ETag: ") + etag + "\r\nCache-Control: no-cache\r\n";
+  downloadStart(body, false);
 }
 
-// ------------------- AQI CALCULATION -------------------
-#if AQI_STANDARD == 0
-// EPA (US) AQI Standard
-// Calculate EPA AQI for PM2.5 (24-hour average, but we use current reading)
-int calculateAQI_PM25(float pm25) {
-  if (!isfinite(pm25) || pm25 < 0) return -1;
+// Distribution of bucket values: whole local days from the day summaries
+// (days=N, today first) or the last hours=N from the RAM bucket ring.
+void handleApiHistogram() {
+  int only = -1;
+  if (server.hasArg("ch")) {
+    String ch = server.arg("ch");
+    for (int i = 0; i < HIST_COUNT; i++) {
+      const ChannelDef& c = CHANNELS[HISTOGRAMS[i].channel];
+      if (ch.equalsIgnoreCase(c.name) || ch.equalsIgnoreCase(c.apiName)) { only = i; break; }
+    }
+    if (only < 0) {
+      server.send(400, "application/json", "{\"ok\":false,\"error\":\"unknown_channel\"}");
+      return;
+    }
+  }
+  bool byHours = server.hasArg("hours");
+  long n = server.arg(byHours ? "hours" : "days").toInt();
+  if (n < 1) n = 1;
+  if (byHours && n > LogConfig::RAM_HISTORY_HOURS) n = LogConfig::RAM_HISTORY_HOURS;
+  if (!byHours && n > LogConfig::DAYS_HISTORY + 1) n = LogConfig::DAYS_HISTORY + 1;
+  bool hasAbove = server.hasArg("above");
+  float above = hasAbove ? server.arg("above").toFloat() : 0.0f;
+
+  DayAgg agg;  // only .hist is used
+  time_t fromE = 0;
+  if (byHours) {
+    fromE = epochNow() - (time_t)n * 3600;
+    gBucketRing.forEach([&](const BucketSample& b) {
+      if (timeIsValid(b.startEpoch) && b.startEpoch >= fromE) accumulateDayAgg(agg, b);
+    });
+  } else {
+    fromE = gTodayMidnightEpoch;
+    mergeDayAgg(agg, gToday);
+    int startIdx = (gDayWrite - (int)gDaysCount + LogConfig::DAYS_HISTORY) % LogConfig::DAYS_HISTORY;
+    for (int i = (int)gDaysCount - 1, used = 1; i >= 0 && used < n; i--, used++) {
+      const DaySummary& d = gDays[(startIdx + i) % LogConfig::DAYS_HISTORY];
+      if (!timeIsValid(d.dayStartEpoch)) continue;
+      for (int h = 0; h < HIST_COUNT; h++) histMerge(agg.hist[h], d.hist[h]);
+      fromE = d.dayStartEpoch;
+    }
+  }
 
-  // EPA AQI breakpoints for PM2.5 (μg/m³)
-  if (pm25 <= 12.0) return map((int)(pm25 * 10), 0, 120, 0, 50);
-  else if (pm25 <= 35.4) return map((int)(pm25 * 10), 121, 354, 51, 100);
-  else if (pm25 <= 55.4) return map((int)(pm25 * 10), 355, 554, 101, 150);
-  else if (pm25 <= 150.4) return map((int)(pm25 * 10), 555, 1504, 151, 200);
-  else if (pm25 <= 250.4) return map((int)(pm25 * 10), 1505, 2504, 201, 300);
-  else if (pm25 <= 500.4) return map((int)(pm25 * 10), 2505, 5004, 301, 500);
-  else return 500;
+  JsonWriter w;
+  w.begin();
+  w.beginObject();
+  w.key(byHours ? "hours" : "days"); w.u32((uint32_t)n);
+  w.key("from"); w.u32((uint32_t)fromE);
+  w.key("bucket_seconds"); w.u32(LogConfig::BUCKET_SECONDS);
+  w.key("histograms"); w.beginArray();
+  for (int i = 0; i < HIST_COUNT; i++) {
+    if (only >= 0 && i != only) continue;
+    const HistogramDef& def = HISTOGRAMS[i];
+    const ChannelDef& ch = CHANNELS[def.channel];
+    const ValueHistogram& h = agg.hist[i];
+    uint32_t total = histTotal(h);
+    w.beginObject();
+    w.key("channel"); w.str(ch.apiName);
+    w.key("unit"); w.str(ch.unit);
+    w.key("edges"); w.beginArray();
+    for (int e = 0; e < def.edgeCount; e++) w.num(def.edges[e], 1);
+    w.endArray();
+    w.key("counts"); w.beginArray();
+    for (int b = 0; b <= def.edgeCount; b++) w.u32(h.bins[b]);
+    w.endArray();
+    w.key("count"); w.u32(total);
+    w.key("min"); w.num(total ? h.lo : NAN, ch.decimals);
+    w.key("max"); w.num(total ? h.hi : NAN, ch.decimals);
+    for (uint8_t pct : HistConfig::PERCENTILES) {
+      char key[8];
+      snprintf(key, sizeof(key), "p%u", (unsigned)pct);
+      w.key(key); w.num(histQuantile(h, def, pct / 100.0f), ch.decimals);
+    }
+    if (hasAbove) {
+      w.key("hours_above");
+      w.num(histCountAbove(h, def, above) * LogConfig::BUCKET_SECONDS / 3600.0f, 2);
+    }
+    w.endObject();
+  }
+  w.endArray();
+  w.endObject();
 }
 
-// Calculate EPA AQI for PM10 (24-hour average, but we use current reading)
-int calculateAQI_PM10(float pm10) {
-  if (!isfinite(pm10) || pm10 < 0) return -1;
+// ------------------- MQTT PUBLISHER -------------------
+// With MqttConfig::ENABLE the station pushes instead of waiting to be polled:
+//   <prefix>/now      the /api/now readings every LIVE_INTERVAL_MS (QoS 0, retained)
+//   <prefix>/buckets  finalized buckets as an /api/buckets array, up to BATCH_BUCKETS per message (QoS 1)
+//   <prefix>/status   "online" (retained); the broker publishes the last will "offline" when the link drops
+// Unsent buckets form one queue: a RAM batch in front of /mqtt.q on the SD card
+// (BktRecords behind a persistent read cursor). A bucket goes to RAM while the
+// broker is up and the card queue is empty, to the card otherwise; after an
+// outage the card queue is replayed oldest first, one batch per
+// REPLAY_INTERVAL_MS. One batch is in flight at a time and leaves the queue only
+// when its PUBACK arrives, so a batch may be delivered twice but never out of order.
+
+static const char* MQTT_QUEUE_PATH = "/mqtt.q";
+static constexpr uint16_t MQTT_QUEUE_VERSION = 1;
+static constexpr uint32_t MQTT_QUEUE_MAX = (uint32_t)MqttConfig::QUEUE_MAX_DAYS * 86400UL / LogConfig::BUCKET_SECONDS;
+
+struct __attribute__((packed)) MqttQueueHeader {
+  char     magic[4];      // "WSMQ"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t head;          // records before this index were acknowledged
+};
 
-  // EPA AQI breakpoints for PM10 (μg/m³)
-  if (pm10 <= 54) return map((int)pm10, 0, 54, 0, 50);
-  else if (pm10 <= 154) return map((int)pm10, 55, 154, 51, 100);
-  else if (pm10 <= 254) return map((int)pm10, 155, 254, 101, 150);
-  else if (pm10 <= 354) return map((int)pm10, 255, 354, 151, 200);
-  else if (pm10 <= 424) return map((int)pm10, 355, 424, 201, 300);
-  else if (pm10 <= 604) return map((int)pm10, 425, 604, 301, 500);
-  else return 500;
+struct MqttInflight {
+  uint16_t packetId;
+  uint8_t  count;         // 0 = nothing waiting for a PUBACK
+  bool     fromSd;
+  uint32_t sentMs;
+  time_t   newestEpoch;
+};
+
+static WiFiClient    gMqttNet;
+static mqtt::Session gMqtt(gMqttNet);
+static bool          gMqttOnline = false;     // CONNACK seen on the current socket
+static uint32_t      gMqttAttemptMs = 0;
+static uint32_t      gMqttRetryDelayMs = 0;
+static uint32_t      gMqttLiveMs = 0;
+static uint32_t      gMqttReplayMs = 0;
+static uint16_t      gMqttNextId = 1;
+static MqttInflight  gMqttInflight = {};
+static BktRecord     gMqttRam[MqttConfig::BATCH_BUCKETS];
+static int           gMqttRamCount = 0;
+static uint32_t      gMqttRamSinceMs = 0;
+static uint32_t      gMqttSdHead = 0;         // /mqtt.q records [head, count) are unsent
+static uint32_t      gMqttSdCount = 0;
+
+// Publisher statistics (reported by /api/now)
+static uint32_t gMqttConnects = 0;
+static uint32_t gMqttPublished = 0;     // buckets acknowledged by the broker
+static uint32_t gMqttDropped = 0;       // buckets that didn't fit the queue
+static uint32_t gMqttAckLastMs = 0;
+static uint32_t gMqttLagLastS = 0;      // age of the newest bucket in the last acknowledged batch
+
+static uint32_t mqttSdPending() { return gMqttSdCount - gMqttSdHead; }
+static uint32_t mqttQueued() { return (uint32_t)gMqttRamCount + mqttSdPending(); }
+
+static String mqttTopic(const char* leaf) {
+  return String(MqttConfig::TOPIC_PREFIX) + "/" + leaf;
 }
 
-// Get EPA AQI category string
-const char* getAQICategory(int aqi) {
-  if (aqi < 0) return "N/A";
-  else if (aqi <= 50) return "Good";
-  else if (aqi <= 100) return "Moderate";
-  else if (aqi <= 150) return "Unhealthy for Sensitive";
-  else if (aqi <= 200) return "Unhealthy";
-  else if (aqi <= 300) return "Very Unhealthy";
-  else return "Hazardous";
+// Picks up the queue left by the previous boot
+static void mqttQueueLoad() {
+  gMqttSdHead = gMqttSdCount = 0;
+  if (!gSdOk || !hal::storage().exists(MQTT_QUEUE_PATH)) return;
+  File f = hal::storage().open(MQTT_QUEUE_PATH, FILE_READ);
+  MqttQueueHeader h;
+  bool ok = f && f.read((uint8_t*)&h, sizeof(h)) == (int)sizeof(h) && memcmp(h.magic, "WSMQ", 4) == 0 &&
+            h.version == MQTT_QUEUE_VERSION && h.recordSize == sizeof(BktRecord);
+  // A record torn by a power cut is not counted; the next append overwrites it
+  uint32_t count = ok ? (uint32_t)((f.size() - sizeof(h)) / sizeof(BktRecord)) : 0;
+  if (f) f.close();
+  if (ok && h.head < count) {
+    gMqttSdHead = h.head;
+    gMqttSdCount = count;
+  } else {
+    hal::storage().remove(MQTT_QUEUE_PATH);
+  }
 }
 
-#elif AQI_STANDARD == 1
-// Australian AQI Standard
-// Calculate Australian AQI for PM2.5 (24-hour average, but we use current reading)
-int calculateAQI_PM25(float pm25) {
-  if (!isfinite(pm25) || pm25 < 0) return -1;
+static void mqttQueueWriteHeader(File& f) {
+  MqttQueueHeader h{};
+  memcpy(h.magic, "WSMQ", 4);
+  h.version = MQTT_QUEUE_VERSION;
+  h.recordSize = sizeof(BktRecord);
+  h.head = gMqttSdHead;
+  f.seek(0);
+  f.write((const uint8_t*)&h, sizeof(h));
+}
 
-  // Australian AQI breakpoints for PM2.5 (μg/m³)
-  // Scale: 0-200+ with categories: Very Good, Good, Fair, Poor, Very Poor, Hazardous
-  if (pm25 <= 25.0) return map((int)(pm25 * 10), 0, 250, 0, 33);
-  else if (pm25 <= 50.0) return map((int)(pm25 * 10), 251, 500, 34, 66);
-  else if (pm25 <= 100.0) return map((int)(pm25 * 10), 501, 1000, 67, 99);
-  else if (pm25 <= 150.0) return map((int)(pm25 * 10), 1001, 1500, 100, 149);
-  else if (pm25 <= 200.0) return map((int)(pm25 * 10), 1501, 2000, 150, 200);
-  else return 200; // Hazardous
+// Appends behind the last whole record; what doesn't fit under QUEUE_MAX_DAYS is dropped
+static bool mqttQueueAppend(const BktRecord* recs, int n) {
+  if (!gSdOk || n <= 0) return false;
+  uint32_t room = MQTT_QUEUE_MAX - mqttSdPending();
+  if ((uint32_t)n > room) {
+    gMqttDropped += (uint32_t)n - room;
+    n = (int)room;
+    if (n == 0) return true;
+  }
+  if (gMqttSdCount == 0) {
+    File f = hal::storage().open(MQTT_QUEUE_PATH, FILE_WRITE);
+    if (!f) return false;
+    mqttQueueWriteHeader(f);
+    f.close();
+  }
+  File f = hal::storage().open(MQTT_QUEUE_PATH, "r+");
+  if (!f) return false;
+  f.seek(sizeof(MqttQueueHeader) + (size_t)gMqttSdCount * sizeof(BktRecord));
+  size_t bytes = (size_t)n * sizeof(BktRecord);
+  bool ok = f.write((const uint8_t*)recs, bytes) == bytes;
+  f.close();
+  if (ok) gMqttSdCount += (uint32_t)n;
+  return ok;
 }
 
-// Calculate Australian AQI for PM10 (24-hour average, but we use current reading)
-int calculateAQI_PM10(float pm10) {
-  if (!isfinite(pm10) || pm10 < 0) return -1;
+static int mqttQueueRead(BktRecord* out, int max) {
+  uint32_t n = std::min(mqttSdPending(), (uint32_t)max);
+  File f = hal::storage().open(MQTT_QUEUE_PATH, FILE_READ);
+  if (!f || n == 0) return 0;
+  f.seek(sizeof(MqttQueueHeader) + (size_t)gMqttSdHead * sizeof(BktRecord));
+  int got = f.read((uint8_t*)out, n * sizeof(BktRecord));
+  f.close();
+  metricSdRead(got);
+  return got > 0 ? got / (int)sizeof(BktRecord) : 0;
+}
 
-  // Australian AQI breakpoints for PM10 (μg/m³)
-  if (pm10 <= 50.0) return map((int)(pm10 * 10), 0, 500, 0, 33);
-  else if (pm10 <= 100.0) return map((int)(pm10 * 10), 501, 1000, 34, 66);
-  else if (pm10 <= 200.0) return map((int)(pm10 * 10), 1001, 2000, 67, 99);
-  else if (pm10 <= 300.0) return map((int)(pm10 * 10), 2001, 3000, 100, 149);
-  else if (pm10 <= 400.0) return map((int)(pm10 * 10), 3001, 4000, 150, 200);
-  else return 200; // Hazardous
+// Moves the read cursor past acknowledged records; a drained queue is deleted
+static void mqttQueueAdvance(uint32_t n) {
+  gMqttSdHead += n;
+  if (gMqttSdHead >= gMqttSdCount) {
+    hal::storage().remove(MQTT_QUEUE_PATH);
+    gMqttSdHead = gMqttSdCount = 0;
+    return;
+  }
+  File f = hal::storage().open(MQTT_QUEUE_PATH, "r+");
+  if (!f) return;
+  mqttQueueWriteHeader(f);
+  f.close();
 }
 
-// Get Australian AQI category string
-const char* getAQICategory(int aqi) {
-  if (aqi < 0) return "N/A";
-  else if (aqi <= 33) return "Very Good";
-  else if (aqi <= 66) return "Good";
-  else if (aqi <= 99) return "Fair";
-  else if (aqi <= 149) return "Poor";
-  else if (aqi <= 200) return "Very Poor";
-  else return "Hazardous";
+// RAM batch to the card, so it survives a reset while the broker is away. Only
+// while the card queue is empty: RAM always holds the older buckets.
+static void mqttSpillRam() {
+  if (!MqttConfig::ENABLE || gMqttRamCount == 0 || mqttSdPending() != 0) return;
+  if (gMqttInflight.count && !gMqttInflight.fromSd) return;
+  if (mqttQueueAppend(gMqttRam, gMqttRamCount)) gMqttRamCount = 0;
 }
 
-#else
-#error "Invalid AQI_STANDARD. Must be 0 (EPA) or 1 (Australian)"
-#endif
+// Called from the commit path in loop() for every finalized bucket
+static void mqttQueueBucket(const BucketSample& b) {
+  if (!MqttConfig::ENABLE || !compactBucketHasData(b)) return;
+  BktRecord r;
+  bucketToRecord(b, r);
+  if (!gMqttOnline) mqttSpillRam();
+  bool toRam = mqttSdPending() == 0 && gMqttRamCount < MqttConfig::BATCH_BUCKETS && (gMqttOnline || !gSdOk);
+  if (!toRam && mqttQueueAppend(&r, 1)) return;
+  if (gMqttRamCount == MqttConfig::BATCH_BUCKETS) {
+    gMqttDropped++;  // no card and the broker is away
+    return;
+  }
+  if (gMqttRamCount == 0) gMqttRamSinceMs = millis();
+  gMqttRam[gMqttRamCount++] = r;
+}
 
-void handleApiNow() {
-  float pps = (WindConfig::PPS_TO_MS > 0.0f) ? (gNowWindMS / WindConfig::PPS_TO_MS) : 0.0f;
-  time_t nowE = epochNow();
-  float press_hpa = isfinite(gPressurePa) ? (gPressurePa / 100.0f) : NAN;
+// Closes the socket; unacknowledged buckets stay queued. The next attempt waits
+// RECONNECT_MIN_MS, doubling with every failure up to RECONNECT_MAX_MS.
+static void mqttLost(uint32_t msNow) {
+  gMqtt.stop();
+  gMqttOnline = false;
+  gMqttInflight.count = 0;
+  gMqttAttemptMs = msNow;
+  gMqttRetryDelayMs = gMqttRetryDelayMs ? std::min(gMqttRetryDelayMs * 2, MqttConfig::RECONNECT_MAX_MS)
+                                        : MqttConfig::RECONNECT_MIN_MS;
+  mqttSpillRam();
+}
 
-  String out = "{";
-  out += "\"epoch\":" + String((uint32_t)nowE) + ",";
-  out += "\"local_time\":\"" + fmtLocal(nowE) + "\",";
+static void mqttConnect(uint32_t msNow) {
+  if (!WiFi.isConnected() || msNow - gMqttAttemptMs < gMqttRetryDelayMs) return;
+  gMqttAttemptMs = msNow;
+  if (!gMqttNet.connect(MqttConfig::BROKER_HOST, MqttConfig::BROKER_PORT, (int32_t)MqttConfig::CONNECT_TIMEOUT_MS)) {
+    mqttLost(msNow);
+    return;
+  }
+  gMqttNet.setNoDelay(true);
+  String willTopic = mqttTopic("status");
+  mqtt::Will will = {willTopic.c_str(), "offline", true};
+  if (!gMqtt.start(MqttConfig::CLIENT_ID, MqttConfig::USERNAME, MqttConfig::PASSWORD, will,
+                   MqttConfig::KEEPALIVE_S, msNow)) {
+    mqttLost(msNow);
+  }
+}
 
-  out += "\"wind_pps\":" + (isfinite(pps) ? String(pps, 3) : String("null")) + ",";
-  out += "\"wind_ms\":" + (isfinite(gNowWindMS) ? String(gNowWindMS, 3) : String("null")) + ",";
+static bool mqttSendBatch(const BktRecord* recs, int n, bool fromSd, uint32_t msNow) {
+  String payload;
+  payload.reserve((size_t)n * 240);
+  {
+    JsonWriter w(&payload);  // never begin()s: the capture string is the only output
+    w.beginArray();
+    for (int i = 0; i < n; i++) {
+      BucketSample b;
+      recordToBucket(recs[i], b);
+      writeBucketJson(w, b);
+    }
+    w.endArray();
+  }
+  uint16_t id = gMqttNextId++;
+  if (gMqttNextId == 0) gMqttNextId = 1;
+  if (!gMqtt.publish(mqttTopic("buckets").c_str(), (const uint8_t*)payload.c_str(), payload.length(),
+                     true, false, id, msNow)) {
+    return false;
+  }
+  gMqttInflight = {id, (uint8_t)n, fromSd, msNow, (time_t)recs[n - 1].epoch};
+  return true;
+}
 
-  out += "\"bme280_ok\":" + String(gBmeOk ? "true" : "false") + ",";
-  out += "\"temp_c\":" + (isfinite(gTempC) ? String(gTempC, 2) : String("null")) + ",";
-  out += "\"hum_rh\":" + (isfinite(gHumRH) ? String(gHumRH, 2) : String("null")) + ",";
-  out += "\"press_hpa\":" + (isfinite(press_hpa) ? String(press_hpa, 2) : String("null")) + ",";
+static void mqttOnAck(uint16_t id, uint32_t msNow) {
+  if (gMqttInflight.count == 0 || id != gMqttInflight.packetId) return;
+  int n = gMqttInflight.count;
+  if (gMqttInflight.fromSd) {
+    mqttQueueAdvance((uint32_t)n);
+  } else {
+    memmove(gMqttRam, gMqttRam + n, (size_t)(gMqttRamCount - n) * sizeof(BktRecord));
+    gMqttRamCount -= n;
+    gMqttRamSinceMs = msNow;
+  }
+  gMqttPublished += (uint32_t)n;
+  gMqttAckLastMs = msNow - gMqttInflight.sentMs;
+  metricMqttAck(gMqttAckLastMs * 1000UL);
+  time_t end = gMqttInflight.newestEpoch + LogConfig::BUCKET_SECONDS;
+  time_t nowE = epochNow();
+  gMqttLagLastS = nowE > end ? (uint32_t)(nowE - end) : 0;
+  gMqttInflight.count = 0;
+}
 
-  out += "\"pms5003_ok\":" + String(gPmsOk ? "true" : "false") + ",";
-  out += "\"pm1\":" + (isfinite(gPM1) ? String(gPM1, 1) : String("null")) + ",";
-  out += "\"pm25\":" + (isfinite(gPM25) ? String(gPM25, 1) : String("null")) + ",";
-  out += "\"pm10\":" + (isfinite(gPM10) ? String(gPM10, 1) : String("null")) + ",";
+// RAM batch when it's full or old enough (or the card queue is waiting behind
+// it), else the next card batch at the replay rate
+static void mqttPumpQueue(uint32_t msNow) {
+  if (gMqttInflight.count) {
+    if (msNow - gMqttInflight.sentMs > MqttConfig::ACK_TIMEOUT_MS) mqttLost(msNow);
+    return;
+  }
+  if (gMqttRamCount > 0 &&
+      (gMqttRamCount >= MqttConfig::BATCH_BUCKETS || mqttSdPending() != 0 ||
+       msNow - gMqttRamSinceMs >= MqttConfig::BATCH_MAX_WAIT_S * 1000UL)) {
+    if (!mqttSendBatch(gMqttRam, gMqttRamCount, false, msNow)) mqttLost(msNow);
+    return;
+  }
+  if (mqttSdPending() == 0 || msNow - gMqttReplayMs < MqttConfig::REPLAY_INTERVAL_MS) return;
+  gMqttReplayMs = msNow;
+  BktRecord recs[MqttConfig::BATCH_BUCKETS];
+  int n = mqttQueueRead(recs, MqttConfig::BATCH_BUCKETS);
+  if (n == 0) {
+    // The card lost the file (removed, card swapped): nothing left to replay
+    gMqttDropped += mqttSdPending();
+    gMqttSdHead = gMqttSdCount = 0;
+    return;
+  }
+  if (!mqttSendBatch(recs, n, true, msNow)) mqttLost(msNow);
+}
 
-  // Calculate AQI values
-  int aqiPM25 = calculateAQI_PM25(gPM25);
-  int aqiPM10 = calculateAQI_PM10(gPM10);
-  out += "\"aqi_pm25\":" + (aqiPM25 >= 0 ? String(aqiPM25) : String("null")) + ",";
-  out += "\"aqi_pm25_category\":\"" + String(getAQICategory(aqiPM25)) + "\",";
-  out += "\"aqi_pm10\":" + (aqiPM10 >= 0 ? String(aqiPM10) : String("null")) + ",";
-  out += "\"aqi_pm10_category\":\"" + String(getAQICategory(aqiPM10)) + "\",";
-
-  out += "\"sd_ok\":" + String(gSdOk ? "true" : "false") + ",";
-  out += "\"cpu_temp_c\":" + String(temperatureRead(), 1) + ",";
-  out += "\"uptime_s\":" + String((uint32_t)(millis() / 1000)) + ",";
-  out += "\"retention_days\":" + String(LogConfig::RETENTION_DAYS) + ",";
-  out += "\"wifi_rssi\":" + String(WiFi.RSSI()) + ",";
-  out += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
-  out += "\"heap_size\":" + String(ESP.getHeapSize());
-  out += "}";
-  server.send(200, "application/json", out);
-}
-
-static inline String numOrNull(float v, int digits) {
-  return isfinite(v) ? String(v, digits) : String("null");
-}
-
-static String buildBucketJson(const BucketSample& b) {
-  // Full descriptive property names
-  float avg_wind = (b.avgWind != 255) ? ((float)b.avgWind / 2.0f) : NAN;
-  float max_wind = (b.maxWind != 255) ? ((float)b.maxWind / 2.0f) : NAN;
-  float temp_c = (b.avgTempC != -128) ? (float)b.avgTempC : NAN;
-  float hum_rh = (b.avgHumRH != 255) ? (float)b.avgHumRH : NAN;
-  float press_hpa = (b.avgPressHpa != -128) ? (1000.0f + (float)b.avgPressHpa) : NAN;
-
-  // Skip buckets with no valid sensor data
-  if (!isfinite(avg_wind) && !isfinite(max_wind) &&
-      !isfinite(temp_c) && !isfinite(hum_rh) && !isfinite(press_hpa)) {
-    return "";
-  }
-
-  String out = "{\"timestamp\":";
-  out += String((uint32_t)b.startEpoch);
-  out += ",\"wind_speed_avg\":";
-  out += numOrNull(avg_wind, 3);
-  out += ",\"wind_speed_max\":";
-  out += numOrNull(max_wind, 3);
-  out += ",\"wind_speed_samples\":";
-  out += String(b.samples);
-  out += ",\"temperature\":";
-  out += numOrNull(temp_c, 2);
-  out += ",\"humidity\":";
-  out += numOrNull(hum_rh, 2);
-  out += ",\"pressure\":";
-  out += numOrNull(press_hpa, 2);
-  out += ",\"pm1\":";
-  out += numOrNull(b.avgPM1, 1);
-  out += ",\"pm25\":";
-  out += numOrNull(b.avgPM25, 1);
-  out += ",\"pm10\":";
-  out += numOrNull(b.avgPM10, 1);
-  out += "}";
-  return out;
+static void mqttPublishLive(uint32_t msNow) {
+  gMqttLiveMs = msNow;
+  LiveSnapshot live = gLive.read();
+  String payload;
+  payload.reserve(768);
+  {
+    JsonWriter w(&payload);
+    w.beginObject();
+    writeLiveFields(w, live, epochNow());
+    writeStatusFields(w);
+    w.endObject();
+  }
+  if (!gMqtt.publish(mqttTopic("now").c_str(), (const uint8_t*)payload.c_str(), payload.length(),
+                     false, true, 0, msNow)) {
+    mqttLost(msNow);
+  }
 }
 
-static String buildBucketJsonCompact(const BucketSample& b) {
-  // Compact format for internal UI - array format with full precision
-  // Format: [epoch, avgWind, maxWind, samples, tempC, humRH, pressHpa, pm1, pm25, pm10]
-  if (!timeIsValid(b.startEpoch)) return "";
-
-  // Use full precision floats directly
-  float avg_wind = b.avgWind;
-  float max_wind = b.maxWind;
-  float temp_c = b.avgTempC;
-  float hum_rh = b.avgHumRH;
-  float press_hpa = b.avgPressHpa;
-
-  // Skip buckets with no valid sensor data
-  if (!isfinite(avg_wind) && !isfinite(max_wind) &&
-      !isfinite(temp_c) && !isfinite(hum_rh) && !isfinite(press_hpa)) {
-    return "";
-  }
-
-  String out = "[";
-  out += String((uint32_t)b.startEpoch);
-  out += ",";
-  out += numOrNull(avg_wind, 3);
-  out += ",";
-  out += numOrNull(max_wind, 3);
-  out += ",";
-  out += String(b.samples);
-  out += ",";
-  out += numOrNull(temp_c, 2);
-  out += ",";
-  out += numOrNull(hum_rh, 2);
-  out += ",";
-  out += numOrNull(press_hpa, 2);
-  out += ",";
-  out += numOrNull(b.avgPM1, 1);
-  out += ",";
-  out += numOrNull(b.avgPM25, 1);
-  out += ",";
-  out += numOrNull(b.avgPM10, 1);
-  out += "]";
-  return out;
+static void mqttBegin() {
+  if (!MqttConfig::ENABLE) return;
+  mqttQueueLoad();
 }
 
-void handleApiBuckets() {
-  time_t nowE = epochNow();
-  time_t todayMidnight = localMidnight(nowE);
+// Called from loop(): (re)connects, takes acknowledgements, sends what's due
+static void mqttStep(uint32_t msNow) {
+  if (!MqttConfig::ENABLE) return;
+  if (gMqtt.state() == mqtt::Session::IDLE) {
+    mqttConnect(msNow);
+    return;
+  }
+  if (!gMqtt.poll(msNow)) {
+    mqttLost(msNow);
+    return;
+  }
+  if (gMqtt.state() == mqtt::Session::CONNECTING) {
+    if (msNow - gMqttAttemptMs > MqttConfig::ACK_TIMEOUT_MS) mqttLost(msNow);
+    return;
+  }
+  if (!gMqttOnline) {
+    gMqttOnline = true;
+    gMqttConnects++;
+    gMqttRetryDelayMs = 0;
+    gMqttLiveMs = msNow - MqttConfig::LIVE_INTERVAL_MS;  // readings go out right away
+    static const char kOnline[] = "online";
+    if (!gMqtt.publish(mqttTopic("status").c_str(), (const uint8_t*)kOnline, sizeof(kOnline) - 1, false, true, 0, msNow)) {
+      mqttLost(msNow);
+      return;
+    }
+  }
+  if (uint16_t ack = gMqtt.takeAck()) mqttOnAck(ack, msNow);
+  mqttPumpQueue(msNow);
+  if (gMqttOnline && msNow - gMqttLiveMs >= MqttConfig::LIVE_INTERVAL_MS) mqttPublishLive(msNow);
+}
 
-  // Use chunked transfer with batching for performance
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "application/json", "");
+static void writeMqttFields(JsonWriter& w) {
+  w.key("mqtt_connected"); w.boolean(gMqttOnline);
+  w.key("mqtt_queued"); w.u32(mqttQueued());
+  w.key("mqtt_published"); w.u32(gMqttPublished);
+  w.key("mqtt_dropped"); w.u32(gMqttDropped);
+  w.key("mqtt_connects"); w.u32(gMqttConnects);
+  w.key("mqtt_ack_ms"); w.u32(gMqttAckLastMs);
+  w.key("mqtt_lag_s"); w.u32(gMqttLagLastS);
+}
 
-  String header = "{\"now_epoch\":";
-  header += String((uint32_t)nowE);
-  header += ",\"bucket_seconds\":";
-  header += String(LogConfig::BUCKET_SECONDS);
-  header += ",\"buckets\":[";
-  server.sendContent(header);
+#if METRICS_ENABLE
+static void putMqttMetrics(ChunkedResponse& w) {
+  putMetricHelp(w, "ws_mqtt_connected", "gauge", "1 while the MQTT broker session is up.");
+  putMetricCount(w, "ws_mqtt_connected", "", gMqttOnline ? 1 : 0);
+  putMetricHelp(w, "ws_mqtt_queue_buckets", "gauge", "Buckets waiting for the broker (RAM batch plus the SD queue).");
+  putMetricCount(w, "ws_mqtt_queue_buckets", "", mqttQueued());
+  putMetricHelp(w, "ws_mqtt_published_buckets_total", "counter", "Buckets acknowledged by the broker.");
+  putMetricCount(w, "ws_mqtt_published_buckets_total", "", gMqttPublished);
+  putMetricHelp(w, "ws_mqtt_dropped_buckets_total", "counter", "Buckets dropped because the queue was full.");
+  putMetricCount(w, "ws_mqtt_dropped_buckets_total", "", gMqttDropped);
+  putMetricHelp(w, "ws_mqtt_publish_ack_seconds", "histogram", "Bucket batch PUBLISH to PUBACK.");
+  putHistogram(w, "ws_mqtt_publish_ack_seconds", "", gMetrics.mqttAck);
+  putMetricHelp(w, "ws_mqtt_delivery_lag_seconds", "gauge", "Age of the newest bucket in the last acknowledged batch.");
+  putMetricCount(w, "ws_mqtt_delivery_lag_seconds", "", gMqttLagLastS);
+}
+#endif
 
-  bool first = true;
-  String batch = "";
-  batch.reserve(12288); // Reserve 12KB for batching
-
-  // Add finalized buckets from today only
-  for (int i = 0; i < LogConfig::BUCKETS_24H; i++) {
-    int idx = (gBucketWrite + i) % LogConfig::BUCKETS_24H;
-    const BucketSample& b = gBuckets[idx];
-    if (!timeIsValid(b.startEpoch)) continue;
-    if (b.startEpoch < todayMidnight) continue;
-
-    String bucketJson = buildBucketJson(b);
-    if (bucketJson.length() > 0) {
-      if (!first) batch += ",";
-      first = false;
-      batch += bucketJson;
-
-      // Send batch when it reaches 10KB to avoid blocking too long
-      if (batch.length() > 10000) {
-        server.sendContent(batch);
-        batch = "";
-      }
-    }
+// ------------------- LONG-RANGE QUERIES -------------------
+// /api/range: hour / day / month aggregates over every day file on the card.
+// Days are visited oldest first, so only one bin is open at a time. A finished
+// day with a days.idx record is taken from the index without opening its files
+// (day and month bins); any other day is read from its .bkt (seeking to `from`)
+// or CSV and indexed on the way. The body is produced from loop(), at most one
+// day file per pass, so the acquisition task never waits on a long query.
+
+enum RangeAgg : uint8_t { RANGE_HOUR, RANGE_DAY, RANGE_MONTH, RANGE_AGG_COUNT };
+static const char* const kRangeAggNames[RANGE_AGG_COUNT] = {"hour", "day", "month"};
+
+static time_t rangeBinStart(time_t t, RangeAgg agg) {
+  switch (agg) {
+    case RANGE_HOUR: return rollupSlotStart(t, 3600);
+    case RANGE_DAY:  return localMidnight(t);
+    default:         return localMonthStart(t);
   }
+}
 
-  // Always append the current in-progress bucket
-  BucketSample cur = currentBucketSnapshot();
-  if (timeIsValid(cur.startEpoch) && cur.startEpoch >= todayMidnight) {
-    bool alreadyFinalized = false;
-    int lastIdx = (gBucketWrite - 1 + LogConfig::BUCKETS_24H) % LogConfig::BUCKETS_24H;
-    if (timeIsValid(gBuckets[lastIdx].startEpoch) &&
-        gBuckets[lastIdx].startEpoch == cur.startEpoch) {
-      alreadyFinalized = true;
-    }
-
-    if (!alreadyFinalized) {
-      String bucketJson = buildBucketJson(cur);
-      if (bucketJson.length() > 0) {
-        if (!first) batch += ",";
-        batch += bucketJson;
+// fields=: day value keys ("maxWind") or channel names ("Temp" = all of its
+// values), comma separated; empty selects everything
+static bool parseRangeFields(const String& arg, bool want[DAY_STAT_COUNT]) {
+  for (int i = 0; i < DAY_STAT_COUNT; i++) want[i] = arg.length() == 0;
+  int start = 0;
+  while (start < (int)arg.length()) {
+    int comma = arg.indexOf(',', start);
+    if (comma < 0) comma = arg.length();
+    String tok = arg.substring(start, comma);
+    tok.trim();
+    start = comma + 1;
+    if (tok.length() == 0) continue;
+    bool known = false;
+    for (int i = 0; i < DAY_STAT_COUNT; i++) {
+      char key[16];
+      if (tok.equalsIgnoreCase(dayStatKey(kDayStats[i], key, sizeof(key))) ||
+          tok.equalsIgnoreCase(CHANNELS[kDayStats[i].ch].name)) {
+        want[i] = true;
+        known = true;
       }
     }
+    if (!known) return false;
   }
+  return true;
+}
 
-  // Send remaining batch
-  if (batch.length() > 0) {
-    server.sendContent(batch);
+static void writeRangeRow(JsonWriter& w, time_t start, const DayAgg& a, const bool want[DAY_STAT_COUNT]) {
+  w.beginArray();
+  w.u32((uint32_t)start);
+  for (int i = 0; i < DAY_STAT_COUNT; i++) {
+    const DayStat& s = kDayStats[i];
+    if (want[i]) w.num(a.stat(s.ch, s.stat), CHANNELS[s.ch].decimals);
   }
-
-  server.sendContent("]}");
+  w.endArray();
 }
 
-void handleApiBucketsCompact() {
-  // Compact format for internal UI use - saves bandwidth
-  time_t nowE = epochNow();
-  time_t todayMidnight = localMidnight(nowE);
-
-  // Use chunked transfer with batching for performance
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "application/json", "");
+// /api/range body. A pass takes up to RangeConfig::YIELD_EVERY_DAYS days from
+// the index, or reads one day file, then returns to loop().
+struct RangeBody {
+  JsonBlock out;
+  std::vector<uint32_t> slots;  // day index record per day from firstDay
+  time_t fromE = 0, toE = 0, endE = 0, todayMid = 0, firstDay = 0;
+  time_t day = 0;               // next day to visit
+  RangeAgg agg = RANGE_DAY;
+  bool want[DAY_STAT_COUNT];
+  DayAgg bin;
+  time_t binStart = 0;
+  bool binUsed = false;
+  uint32_t daysFromIndex = 0, filesRead = 0;
+  bool started = false;
+
+  bool fill(Download& d) {
+    JsonWriter& w = out.w;
+    if (!started) {
+      started = true;
+      d.head(200, "application/json", CONTENT_LENGTH_UNKNOWN, "");
+      w.beginObject();
+      w.key("from"); w.u32((uint32_t)fromE);
+      w.key("to"); w.u32((uint32_t)toE);
+      w.key("agg"); w.str(kRangeAggNames[agg]);
+      w.key("fields"); w.beginArray();
+      w.str("epoch");
+      for (int i = 0; i < DAY_STAT_COUNT; i++) {
+        char key[16];
+        if (want[i]) w.str(dayStatKey(kDayStats[i], key, sizeof(key)));
+      }
+      w.endArray();
+      w.key("rows"); w.beginArray();
+    }
 
-  String header = "{\"now_epoch\":";
-  header += String((uint32_t)nowE);
-  header += ",\"bucket_seconds\":";
-  header += String(LogConfig::BUCKET_SECONDS);
-  header += ",\"buckets\":[";
-  server.sendContent(header);
+    File index;
+    uint32_t indexCount = 0;
+    bool indexOpen = false;
+    int fromIndex = 0;
+    bool fileRead = false;
+    while (day < endE && !fileRead && fromIndex < RangeConfig::YIELD_EVERY_DAYS && !out.full()) {
+      time_t next = subtractDaysLocalMidnight(day, -1);
+      bool whole = day >= fromE && next <= toE && day < todayMid;
+      size_t slot = (size_t)((day - firstDay + 43200) / 86400);
+      uint32_t rec = slot < slots.size() ? slots[slot] : UINT32_MAX;
+
+      DayIndexRecord r;
+      bool indexed = false;
+      if (whole && agg != RANGE_HOUR && rec != UINT32_MAX) {
+        if (!indexOpen) indexOpen = openDayIndex(index, indexCount);
+        indexed = indexOpen && readDayIndexRecordAt(index, rec, r) && (time_t)r.dayStartEpoch == day;
+      }
 
-  bool first = true;
-  String batch = "";
-  batch.reserve(12288); // Reserve 12KB for batching
-
-  // Add finalized buckets from last 24 hours
-  time_t cutoff24h = nowE - 86400;  // 24 hours ago
-  for (int i = 0; i < LogConfig::BUCKETS_24H; i++) {
-    int idx = (gBucketWrite + i) % LogConfig::BUCKETS_24H;
-    const BucketSample& b = gBuckets[idx];
-    if (!timeIsValid(b.startEpoch)) continue;
-    if (b.startEpoch < cutoff24h) continue;
-
-    String bucketJson = buildBucketJsonCompact(b);
-    if (bucketJson.length() > 0) {
-      if (!first) batch += ",";
-      first = false;
-      batch += bucketJson;
-
-      // Send batch when it reaches 10KB to avoid blocking too long
-      if (batch.length() > 10000) {
-        server.sendContent(batch);
-        batch = "";
+      if (indexed) {
+        daysFromIndex++;
+        if (r.csvSize > 0 || r.bktSize > 0) {
+          DaySummary s{};
+          summaryFromDayIndex(r, s);
+          mergeDaySummary(binFor(day), s);
+        }
+        fromIndex++;
+      } else {
+        if (indexOpen) { index.close(); indexOpen = false; }
+        readDayFile(day, whole, rec == UINT32_MAX);
+        fileRead = true;
       }
+      day = next;
     }
+    if (indexOpen) index.close();
+
+    bool more = day < endE;
+    if (!more) {
+      if (binUsed) writeRangeRow(w, binStart, bin, want);
+      w.endArray();
+      w.key("days_from_index"); w.u32(daysFromIndex);
+      w.key("files_read"); w.u32(filesRead);
+      w.endObject();
+    }
+    out.sendTo(d);
+    return more;
   }
 
-  // Always append the current in-progress bucket
-  BucketSample cur = currentBucketSnapshot();
-  if (timeIsValid(cur.startEpoch) && cur.startEpoch >= cutoff24h) {
-    bool alreadyFinalized = false;
-    int lastIdx = (gBucketWrite - 1 + LogConfig::BUCKETS_24H) % LogConfig::BUCKETS_24H;
-    if (timeIsValid(gBuckets[lastIdx].startEpoch) &&
-        gBuckets[lastIdx].startEpoch == cur.startEpoch) {
-      alreadyFinalized = true;
+ private:
+  DayAgg& binFor(time_t epoch) {
+    time_t start = rangeBinStart(epoch, agg);
+    if (start != binStart) {
+      if (binUsed) writeRangeRow(out.w, binStart, bin, want);
+      bin = DayAgg();
+      binStart = start;
     }
+    binUsed = true;
+    return bin;
+  }
 
-    if (!alreadyFinalized) {
-      String bucketJson = buildBucketJsonCompact(cur);
-      if (bucketJson.length() > 0) {
-        if (!first) batch += ",";
-        batch += bucketJson;
-      }
+  void readDayFile(time_t dayMid, bool whole, bool unindexed) {
+    DayAgg dayAgg;
+    bool found = forEachDayBucket(dayMid, std::max(fromE, dayMid), [&](const BucketSample& b) {
+      if (!timeIsValid(b.startEpoch) || b.startEpoch < fromE || b.startEpoch >= toE) return;
+      accumulateDayAgg(binFor(b.startEpoch), b);
+      if (whole) accumulateDayAgg(dayAgg, b);
+    });
+    if (!found) return;
+    filesRead++;
+    // Not indexed yet (older than the days boot loads): index it for next time
+    if (whole && unindexed) {
+      DaySummary s;
+      daySummaryFromAgg(dayMid, dayAgg, s);
+      DayIndexRecord cur{};
+      dayIndexFromSummary(s, cur);
+      statDayFiles(dayMid, cur);
+      cur.flags = DAY_INDEX_FROM_RANGE;
+      writeDayIndexRecord(cur);
     }
   }
+};
 
-  // Send remaining batch
-  if (batch.length() > 0) {
-    server.sendContent(batch);
+void handleApiRange() {
+  time_t nowE = epochNow();
+  time_t toE = server.hasArg("to") ? (time_t)server.arg("to").toInt() : nowE;
+  time_t fromE = server.hasArg("from") ? (time_t)server.arg("from").toInt() : toE - 30 * 86400;
+  if (!timeIsValid(fromE) || !timeIsValid(toE) || toE <= fromE) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"bad_range\"}");
+    return;
+  }
+  int agg = server.hasArg("agg") ? -1 : RANGE_DAY;
+  for (int i = 0; i < RANGE_AGG_COUNT && agg < 0; i++) {
+    if (server.arg("agg").equalsIgnoreCase(kRangeAggNames[i])) agg = i;
+  }
+  if (agg < 0) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"bad_agg\"}");
+    return;
+  }
+  bool want[DAY_STAT_COUNT];
+  if (!parseRangeFields(server.arg("fields"), want)) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"unknown_field\"}");
+    return;
+  }
+  if (!gSdOk) {
+    server.send(503, "application/json", "{\"ok\":false,\"error\":\"sd_not_available\"}");
+    return;
   }
 
-  server.sendContent("]}");
-}
-
-void handleApiDays() {
-  String out;
-  out.reserve(8 * 1024);
-  out += "{";
-  out += "\"days\":[";
-  DaySummary curDay{};
-  bool hasCurDay = buildCurrentDaySummary(curDay);
-  bool firstOut = true;
-  if (hasCurDay) {
-    out += "{";
-    out += "\"dayStartEpoch\":" + String((uint32_t)curDay.dayStartEpoch) + ",";
-    out += "\"dayStartLocal\":\"" + fmtLocal(curDay.dayStartEpoch) + "\",";
-    out += "\"avgWind\":" + (isfinite(curDay.avgWind) ? String(curDay.avgWind, 3) : String("null")) + ",";
-    out += "\"maxWind\":" + (isfinite(curDay.maxWind) ? String(curDay.maxWind, 3) : String("null")) + ",";
-    out += "\"avgTemp\":" + (isfinite(curDay.avgTemp) ? String(curDay.avgTemp, 2) : String("null")) + ",";
-    out += "\"minTemp\":" + (isfinite(curDay.minTemp) ? String(curDay.minTemp, 2) : String("null")) + ",";
-    out += "\"maxTemp\":" + (isfinite(curDay.maxTemp) ? String(curDay.maxTemp, 2) : String("null")) + ",";
-    out += "\"avgHum\":" + (isfinite(curDay.avgHum) ? String(curDay.avgHum, 2) : String("null")) + ",";
-    out += "\"minHum\":" + (isfinite(curDay.minHum) ? String(curDay.minHum, 2) : String("null")) + ",";
-    out += "\"maxHum\":" + (isfinite(curDay.maxHum) ? String(curDay.maxHum, 2) : String("null")) + ",";
-    out += "\"avgPress\":" + (isfinite(curDay.avgPress) ? String(curDay.avgPress, 2) : String("null")) + ",";
-    out += "\"minPress\":" + (isfinite(curDay.minPress) ? String(curDay.minPress, 2) : String("null")) + ",";
-    out += "\"maxPress\":" + (isfinite(curDay.maxPress) ? String(curDay.maxPress, 2) : String("null")) + ",";
-    out += "\"avgPM1\":" + (isfinite(curDay.avgPM1) ? String(curDay.avgPM1, 1) : String("null")) + ",";
-    out += "\"maxPM1\":" + (isfinite(curDay.maxPM1) ? String(curDay.maxPM1, 1) : String("null")) + ",";
-    out += "\"avgPM25\":" + (isfinite(curDay.avgPM25) ? String(curDay.avgPM25, 1) : String("null")) + ",";
-    out += "\"maxPM25\":" + (isfinite(curDay.maxPM25) ? String(curDay.maxPM25, 1) : String("null")) + ",";
-    out += "\"avgPM10\":" + (isfinite(curDay.avgPM10) ? String(curDay.avgPM10, 1) : String("null")) + ",";
-    out += "\"maxPM10\":" + (isfinite(curDay.maxPM10) ? String(curDay.maxPM10, 1) : String("null"));
-    out += "}";
-    firstOut = false;
-  }
-  uint32_t count = gDaysCount;
-  // Loop backwards from most recent to oldest
-  for (int i = (int)count - 1; i >= 0; i--) {
-    int startIdx = (gDayWrite - (int)gDaysCount + LogConfig::DAYS_HISTORY) % LogConfig::DAYS_HISTORY;
-    int idx = (startIdx + i) % LogConfig::DAYS_HISTORY;
-    const DaySummary& d = gDays[idx];
-    if (!timeIsValid(d.dayStartEpoch)) continue;
-    if (!firstOut) out += ",";
-    firstOut = false;
-    out += "{";
-    out += "\"dayStartEpoch\":" + String((uint32_t)d.dayStartEpoch) + ",";
-    out += "\"dayStartLocal\":\"" + fmtLocal(d.dayStartEpoch) + "\",";
-    out += "\"avgWind\":" + (isfinite(d.avgWind) ? String(d.avgWind, 3) : String("null")) + ",";
-    out += "\"maxWind\":" + (isfinite(d.maxWind) ? String(d.maxWind, 3) : String("null")) + ",";
-    out += "\"avgTemp\":" + (isfinite(d.avgTemp) ? String(d.avgTemp, 2) : String("null")) + ",";
-    out += "\"minTemp\":" + (isfinite(d.minTemp) ? String(d.minTemp, 2) : String("null")) + ",";
-    out += "\"maxTemp\":" + (isfinite(d.maxTemp) ? String(d.maxTemp, 2) : String("null")) + ",";
-    out += "\"avgHum\":" + (isfinite(d.avgHum) ? String(d.avgHum, 2) : String("null")) + ",";
-    out += "\"minHum\":" + (isfinite(d.minHum) ? String(d.minHum, 2) : String("null")) + ",";
-    out += "\"maxHum\":" + (isfinite(d.maxHum) ? String(d.maxHum, 2) : String("null")) + ",";
-    out += "\"avgPress\":" + (isfinite(d.avgPress) ? String(d.avgPress, 2) : String("null")) + ",";
-    out += "\"minPress\":" + (isfinite(d.minPress) ? String(d.minPress, 2) : String("null")) + ",";
-    out += "\"maxPress\":" + (isfinite(d.maxPress) ? String(d.maxPress, 2) : String("null")) + ",";
-    out += "\"avgPM1\":" + (isfinite(d.avgPM1) ? String(d.avgPM1, 1) : String("null")) + ",";
-    out += "\"maxPM1\":" + (isfinite(d.maxPM1) ? String(d.maxPM1, 1) : String("null")) + ",";
-    out += "\"avgPM25\":" + (isfinite(d.avgPM25) ? String(d.avgPM25, 1) : String("null")) + ",";
-    out += "\"maxPM25\":" + (isfinite(d.maxPM25) ? String(d.maxPM25, 1) : String("null")) + ",";
-    out += "\"avgPM10\":" + (isfinite(d.avgPM10) ? String(d.avgPM10, 1) : String("null")) + ",";
-    out += "\"maxPM10\":" + (isfinite(d.maxPM10) ? String(d.maxPM10, 1) : String("null"));
-    out += "}";
-  }
-  out += "]}";
-  server.send(200, "application/json", out);
+  time_t todayMid = localMidnight(nowE);
+  time_t endE = std::min(toE, nowE + 1);
+  time_t firstDay = localMidnight(fromE);
+  if (LogConfig::RETENTION_DAYS > 0) {
+    // Older files are gone; their index records are not
+    firstDay = std::max(firstDay, subtractDaysLocalMidnight(todayMid, LogConfig::RETENTION_DAYS));
+  }
+  long spanDays = endE > firstDay ? (long)((endE - firstDay) / 86400) + 1 : 0;
+  if (spanDays > RangeConfig::MAX_DAYS) {
+    server.send(400, "application/json", "{\"ok\":false,\"error\":\"range_too_long\"}");
+    return;
+  }
+  if (!downloadAdmit(false)) return;
+
+  RangeBody* body = new RangeBody;
+  body->slots.resize((size_t)spanDays + 1);
+  readDayIndexSlots(firstDay, body->slots);
+  if (endE > todayMid) flushLogBuffer();  // today's rows still in RAM
+  body->fromE = fromE;
+  body->toE = toE;
+  body->endE = endE;
+  body->todayMid = todayMid;
+  body->firstDay = firstDay;
+  body->day = firstDay;
+  body->agg = (RangeAgg)agg;
+  memcpy(body->want, want, sizeof(want));
+  downloadStart(body, false);
 }
 
 void handleApiConfig() {
-  String out;
-  out.reserve(4096);
-  out = "{";
+  // Compiled in, so it only changes with a new firmware (and a reboot)
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"c%08lx\"", (unsigned long)gBootId);
+  if (respondNotModified(etag)) return;
+
+  JsonWriter w;
+  w.begin();
+  w.beginObject();
 
   // Plots configuration
-  out += "\"plots\":[";
+  w.key("plots"); w.beginArray();
   for (int i = 0; i < PLOTS_COUNT; i++) {
-    if (i > 0) out += ",";
     const PlotConfig& p = PLOTS[i];
-    out += "{";
-    out += "\"id\":\"" + String(p.id) + "\",";
-    out += "\"title\":\"" + String(p.title) + "\",";
-    out += "\"unit\":\"" + String(p.unit) + "\",";
-    out += "\"conversionFactor\":" + String(p.conversionFactor, 3) + ",";
-    out += "\"series\":[";
+    w.beginObject();
+    w.key("id"); w.str(p.id);
+    w.key("title"); w.str(p.title);
+    w.key("unit"); w.str(p.unit);
+    w.key("conversionFactor"); w.num(p.conversionFactor, 3);
+    w.key("series"); w.beginArray();
     for (int j = 0; j < p.seriesCount; j++) {
-      if (j > 0) out += ",";
       const PlotSeries& s = p.series[j];
-      if (s.field) {
-        out += "{";
-        out += "\"field\":\"" + String(s.field) + "\",";
-        out += "\"color\":\"" + String(s.color) + "\",";
-        out += "\"label\":\"" + String(s.label) + "\"";
-        out += "}";
-      }
+      if (!s.field) continue;
+      w.beginObject();
+      w.key("field"); w.str(s.field);
+      w.key("color"); w.str(s.color);
+      w.key("label"); w.str(s.label);
+      w.endObject();
     }
-    out += "]";
-    out += "}";
+    w.endArray();
+    w.endObject();
   }
-  out += "],";
+  w.endArray();
 
   // Table configuration
-  out += "\"tableColumns\":[";
+  w.key("tableColumns"); w.beginArray();
   for (int i = 0; i < TABLE_COLUMNS_COUNT; i++) {
-    if (i > 0) out += ",";
     const TableColumn& c = TABLE_COLUMNS[i];
-    out += "{";
-    out += "\"field\":\"" + String(c.field) + "\",";
-    out += "\"label\":\"" + String(c.label) + "\",";
-    out += "\"unit\":\"" + String(c.unit) + "\",";
-    out += "\"conversionFactor\":" + String(c.conversionFactor, 3) + ",";
-    out += "\"decimals\":" + String(c.decimals) + ",";
-    out += "\"bgColor\":\"" + String(c.bgColor) + "\",";
-    out += "\"group\":\"" + String(c.group) + "\"";
-    out += "}";
-  }
-  out += "],";
+    w.beginObject();
+    w.key("field"); w.str(c.field);
+    w.key("label"); w.str(c.label);
+    w.key("unit"); w.str(c.unit);
+    w.key("conversionFactor"); w.num(c.conversionFactor, 3);
+    w.key("decimals"); w.i32(c.decimals);
+    w.key("bgColor"); w.str(c.bgColor);
+    w.key("group"); w.str(c.group);
+    w.endObject();
+  }
+  w.endArray();
 
   // UI parameters
-  out += "\"filesPerPage\":" + String(UIConfig::FILES_PER_PAGE) + ",";
-  out += "\"maxPlotPoints\":" + String(UIConfig::MAX_PLOT_POINTS);
-
-  out += "}";
-  server.send(200, "application/json", out);
+  w.key("filesPerPage"); w.i32(UIConfig::FILES_PER_PAGE);
+  w.key("maxPlotPoints"); w.i32(UIConfig::MAX_PLOT_POINTS);
+  w.endObject();
 }
 
 void handleApiUiFiles() {
@@ -1914,29 +6038,28 @@ void handleApiUiFiles() {
     return;
   }
 
-  String out = "{\"ok\":true,\"files\":[";
-  bool first = true;
+  JsonWriter w;
+  w.begin();
+  w.beginObject();
+  w.key("ok"); w.boolean(true);
+  w.key("files"); w.beginArray();
 
   const char* webFiles[] = {"/web/index.html", "/web/app.js"};
   for (int i = 0; i < 2; i++) {
     const char* path = webFiles[i];
-    if (SD.exists(path)) {
-      File f = SD.open(path, FILE_READ);
-      if (f) {
-        if (!first) out += ",";
-        first = false;
-        out += "{";
-        out += "\"path\":\"" + String(path) + "\",";
-        out += "\"size\":" + String((uint32_t)f.size()) + ",";
-        out += "\"lastModified\":" + String((uint32_t)f.getLastWrite());
-        out += "}";
-        f.close();
-      }
-    }
+    if (!hal::storage().exists(path)) continue;
+    File f = hal::storage().open(path, FILE_READ);
+    if (!f) continue;
+    w.beginObject();
+    w.key("path"); w.str(path);
+    w.key("size"); w.u32((uint32_t)f.size());
+    w.key("lastModified"); w.u32((uint32_t)f.getLastWrite());
+    w.endObject();
+    f.close();
   }
 
-  out += "]}";
-  server.send(200, "application/json", out);
+  w.endArray();
+  w.endObject();
 }
 
 void handleUploadPage() {
@@ -1948,6 +6071,7 @@ static bool gUploadPasswordVerified = false;
 static bool gUploadError = false;
 static String gUploadErrorMsg = "";
 static const char* TEMP_UPLOAD_FILE = "/web/.upload.tmp";
+static uint32_t gUploadCrc = 0;
 
 void handleUploadData() {
   HTTPUpload& upload = server.upload();
@@ -1963,17 +6087,19 @@ void handleUploadData() {
       return;
     }
 
-    if (!SD.exists("/web")) {
-      SD.mkdir("/web");
+    if (!hal::storage().exists("/web")) {
+      hal::storage().mkdir("/web");
     }
 
     // Delete any previous temp file
-    if (SD.exists(TEMP_UPLOAD_FILE)) {
-      SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) {
+      hal::storage().remove(TEMP_UPLOAD_FILE);
     }
 
     // Save to temporary file first
-    gUploadFile = SD.open(TEMP_UPLOAD_FILE, FILE_WRITE);
+    crc32_init();
+    gUploadCrc = 0xFFFFFFFFUL;
+    gUploadFile = hal::storage().open(TEMP_UPLOAD_FILE, FILE_WRITE);
     if (!gUploadFile) {
       gUploadError = true;
       gUploadErrorMsg = "failed_to_create_file";
@@ -1981,6 +6107,7 @@ void handleUploadData() {
   } else if (upload.status == UPLOAD_FILE_WRITE) {
     if (gUploadFile && !gUploadError) {
       gUploadFile.write(upload.buf, upload.currentSize);
+      gUploadCrc = crc32_update(gUploadCrc, upload.buf, upload.currentSize);
     }
   } else if (upload.status == UPLOAD_FILE_END) {
     if (gUploadFile) {
@@ -1993,8 +6120,8 @@ void handleUploadComplete() {
   // Check for upload errors first
   if (gUploadError) {
     // Delete temp file on error
-    if (SD.exists(TEMP_UPLOAD_FILE)) {
-      SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) {
+      hal::storage().remove(TEMP_UPLOAD_FILE);
     }
 
     int statusCode = 500;
@@ -2018,43 +6145,43 @@ void handleUploadComplete() {
 
   // Validate path
   if (path.length() == 0) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(400, "application/json", "{\"ok\":false,\"error\":\"missing_path\"}");
     return;
   }
 
   // Check for path traversal attempts
   if (path.indexOf("..") >= 0) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(403, "application/json", "{\"ok\":false,\"error\":\"path_traversal_detected\"}");
     return;
   }
 
   // Check for backslashes (Windows-style paths)
   if (path.indexOf('\\') >= 0) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(403, "application/json", "{\"ok\":false,\"error\":\"invalid_path_separator\"}");
     return;
   }
 
   // Ensure path starts with /web/
   if (!path.startsWith("/web/")) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(403, "application/json", "{\"ok\":false,\"error\":\"forbidden_path\"}");
     return;
   }
 
   // Validate that path doesn't have double slashes or other suspicious patterns
   if (path.indexOf("//") >= 0) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(403, "application/json", "{\"ok\":false,\"error\":\"invalid_path_format\"}");
     return;
   }
 
   // Extract filename from path and validate it
   int lastSlash = path.lastIndexOf('/');
-  if (lastSlash < 0 || lastSlash == path.length() - 1) {
-    if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+  if (lastSlash < 0 || lastSlash == (int)path.length() - 1) {
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
     server.send(403, "application/json", "{\"ok\":false,\"error\":\"invalid_filename\"}");
     return;
   }
@@ -2064,7 +6191,7 @@ void handleUploadComplete() {
   for (unsigned int i = 0; i < filename.length(); i++) {
     char c = filename.charAt(i);
     if (!isalnum(c) && c != '-' && c != '_' && c != '.') {
-      if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+      if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
       server.send(403, "application/json", "{\"ok\":false,\"error\":\"invalid_filename_characters\"}");
       return;
     }
@@ -2076,8 +6203,8 @@ void handleUploadComplete() {
 
   if (!gUploadPasswordVerified) {
     // Password failed - delete temp file
-    if (SD.exists(TEMP_UPLOAD_FILE)) {
-      SD.remove(TEMP_UPLOAD_FILE);
+    if (hal::storage().exists(TEMP_UPLOAD_FILE)) {
+      hal::storage().remove(TEMP_UPLOAD_FILE);
     }
 
     int statusCode = rateLimited ? 429 : 401;
@@ -2087,17 +6214,26 @@ void handleUploadComplete() {
   } else {
     // Password OK - move temp file to final location
     // Delete existing file if present
-    if (SD.exists(path.c_str())) {
-      SD.remove(path.c_str());
+    if (hal::storage().exists(path.c_str())) {
+      hal::storage().remove(path.c_str());
     }
 
     // Rename temp file to final name
-    if (SD.rename(TEMP_UPLOAD_FILE, path.c_str())) {
+    if (hal::storage().rename(TEMP_UPLOAD_FILE, path.c_str())) {
+      writeStaticCrc(path, gUploadCrc ^ 0xFFFFFFFFUL, (uint32_t)server.upload().totalSize);
+      // A new plain file makes its old gzip variant stale; the upload page sends the new one next
+      if (!path.endsWith(".gz")) {
+        String gzPath = path + ".gz";
+        if (hal::storage().exists(gzPath.c_str())) hal::storage().remove(gzPath.c_str());
+        gzPath += ".crc";
+        if (hal::storage().exists(gzPath.c_str())) hal::storage().remove(gzPath.c_str());
+      }
+      invalidateStaticAsset(path);
       server.send(200, "application/json",
                   "{\"ok\":true,\"bytes\":" + String(server.upload().totalSize) + "}");
     } else {
       // Rename failed - try to delete temp file
-      if (SD.exists(TEMP_UPLOAD_FILE)) SD.remove(TEMP_UPLOAD_FILE);
+      if (hal::storage().exists(TEMP_UPLOAD_FILE)) hal::storage().remove(TEMP_UPLOAD_FILE);
       server.send(500, "application/json", "{\"ok\":false,\"error\":\"rename_failed\"}");
     }
   }
@@ -2110,7 +6246,7 @@ void handleUploadComplete() {
 void saveDaySummariesCache(const DaySummary* curDay, bool hasCurDay) {
   if (!gSdOk) return;
   ensureDir("/data");
-  File f = SD.open("/data/day_summaries_cache.csv", FILE_WRITE);
+  File f = hal::storage().open("/data/day_summaries_cache.csv", FILE_WRITE);
   if (!f) return;
   f.print("dayStartEpoch,avgWind,maxWind,avgTemp,minTemp,maxTemp,avgHum,minHum,maxHum,avgPress,minPress,maxPress,avgPM1,maxPM1,avgPM25,maxPM25,avgPM10,maxPM10\n");
   auto writeRow = [&](const DaySummary& d){
@@ -2146,43 +6282,40 @@ void saveDaySummariesCache(const DaySummary* curDay, bool hasCurDay) {
 }
 
 bool loadDaySummariesCache() {
-  if (!gSdOk || !SD.exists("/data/day_summaries_cache.csv")) return false;
-  File f = SD.open("/data/day_summaries_cache.csv", FILE_READ);
+  if (!gSdOk || !hal::storage().exists("/data/day_summaries_cache.csv")) return false;
+  File f = hal::storage().open("/data/day_summaries_cache.csv", FILE_READ);
   if (!f) return false;
   memset(gDays, 0, sizeof(gDays));
   gDayWrite = 0;
   gDaysCount = 0;
   bool first = true;
-  while (f.available()) {
-    String line = f.readStringUntil('\n');
-    line.trim();
-    if (!line.length()) continue;
-    if (first) { first = false; if (line.startsWith("dayStartEpoch")) continue; }
-    String parts[18];
-    int numParts = splitCSVLine(line, parts, 18) ? 18 : 0;
+  CsvReader r(f);
+  while (r.nextRow()) {
+    if (first) { first = false; if (strncmp(r.field(0), "dayStartEpoch", 13) == 0) continue; }
+    int numParts = r.numCols;
     if (numParts < 9) continue;  // Need at least 9 fields for backward compatibility
     DaySummary d{};
-    d.dayStartEpoch = (time_t)parts[0].toInt();
+    d.dayStartEpoch = (time_t)csvInt(r.field(0));
     if (!timeIsValid(d.dayStartEpoch)) continue;
-    d.avgWind = parts[1].length() ? parts[1].toFloat() : NAN;
-    d.maxWind = parts[2].length() ? parts[2].toFloat() : NAN;
-    d.avgTemp = parts[3].length() ? parts[3].toFloat() : NAN;
-    d.minTemp = parts[4].length() ? parts[4].toFloat() : NAN;
-    d.maxTemp = parts[5].length() ? parts[5].toFloat() : NAN;
-    d.avgHum  = parts[6].length() ? parts[6].toFloat() : NAN;
-    d.minHum  = parts[7].length() ? parts[7].toFloat() : NAN;
-    d.maxHum  = parts[8].length() ? parts[8].toFloat() : NAN;
+    d.avgWind = csvFloat(r.field(1));
+    d.maxWind = csvFloat(r.field(2));
+    d.avgTemp = csvFloat(r.field(3));
+    d.minTemp = csvFloat(r.field(4));
+    d.maxTemp = csvFloat(r.field(5));
+    d.avgHum  = csvFloat(r.field(6));
+    d.minHum  = csvFloat(r.field(7));
+    d.maxHum  = csvFloat(r.field(8));
     // Pressure fields (optional for backward compatibility)
-    d.avgPress = (numParts > 9 && parts[9].length()) ? parts[9].toFloat() : NAN;
-    d.minPress = (numParts > 10 && parts[10].length()) ? parts[10].toFloat() : NAN;
-    d.maxPress = (numParts > 11 && parts[11].length()) ? parts[11].toFloat() : NAN;
+    d.avgPress = (numParts > 9) ? csvFloat(r.field(9)) : NAN;
+    d.minPress = (numParts > 10) ? csvFloat(r.field(10)) : NAN;
+    d.maxPress = (numParts > 11) ? csvFloat(r.field(11)) : NAN;
     // PM fields (optional for backward compatibility)
-    d.avgPM1 = (numParts > 12 && parts[12].length()) ? parts[12].toFloat() : NAN;
-    d.maxPM1 = (numParts > 13 && parts[13].length()) ? parts[13].toFloat() : NAN;
-    d.avgPM25 = (numParts > 14 && parts[14].length()) ? parts[14].toFloat() : NAN;
-    d.maxPM25 = (numParts > 15 && parts[15].length()) ? parts[15].toFloat() : NAN;
-    d.avgPM10 = (numParts > 16 && parts[16].length()) ? parts[16].toFloat() : NAN;
-    d.maxPM10 = (numParts > 17 && parts[17].length()) ? parts[17].toFloat() : NAN;
+    d.avgPM1 = (numParts > 12) ? csvFloat(r.field(12)) : NAN;
+    d.maxPM1 = (numParts > 13) ? csvFloat(r.field(13)) : NAN;
+    d.avgPM25 = (numParts > 14) ? csvFloat(r.field(14)) : NAN;
+    d.maxPM25 = (numParts > 15) ? csvFloat(r.field(15)) : NAN;
+    d.avgPM10 = (numParts > 16) ? csvFloat(r.field(16)) : NAN;
+    d.maxPM10 = (numParts > 17) ? csvFloat(r.field(17)) : NAN;
     gDays[gDayWrite] = d;
     gDayWrite = (gDayWrite + 1) % LogConfig::DAYS_HISTORY;
     if (gDaysCount < (uint32_t)LogConfig::DAYS_HISTORY) gDaysCount++;
@@ -2200,7 +6333,7 @@ bool syncTimeWithNTP(uint32_t timeoutMs = 20000) {
 
   uint32_t start = millis();
   while (millis() - start < timeoutMs) {
-    time_t nowE = time(nullptr);
+    time_t nowE = epochNow();
     if (timeIsValid(nowE)) return true;
     delay(250);
   }
@@ -2214,7 +6347,7 @@ void initSD() {
   // If your board needs explicit SPI pins, do it here, e.g.:
   // SPI.begin(SCK, MISO, MOSI, SDConfig::CS_PIN);
 
-  if (!SD.begin(SDConfig::CS_PIN)) return;
+  if (!hal::storage().begin(SDConfig::CS_PIN)) return;
 
   gSdOk = true;
   ensureDir("/data");
@@ -2222,84 +6355,160 @@ void initSD() {
 
 // ------------------- LOOP HELPERS -------------------
 
-static void updateWindPPS(uint32_t msNow) {
-  if (msNow - gLastPpsMillis < WindConfig::PPS_WINDOW_MS) return;
+// Feeds the pulses since the last call to gWindPulses; returns how many
+// arrived (exact even if the ring overflowed)
+static uint32_t drainPulseRing() {
+  uint32_t head = gPulseHead;
+  uint32_t count = head - gPulseTail;
+  if (count > WindConfig::PULSE_RING_SIZE) {
+    gPulseRingOverflows += count - WindConfig::PULSE_RING_SIZE;
+    gPulseTail = head - WindConfig::PULSE_RING_SIZE;
+  }
+  for (; gPulseTail != head; gPulseTail++) {
+    gWindPulses.addPulse(gPulseRing[gPulseTail & (WindConfig::PULSE_RING_SIZE - 1)]);
+  }
+  gWindPulses.advanceTo(micros());
+  return count;
+}
 
+// Called once per PPS window by the acquisition task
+static void updateWindPPS(uint32_t msNow) {
   uint32_t elapsedMs = msNow - gLastPpsMillis;
 
-  uint32_t delta;
-  noInterrupts();
-  delta = gPulseCount;
-  gPulseCount = 0;
-  interrupts();
+  uint32_t delta = drainPulseRing();
 
   float pps = (elapsedMs > 0) ? (delta * 1000.0f / (float)elapsedMs) : 0.0f;
   float ms = pps * WindConfig::PPS_TO_MS;
 
   gNowWindMS = ms;
-  if (gNowWindMS > gBucketWindMax1) {
-    gBucketWindMax2 = gBucketWindMax1;
-    gBucketWindMax1 = gNowWindMS;
-  } else if (gNowWindMS > gBucketWindMax2) {
-    gBucketWindMax2 = gNowWindMS;
-  }
+  if (gNowWindMS > gBucketWindMax1) gBucketWindMax1 = gNowWindMS;
+  float gust = gWindPulses.takeGust();
+  if (isfinite(gust) && (!isfinite(gBucketGust) || gust > gBucketGust)) gBucketGust = gust;
 
   gBucketPulseCount += delta;
   gBucketPulseElapsedMs += elapsedMs;
 
   // Sample wind into bucket immediately after calculation
   gBucketWindSum += gNowWindMS;
+  gBucketWindSqSum += gNowWindMS * gNowWindMS;
   gBucketSamples++;
 
   gLastPpsMillis = msNow;
 }
 
+// Polls are due within half a PPS window, so tick-rounding jitter can't skip one.
+// In forced mode the conversion is started on the tick before a poll is due (or
+// right after the poll when the next one is only a window away), so the read
+// collects a result taken one window earlier, never one left over from a skipped
+// trigger.
 static void pollBMEIfNeeded(uint32_t msNow) {
   if (!BME280Config::ENABLE || !gBmeOk) return;
-  if (msNow - gLastBmePollMillis < BME280Config::POLL_INTERVAL_MS) return;
-  pollBME();
-  gLastBmePollMillis += BME280Config::POLL_INTERVAL_MS;
+  uint32_t since = msNow - gLastBmePollMillis + WindConfig::PPS_WINDOW_MS / 2;
+  if (since >= BME280Config::POLL_INTERVAL_MS) {
+    if (!BME280Config::FORCED_MODE || gBmeConversionPending) pollBME();
+    gBmeConversionPending = false;
+    gLastBmePollMillis += BME280Config::POLL_INTERVAL_MS;
+    since -= BME280Config::POLL_INTERVAL_MS;
+  }
+  if (BME280Config::FORCED_MODE && !gBmeConversionPending &&
+      since + WindConfig::PPS_WINDOW_MS >= BME280Config::POLL_INTERVAL_MS) {
+    gBmeConversionPending = hal::envTrigger();
+  }
 }
 
 static void pollPMSIfNeeded(uint32_t msNow) {
   if (!PMS5003Config::ENABLE) return;
-  if (msNow - gLastPmsPollMillis < PMS5003Config::POLL_INTERVAL_MS) return;
+  if (msNow - gLastPmsPollMillis + WindConfig::PPS_WINDOW_MS / 2 < PMS5003Config::POLL_INTERVAL_MS) return;
   pollPMS();
   gLastPmsPollMillis += PMS5003Config::POLL_INTERVAL_MS;
 }
 
+static time_t gBackstepAligned = 0;  // acquisition task: boundary the stepped-back clock is in
+
+// Closes the finished bucket and hands it to loop(), together with where the
+// new one starts; after a jump forward the empty buckets in between cost one
+// queue slot. If the queue is full (loop() stuck in a long request) the bucket
+// stays open and the hand-off is retried next tick, so nothing is dropped.
 static void processBucketCatchup(time_t nowE) {
   time_t aligned = floorToBucketBoundaryLocal(nowE);
   if (!timeIsValid(gCurrentBucketStart)) startBucketAt(aligned);
 
-  // Limit catch-up work so we keep serving HTTP/OTA while filling missed buckets
-  const int MAX_BUCKETS_PER_LOOP = 6;
-  int bucketsProcessed = 0;
-  while (gCurrentBucketStart < aligned && bucketsProcessed < MAX_BUCKETS_PER_LOOP) {
-    finalizeCurrentBucket(gCurrentBucketStart);
-
-    gCurrentBucketStart += LogConfig::BUCKET_SECONDS;
-    gBucketWindSum = 0.0f;
-    gBucketWindMax1 = 0.0f;
-    gBucketWindMax2 = 0.0f;
-    gBucketSamples = 0;
-    gBucketPulseCount = 0;
-    gBucketPulseElapsedMs = 0;
-    gBucketTempSum = 0.0f;
-    gBucketHumSum = 0.0f;
-    gBucketPressSumPa = 0.0f;
-    gBucketEnvSamples = 0;
-    gBucketPM1Sum = 0.0f;
-    gBucketPM25Sum = 0.0f;
-    gBucketPM10Sum = 0.0f;
-    gBucketPmSamples = 0;
-    bucketsProcessed++;
-    if ((bucketsProcessed % 2) == 0) {
-      server.handleClient();
-      ArduinoOTA.handle();
-      delay(0);
+  if (aligned < gCurrentBucketStart) {
+    // The clock stepped back past the open bucket. Buckets are never reopened or
+    // emitted out of order, so it stays open until the clock passes its end
+    // again; every boundary the stepped-back clock crosses restarts its samples,
+    // so it closes with one bucket's worth rather than everything since the step.
+    if (aligned != gBackstepAligned) {
+      if (gBackstepAligned == 0) gAcqStats.clockBacksteps++;
+      else startBucketAt(gCurrentBucketStart);
+      gBackstepAligned = aligned;
     }
+    return;
+  }
+  if (gBackstepAligned != 0) {
+    gBackstepAligned = 0;
+    if (aligned == gCurrentBucketStart) {
+      startBucketAt(gCurrentBucketStart);
+      return;
+    }
+  }
+  if (aligned == gCurrentBucketStart) return;
+
+  ClosedBucket c;
+  computeBucketSample(c.bucket, gCurrentBucketStart);
+  c.nextStart = aligned;
+  if (!gBucketQueue.push(c)) {
+    gAcqStats.queueFull++;
+    return;
+  }
+  if (aligned > floorToBucketBoundaryLocal(gCurrentBucketStart + LogConfig::BUCKET_SECONDS)) gAcqStats.gapFills++;
+  startBucketAt(aligned);
+}
+
+static void recordAcqWindow(uint32_t windowUs, uint32_t busyUs) {
+  const uint32_t nominalUs = WindConfig::PPS_WINDOW_MS * 1000UL;
+  uint32_t overrun = (windowUs > nominalUs) ? windowUs - nominalUs : 0;
+  gAcqStats.windows++;
+  gAcqStats.overrunSumUs += overrun;
+  if (overrun > gAcqStats.overrunMaxUs) gAcqStats.overrunMaxUs = overrun;
+  if (overrun > nominalUs / 10) gAcqStats.lateWindows++;
+  if (busyUs > gAcqStats.busyMaxUs) gAcqStats.busyMaxUs = busyUs;
+}
+
+// Runs above loop()'s priority on a fixed PPS_WINDOW_MS cadence; HTTP and SD
+// work in loop() can no longer stretch a wind window or delay a poll.
+static void acquisitionTask(void*) {
+  TickType_t lastWake = xTaskGetTickCount();
+  uint32_t lastWindowUs = micros();
+  for (;;) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(WindConfig::PPS_WINDOW_MS));
+    uint32_t startUs = micros();
+    uint32_t msNow = millis();
+
+    updateWindPPS(msNow);
+    pollBMEIfNeeded(msNow);
+    pollPMSIfNeeded(msNow);
+    processBucketCatchup(epochNow());
+
+    recordAcqWindow(startUs - lastWindowUs, micros() - startUs);
+    lastWindowUs = startUs;
+    publishLiveSnapshot();
+  }
+}
+
+// Commits the buckets the acquisition task closed (rolling the day over before
+// the first bucket of a new day), then once more for the task's open bucket.
+static void drainClosedBuckets() {
+  time_t openBucket = gLive.read().bucket.startEpoch;
+  ClosedBucket c;
+  while (gBucketQueue.pop(c)) {
+    maybeRolloverDay(c.bucket.startEpoch);
+    commitBucket(c.bucket);
+    streamBucketEvent(c.bucket);
+    mqttQueueBucket(c.bucket);
+    commitEmptyRun(floorToBucketBoundaryLocal(c.bucket.startEpoch + LogConfig::BUCKET_SECONDS), c.nextStart);
   }
+  if (timeIsValid(openBucket)) maybeRolloverDay(openBucket);
 }
 
 // ------------------- SETUP / LOOP -------------------
@@ -2308,11 +6517,11 @@ void setup() {
   Serial.begin(115200);
   delay(200);
 
-  memset(gBuckets, 0, sizeof(gBuckets));
+  gBucketRing.clear();
   memset(gDays, 0, sizeof(gDays));
-  gBucketWrite = 0;
   gDayWrite = 0;
   gDaysCount = 0;
+  gBootId = esp_random();  // ETags from a previous boot never match
 
   // Set up pulse pin but don't attach interrupt yet to avoid counting noise during WiFi init
   pinMode(WindConfig::PULSE_PIN, INPUT_PULLUP);
@@ -2332,24 +6541,18 @@ void setup() {
 
   Wire.begin();
   if (BME280Config::ENABLE) {
-    gBmeOk = bme.begin(BME280Config::I2C_ADDR_PRIMARY);
-    if (!gBmeOk) gBmeOk = bme.begin(0x77);
-    if (gBmeOk) {
-      bme.setSampling(
-        Adafruit_BME280::MODE_NORMAL,
-        Adafruit_BME280::SAMPLING_X2,
-        Adafruit_BME280::SAMPLING_X16,
-        Adafruit_BME280::SAMPLING_X1,
-        Adafruit_BME280::FILTER_X16,
-        Adafruit_BME280::STANDBY_MS_500
-      );
-      pollBME();
-    }
-  }
-
-  // Initialize PMS5003 on Serial2
+    initMslpTable();
+    gBmeOk = hal::envBegin();
+    if (gBmeOk && BME280Config::FORCED_MODE) {
+      gBmeOk = hal::envTrigger();
+      delay(hal::ENV_MEASURE_MS);
+    }
+    if (gBmeOk) pollBME();
+  }
+
+  // Initialize PMS5003 on UART1
   if (PMS5003Config::ENABLE) {
-    Serial2.begin(9600, SERIAL_8N1, PMS5003Config::RX_PIN, PMS5003Config::TX_PIN);
+    hal::pmsBegin();
     gPmsOk = true;  // Sensor ready (no handshake needed)
     Serial.println("PMS5003 UART initialized");
   }
@@ -2360,47 +6563,60 @@ void setup() {
   gTodayMidnightEpoch = localMidnight(nowE);
   deleteOldDailyFileIfNeeded(gTodayMidnightEpoch);
 
+  // Rows that were still buffered at the last reset go to their day files first
+  replayLogJournal();
+  mqttBegin();
+
   // Remove stale cache file if it exists
-  if (gSdOk && SD.exists("/data/day_summaries_cache.csv")) {
-    SD.remove("/data/day_summaries_cache.csv");
+  if (gSdOk && hal::storage().exists("/data/day_summaries_cache.csv")) {
+    hal::storage().remove("/data/day_summaries_cache.csv");
   }
 
-  // Always load fresh from SD to avoid stale cache issues
-  loadDaySummariesFromSD(nowE);
-  loadRecentBucketsFromSD(nowE);
-
   time_t aligned = floorToBucketBoundaryLocal(nowE);
   startBucketAt(aligned);
 
-  gLastPpsMillis = millis();
-  gLastBmePollMillis = millis();
-  gLastPmsPollMillis = millis();
+  // History (days, RAM buckets, rollups) is read from SD by loop() in slices
+  // once the server and the acquisition task are running
+  startHistoryBackfill(aligned);
 
   // routes
-  server.on("/", handleRoot);
-  server.on("/root.js", handleRootJs);
-  server.on("/api/now", handleApiNow);
-  server.on("/api/buckets", handleApiBuckets);
-  server.on("/api/buckets_compact", handleApiBucketsCompact);  // Compact format for internal UI
-  server.on("/api/days", handleApiDays);
-  server.on("/api/config", handleApiConfig);
-  server.on("/api/ui_files", handleApiUiFiles);
-  server.on("/api_help", handleApiHelp);
-  server.on("/api/clear_data", HTTP_POST, handleApiClearData);
-  server.on("/api/delete", HTTP_POST, handleApiDelete);
-  server.on("/api/reboot", HTTP_POST, handleApiReboot);
-
-  server.on("/api/files", handleApiFiles);
-  server.on("/download", handleDownload);
-  server.on("/download_zip", handleDownloadZip);
-  server.on("/upload", HTTP_GET, handleUploadPage);
-  server.on("/upload", HTTP_POST, handleUploadComplete, handleUploadData);
-
+  onRoute("/", handleRoot);
+  onRoute("/root.js", handleRootJs);
+  onRoute("/api/now", handleApiNow);
+  onRoute("/api/stream", handleApiStream);
+#if METRICS_ENABLE
+  onRoute("/api/metrics", handleApiMetrics);
+#endif
+  onRoute("/api/buckets", handleApiBuckets);
+  onRoute("/api/buckets_compact", handleApiBucketsCompact);  // Compact format for internal UI
+  onRoute("/api/buckets.bin", handleApiBucketsBin);  // Binary columnar format for internal UI
+  onRoute("/api/series", handleApiSeries);
+  onRoute("/api/days", handleApiDays);
+  onRoute("/api/histogram", handleApiHistogram);
+  onRoute("/api/range", handleApiRange);
+  onRoute("/api/config", handleApiConfig);
+  onRoute("/api/ui_files", handleApiUiFiles);
+  onRoute("/api_help", handleApiHelp);
+  onRoute("/api/clear_data", HTTP_POST, handleApiClearData);
+  onRoute("/api/delete", HTTP_POST, handleApiDelete);
+  onRoute("/api/reboot", HTTP_POST, handleApiReboot);
+
+  onRoute("/api/files", handleApiFiles);
+  onRoute("/download", handleDownload);
+  onRoute("/download_zip", handleDownloadZip);
+  onRoute("/upload", HTTP_GET, handleUploadPage);
+  onRoute("/upload", HTTP_POST, handleUploadComplete, handleUploadData);
+
+  static const char* kRequestHeaders[] = {"If-None-Match", "Accept-Encoding", "Range", "If-Range"};
+  server.collectHeaders(kRequestHeaders, sizeof(kRequestHeaders) / sizeof(kRequestHeaders[0]));
   server.begin();
+  gBoot.httpReadyMs = millis();
 
   ArduinoOTA.setHostname("anemometer");
   ArduinoOTA.setPassword(OTA_PASSWORD);
   ArduinoOTA.onStart([]() {
+    flushLogBuffer();
+    mqttSpillRam();
   });
   ArduinoOTA.onError([](ota_error_t error) {
     (void)error;
@@ -2409,21 +6625,31 @@ void setup() {
 
   // Attach pulse interrupt after all initialization to avoid counting noise during boot
   gLastPulseMicros = micros();
-  gPulseCount = 0;
+  gPulseTail = gPulseHead;
+  gWindPulses.reset(gLastPulseMicros);
   attachInterrupt(digitalPinToInterrupt(WindConfig::PULSE_PIN), onPulse, RISING);
+
+  // From here on the sensors and bucket accumulators belong to the acquisition task
+  gLastPpsMillis = millis();
+  gLastBmePollMillis = gLastPpsMillis;
+  gLastPmsPollMillis = gLastPpsMillis;
+  publishLiveSnapshot();
+  if (xTaskCreate(acquisitionTask, "acq", AcqConfig::STACK_BYTES, nullptr, AcqConfig::PRIORITY, &gAcqTask) != pdPASS) {
+    delay(500);
+    ESP.restart();
+  }
 }
 
 void loop() {
+  METRIC_SCOPE(loop);
   server.handleClient();
   ArduinoOTA.handle();
 
-  uint32_t msNow = millis();
-
-  updateWindPPS(msNow);
-  pollBMEIfNeeded(msNow);
-  pollPMSIfNeeded(msNow);
-
-  time_t nowE = epochNow();
-  maybeRolloverDay(nowE);
-  processBucketCatchup(nowE);
+  // Closed buckets are committed before the day rolls over so the last one lands in that day's summary
+  drainClosedBuckets();
+  flushLogBufferIfDue(millis());
+  pumpLiveStream(millis());
+  pumpDownloads(millis());
+  mqttStep(millis());
+  backfillStep();
 }
@@ -8,7 +8,10 @@ function debugLog(msg, data = null) {
   console.log(msg, data || '');
 }
 
-async function fetchJSON(url, { timeoutMs = 6000 } = {}){
+// url -> {etag, data} for responses fetched with revalidate
+const etagCache = new Map();
+
+async function fetchJSON(url, { timeoutMs = 6000, revalidate = false } = {}){
   // Use AbortController for proper timeout handling
   const useAbort = typeof AbortController !== 'undefined';
   const ctrl = useAbort ? new AbortController() : null;
@@ -19,7 +22,10 @@ async function fetchJSON(url, { timeoutMs = 6000 } = {}){
   try{
     debugLog(`Fetching ${url}...`);
 
-    const fetchPromise = fetch(url, {cache:"no-store", signal: signal});
+    // revalidate: send the last ETag; a 304 returns the cached (same) object
+    const cached = revalidate ? etagCache.get(url) : null;
+    const headers = cached ? {"If-None-Match": cached.etag} : {};
+    const fetchPromise = fetch(url, {cache:"no-store", signal: signal, headers: headers});
 
     let r;
     if (useAbort) {
@@ -37,6 +43,7 @@ async function fetchJSON(url, { timeoutMs = 6000 } = {}){
     }
 
     debugLog(`Response ${url}`, {status: r.status, ok: r.ok});
+    if (r.status === 304 && cached) return cached.data;
     let txt = await r.text();
     debugLog(`Response length: ${txt.length} chars`);
     if (!r.ok) throw new Error(`${url}: ${r.status}`);
@@ -44,6 +51,8 @@ async function fetchJSON(url, { timeoutMs = 6000 } = {}){
       txt = txt.replace(/,(\s*,)+/g, ',').replace(/,(\s*)\]/g, '$1]').replace(/\[(\s*),/g, '[$1');
       const parsed = JSON.parse(txt);
       debugLog(`Parsed JSON from ${url}`);
+      const etag = revalidate ? r.headers.get("ETag") : null;
+      if (etag) etagCache.set(url, {etag: etag, data: parsed});
       return parsed;
     }catch(e){
       debugLog(`Parse error ${url}`, {error: e.message, sample: txt.substring(0, 200)});
@@ -817,8 +826,10 @@ function plotTouchEnd(key, evt) {
   setResetButtonVisible(true);
 }
 
-// Current zoom level in hours (default 24)
+// Current zoom level in hours (default 24). Levels above 24h come from
+// /api/series (device-side rollups) instead of the raw 24h buckets.
 let currentZoomLevel = 24;
+const RAW_RANGE_HOURS = 24;
 // Track if user has manually zoomed via drag (away from preset)
 let hasManualZoom = false;
 
@@ -827,7 +838,7 @@ function loadZoomLevelFromCookie() {
   const saved = getCookie('zoomLevel');
   if (saved) {
     const parsed = parseInt(saved, 10);
-    if ([1, 3, 6, 12, 24].includes(parsed)) {
+    if ([1, 3, 6, 12, 24, 168, 720].includes(parsed)) {
       currentZoomLevel = parsed;
     }
   }
@@ -863,12 +874,26 @@ function resetZoom(key){
 function setZoomLevel(hours, saveToStorage = true){
   // Save the selected zoom level
   if (saveToStorage) {
+    const prevLevel = currentZoomLevel;
     currentZoomLevel = hours;
     saveZoomLevelToCookie(hours);
     // Clicking a preset clears manual zoom
     hasManualZoom = false;
     setResetButtonVisible(false);
     updateActiveZoomButton(hours);
+
+    // Different data source: drop zoom state and refetch before applying
+    if (hours !== prevLevel && (hours > RAW_RANGE_HOURS || prevLevel > RAW_RANGE_HOURS)) {
+      PLOT_KEYS.forEach(plotKey => {
+        const state = plotState[plotKey];
+        if (state) {
+          state.zoomXDomain = null;
+          state.originalXDomain = null;
+        }
+      });
+      slowTick().then(() => setZoomLevel(hours, false));
+      return;
+    }
   }
 
   // Get current time from any plot's data, or use system time
@@ -998,8 +1023,9 @@ function renderXAxis(axisId, xDomain, dims = chartDims){
     const d = new Date(t * 1000);
     const hh = d.getHours().toString().padStart(2, "0");
     const mm = d.getMinutes().toString().padStart(2, "0");
+    const label = span > 2 * 86400 ? `${d.getDate()}/${d.getMonth() + 1}` : `${hh}:${mm}`;
     html += `<line x1="${x.toFixed(1)}" y1="${baseY}" x2="${x.toFixed(1)}" y2="${(baseY+4)}" stroke-width="1"/>`;
-    html += `<text x="${x.toFixed(1)}" y="${(baseY+14)}" text-anchor="middle" transform="scale(${textScale.toFixed(3)}, 1)" transform-origin="${x.toFixed(1)} ${(baseY+14)}">${hh}:${mm}</text>`;
+    html += `<text x="${x.toFixed(1)}" y="${(baseY+14)}" text-anchor="middle" transform="scale(${textScale.toFixed(3)}, 1)" transform-origin="${x.toFixed(1)} ${(baseY+14)}">${label}</text>`;
   }
   axis.innerHTML = html;
 }
@@ -1304,8 +1330,9 @@ function wifiQuality(rssi){
   return "Weak";
 }
 
+// The device pages its file catalog (newest first); only the shown page is fetched
 const filesState = {
-  data: { offset: 0, total: 0, files: [] }
+  data: { page: 1, pages: 0, total: 0, retry: null }
 };
 
 async function loadFiles(dir){
@@ -1319,39 +1346,40 @@ async function loadFiles(dir){
   target.textContent = "Loading...";
 
   try{
-    const j = await fetchJSON(`/api/files?dir=${encodeURIComponent(dir)}`);
+    const st = filesState[dir];
+    clearTimeout(st.retry);
+    const j = await fetchJSON(`/api/files?dir=${encodeURIComponent(dir)}&page=${st.page}&per_page=${FILES_PER_PAGE}`);
     if (!j.ok){
       target.textContent = `Error: ${j.error || 'unknown'}`;
       if (navEl) navEl.style.display = "none";
       return;
     }
-    const files = (j.files || []).slice().sort((a,b)=> (b.path||'').localeCompare(a.path||''));
-
-    filesState[dir].files = files;
-    filesState[dir].total = files.length;
+    // The list is read from the card in the background after boot
+    if (j.loading) st.retry = setTimeout(() => loadFiles(dir), 3000);
+
+    st.total = j.total || 0;
+    st.pages = j.pages || 0;
+    if (st.pages > 0 && st.page > st.pages) {
+      st.page = st.pages;
+      return loadFiles(dir);
+    }
+    const files = j.files || [];
 
     if (!files.length){
-      target.textContent = "(none)";
+      target.textContent = j.loading ? "Loading..." : "(none)";
       if (navEl) navEl.style.display = "none";
       return;
     }
 
     if (navEl) {
-      navEl.style.display = files.length > FILES_PER_PAGE ? "flex" : "none";
+      navEl.style.display = st.pages > 1 ? "flex" : "none";
     }
 
-    const maxOffset = Math.max(0, files.length - FILES_PER_PAGE);
-    if (filesState[dir].offset > maxOffset) filesState[dir].offset = maxOffset;
-    if (filesState[dir].offset < 0) filesState[dir].offset = 0;
-
-    const offset = filesState[dir].offset;
-    const pageFiles = files.slice(offset, offset + FILES_PER_PAGE);
-
     // Create list safely using DOM APIs instead of innerHTML
     const ul = document.createElement('ul');
     ul.style.cssText = 'margin:8px 0; padding-left:18px';
 
-    for (const f of pageFiles){
+    for (const f of files){
       const p = f.path;
       const filename = p.substring(p.lastIndexOf('/') + 1);
       const s = bytesPretty(f.size);
@@ -1386,25 +1414,21 @@ async function loadFiles(dir){
     target.textContent = '';
     target.appendChild(ul);
 
-    const totalPages = Math.ceil(files.length / FILES_PER_PAGE);
-    const currentPage = Math.floor(offset / FILES_PER_PAGE) + 1;
-
+    const offset = (st.page - 1) * (j.per_page || FILES_PER_PAGE);
     if (infoEl) {
-      const start = offset + 1;
-      const end = Math.min(offset + FILES_PER_PAGE, files.length);
-      infoEl.textContent = `${start}-${end} of ${files.length}`;
+      infoEl.textContent = `${offset + 1}-${offset + files.length} of ${st.total}`;
     }
-    if (prevBtn) prevBtn.disabled = offset === 0;
-    if (nextBtn) nextBtn.disabled = offset + FILES_PER_PAGE >= files.length;
+    if (prevBtn) prevBtn.disabled = st.page <= 1;
+    if (nextBtn) nextBtn.disabled = st.page >= st.pages;
 
     const pageSelector = document.getElementById(`files_${dir}_page`);
     if (pageSelector) {
       pageSelector.innerHTML = '';
-      for (let i = 1; i <= totalPages; i++) {
+      for (let i = 1; i <= st.pages; i++) {
         const option = document.createElement('option');
         option.value = i;
         option.textContent = `Page ${i}`;
-        if (i === currentPage) option.selected = true;
+        if (i === st.page) option.selected = true;
         pageSelector.appendChild(option);
       }
     }
@@ -1416,21 +1440,22 @@ async function loadFiles(dir){
 }
 
 function navigateFiles(dir, delta){
-  filesState[dir].offset += delta * FILES_PER_PAGE;
+  filesState[dir].page = Math.max(1, filesState[dir].page + delta);
   loadFiles(dir);
 }
 
 function goToPage(dir, pageNum){
   const page = parseInt(pageNum, 10);
   if (!isFinite(page) || page < 1) return;
-  filesState[dir].offset = (page - 1) * FILES_PER_PAGE;
+  filesState[dir].page = page;
   loadFiles(dir);
 }
 
 function downloadZip(){
   const n = parseInt(document.getElementById("zipdays").value || "7", 10);
   const days = (isFinite(n) && n > 0) ? n : 7;
-  window.location = `/download_zip?days=${encodeURIComponent(days)}`;
+  const deflate = document.getElementById("zipdeflate").checked;
+  window.location = `/download_zip?days=${encodeURIComponent(days)}` + (deflate ? "&method=deflate" : "");
 }
 
 async function deleteFile(filename, dir){
@@ -1450,7 +1475,7 @@ async function deleteFile(filename, dir){
     const txt = await res.text();
     if (res.ok){
       alert("File deleted.");
-      filesState[dir].offset = 0;
+      filesState[dir].page = 1;
       loadFiles(dir);
     } else {
       alert("Delete failed: " + txt);
@@ -1476,7 +1501,7 @@ async function clearSdData(){
     const txt = await res.text();
     if (res.ok){
       alert("SD data cleared.");
-      filesState.data.offset = 0;
+      filesState.data.page = 1;
       loadFiles('data');
     } else {
       alert("Failed to clear SD data: " + txt);
@@ -1647,6 +1672,27 @@ function updateCurrentReadings(now) {
 let tickCount = 0;
 let isFastTickRunning = false;
 let isSlowTickRunning = false;
+let slowTickQueued = false;
+let lastDeviceEpoch = 0;
+// Raw 24h buckets by epoch, kept in sync with ?since= deltas
+const bucketCache = new Map();
+let bucketCursor = 0;
+let lastDaysRes = null;
+// The device reads its history in the background after boot ("loading" in
+// /api/now); once it is done the plots are refetched in full, since ?since=
+// deltas never bring back the older buckets it filled in.
+let historyLoading = false;
+
+function noteHistoryLoading(res) {
+  if (!res || !("loading" in res)) return;
+  const loading = res.loading !== false;
+  if (historyLoading && !loading) {
+    debugLog('History loaded, refetching plots');
+    bucketCursor = 0;
+    slowTick();
+  }
+  historyLoading = loading;
+}
 
 async function fastTick() {
   // Prevent overlapping requests
@@ -1659,6 +1705,7 @@ async function fastTick() {
   try {
     const nowRes = await fetchJSON("/api/now", { timeoutMs: 12000 });
     updateCurrentReadings(nowRes);
+    noteHistoryLoading(nowRes);
   } catch(e) {
     console.warn("fastTick", e);
   } finally {
@@ -1666,66 +1713,247 @@ async function fastTick() {
   }
 }
 
+// Live readings from /api/stream (Server-Sent Events): "now" every second,
+// "status" every 10 s, "bucket" when a bucket is finalized. While the stream is
+// open the 2 s /api/now poll and the 14 s plot refresh are skipped; if the device
+// refuses it (all stream slots taken) or it drops for good, polling takes over
+// and the stream is retried later.
+const STREAM_RETRY_MS = 60000;
+let liveStream = null;
+let liveState = {};
+let streamRetryAt = 0;
+
+function startLiveStream() {
+  if (typeof EventSource === 'undefined' || liveStream || Date.now() < streamRetryAt) return;
+  const es = new EventSource("/api/stream");
+  liveStream = es;
+  const onReadings = (e) => {
+    try {
+      Object.assign(liveState, JSON.parse(e.data));
+      updateCurrentReadings(liveState);
+      noteHistoryLoading(liveState);
+    } catch (err) {
+      console.warn("stream", err);
+    }
+  };
+  es.addEventListener("now", onReadings);
+  es.addEventListener("status", onReadings);
+  es.addEventListener("bucket", () => slowTick());
+  es.onerror = () => {
+    // CONNECTING: the browser retries by itself; CLOSED: refused, fall back to polling
+    if (es.readyState === EventSource.CLOSED) {
+      debugLog('Live stream closed, polling');
+      liveStream = null;
+      streamRetryAt = Date.now() + STREAM_RETRY_MS;
+    }
+  };
+}
+
+function streamIsLive() {
+  return liveStream !== null && liveStream.readyState === EventSource.OPEN;
+}
+
+function renderAllPlots(series) {
+  debugLog('Rendering plots');
+  renderWind(series);
+  renderSingleSeries(series, "avgTempC", "line_temp", "#d9534f", "axis_temp", "axis_x_temp");
+  renderSingleSeries(series, "avgHumRH", "line_hum", "#0275d8", "axis_hum", "axis_x_hum");
+  renderSingleSeries(series, "avgPressHpa", "line_press", "#5cb85c", "axis_press", "axis_x_press");
+  renderPM(series);
+  debugLog('Plots rendered');
+}
+
+function seriesUrl(hours) {
+  const to = lastDeviceEpoch || Math.floor(Date.now() / 1000);
+  return `/api/series?from=${to - hours * 3600}&to=${to + 60}&points=${MAX_PLOT_POINTS}`;
+}
+
+// /api/series rows: [epoch, avgWind, maxWind, avgTemp, minTemp, maxTemp, avgHum, minHum, maxHum,
+//                    avgPress, minPress, maxPress, avgPM1, maxPM1, avgPM25, maxPM25, avgPM10, maxPM10]
+function seriesFromApi(res) {
+  const rows = Array.isArray(res.points) ? res.points : [];
+  return rows.filter(r => Array.isArray(r) && r.length >= 18).map(r => ({
+    startEpoch: r[0],
+    avgWind: r[1],
+    maxWind: r[2],
+    samples: 0,
+    avgTempC: r[3],
+    avgHumRH: r[6],
+    avgPressHpa: r[9],
+    avgPM1: r[12],
+    avgPM25: r[14],
+    avgPM10: r[16]
+  }));
+}
+
+async function fetchBinary(url, { timeoutMs = 6000 } = {}){
+  const ctrl = typeof AbortController !== 'undefined' ? new AbortController() : null;
+  const timeoutId = ctrl ? setTimeout(() => ctrl.abort(), timeoutMs) : null;
+  try {
+    const r = await fetch(url, {cache:"no-store", signal: ctrl ? ctrl.signal : undefined});
+    if (!r.ok) throw new Error(`${url}: ${r.status}`);
+    return await r.arrayBuffer();
+  } catch (e) {
+    if (e.name === "AbortError") throw new Error(`timeout ${url}`);
+    throw e;
+  } finally {
+    if (timeoutId) clearTimeout(timeoutId);
+  }
+}
+
+// Decodes /api/buckets.bin into typed columns (see handleApiBucketsBin):
+// {nowEpoch, cursor, bucketSeconds, count, epochs, samples, values[8]}, values in
+// compact-array order (avgWind, maxWind, tempC, humRH, pressHpa, pm1, pm25, pm10), NaN = no data
+function decodeBucketsBin(buf) {
+  const dv = new DataView(buf);
+  if (buf.byteLength < 24 || String.fromCharCode(dv.getUint8(0), dv.getUint8(1), dv.getUint8(2), dv.getUint8(3)) !== "WSBB") {
+    throw new Error("buckets.bin: bad magic");
+  }
+  if (dv.getUint16(4, true) !== 1) throw new Error("buckets.bin: unsupported version");
+  const nCols = dv.getUint16(6, true);
+  const count = dv.getUint32(8, true);
+  const out = {
+    nowEpoch: dv.getUint32(12, true),
+    cursor: dv.getUint32(16, true),
+    bucketSeconds: dv.getUint16(20, true),
+    count: count,
+    epochs: new Uint32Array(count),
+    samples: null,
+    values: []
+  };
+  const epochBytes = dv.getUint16(22, true);
+  let off = 24;
+  const cols = [];
+  for (let c = 0; c < nCols; c++, off += 4) cols.push({scale: dv.getInt16(off, true), offset: dv.getInt16(off + 2, true)});
+  if (off + epochBytes + count * 2 * (nCols + 1) > buf.byteLength) throw new Error("buckets.bin: truncated");
+
+  // Epochs: LEB128 varints, first absolute then deltas
+  let p = off, epoch = 0;
+  for (let i = 0; i < count; i++) {
+    let d = 0, shift = 0, b;
+    do { b = dv.getUint8(p++); d += (b & 0x7f) * Math.pow(2, shift); shift += 7; } while (b & 0x80);
+    epoch += d;
+    out.epochs[i] = epoch;
+  }
+  off += epochBytes;
+  out.samples = new Uint16Array(buf, off, count);
+  off += count * 2;
+  cols.forEach(c => {
+    const q = new Int16Array(buf, off, count);
+    const v = new Float32Array(count);
+    for (let i = 0; i < count; i++) v[i] = q[i] === -32768 ? NaN : q[i] / c.scale + c.offset;
+    out.values.push(v);
+    off += count * 2;
+  });
+  return out;
+}
+
+// Same columns from the JSON endpoint (firmware without /api/buckets.bin)
+function bucketsFromCompact(res) {
+  const rows = (Array.isArray(res.buckets) ? res.buckets : []).filter(b => Array.isArray(b) && b.length >= 7);
+  const num = x => (x === null || x === undefined ? NaN : x);
+  return {
+    nowEpoch: res.now_epoch,
+    cursor: res.cursor,
+    bucketSeconds: res.bucket_seconds,
+    count: rows.length,
+    epochs: rows.map(b => b[0]),
+    samples: rows.map(b => b[3] || 0),
+    values: [1, 2, 4, 5, 6, 7, 8, 9].map(k => Float64Array.from(rows, b => num(b[k])))
+  };
+}
+
+let useBinaryBuckets = true;
+
+// Last 24h of buckets, or only those after bucketCursor, as decoded columns
+async function fetchRecentBuckets() {
+  const query = bucketCursor ? `?since=${bucketCursor}` : "";
+  if (useBinaryBuckets) {
+    try {
+      return decodeBucketsBin(await fetchBinary(`/api/buckets.bin${query}`, { timeoutMs: 20000 }));
+    } catch (e) {
+      if (!/: 404$/.test(e.message)) throw e;
+      debugLog('No /api/buckets.bin, using JSON');
+      useBinaryBuckets = false;
+    }
+  }
+  return bucketsFromCompact(await fetchJSON(`/api/buckets_compact${query}`, { timeoutMs: 20000 }));
+}
+
 async function slowTick() {
   // Prevent overlapping requests
   if (isSlowTickRunning) {
     debugLog('Skipping slowTick - already running');
+    slowTickQueued = true;
     return;
   }
 
   isSlowTickRunning = true;
   try {
+    const longRange = currentZoomLevel > RAW_RANGE_HOURS;
     const [bucketsRes, daysRes] = await Promise.allSettled([
-      fetchJSON("/api/buckets_compact", { timeoutMs: 20000 }),
-      fetchJSON("/api/days", { timeoutMs: 20000 })
+      longRange ? fetchJSON(seriesUrl(currentZoomLevel), { timeoutMs: 20000 })
+                : fetchRecentBuckets(),
+      fetchJSON("/api/days", { timeoutMs: 20000, revalidate: true })
     ]);
 
-    if (bucketsRes.status === "fulfilled") {
-      debugLog('Buckets received', {count: bucketsRes.value.buckets?.length});
-      let series = Array.isArray(bucketsRes.value.buckets) ? bucketsRes.value.buckets : [];
-      series = series.filter(b => Array.isArray(b) && b.length >= 7);
-      debugLog('Valid buckets', {count: series.length});
+    if (longRange && bucketsRes.status === "fulfilled") {
+      const series = seriesFromApi(bucketsRes.value);
+      debugLog('Series received', {count: series.length, bin: bucketsRes.value.bin_seconds});
+      document.getElementById("bucket_sec").textContent = bucketsRes.value.bin_seconds || "--";
+      renderAllPlots(series);
+    } else if (bucketsRes.status === "fulfilled") {
+      const res = bucketsRes.value;
+      debugLog('Buckets received', {count: res.count, since: bucketCursor, binary: useBinaryBuckets});
 
       // Get current time and calculate 24h cutoff
-      const nowEpoch = bucketsRes.value.now_epoch || Math.floor(Date.now() / 1000);
+      const nowEpoch = res.nowEpoch || Math.floor(Date.now() / 1000);
+      // Full responses (no cursor sent, older firmware, device clock moved back) replace the cache
+      if (!bucketCursor || typeof res.cursor !== "number" || nowEpoch < lastDeviceEpoch) bucketCache.clear();
+      lastDeviceEpoch = nowEpoch;
+      bucketCursor = typeof res.cursor === "number" ? res.cursor : 0;
       const cutoff24h = nowEpoch - 86400;  // 24 hours ago
 
-      series = series.map(b => {
-        return {
-          startEpoch: b[0],
-          avgWind: b[1],
-          maxWind: b[2],
-          samples: b[3] || 0,
-          avgTempC: b[4],
-          avgHumRH: b[5],
-          avgPressHpa: b[6],
-          avgPM1: b.length > 7 ? b[7] : null,
-          avgPM25: b.length > 8 ? b[8] : null,
-          avgPM10: b.length > 9 ? b[9] : null
-        };
-      });
+      // Merge; the in-progress bucket is resent (and replaced) until it is finalized
+      const v = res.values;
+      const val = (col, i) => (isNaN(v[col][i]) ? null : v[col][i]);
+      for (let i = 0; i < res.count; i++) {
+        bucketCache.set(res.epochs[i], {
+          startEpoch: res.epochs[i],
+          avgWind: val(0, i),
+          maxWind: val(1, i),
+          samples: res.samples[i],
+          avgTempC: val(2, i),
+          avgHumRH: val(3, i),
+          avgPressHpa: val(4, i),
+          avgPM1: val(5, i),
+          avgPM25: val(6, i),
+          avgPM10: val(7, i)
+        });
+      }
 
       // Filter to only show last 24 hours
-      series = series.filter(b => b.startEpoch >= cutoff24h);
+      for (const epoch of bucketCache.keys()) {
+        if (epoch < cutoff24h) bucketCache.delete(epoch);
+      }
+      const series = Array.from(bucketCache.values()).sort((a, b) => a.startEpoch - b.startEpoch);
       debugLog('Filtered to last 24h', {count: series.length});
 
       if (series.length > 0) debugLog('Sample data', series[0]);
-      const bucketSeconds = bucketsRes.value.bucket_seconds || "--";
+      const bucketSeconds = res.bucketSeconds || "--";
       document.getElementById("bucket_sec").textContent = bucketSeconds;
-      debugLog('Rendering plots');
-      renderWind(series);
-      renderSingleSeries(series, "avgTempC", "line_temp", "#d9534f", "axis_temp", "axis_x_temp");
-      renderSingleSeries(series, "avgHumRH", "line_hum", "#0275d8", "axis_hum", "axis_x_hum");
-      renderSingleSeries(series, "avgPressHpa", "line_press", "#5cb85c", "axis_press", "axis_x_press");
-      renderPM(series);
-      debugLog('Plots rendered');
+      renderAllPlots(series);
     } else {
       debugLog("Buckets failed", {error: bucketsRes.reason?.message});
     }
 
     if (daysRes.status === "fulfilled") {
       if (!Array.isArray(daysRes.value.days)) throw new Error("days array missing");
-      renderDays(daysRes.value.days);
+      // Unchanged (304) responses come back as the same object
+      if (daysRes.value !== lastDaysRes) {
+        lastDaysRes = daysRes.value;
+        renderDays(daysRes.value.days);
+      }
     } else {
       console.warn("days", daysRes.reason);
     }
@@ -1733,11 +1961,17 @@ async function slowTick() {
     console.warn("slowTick", e);
   } finally {
     isSlowTickRunning = false;
+    if (slowTickQueued) {
+      slowTickQueued = false;
+      await slowTick();
+    }
   }
 }
 
 function combinedTick() {
   tickCount++;
+  startLiveStream();
+  if (streamIsLive()) return;  // readings and bucket events arrive on the stream
 
   // Fast updates every tick (2s)
   fastTick();
@@ -1770,7 +2004,8 @@ function combinedTick() {
     setZoomLevel(currentZoomLevel, false);
     debugLog('Applied zoom level', {hours: currentZoomLevel});
 
-    // Then update current readings every 2s, plots every 14s (7 ticks)
+    // Then update current readings every 2s, plots every 14s (7 ticks), unless the live stream is up
+    startLiveStream();
     setInterval(combinedTick, 2000);
     loadFiles('data');
 